@@ -0,0 +1,382 @@
+/*
+ * Copyright 2019-2023 University of Toronto
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Authors: Mario Badr, Sameh Attia, Tanner Young-Schultz and Vaughn Betz
+ */
+
+/**
+ * Replays a draw capture (see ezgl/qt/draw_capture.hpp) headless against a
+ * renderer backend and reports where the time goes.
+ *
+ * Usage:
+ *   ezgl-replay <capture>                      — replay every frame with rhi
+ *   ezgl-replay <capture> --renderer <r>       — immediate, deferred, rhi (default: rhi)
+ *   ezgl-replay <capture> --frame <i>          — replay only frame i (0-based)
+ *   ezgl-replay <capture> --repeat <n>         — replay each frame n times (default: 3)
+ *   ezgl-replay <capture> --png                — also save each frame as a PNG
+ *   ezgl-replay --make-sample <capture> [n]    — record a synthetic n-primitive frame
+ *
+ * Stages reported per frame:
+ *   decode  — walking the capture into a renderer that does nothing
+ *   record  — the replayed draw callback against the backend's renderer
+ *   render  — everything after the callback: flush, rasterize / GPU, readback
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <QFile>
+
+#include "ezgl/application.hpp"
+#include "ezgl/graphics.hpp"
+#include "ezgl/logutils.hpp"
+#include "ezgl/qt/draw_capture.hpp"
+
+// ---- null renderer ----------------------------------------------------------
+
+// Accepts every call and does nothing; replaying into it times decoding alone.
+class null_renderer final : public ezgl::irenderer {
+public:
+  explicit null_renderer(const ezgl::capture_reader::frame_info &frame)
+      : irenderer(nullptr, {}, nullptr, nullptr)
+      , m_world(frame.visible_world)
+      , m_screen({0, 0}, double(frame.screen_width), double(frame.screen_height))
+  {
+  }
+
+  void set_coordinate_system(ezgl::t_coordinate_system) override {}
+  void set_visible_world(ezgl::rectangle) override {}
+  ezgl::rectangle get_visible_world() override { return m_world; }
+  ezgl::rectangle get_visible_screen() const override { return m_screen; }
+  ezgl::rectangle world_to_screen(const ezgl::rectangle &box) override { return box; }
+  void set_color(ezgl::color) override {}
+  void set_color(ezgl::color, uint_fast8_t) override {}
+  void set_color(uint_fast8_t, uint_fast8_t, uint_fast8_t, uint_fast8_t) override {}
+  void set_line_cap(ezgl::line_cap) override {}
+  void set_line_dash(ezgl::line_dash) override {}
+  void set_line_width(int) override {}
+  void set_font_size(double) override {}
+  void format_font(std::string const &, ezgl::font_slant, ezgl::font_weight) override {}
+  void format_font(std::string const &, ezgl::font_slant, ezgl::font_weight, double) override {}
+  void set_text_rotation(double) override {}
+  void set_horiz_justification(ezgl::justification) override {}
+  void set_vert_justification(ezgl::justification) override {}
+  void set_text_screen_offset(ezgl::point2d) override {}
+  void set_pick_id(std::uint32_t) override {}
+
+  void draw_line(const ezgl::point2d &, const ezgl::point2d &) override {}
+  void draw_rectangle(const ezgl::point2d &, const ezgl::point2d &) override {}
+  void draw_rectangle(const ezgl::point2d &, double, double) override {}
+  void draw_rectangle(const ezgl::rectangle &) override {}
+  void fill_rectangle(const ezgl::point2d &, const ezgl::point2d &) override {}
+  void fill_rectangle(const ezgl::point2d &, double, double) override {}
+  void fill_rectangle(const ezgl::rectangle &) override {}
+  void fill_poly(const std::vector<ezgl::point2d> &) override {}
+  void fill_triangle(const ezgl::point2d &, const ezgl::point2d &, const ezgl::point2d &) override {}
+  void fill_poly_with_holes(const std::vector<ezgl::point2d> &,
+                            const std::vector<std::vector<ezgl::point2d>> &) override {}
+  void fill_arrow_pointer_triangle(const ezgl::point2d &, const ezgl::point2d &, float) override {}
+  void draw_elliptic_arc(const ezgl::point2d &, double, double, double, double) override {}
+  void draw_arc(const ezgl::point2d &, double, double, double) override {}
+  void fill_elliptic_arc(const ezgl::point2d &, double, double, double, double) override {}
+  void fill_arc(const ezgl::point2d &, double, double, double) override {}
+  void draw_text(const ezgl::point2d &, std::string const &) override {}
+  void draw_text(const ezgl::point2d &, std::string const &, double, double) override {}
+  void draw_surface(ezgl::surface *, const ezgl::point2d &, double) override {}
+
+private:
+  ezgl::rectangle m_world;
+  ezgl::rectangle m_screen;
+};
+
+// ---- replay state -----------------------------------------------------------
+
+// draw_canvas_fn carries no state, so the callbacks read these.
+static const ezgl::capture_reader *g_reader      = nullptr;
+static std::size_t                 g_frame       = 0;
+static double                      g_record_ms   = 0.0;
+static bool                        g_replay_ok   = true;
+
+static void replay_frame(ezgl::renderer *g)
+{
+  ezgl::scope_timer timer;
+  g_replay_ok = g_reader->replay(g_frame, *g);
+  g_record_ms = timer.elapsed_ms();
+}
+
+struct stage_times {
+  double decode = 0.0;
+  double record = 0.0;
+  double render = 0.0;
+};
+
+static int replay_capture(const std::string &path, ezgl::renderer_type renderer,
+                          long only_frame, int repeat, bool save_png)
+{
+  // Map the file read-only; the reader decodes straight out of the mapping.
+  QFile file(QString::fromStdString(path));
+  if (!file.open(QIODevice::ReadOnly)) {
+    std::cerr << "Error: cannot open '" << path << "'\n";
+    return 1;
+  }
+  const uchar *data = file.map(0, file.size());
+  if (data == nullptr) {
+    std::cerr << "Error: cannot map '" << path << "'\n";
+    return 1;
+  }
+
+  const ezgl::capture_reader reader(data, std::size_t(file.size()));
+  if (reader.frame_count() == 0) {
+    std::cerr << "Error: '" << path << "' holds no replayable frames\n";
+    return 1;
+  }
+  if (only_frame >= long(reader.frame_count())) {
+    std::cerr << "Error: frame " << only_frame << " out of range [0,"
+              << reader.frame_count() - 1 << "]\n";
+    return 1;
+  }
+  g_reader = &reader;
+
+  ezgl::application::settings s;
+  static int   fake_argc    = 1;
+  static char  fake_argv0[] = "ezgl-replay";
+  static char *fake_argv[]  = {fake_argv0, nullptr};
+  ezgl::application app(s, fake_argc, fake_argv);
+
+  app.add_canvas("replay_canvas", replay_frame, reader.world(), ezgl::WHITE);
+  ezgl::canvas *c = app.get_canvas("replay_canvas");
+  c->set_renderer_type(renderer);
+
+  const char *rname = ezgl::renderer_type_name(renderer);
+  std::cout << path << ": " << reader.frame_count() << " frame(s), "
+            << file.size() << " bytes, renderer " << rname << "\n"
+            << std::fixed << std::setprecision(2)
+            << " frame        ops     bytes   decode ms   record ms   render ms    total ms\n";
+
+  const std::size_t first = only_frame < 0 ? 0 : std::size_t(only_frame);
+  const std::size_t last  = only_frame < 0 ? reader.frame_count() : first + 1;
+  stage_times       sum;
+  int               runs = 0;
+
+  for (std::size_t f = first; f < last; ++f) {
+    const ezgl::capture_reader::frame_info info = reader.frame(f);
+    const int w = std::max(1, info.screen_width);
+    const int h = std::max(1, info.screen_height);
+    g_frame     = f;
+
+    // Best of n: the first run also pays for backend creation and caches.
+    stage_times best{1e300, 1e300, 1e300};
+    for (int r = 0; r < repeat; ++r) {
+      null_renderer sink(info);
+      ezgl::scope_timer decode_timer;
+      reader.replay(f, sink);
+      const double decode_ms = decode_timer.elapsed_ms();
+
+      c->get_camera().set_world(info.visible_world);
+      ezgl::scope_timer total_timer;
+      c->draw_offscreen(w, h);
+      const double total_ms = total_timer.elapsed_ms();
+
+      best.decode = std::min(best.decode, decode_ms);
+      best.record = std::min(best.record, g_record_ms);
+      best.render = std::min(best.render, std::max(0.0, total_ms - g_record_ms));
+    }
+    if (!g_replay_ok)
+      std::cerr << "Warning: frame " << f << " is corrupt; timings cover the part before it\n";
+
+    if (save_png) {
+      const std::string png = "ezgl-replay_" + std::string(rname) + "_" + std::to_string(f) + ".png";
+      c->get_camera().set_world(info.visible_world);
+      c->print_png(png.c_str(), w, h);
+    }
+
+    std::cout << std::setw(6) << f
+              << std::setw(11) << info.ops
+              << std::setw(10) << info.bytes
+              << std::setw(12) << best.decode
+              << std::setw(12) << best.record
+              << std::setw(12) << best.render
+              << std::setw(12) << best.decode + best.record + best.render << "\n";
+
+    sum.decode += best.decode;
+    sum.record += best.record;
+    sum.render += best.render;
+    ++runs;
+  }
+
+  if (runs > 1) {
+    std::cout << "  mean" << std::setw(21) << ""
+              << std::setw(12) << sum.decode / runs
+              << std::setw(12) << sum.record / runs
+              << std::setw(12) << sum.render / runs
+              << std::setw(12) << (sum.decode + sum.record + sum.render) / runs << "\n";
+  }
+  return 0;
+}
+
+// ---- sample capture ---------------------------------------------------------
+
+static ezgl::capture_writer *g_writer    = nullptr;
+static int                   g_sample_n  = 100000;
+static const ezgl::rectangle SAMPLE_WORLD{{0, 0}, 1000.0, 1000.0};
+
+// A small mix of everything the format encodes: a grid of lines and
+// rectangles, a fan of arcs and a few labels.
+static void draw_sample(ezgl::renderer *target)
+{
+  ezgl::recording_renderer g(*target, *g_writer);
+
+  const int    cols = std::max(1, int(std::sqrt(double(g_sample_n))));
+  const double cell = SAMPLE_WORLD.width() / cols;
+
+  g.set_line_width(1);
+  for (int i = 0; i < g_sample_n; ++i) {
+    const double x = (i % cols) * cell;
+    const double y = (i / cols) * cell;
+    if (i % 2 == 0) {
+      g.set_color(ezgl::BLUE);
+      g.draw_line({x, y}, {x + cell * 0.8, y + cell * 0.8});
+    } else {
+      g.set_color(ezgl::RED, 128);
+      g.fill_rectangle({x + cell * 0.1, y + cell * 0.1}, {x + cell * 0.9, y + cell * 0.9});
+    }
+  }
+
+  g.set_color(ezgl::BLACK);
+  for (int i = 0; i < 16; ++i)
+    g.draw_arc({500, 500}, 50.0 + 20.0 * i, 0.0, 22.5 * i);
+
+  g.set_font_size(14);
+  g.set_coordinate_system(ezgl::SCREEN);
+  g.draw_text({100, 30}, "ezgl-replay sample");
+  g.set_coordinate_system(ezgl::WORLD);
+  g.draw_text({500, 500}, "center", 200, 50);
+}
+
+static int make_sample(const std::string &path, int n)
+{
+  ezgl::capture_writer writer(path, SAMPLE_WORLD);
+  if (!writer.is_open())
+    return 1;
+  g_writer   = &writer;
+  g_sample_n = n;
+
+  ezgl::application::settings s;
+  static int   fake_argc    = 1;
+  static char  fake_argv0[] = "ezgl-replay";
+  static char *fake_argv[]  = {fake_argv0, nullptr};
+  ezgl::application app(s, fake_argc, fake_argv);
+
+  app.add_canvas("sample_canvas", draw_sample, SAMPLE_WORLD, ezgl::WHITE);
+  ezgl::canvas *c = app.get_canvas("sample_canvas");
+  c->set_renderer_type(ezgl::renderer_type::immediate);
+  c->draw_offscreen(1000, 1000);
+
+  std::cout << "wrote " << writer.frames_written() << " frame(s), "
+            << writer.bytes_written() << " bytes to " << path << "\n";
+  return 0;
+}
+
+// ---- help / argument parsing -----------------------------------------------
+
+static void print_help(const char *prog)
+{
+  std::cout <<
+    "Usage:\n"
+    "  " << prog << " <capture> [options]      Replay a draw capture headless and time it\n"
+    "  " << prog << " --make-sample <capture> [N]\n"
+    "                                    Record a synthetic N-primitive frame (default 100000)\n"
+    "\n"
+    "Options:\n"
+    "  --renderer <r>      Select rendering backend (immediate | deferred | rhi)\n"
+    "  --frame <i>         Replay only frame i\n"
+    "  --repeat <n>        Replay each frame n times and report the best (default 3)\n"
+    "  --png               Save each replayed frame as a PNG\n"
+    "  --help              Show this message\n";
+}
+
+int main(int argc, char **argv)
+{
+  std::string          capture;
+  ezgl::renderer_type  renderer   = ezgl::renderer_type::rhi;
+  long                 only_frame = -1;
+  int                  repeat     = 3;
+  bool                 save_png   = false;
+
+  auto need_value = [&](int i, const char *what) {
+    if (i + 1 < argc)
+      return true;
+    std::cerr << "Error: " << what << " requires a value\n\n";
+    print_help(argv[0]);
+    return false;
+  };
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    try {
+      if (arg == "--help" || arg == "-h") {
+        print_help(argv[0]);
+        return 0;
+      } else if (arg == "--make-sample") {
+        if (!need_value(i, "--make-sample")) return 1;
+        const std::string out(argv[++i]);
+        const int n = i + 1 < argc ? std::stoi(argv[++i]) : 100000;
+        return make_sample(out, std::max(1, n));
+      } else if (arg == "--renderer") {
+        if (!need_value(i, "--renderer")) return 1;
+        std::string val(argv[++i]);
+        if (val == "immediate")      renderer = ezgl::renderer_type::immediate;
+        else if (val == "deferred")  renderer = ezgl::renderer_type::deferred;
+        else if (val == "rhi")       renderer = ezgl::renderer_type::rhi;
+        else {
+          std::cerr << "Error: unknown renderer '" << val
+                    << "' — expected immediate, deferred, or rhi\n\n";
+          print_help(argv[0]);
+          return 1;
+        }
+      } else if (arg == "--frame") {
+        if (!need_value(i, "--frame")) return 1;
+        only_frame = std::max(0L, std::stol(argv[++i]));
+      } else if (arg == "--repeat") {
+        if (!need_value(i, "--repeat")) return 1;
+        repeat = std::max(1, std::stoi(argv[++i]));
+      } else if (arg == "--png") {
+        save_png = true;
+      } else if (capture.empty() && arg.rfind("--", 0) != 0) {
+        capture = arg;
+      } else {
+        std::cerr << "Error: unknown argument '" << arg << "'\n\n";
+        print_help(argv[0]);
+        return 1;
+      }
+    } catch (...) {
+      std::cerr << "Error: bad value for '" << arg << "'\n\n";
+      print_help(argv[0]);
+      return 1;
+    }
+  }
+
+  if (capture.empty()) {
+    print_help(argv[0]);
+    return 1;
+  }
+  return replay_capture(capture, renderer, only_frame, repeat, save_png);
+}
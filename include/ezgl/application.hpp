@@ -446,9 +446,10 @@ public:
   void change_canvas_world_coordinates(std::string const &canvas_id, rectangle coordinate_system);
 
   /**
-   * redraw the main canvas 
-   * 
-   * Useful to force an immediate redraw when you want a different graphics display
+   * redraw the main canvas
+   *
+   * Useful when you want a different graphics display. The redraw runs at the next display refresh, together with
+   * any pan/zoom since the last one; use flush_drawing() if it must happen before returning.
    */
   void refresh_drawing();
 
@@ -24,15 +24,24 @@
 #include "ezgl/graphics.hpp"
 #include "ezgl/color.hpp"
 #include "ezgl/qt/qtutils.hpp"
+#include "ezgl/qt/camera_animator.hpp"
+#include "ezgl/qt/frame_scheduler.hpp"
 #include "ezgl/qt/render_backend.hpp"
+#include "ezgl/qt/scene_scratch.hpp"
 
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <span>
 #include <string>
+#include <vector>
 
 namespace ezgl {
 
+enum class vector_format;
+
 /**** Functions in this class are for ezgl internal use; application code doesn't need to call them ****/
 
 /**
@@ -47,9 +56,9 @@ namespace ezgl {
 class canvas {
 public:
   /**
-   * Destructor.
+   * Destructor. Ends an image sequence still in progress.
    */
-  ~canvas() = default;
+  ~canvas();
 
   /**
    * Get the name (identifier) of the canvas.
@@ -85,6 +94,81 @@ public:
    */
   void redraw_camera_only();
 
+  /**
+   * Schedule a full redraw for the next display refresh instead of running it now.
+   *
+   * Any number of requests (full or camera-only) before that refresh result in a single redraw; full wins over
+   * camera-only. The built-in pan/zoom handlers and application::refresh_drawing() use this so that high-rate mice
+   * and trackpads cost one redraw per displayed frame. Before initialize() has given the canvas its drawing area it
+   * redraws immediately; after that a request always waits for the next tick, even while the canvas is hidden.
+   */
+  void request_redraw();
+
+  /**
+   * Schedule a camera-only redraw for the next display refresh. See request_redraw().
+   */
+  void request_redraw_camera_only();
+
+  /**
+   * Run a scheduled redraw now, if one is pending.
+   */
+  void flush_scheduled_redraw();
+
+  /**
+   * Move the visible world to @p world. With smooth zoom enabled the camera glides there over the configured duration:
+   * intermediate frames only update the transform (the rhi backend reprojects the last text/arc overlay on the GPU)
+   * and the overlay is laid out again once the camera settles. Otherwise the camera jumps and a camera-only redraw is
+   * scheduled. The built-in zoom controls use this.
+   */
+  void animate_camera_to(rectangle world);
+
+  /**
+   * Keep panning at @p world_per_second, slowing down until the view comes to rest. No-op unless kinetic pan is
+   * enabled. Used on release of a drag-pan.
+   */
+  void fling_camera(point2d world_per_second);
+
+  /**
+   * Stop a running camera animation where it is, e.g. when the user grabs the view.
+   */
+  void stop_camera_animation();
+
+  /**
+   * Where the camera ends up once the running animation finishes (the current world if none runs). Successive zoom
+   * steps compose on this, so fast wheel input is not lost to an animation in progress.
+   */
+  rectangle camera_target_world() const
+  {
+    return m_camera_animator.target_world();
+  }
+
+  /**
+   * Smooth zoom duration in milliseconds; 0 (the default) makes zoom and zoom-fit jump immediately.
+   */
+  void set_smooth_zoom(int duration_ms)
+  {
+    m_smooth_zoom_ms = duration_ms;
+  }
+
+  int smooth_zoom() const
+  {
+    return m_smooth_zoom_ms;
+  }
+
+  /**
+   * Kinetic pan: after a drag-pan is released while still moving, the view keeps gliding and decelerates. Off by
+   * default.
+   */
+  void set_kinetic_pan(bool enabled)
+  {
+    m_kinetic_pan = enabled;
+  }
+
+  bool is_kinetic_pan() const
+  {
+    return m_kinetic_pan;
+  }
+
   /**
    * Get an immutable reference to this canvas' camera.
    */
@@ -114,6 +198,96 @@ public:
     return m_renderer_type;
   }
 
+  /**
+   * Memory-lean mode (rhi backend only). When enabled, the CPU copy of the scene is released as soon as it has been
+   * uploaded to the GPU, instead of being kept so the GPU buffers can be rebuilt. If they are lost (device loss,
+   * moving the window to another GPU) the draw callback is re-run. Trades a redraw on those rare events for not
+   * holding the scene in system RAM and VRAM at the same time. May be called before or after application::run().
+   */
+  void set_memory_lean(bool enabled);
+
+  bool is_memory_lean() const
+  {
+    return m_memory_lean;
+  }
+
+  /**
+   * Bytes of CPU-side scene geometry the rhi backend currently keeps alive (0 for the other backends, and 0 in
+   * memory-lean mode once a frame has been uploaded).
+   */
+  std::size_t resident_cpu_scene_bytes() const;
+
+  /**
+   * Picking (rhi backend only). Primitives drawn in WORLD coordinates after renderer::set_pick_id(id) are entered, by
+   * id, into a spatial index built with the scene, so click and hover handlers can ask what is under the cursor
+   * instead of searching their own data. pick() returns the id of the primitive nearest to @p world_point within
+   * @p tolerance_px screen pixels (lines by distance to the segment, everything else by its bounding box; text and
+   * surfaces by their anchor), preferring the one drawn last, or 0 if there is none. pick_rect() returns the ids of
+   * all primitives touching @p world_rect, ascending. Both answer for the frame on screen, including after pan and
+   * zoom, and return nothing while a scene snapshot is shown or with the other backends.
+   */
+  std::uint32_t pick(point2d world_point, double tolerance_px = 3.0) const;
+  std::vector<std::uint32_t> pick_rect(const rectangle &world_rect) const;
+
+  /**
+   * Progressive first frame (rhi backend only). Upload at most @p bytes_per_frame of new scene geometry per frame,
+   * visible region first, so a large design appears within a frame or two and the rest fills in. 0 (the default)
+   * uploads each scene in a single frame. May be called before or after application::run().
+   */
+  void set_upload_budget(std::size_t bytes_per_frame);
+
+  /**
+   * Overlay tile cache (rhi backend only). Keep up to @p vram_bytes of rasterized text, arcs and other overlay content
+   * in VRAM as world-space tiles, so panning back over a region, or zooming back to a level already seen, redraws it
+   * without rasterizing or uploading anything. Content drawn in SCREEN coordinates is laid out once and stays put.
+   * Tiles are 256x256 RGBA (256 KiB each); 0 (the default) turns the cache off. May be called before or after
+   * application::run().
+   */
+  void set_overlay_tile_cache(std::size_t vram_bytes);
+
+  std::size_t overlay_tile_cache() const
+  {
+    return m_overlay_tile_budget_bytes;
+  }
+
+  /**
+   * Out-of-core scene storage (rhi backend only). With @c options.out_of_core set, the geometry of each new scene is
+   * written to a memory-mapped scratch file (in @c options.scratch_dir, or the system temp directory) instead of the
+   * heap, and at most @c options.resident_budget_bytes of it is kept in memory while building and uploading. Meant for
+   * scenes whose geometry would not fit in RAM; combine with set_memory_lean() so the file is dropped once the scene is
+   * on the GPU. Applies to headless captures too. May be called before or after application::run().
+   */
+  void set_scene_storage(const SceneStorageOptions &options);
+
+  const SceneStorageOptions &scene_storage() const
+  {
+    return m_scene_storage;
+  }
+
+  /**
+   * Background scene rebuilds (rhi backend only). When enabled, a full redraw runs the draw callback and builds the
+   * GPU scene on a worker thread while the previous scene stays on screen and pan/zoom keep working; a newer redraw
+   * cancels a rebuild still in flight. The draw callback then runs off the GUI thread, so it must not touch widgets or
+   * race the application's updates to the data it draws. It never runs twice at once: a synchronous redraw, snapshot or
+   * capture first cancels or waits for the rebuild. The frame timing callback only sees the cost of posting the
+   * rebuild. May be called before or after application::run().
+   */
+  void set_async_redraw(bool enabled);
+
+  bool is_async_redraw() const
+  {
+    return m_async_redraw;
+  }
+
+  /**
+   * Register a callback receiving (uploaded bytes, total bytes) after each frame of a progressive upload. The last
+   * call has uploaded == total.
+   */
+  void set_upload_progress_callback(std::function<void(std::size_t, std::size_t)> fn)
+  {
+    m_upload_progress_fn = std::move(fn);
+  }
+
   /**
    * Register a callback invoked after each canvas::redraw() completes.
    * Receives the total CPU time of the redraw in milliseconds — for RHI this
@@ -134,6 +308,11 @@ public:
    * print_pdf, print_svg, and print_png generate a PDF, SVG, or PNG output file showing
    * all the graphical content of the current canvas.
    *
+   * PDF and SVG are written as vectors straight from the draw callback: runs of identically styled primitives are
+   * merged into one path, connected collinear lines into one polyline, and anything outside the visible world is
+   * culled, so the file stays small and the output is streamed rather than held in memory. With a scene snapshot
+   * loaded they fall back to an embedded image.
+   *
    * @param file_name   name of the output file
    * @return            returns true if the function has successfully generated the output file, otherwise
    *                    failed due to errors such as out of memory occurs.
@@ -142,6 +321,31 @@ public:
   bool print_svg(const char *file_name, int width = 0, int height = 0);
   bool print_png(const char *file_name, int width = 0, int height = 0);
 
+  /**
+   * Poster export for images too large to render or hold at once, e.g. 30000 x 30000 pixels of a full device. The
+   * image is rendered as a grid of @p tile_size tiles (capped at the GPU's texture size limit), each a sub-window of
+   * the same view, and every finished row of tiles is compressed into the file before the next one is rendered, so
+   * memory stays at about width * tile_size * 3 bytes. The scene is recorded and uploaded once. A ".tif"/".tiff"
+   * file name writes a Deflate-compressed TIFF (BigTIFF past 4 GB), anything else a PNG; pixels are stored as RGB.
+   * print_png() switches to this path by itself when the requested size exceeds the GPU limit.
+   *
+   * @return  false if the file could not be written or a tile could not be rendered.
+   */
+  bool print_tiled(const char *file_name, int width, int height, int tile_size = 1024);
+
+  /**
+   * Scene snapshots (rhi backend only). save_scene_snapshot() runs the draw callback once and writes the assembled GPU
+   * scene plus the recorded text/arc overlay to a binary file. After load_scene_snapshot(), full redraws and
+   * print_png()/print_pdf()/print_svg() use the file instead of the draw callback, so a large design re-opens without
+   * re-running it. Pan and zoom work as usual. Call clear_scene_snapshot() to go back to the draw callback, e.g. once
+   * the design changes. A snapshot that fails to load is dropped with a warning and the draw callback runs instead.
+   *
+   * @return  false if the file could not be written, or is not a snapshot of this version.
+   */
+  bool save_scene_snapshot(const char *file_name);
+  bool load_scene_snapshot(const char *file_name);
+  void clear_scene_snapshot();
+
   /**
    * Run the draw callback on an offscreen surface of the given size without
    * saving any file. Use this to measure pure render time, separate from
@@ -149,6 +353,56 @@ public:
    */
   void draw_offscreen(int width, int height);
 
+  /**
+   * Batch export of many camera positions of the same scene. Each entry of @p worlds becomes one image, as if the
+   * camera had been zoomed to it with zoom_fit(). With the rhi backend the draw callback runs at most once (not at all
+   * when the canvas already shows the current scene), the geometry is uploaded once, and each view only costs its
+   * text/arc layout, a draw and a readback; other backends render each view in full. The live camera is left untouched.
+   *
+   * render_views() returns the images in the order of @p worlds. print_views_png() writes them instead, encoding on
+   * background threads while the next views render; each "%1" in @p file_pattern is replaced by the view's index.
+   *
+   * @return  print_views_png() returns false, writing nothing, if @p file_pattern has no "%1", and false if any file
+   *          could not be written.
+   */
+  std::vector<QImage> render_views(std::span<const rectangle> worlds, int width = 0, int height = 0);
+  bool print_views_png(std::span<const rectangle> worlds, const char *file_pattern, int width = 0, int height = 0);
+
+  /**
+   * Export the whole world (the initial coordinate system, squared up) as an XYZ tile pyramid for web map viewers:
+   * @p directory/z/x/y.<format>, zoom levels 0..@p max_level, 2^z x 2^z tiles of @p tile_size pixels at level z, with
+   * y growing downwards. Each tile's world is derived as it is rendered, so memory does not grow with the number of
+   * tiles; with the rhi backend the scene is recorded and uploaded once for the whole pyramid (not at all when the
+   * canvas already shows it). Tiles are encoded on background threads. @p format is any Qt image writer format, e.g.
+   * "png", or "webp" if the plugin is installed.
+   *
+   * @return  false if the format is unsupported or any tile could not be written.
+   */
+  bool print_tile_pyramid(const char *directory, int max_level, int tile_size = 256, const char *format = "png");
+
+  /**
+   * Image sequences, e.g. a movie of a placement anneal. Between begin_image_sequence() and end_image_sequence(), each
+   * capture_sequence_frame() takes an image of what the canvas would draw at that moment, at the size given to begin.
+   * With the rhi backend frames are rendered and read back in small batches, so the GPU draws the next frames instead
+   * of waiting for each readback; images therefore reach the sink a few frames late, but always in order, and all of
+   * them by the time end_image_sequence() returns. Other backends capture each frame immediately.
+   *
+   * The file_pattern form writes PNGs, encoding on background threads; each "%1" is replaced by the frame number, and
+   * a pattern without "%1" ends any running sequence and starts none (capture_sequence_frame() then fails as outside
+   * a sequence). The frame_sink form hands each image over instead. begin_raw_sequence() passes the pixels as tightly
+   * packed top-down RGBA rows, 4 * width bytes each, for piping into a video encoder, e.g.
+   * "ffmpeg -f rawvideo -pix_fmt rgba -s <width>x<height> -i - movie.mp4". Sinks run on the calling thread.
+   *
+   * @return  end_image_sequence() returns false if any frame could not be captured or written.
+   */
+  using frame_sink_fn = std::function<void(std::size_t frame, const QImage &image)>;
+  using raw_frame_sink_fn = std::function<void(std::size_t frame, const unsigned char *rgba, std::size_t bytes)>;
+  void begin_image_sequence(const char *file_pattern, int width = 0, int height = 0);
+  void begin_image_sequence(frame_sink_fn sink, int width = 0, int height = 0);
+  void begin_raw_sequence(raw_frame_sink_fn sink, int width = 0, int height = 0);
+  void capture_sequence_frame();
+  bool end_image_sequence();
+
 protected:
   // Only the ezgl::application can create and initialize a canvas object.
   friend class application;
@@ -168,6 +422,11 @@ protected:
    */
   void initialize(QWidget *drawing_area);
 
+  /**
+   * Push the rhi-only settings (scene storage, snapshot) to a freshly created or existing rhi backend.
+   */
+  void apply_backend_settings();
+
 private:
   // Name of the canvas in XML.
   std::string m_canvas_id;
@@ -187,15 +446,66 @@ private:
   // Requested backend type — set before run(), used by initialize() to pick the backend.
   renderer_type m_renderer_type = renderer_type::rhi;
 
+  // Drop the CPU scene after GPU upload (rhi backend).
+  bool m_memory_lean = false;
+
+  // Per-frame geometry upload budget (rhi backend), 0 = unlimited.
+  std::size_t m_upload_budget_bytes = 0;
+
+  // VRAM budget of the overlay tile cache (rhi backend), 0 = off.
+  std::size_t m_overlay_tile_budget_bytes = 0;
+
+  // Where the rhi backend keeps scene geometry (heap or scratch file).
+  SceneStorageOptions m_scene_storage;
+
+  // Rebuild scenes on a background thread (rhi backend).
+  bool m_async_redraw = false;
+
+  // Snapshot file replayed in place of the draw callback (rhi backend), or empty.
+  QString m_scene_snapshot;
+
+  // Optional progressive-upload progress callback.
+  std::function<void(std::size_t, std::size_t)> m_upload_progress_fn;
+
   // Optional post-redraw timing callback.
   std::function<void(double)> m_frame_timing_fn;
 
   // Active rendering backend — selected at initialize() time based on widget type.
   std::unique_ptr<render_backend> m_backend;
 
+  // Coalesces request_redraw*() calls to one redraw per displayed frame; null until initialize().
+  std::unique_ptr<FrameScheduler> m_frame_scheduler;
+
+  // Smooth zoom / kinetic pan state; advanced by m_frame_scheduler once per frame.
+  camera_animator m_camera_animator;
+
+  // Smooth zoom duration (0 = jump) and kinetic pan switch.
+  int m_smooth_zoom_ms = 0;
+  bool m_kinetic_pan = false;
+
   // Renders the canvas into an off-screen QImage; shared by print_pdf/print_svg/print_png.
   QImage render_to_image(int surface_width, int surface_height);
 
+  // Writes the draw callback's primitives as an SVG/PDF page; shared by print_pdf/print_svg.
+  bool render_to_vector(const char *file_name, int surface_width, int surface_height, vector_format format);
+
+  // Renders one image per world and passes each to sink; shared by render_views/print_views_png.
+  void render_views_to(std::span<const rectangle> worlds,
+                       int surface_width,
+                       int surface_height,
+                       const render_backend::view_sink_fn &sink);
+
+  // As above, asking world_of for each of count worlds as it is rendered; used by print_tile_pyramid.
+  void render_views_to(std::size_t count,
+                       const render_backend::view_world_fn &world_of,
+                       int surface_width,
+                       int surface_height,
+                       const render_backend::view_sink_fn &sink);
+
+  // State of the image sequence in progress, if any; defined in canvas.cpp.
+  struct image_sequence;
+  std::unique_ptr<image_sequence> m_image_sequence;
+
   void begin_deferred_redraw_cycle();
   void end_deferred_redraw_cycle();
 };
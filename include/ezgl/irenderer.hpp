@@ -90,6 +90,15 @@ public:
      */
     virtual void set_text_screen_offset(point2d offset_px);
 
+    /**
+     * Tag the WORLD primitives drawn from now on with @p id, so that
+     * canvas::pick() / canvas::pick_rect() can report them (e.g. a block
+     * or net index for hover highlighting). 0, the default at the start
+     * of every frame, records nothing. Only the rhi backend builds a pick
+     * index; the other renderers ignore the id.
+     */
+    virtual void set_pick_id(std::uint32_t id);
+
     virtual void draw_line(const point2d& start, const point2d& end) = 0;
     virtual void draw_rectangle(const point2d& start, const point2d& end) = 0;
     virtual void draw_rectangle(const point2d& start, double width, double height) = 0;
@@ -100,6 +109,21 @@ public:
     virtual void fill_poly(const std::vector<point2d>& points) = 0;
     virtual void fill_triangle(const point2d& a, const point2d& b, const point2d& c) = 0;
 
+    /**
+     * Fill a simple polygon with holes cut out of it.
+     *
+     * @param outer Outer boundary, either winding.
+     * @param holes Hole boundaries, each lying inside @p outer.
+     *
+     * The default implementation triangulates (see ezgl::triangulate_polygon)
+     * and calls fill_triangle per triangle, which works for any backend that
+     * can batch triangles. The immediate backend overrides this with a single
+     * even-odd path fill so antialiased edges do not show seams; RHI reuses
+     * its triangulation cache.
+     */
+    virtual void fill_poly_with_holes(const std::vector<point2d>& outer,
+                                      const std::vector<std::vector<point2d>>& holes);
+
     /**
      * Fill an arrow-head triangle anchored to a world position but rendered
      * at a constant SCREEN size at every zoom level.
@@ -154,6 +178,7 @@ protected:
     justification       vert_justification  = justification::center;
     QFont               current_font;
     point2d             text_screen_offset_px = {0.0, 0.0};
+    std::uint32_t       current_pick_id = 0;
 
     void update_painter(Painter* painter, QImage* surface);
 
@@ -162,6 +187,8 @@ protected:
     void paint_line(const point2d& start, const point2d& end);
     void paint_rectangle_path(const point2d& start, const point2d& end, bool fill);
     void paint_poly(const std::vector<point2d>& points);
+    void paint_poly_with_holes(const std::vector<point2d>& outer,
+                               const std::vector<std::vector<point2d>>& holes);
     void paint_arc_path(const point2d& center, double radius, double start_angle,
                        double extent_angle, double stretch_factor, bool fill);
     void paint_text(const point2d& point, const std::string& text,
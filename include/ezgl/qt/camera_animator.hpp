@@ -0,0 +1,76 @@
+#pragma once
+
+#include "ezgl/camera.hpp"
+#include "ezgl/point.hpp"
+#include "ezgl/rectangle.hpp"
+
+#include <QElapsedTimer>
+
+namespace ezgl {
+
+/**
+ * @brief Time-based camera transitions for smooth zoom and kinetic pan.
+ *
+ * The animator only moves the camera; @ref FrameScheduler calls
+ * @ref advance once per displayed frame and redraws with
+ * @c render_backend::redraw_camera_transient while it returns true, then
+ * with a regular camera-only redraw once the camera has settled. Progress
+ * is measured in wall-clock time, so a slow frame skips ahead instead of
+ * stretching the animation.
+ *
+ * @par Zoom
+ * @ref animate_to moves every edge of the visible world along the same
+ * eased weight, so a zoom about a point keeps that point fixed on screen.
+ * The weight follows the width geometrically: each frame scales the view
+ * by the same factor, which reads as constant zoom speed. Retargeting a
+ * running animation starts from the current (intermediate) world.
+ *
+ * @par Kinetic pan
+ * @ref fling keeps translating the camera at the release velocity and
+ * decays it exponentially with time constant @ref kFlingTimeConstantS,
+ * until it drops below @ref kFlingStopPxPerS on screen.
+ */
+class camera_animator {
+public:
+    static constexpr double kFlingTimeConstantS = 0.325;
+    static constexpr double kFlingStopPxPerS    = 20.0;
+
+    explicit camera_animator(camera& cam) : m_camera(cam) {}
+
+    /// Move the visible world to @p target over @p duration_ms.
+    void animate_to(rectangle target, int duration_ms);
+
+    /// Keep panning at @p world_per_s (world units per second), decaying.
+    void fling(point2d world_per_s);
+
+    /// Stop at the current intermediate world.
+    void stop() { m_mode = mode::idle; }
+
+    bool active() const { return m_mode != mode::idle; }
+
+    /// Where the camera ends up: the zoom target while zooming, else the
+    /// current world. Successive zoom steps compose on this.
+    rectangle target_world() const;
+
+    /// Move the camera to its position for the current time. Returns true
+    /// while more frames are needed; false once it has settled.
+    bool advance();
+
+private:
+    enum class mode { idle, zoom, fling };
+
+    camera&       m_camera;
+    mode          m_mode = mode::idle;
+    QElapsedTimer m_clock;
+
+    // zoom
+    rectangle m_from;
+    rectangle m_to;
+    double    m_duration_s = 0.0;
+
+    // fling
+    point2d m_velocity{0.0, 0.0};
+    qint64  m_last_ns = 0;
+};
+
+} // namespace ezgl
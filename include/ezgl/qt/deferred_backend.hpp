@@ -7,15 +7,22 @@
 #include <QImage>
 #include <QWidget>
 
+#include <memory>
+
 namespace ezgl {
 
 class Painter;
+class deferred_renderer;
 
 /**
  * QPainter-backed rendering backend (deferred_renderer path).
  *
  * Owns the off-screen QImage surface and Painter, recreating them on every
- * resize.  Geometry is re-submitted through deferred_renderer on each frame.
+ * resize.  redraw() re-submits the geometry through a deferred_renderer and
+ * keeps that recording; redraw_camera_only() (pan / zoom) replays it for the
+ * new camera without calling the draw callback.  Culling and rasterizing of
+ * the batched primitives run on one thread per core (see
+ * deferred_renderer::set_replay_threads).
  */
 class deferred_backend final : public render_backend {
 public:
@@ -33,6 +40,7 @@ public:
 
 private:
     void recreate_surface();
+    void paint_background();
 
     QWidget*       m_drawing_area;
     draw_canvas_fn m_draw_callback;
@@ -42,6 +50,9 @@ private:
     QImage*   m_surface            = nullptr;
     Painter*  m_painter            = nullptr;
     renderer* m_animation_renderer = nullptr;
+
+    // Last redraw()'s recording, replayed by redraw_camera_only().
+    std::unique_ptr<deferred_renderer> m_recording;
 };
 
 } // namespace ezgl
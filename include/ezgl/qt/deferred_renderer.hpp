@@ -8,13 +8,18 @@
 #include <QRectF>
 #include <QFont>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <variant>
 #include <vector>
 
+QT_FORWARD_DECLARE_CLASS(QDataStream)
+
 namespace ezgl {
 
+struct DeferredVisibleBatches;
+
 // ---- style keys ----------------------------------------------------------
 
 // Packed key for line primitives: color(32) | line_width(16) | line_cap(8) | line_dash(8)
@@ -41,24 +46,32 @@ struct FillStyleKey {
 
 // ---- batch storage -------------------------------------------------------
 
+// A batch of WORLD primitives (world == true) is stored in world units and
+// projected with the camera of each replay; SCREEN batches hold pixels.
+// A world rect keeps its two recorded corners as top-left / bottom-right.
+
 struct LineBatch {
     LineStyleKey        style;
     std::vector<QLineF> lines;
+    bool                world = false;
 };
 
 struct FillRectBatch {
     FillStyleKey        style;
     std::vector<QRectF> rects;
+    bool                world = false;
 };
 
 struct DrawRectBatch {
     LineStyleKey        style;
     std::vector<QRectF> rects;
+    bool                world = false;
 };
 
 struct FillPolyBatch {
     FillStyleKey            style;
     std::vector<QPolygonF>  polys;
+    bool                    world = false;
 };
 
 struct DeferredPainterState {
@@ -92,6 +105,7 @@ struct DeferredTextCommand {
     bool                 scale_font_with_camera = false;
     double               recorded_world_scale = 1.0;
     point2d              screen_offset_px = {0.0, 0.0};
+    double               recorded_world_scale_y = 1.0; // for re-indexing a loaded recording
 };
 
 struct DeferredSurfaceCommand {
@@ -125,6 +139,11 @@ using DeferredOverlayCommand =
                  DeferredSurfaceCommand,
                  DeferredArrowTriangleCommand>;
 
+// Which part of the recording a replay paints: everything, only what is
+// placed in world coordinates, or only SCREEN-coordinate content (which
+// includes the batched primitives, stored in screen pixels).
+enum class overlay_space { all, world, screen };
+
 // ---- deferred_renderer ---------------------------------------------------
 
 class deferred_renderer : public irenderer {
@@ -173,10 +192,31 @@ public:
     // ---- Flush all batches to the underlying QPainter, then reset ----------
     void flush();
 
+    // Threads that rasterize the batched primitives of a replay: 1 (the
+    // default) paints them through the painter on the calling thread; 0
+    // uses one per hardware thread. With more than one, the target image
+    // is split into horizontal bands, each painted by its own QPainter and
+    // thread with every culled batch in the usual order, so each pixel
+    // sees the same sequence of primitives as in a serial replay. Overlay
+    // commands (text, arcs, surfaces) still follow on the calling thread.
+    // Replays onto rotated painters, non-image devices or small frames
+    // stay serial.
+    void set_replay_threads(int threads) { m_replay_threads = threads; }
+
+    // Keep WORLD primitives that are off screen at record time, so the
+    // recording can be replayed for any later camera (deferred_backend's
+    // camera-only redraws). Off by default: they are dropped as recorded.
+    void set_retain_recording(bool retain) { m_retain_recording = retain; }
+
     // ---- Methods used by rhi_renderer --------------------------------------
 
     // Replay stored overlay commands without resetting (for camera-only update).
-    void replay_overlay();
+    void replay_overlay(overlay_space space = overlay_space::all);
+
+    // Replay only what falls inside `clip` (widget pixels): the painter is
+    // clipped to it and the overlay index is queried for that region only.
+    // Used to repaint the strips a pan has exposed and to fill overlay tiles.
+    void replay_overlay(const QRectF& clip, overlay_space space = overlay_space::all);
 
     // Discard all stored commands and batches (called at begin of new frame).
     void clear_overlay_and_batches();
@@ -184,21 +224,41 @@ public:
     // Redirect the internal painter to a new surface (called after resize).
     void set_painter_surface(Painter* painter, QImage* surface);
 
+    // Write the recorded batches and overlay commands to a snapshot stream.
+    // Surfaces are stored by value, since the application owns them.
+    void save_recording(QDataStream& out) const;
+
+    // Replace the recording with one written by save_recording(). Surfaces
+    // are loaded into images owned by this renderer until the next reset.
+    // Returns false (and leaves the recording empty) on a corrupt stream.
+    bool load_recording(QDataStream& in);
+
 protected:
     void replay();
     void clear_deferred_primitives();
 
 private:
+    // Threads a replay may use, from set_replay_threads().
+    int replay_thread_count() const;
+    // Project, clip and cull the batches for the current camera.
+    void cull_batches(DeferredVisibleBatches& visible);
+    // Paint the batches band by band on worker threads; false (nothing
+    // painted) when the target does not allow it.
+    bool replay_batches_banded(const DeferredVisibleBatches& visible);
     void ensure_overlay_index_grid();
     int clamp_overlay_tile_x(double x) const;
     int clamp_overlay_tile_y(double y) const;
     void index_world_overlay_command(std::uint32_t command_index,
                                      rectangle      bounds);
+    void index_text_command(std::uint32_t              command_index,
+                            const DeferredTextCommand& cmd,
+                            point2d                    world_scale);
     void reset();
     DeferredPainterState capture_painter_state() const;
     void apply_painter_state(const DeferredPainterState& state);
 
     QRectF screen_viewport_rect() const;
+    rectangle replay_visible_world();
     bool screen_rect_visible(const QRectF& rect, double padding = 0.0) const;
     bool screen_line_visible(const QLineF& line, double line_width) const;
     bool screen_arc_visible(const point2d& center,
@@ -215,17 +275,19 @@ private:
     LineStyleKey current_line_style() const;
     FillStyleKey current_fill_style() const;
 
-    void add_line(const LineStyleKey &s, QLineF line);
-    void add_fill_rect(const FillStyleKey &s, QRectF rect);
-    void add_draw_rect(const LineStyleKey &s, QRectF rect);
-    void add_fill_poly(const FillStyleKey &s, QPolygonF poly);
+    void add_line(const LineStyleKey &s, QLineF line, bool world);
+    void add_fill_rect(const FillStyleKey &s, QRectF rect, bool world);
+    void add_draw_rect(const LineStyleKey &s, QRectF rect, bool world);
+    void add_fill_poly(const FillStyleKey &s, QPolygonF poly, bool world);
 
-    QRectF to_screen_rect(const point2d& start, const point2d& end);
+    // The rect a batch stores for (start, end) in the current system.
+    QRectF to_batch_rect(const point2d& start, const point2d& end) const;
 
     void push_arc_command(const point2d& center, double radius_x, double radius_y,
                           double start_angle, double extent_angle, bool fill);
 
     // Batch vectors — maintain submission order for painter's algorithm.
+    // WORLD and SCREEN primitives of one style go to separate batches.
     std::vector<LineBatch>     m_line_batches;
     std::vector<FillRectBatch> m_fill_rect_batches;
     std::vector<DrawRectBatch> m_draw_rect_batches;
@@ -244,6 +306,13 @@ private:
     std::vector<std::uint32_t>           m_unindexed_overlay_commands;
     std::vector<std::uint32_t>           m_overlay_query_marks;
     std::uint32_t                        m_overlay_query_generation = 1;
+    std::vector<std::unique_ptr<surface>> m_loaded_surfaces;
+
+    // Set only while replay_overlay(clip) runs; null otherwise.
+    QRectF                               m_replay_clip;
+    overlay_space                        m_replay_space = overlay_space::all;
+    int                                  m_replay_threads = 1;
+    bool                                 m_retain_recording = false;
 };
 
 } // namespace ezgl
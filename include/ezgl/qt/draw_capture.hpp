@@ -0,0 +1,199 @@
+#pragma once
+
+#include "ezgl/irenderer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+QT_FORWARD_DECLARE_CLASS(QFile)
+
+/**
+ * @file draw_capture.hpp
+ *
+ * @brief Record the calls a draw callback makes and replay them later.
+ *
+ * Wrap the renderer passed to a draw callback in a @ref recording_renderer
+ * to forward every call unchanged and log it to a @ref capture_writer.
+ * A @ref capture_reader replays the logged frames against any renderer,
+ * so a production workload can be reproduced offline (see the
+ * @c ezgl-replay example) without the application that drew it.
+ *
+ * @par Format
+ * @code
+ *   header   "EZGLCAP\0", u32 version, f64 world[4], f64 world quantum
+ *   frame*   u8 'F', varint payload bytes, payload:
+ *              f64 visible world[4], varint screen w, h, varint op count,
+ *              ops (u8 opcode + operands)
+ * @endcode
+ * Multi-byte fixed fields are little-endian. Coordinates are quantized
+ * (WORLD to the header's quantum, 2^-30 of the world extent; SCREEN to
+ * 1/64 pixel) and stored as zigzag varint deltas from the previous point
+ * in the same coordinate system, so a polyline or a grid of rectangles
+ * costs a byte or two per coordinate. Angles, radii and text bounds are
+ * stored as plain doubles. Each frame is self-contained: surfaces are
+ * embedded as PNG the first time a frame uses them.
+ */
+
+namespace ezgl {
+
+/// Bumped whenever the capture layout changes.
+inline constexpr std::uint32_t kDrawCaptureVersion = 2;
+
+/**
+ * @brief Appends frames recorded by @ref recording_renderer to a file.
+ */
+class capture_writer {
+public:
+    /// Create (truncate) @p path and write the header. @p world is the
+    /// canvas coordinate system; it sets the WORLD coordinate quantum.
+    capture_writer(const std::string& path, const rectangle& world);
+    ~capture_writer();
+
+    capture_writer(const capture_writer&)            = delete;
+    capture_writer& operator=(const capture_writer&) = delete;
+
+    bool        is_open() const;
+    std::size_t frames_written() const { return m_frames; }
+    std::size_t bytes_written() const { return m_bytes; }
+
+private:
+    friend class recording_renderer;
+
+    void write_frame(const std::vector<std::uint8_t>& header,
+                     const std::vector<std::uint8_t>& ops);
+
+    std::unique_ptr<QFile> m_file;
+    double                 m_world_quantum = 1.0;
+    std::size_t            m_frames = 0;
+    std::size_t            m_bytes  = 0;
+};
+
+/**
+ * @brief @ref irenderer decorator that logs every call before forwarding
+ * it to the wrapped renderer.
+ *
+ * Lives for one draw callback: construct it on the renderer the callback
+ * received, draw through it, and the frame is appended to the writer when
+ * it is destroyed. Queries (visible world, world_to_screen) are answered
+ * by the wrapped renderer and not logged.
+ */
+class recording_renderer final : public irenderer {
+public:
+    recording_renderer(irenderer& target, capture_writer& out);
+    ~recording_renderer() override;
+
+    void set_coordinate_system(t_coordinate_system new_coordinate_system) override;
+    void set_visible_world(rectangle new_world) override;
+    rectangle get_visible_world() override;
+    rectangle get_visible_screen() const override;
+    rectangle world_to_screen(const rectangle& box) override;
+
+    void set_color(color new_color) override;
+    void set_color(color new_color, uint_fast8_t alpha) override;
+    void set_color(uint_fast8_t red, uint_fast8_t green, uint_fast8_t blue,
+                   uint_fast8_t alpha = 255) override;
+    void set_line_cap(line_cap cap) override;
+    void set_line_dash(line_dash dash) override;
+    void set_line_width(int width) override;
+    void set_font_size(double new_size) override;
+    void format_font(std::string const& family, font_slant slant, font_weight weight) override;
+    void format_font(std::string const& family, font_slant slant,
+                     font_weight weight, double new_size) override;
+    void set_text_rotation(double degrees) override;
+    void set_horiz_justification(justification horiz_just) override;
+    void set_vert_justification(justification vert_just) override;
+    void set_text_screen_offset(point2d offset_px) override;
+    void set_pick_id(std::uint32_t id) override;
+
+    void draw_line(const point2d& start, const point2d& end) override;
+    void draw_rectangle(const point2d& start, const point2d& end) override;
+    void draw_rectangle(const point2d& start, double width, double height) override;
+    void draw_rectangle(const rectangle& r) override;
+    void fill_rectangle(const point2d& start, const point2d& end) override;
+    void fill_rectangle(const point2d& start, double width, double height) override;
+    void fill_rectangle(const rectangle& r) override;
+    void fill_poly(const std::vector<point2d>& points) override;
+    void fill_triangle(const point2d& a, const point2d& b, const point2d& c) override;
+    void fill_poly_with_holes(const std::vector<point2d>& outer,
+                              const std::vector<std::vector<point2d>>& holes) override;
+    void fill_arrow_pointer_triangle(const point2d& anchor_world,
+                                     const point2d& dir_world,
+                                     float          arrow_size_px) override;
+    void draw_elliptic_arc(const point2d& center, double radius_x, double radius_y,
+                           double start_angle, double extent_angle) override;
+    void draw_arc(const point2d& center, double radius,
+                  double start_angle, double extent_angle) override;
+    void fill_elliptic_arc(const point2d& center, double radius_x, double radius_y,
+                           double start_angle, double extent_angle) override;
+    void fill_arc(const point2d& center, double radius,
+                  double start_angle, double extent_angle) override;
+    void draw_text(const point2d& point, std::string const& text) override;
+    void draw_text(const point2d& point, std::string const& text,
+                   double bound_x, double bound_y) override;
+    void draw_surface(surface* p_surface, const point2d& anchor_point,
+                      double scale_factor = 1) override;
+
+private:
+    void op(std::uint8_t code);
+    void put_point(const point2d& p);
+    void put_points(const std::vector<point2d>& points);
+
+    irenderer&                                 m_target;
+    capture_writer&                            m_out;
+    std::vector<std::uint8_t>                  m_frame_header;
+    std::vector<std::uint8_t>                  m_payload;
+    std::size_t                                m_ops = 0;
+    t_coordinate_system                        m_system = WORLD;
+    std::int64_t                               m_last[2][2] = {}; ///< [system][x|y] in quanta
+    std::unordered_map<const surface*, std::uint32_t> m_surface_ids;
+};
+
+/**
+ * @brief Replays frames from a capture held in memory.
+ *
+ * Decodes straight from the caller's buffer (typically a read-only
+ * mapping of the file); nothing is copied except text strings and
+ * surfaces, which the renderer API takes by value.
+ */
+class capture_reader {
+public:
+    struct frame_info {
+        rectangle   visible_world;
+        int         screen_width  = 0;
+        int         screen_height = 0;
+        std::size_t ops   = 0;
+        std::size_t bytes = 0;
+    };
+
+    /// Index the frames in @p data[0, size). @p data must outlive the reader.
+    capture_reader(const std::uint8_t* data, std::size_t size);
+
+    /// False if the header is missing or from another version, or a frame
+    /// is truncated (frames before it are still usable).
+    bool        valid() const { return m_valid; }
+    rectangle   world() const { return m_world; }
+    std::size_t frame_count() const { return m_frames.size(); }
+    frame_info  frame(std::size_t index) const;
+
+    /// Replay frame @p index into @p target. Returns false if the frame is
+    /// corrupt; calls before the corruption have already been made.
+    bool replay(std::size_t index, irenderer& target) const;
+
+private:
+    struct frame_entry {
+        frame_info         info;
+        const std::uint8_t* ops_begin = nullptr;
+        const std::uint8_t* ops_end   = nullptr;
+    };
+
+    std::vector<frame_entry> m_frames;
+    rectangle                m_world;
+    double                   m_world_quantum = 1.0;
+    bool                     m_valid = false;
+};
+
+} // namespace ezgl
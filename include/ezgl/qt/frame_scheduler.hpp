@@ -0,0 +1,96 @@
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QWidget>
+
+#include <functional>
+
+namespace ezgl {
+
+/**
+ * @brief Coalesces a canvas's redraw requests into at most one redraw per
+ * displayed frame.
+ *
+ * Input handlers move the camera immediately but only mark the canvas
+ * dirty here. A queued tick then runs exactly one full or camera-only
+ * redraw (full wins if both were requested) and waits for the widget to
+ * present that frame before the next tick may run: the
+ * @c QRhiWidget::frameSubmitted signal for the rhi backend, the widget's
+ * paint event otherwise. Requests made in between are folded into the
+ * next tick, so a 1000 Hz mouse costs one overlay re-layout per refresh.
+ *
+ * A frame that never reaches the screen (hidden widget, a redraw that
+ * presents nothing yet such as a background rebuild) releases the gate
+ * after @ref kPresentTimeoutMs so pending requests are never stranded.
+ *
+ * @par Animations
+ * While @ref start_animation is in effect, every tick first calls the
+ * animation hook, which moves the camera, and redraws with the cheaper
+ * transient camera-only path. The tick after the hook reports the end
+ * runs a regular camera-only redraw, so the overlay is laid out once for
+ * the settled camera. A full or camera-only request during an animation
+ * takes precedence for that tick.
+ *
+ * The scheduler has no QObject parent: its creator owns it, and it only
+ * watches the widget, which may be destroyed first.
+ */
+class FrameScheduler final : public QObject {
+    Q_OBJECT
+public:
+    static constexpr int kPresentTimeoutMs = 100;
+
+    FrameScheduler(QWidget*              widget,
+                   std::function<void()> redraw,
+                   std::function<void()> redraw_camera_only,
+                   std::function<void()> redraw_camera_transient);
+
+    /// Hook run at the start of each animation tick; returns true while the
+    /// animation needs more frames.
+    void set_animation_hook(std::function<bool()> advance);
+
+    /// Tick every frame through the animation hook until it reports done.
+    void start_animation();
+
+    /// Stop ticking the animation hook; the camera stays where it is.
+    void stop_animation();
+
+    bool animating() const { return m_animating; }
+
+    /// Schedule a full redraw for the next frame.
+    void request_redraw();
+
+    /// Schedule a camera-only redraw for the next frame.
+    void request_redraw_camera_only();
+
+    /// Run a pending redraw now, ignoring the frame gate. For callers that
+    /// need the result immediately (animation drawing, event processing).
+    void flush();
+
+    bool pending() const { return m_full || m_camera_only || m_transient; }
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
+private:
+    void schedule_tick();
+    void tick();
+    void frame_presented();
+
+    QPointer<QWidget>     m_widget;
+    std::function<void()> m_redraw;
+    std::function<void()> m_redraw_camera_only;
+    std::function<void()> m_redraw_camera_transient;
+    std::function<bool()> m_advance_animation;
+    QTimer                m_present_timeout;
+
+    bool m_full             = false;
+    bool m_camera_only      = false;
+    bool m_transient        = false;
+    bool m_animating        = false;
+    bool m_tick_queued      = false;
+    bool m_frame_in_flight  = false;
+};
+
+} // namespace ezgl
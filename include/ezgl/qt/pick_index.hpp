@@ -0,0 +1,109 @@
+#pragma once
+
+#include "ezgl/point.hpp"
+#include "ezgl/rectangle.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ezgl {
+
+/**
+ * @brief One pickable primitive: its pick id and world geometry.
+ *
+ * A segment keeps its end points in (x0, y0)-(x1, y1) and is matched by
+ * distance to the line; anything else is its bounding box and matches
+ * anywhere inside it.
+ */
+struct PickEntry {
+    float         x0, y0, x1, y1;
+    std::uint32_t id;
+    std::uint32_t order; ///< recording sequence << 1 | 1 for a segment
+
+    bool is_segment() const noexcept { return (order & 1u) != 0; }
+    float left() const noexcept { return x0 < x1 ? x0 : x1; }
+    float right() const noexcept { return x0 < x1 ? x1 : x0; }
+    float bottom() const noexcept { return y0 < y1 ? y0 : y1; }
+    float top() const noexcept { return y0 < y1 ? y1 : y0; }
+};
+
+/**
+ * @brief Packed R-tree over the entries of one tile.
+ *
+ * Bulk-loaded once (sort-tile-recursive), then read-only. Nodes hold
+ * @ref kNodeSize children and are stored level by level, so the tree is
+ * two flat arrays: the entries in leaf order and one box per node, about
+ * 1/15 of the entry count.
+ */
+class PickTree {
+public:
+    static constexpr std::size_t kNodeSize = 16;
+
+    struct Box {
+        float x0, y0, x1, y1;
+    };
+
+    void build(std::vector<PickEntry> entries);
+
+    /// Append every entry whose bounding box overlaps @p query.
+    void query(const Box& query, std::vector<const PickEntry*>& out) const;
+
+    std::size_t size() const noexcept { return m_entries.size(); }
+    std::size_t byte_size() const noexcept
+    {
+        return m_entries.capacity() * sizeof(PickEntry) + m_nodes.capacity() * sizeof(Box);
+    }
+
+private:
+    std::vector<PickEntry>   m_entries;
+    std::vector<Box>         m_nodes;       ///< all levels, leaf parents first
+    std::vector<std::size_t> m_level_begin; ///< first node of each level, plus the end
+};
+
+/**
+ * @brief World-space index of the primitives recorded with a pick id.
+ *
+ * Built by @ref rhi_renderer alongside the scene it assembles: the same
+ * square grid of tiles over the initial world, one @ref PickTree per tile.
+ * A primitive that spans several tiles is entered in each, and results
+ * are de-duplicated. Primitives outside the grid fall into its edge tiles,
+ * like the scene geometry.
+ *
+ * Read-only once built, so queries may run on any thread.
+ */
+class PickIndex {
+public:
+    PickIndex(const rectangle& bounds, int dimension);
+
+    int dimension() const noexcept { return m_dimension; }
+    const rectangle& tile_bounds(int tile_x, int tile_y) const;
+    PickTree& tile(int tile_x, int tile_y);
+    int clamp_tile_x(double x) const;
+    int clamp_tile_y(double y) const;
+
+    /**
+     * The id of the primitive nearest to @p p, or 0 if none is within
+     * @p tolerance (world units per axis, e.g. a few pixels times the
+     * camera's world scale). Distance is measured relative to the
+     * tolerance, so it is isotropic on screen; ties go to the primitive
+     * recorded last, i.e. the one drawn on top.
+     */
+    std::uint32_t pick(point2d p, point2d tolerance) const;
+
+    /// Ids of every primitive touching @p r, ascending and unique.
+    std::vector<std::uint32_t> pick_rect(const rectangle& r) const;
+
+    std::size_t entry_count() const;
+    std::size_t byte_size() const;
+
+private:
+    rectangle              m_bounds;
+    int                    m_dimension;
+    double                 m_tile_width;
+    double                 m_tile_height;
+    std::vector<rectangle> m_tile_bounds;
+    std::vector<PickTree>  m_tiles;
+};
+
+} // namespace ezgl
@@ -3,6 +3,9 @@
 #include "ezgl/irenderer.hpp"
 
 #include <QImage>
+#include <cstddef>
+#include <functional>
+#include <memory>
 
 /**
  * @file render_backend.hpp
@@ -28,6 +31,8 @@
 
 namespace ezgl {
 
+class PickIndex;
+
 using draw_canvas_fn = void (*)(renderer*);
 
 /// Backend identifier used by @c canvas::set_renderer_type to select
@@ -91,6 +96,13 @@ public:
     /// fall through to a full @ref redraw because they have no cache.
     virtual void redraw_camera_only() = 0;
 
+    /// Camera-only redraw for an intermediate frame of a camera animation
+    /// (smooth zoom, kinetic pan). Backends that can reproject their last
+    /// overlay (rhi) move only the geometry and leave the overlay layout
+    /// to the @ref redraw_camera_only that ends the animation. Defaults to
+    /// @ref redraw_camera_only.
+    virtual void redraw_camera_transient() { redraw_camera_only(); }
+
     /// Optional batching window. Multiple @ref redraw / @ref
     /// redraw_camera_only calls between @c begin_ / @c end_ may coalesce
     /// into a single GPU frame. Default impl is a no-op for backends
@@ -123,6 +135,60 @@ public:
      * @param h  Desired output height (0 = use the widget's current height).
      */
     virtual QImage render_to_image(int /*w*/, int /*h*/) { return {}; }
+
+    /// Largest width or height @ref render_to_image() can produce in one
+    /// piece, or 0 if there is no fixed limit. @c canvas::print_png()
+    /// switches to tiled rendering beyond it.
+    virtual int max_image_size() const { return 0; }
+
+    /// Receives each image of @ref render_views with its view index.
+    using view_sink_fn = std::function<void(std::size_t index, QImage image)>;
+
+    /// World of view @c index; called once per view, in order.
+    using view_world_fn = std::function<rectangle(std::size_t index)>;
+
+    /**
+     * Render @p count @p w x @p h images, setting the camera's world to
+     * @p world_of each view in turn, and hand them to @p sink in order.
+     * Worlds are asked for as the views are rendered, so the list never
+     * has to exist in memory. The camera is left at the last view; the
+     * caller restores it.
+     *
+     * Returns false by default, which tells @c canvas::render_views() to
+     * fall back to one @ref render_to_image() per view. Backends that can
+     * record the scene once and only redo the camera-dependent parts
+     * (e.g. @ref rhi_backend) override this.
+     */
+    virtual bool render_views(std::size_t          /*count*/,
+                              const view_world_fn& /*world_of*/,
+                              int                  /*w*/,
+                              int                  /*h*/,
+                              const view_sink_fn&  /*sink*/)
+    {
+        return false;
+    }
+
+    /// Receives a frame taken by @ref queue_frame; null on failure.
+    using frame_sink_fn = std::function<void(QImage image)>;
+
+    /**
+     * Take a @p w x @p h image of the current frame, like
+     * @ref render_to_image(), but let the backend hold it back and hand it
+     * to @p sink later, so GPU work and readbacks can be batched across
+     * the frames of a sequence. Frames reach their sinks in the order they
+     * were queued; @ref flush_frames() delivers all that are still held.
+     *
+     * Returns false by default, in which case @p sink is not called and
+     * @c canvas falls back to @ref render_to_image(). Backends that
+     * pipeline readback (e.g. @ref rhi_backend) override both.
+     */
+    virtual bool queue_frame(int /*w*/, int /*h*/, frame_sink_fn /*sink*/) { return false; }
+    virtual void flush_frames() {}
+
+    /// Index of the primitives the shown frame recorded with a pick id,
+    /// for @c canvas::pick(). Null by default: only backends that keep the
+    /// recorded scene (rhi) build one.
+    virtual std::shared_ptr<const PickIndex> pick_index() const { return nullptr; }
 };
 
 } // namespace ezgl
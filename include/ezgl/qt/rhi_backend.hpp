@@ -4,13 +4,17 @@
 #include "ezgl/camera.hpp"
 #include "ezgl/color.hpp"
 #include "ezgl/qt/rhi_canvas_widget.hpp"
+#include "ezgl/qt/scene_scratch.hpp"
 
+#include <cstdint>
 #include <memory>
 #include <QColor>
+#include <QObject>
 
 namespace ezgl {
 
 class rhi_renderer;
+class RhiSceneBuilder;
 
 /**
  * @brief Qt RHI GPU-backed @ref render_backend implementation. Lifecycle
@@ -37,14 +41,43 @@ class rhi_renderer;
  * @c m_has_drawn_frame so subsequent resize events know whether the
  * scene has been initialised.
  *
+ * @par Scene snapshots
+ * While @c m_snapshot_path is set, a full redraw loads that file through
+ * @ref rhi_renderer::load_snapshot() instead of running the draw callback;
+ * a file that fails to load is dropped and the callback runs again.
+ * Camera-only redraws are unaffected.
+ *
+ * @par Async redraw
+ * With @ref set_async_redraw(true), a full redraw posts the draw callback
+ * and scene assembly to a @ref RhiSceneBuilder thread instead of running
+ * them here, with a copy of the camera taken at request time. The widget
+ * keeps presenting the previous scene, camera-only redraws stay live, and
+ * the finished frame is handed back through a queued call and presented
+ * with the then-current camera. Each request gets a new generation; a
+ * newer request cancels the build in flight, and a frame that arrives for
+ * an older generation is dropped. Snapshot loads, @ref save_snapshot() and
+ * @ref render_to_image() stay synchronous.
+ *
  * @par Headless capture
- * @ref render_to_image() never touches the on-screen widget or its
- * @ref rhi_renderer. It constructs a transient @ref rhi_renderer via the
- * headless (size-based) constructor, runs the draw callback through it,
- * calls @ref rhi_renderer::flush_capture(), and passes the captured
- * frame into the static helper @ref RhiCanvasWidget::render_offscreen(),
- * which builds its own standalone @c QRhi over @c QOffscreenSurface. No
- * @ref RhiCanvasWidget instance is created.
+ * @ref render_to_image() never draws into the on-screen widget. When the
+ * widget presents an up-to-date scene (no redraw pending or building),
+ * @ref rhi_renderer::capture_presented() shares that scene and only redoes
+ * the MVP and the overlay for the requested size, so the image matches
+ * the screen and the draw callback does not run. Otherwise (headless
+ * canvas, memory-lean mode, stale scene) it constructs a transient
+ * @ref rhi_renderer via the headless (size-based) constructor, runs the
+ * draw callback through it and calls @ref rhi_renderer::flush_capture().
+ * Either frame goes to the static helper
+ * @ref RhiCanvasWidget::render_offscreen(), which renders it in the shared
+ * offscreen @c QRhi context. No @ref RhiCanvasWidget instance is created.
+ *
+ * @par Image sequences
+ * @ref queue_frame() captures a frame the same way but submits it to the
+ * shared @ref RhiOffscreenContext instead of rendering it at once. The
+ * context renders and reads back up to @ref RhiOffscreenContext::kRingSize
+ * frames per offscreen frame, so a sequence waits on the GPU once per
+ * batch instead of once per image. @ref render_views() batches its views
+ * the same way.
  */
 class rhi_backend final : public render_backend {
 public:
@@ -65,6 +98,10 @@ public:
     /// camera-only result).
     void redraw_camera_only() override;
 
+    /// Animation frame: like @ref redraw_camera_only but keeps the last
+    /// overlay (reprojected on the GPU) instead of re-laying it out.
+    void redraw_camera_transient() override;
+
     /// Open a defer window: coalesce multiple @ref redraw /
     /// @ref redraw_camera_only calls into a single GPU frame on close.
     void begin_deferred_redraw_cycle() override;
@@ -83,12 +120,63 @@ public:
     /// Headless PNG capture. See class brief for the offscreen flow.
     QImage render_to_image(int w, int h) override;
 
+    /// The offscreen context's texture size limit.
+    int max_image_size() const override;
+
+    /// Batch capture: the scene is taken from the widget, or recorded
+    /// once, and uploaded once; each view then costs an overlay layout, a
+    /// draw and a readback in the shared offscreen context.
+    bool render_views(std::size_t          count,
+                      const view_world_fn& world_of,
+                      int                  w,
+                      int                  h,
+                      const view_sink_fn&  sink) override;
+
+    /// Pipelined capture for sequences (see class brief). Declines off
+    /// the GUI thread, where there is no shared offscreen context.
+    bool queue_frame(int w, int h, frame_sink_fn sink) override;
+    void flush_frames() override;
+
+    /// The live renderer's index; a background build replaces it when
+    /// its frame is presented.
+    std::shared_ptr<const PickIndex> pick_index() const override;
+
+    /// Replay the snapshot at @p path in place of the draw callback on
+    /// every full redraw (and headless capture) until called again with an
+    /// empty path. Takes effect on the next redraw.
+    void set_scene_snapshot(const QString& path) { m_snapshot_path = path; }
+
+    /// Run the draw callback and write the assembled scene to @p path.
+    /// With a widget the frame is also presented, as by @ref redraw().
+    bool save_snapshot(const QString& path);
+
+    /// Rebuild scenes on a background thread (see class brief). Turning it
+    /// off cancels a build in flight and redraws synchronously instead.
+    void set_async_redraw(bool enabled);
+
+    /// Geometry storage for scenes built from now on, by both the live
+    /// renderer and headless captures. See @ref SceneStorageOptions.
+    void set_scene_storage(const SceneStorageOptions& options);
+
 private:
+    void post_background_build();
+    bool background_build_busy() const;
+    /// True if the widget shows the scene a redraw would build now.
+    bool live_scene_current() const;
+    /// Drop whatever the builder is doing, as its result would be stale,
+    /// and wait until it has left the draw callback.
+    void cancel_background_build();
+    /// A transient renderer of @p size that has run the draw callback (or
+    /// loaded the snapshot), ready for a capture.
+    std::unique_ptr<rhi_renderer> record_headless(QSize size) const;
+
     RhiCanvasWidget*              m_widget;
     draw_canvas_fn                m_draw_callback;
     camera*                       m_camera;
     QColor                        m_bg_color;
     std::unique_ptr<rhi_renderer> m_renderer;
+    SceneStorageOptions           m_scene_storage;
+    QString                       m_snapshot_path;
 
     bool m_defer_redraw        = false;
     bool m_pending_redraw      = false;
@@ -97,6 +185,16 @@ private:
 
     int m_last_w = 0;
     int m_last_h = 0;
+
+    bool          m_async_redraw     = false;
+    std::uint64_t m_build_generation = 0;
+
+    // Context for the queued hand-back from the builder thread: deleting
+    // it discards deliveries that have not run yet. Declared after
+    // m_renderer and before m_builder so the builder thread is joined
+    // first and the renderer outlives both.
+    std::unique_ptr<QObject>         m_async_context;
+    std::unique_ptr<RhiSceneBuilder> m_builder;
 };
 
 } // namespace ezgl
@@ -8,7 +8,11 @@
 #include <QMatrix4x4>
 #include <QMutex>
 #include <QColor>
+#include <atomic>
+#include <cstddef>
 #include <memory>
+#include <unordered_set>
+#include <vector>
 
 namespace ezgl {
 
@@ -23,16 +27,47 @@ namespace ezgl {
  * for the swapchain.
  *
  * @par Thread-safe frame inbox
- * @ref rhi_renderer calls @ref set_frame_data / @ref set_mvp_only /
- * @ref set_mvp_and_overlay on the main thread; @ref render() consumes the
- * pending state on the Qt render thread. The inbox fields
- * (@c m_pending_scene_buffers, @c m_pending_mvp, @c m_pending_overlay,
- * @c m_pending_bg) are guarded by @c m_frame_mutex. Writers hold it
- * briefly to swap state and set @c m_frame_dirty / @c m_mvp_dirty. The
- * render thread snapshots and clears under the same lock at the top of
- * @ref render(). The scene is held as @c shared_ptr<const SceneBuffers>
- * so the render thread can keep using the previous frame while the main
- * thread builds the next one without copying.
+ * @ref rhi_renderer calls @ref set_frame_data / @ref set_mvp_only on the
+ * main thread, and its overlay worker calls @ref set_overlay from a
+ * background thread; @ref render() consumes the pending state on the Qt
+ * render thread. The inbox fields (@c m_pending_scene_buffers,
+ * @c m_pending_mvp, @c m_pending_overlay, @c m_pending_bg) are guarded
+ * by @c m_frame_mutex. Writers hold it briefly to swap state and set
+ * @c m_frame_dirty / @c m_mvp_dirty. The render thread snapshots and
+ * clears under the same lock at the top of @ref render(). The scene is
+ * held as @c shared_ptr<const SceneBuffers> so the render thread can keep
+ * using the previous frame while the main thread builds the next one
+ * without copying.
+ *
+ * @par Overlay lag
+ * The overlay is not replaced by scene or MVP updates: the last delivered
+ * overlay stays on screen, together with the MVP it was rasterized for,
+ * until @ref set_overlay brings a newer one. @ref RhiSceneRenderer warps
+ * it by @c mvp * inverse(overlay_mvp) in the meantime, so labels track
+ * pan/zoom while the worker is still painting.
+ *
+ * @par Memory-lean mode
+ * @ref set_retain_cpu_scene(false) lets @ref RhiSceneRenderer drop its CPU
+ * copy of the scene once the geometry is on the GPU. If the GPU pools
+ * are later lost (a new @c QRhi after device loss or reparenting),
+ * @ref scene_lost is emitted so the owner can re-run the draw callback.
+ * Plain resizes keep the scene renderer and its pools alive.
+ * @ref resident_cpu_scene_bytes reports what is held in either mode.
+ *
+ * @par Progressive upload
+ * With @ref set_upload_budget the first frames of a new scene upload at
+ * most that many bytes each, visible region first. The widget keeps
+ * scheduling repaints until the scene is resident and reports each step
+ * through @ref upload_progress.
+ *
+ * @par Overlay tiles
+ * With @ref set_overlay_tile_budget the overlay's world content is cached
+ * as world-space tiles in VRAM (see @ref RhiOverlayTileCache).
+ * @ref rhi_renderer publishes which tiles the view needs through
+ * @ref set_overlay_tile_view, and the overlay worker hands finished ones to
+ * @ref add_overlay_tile. The widget remembers which tiles of the current
+ * epoch are resident, so @ref missing_overlay_tiles lets the renderer ask
+ * only for what the GPU does not already hold.
  *
  * @par Responsibilities
  *  - Thread-safe receipt of frame data from @ref rhi_renderer.
@@ -50,32 +85,74 @@ namespace ezgl {
 class RhiCanvasWidget : public QRhiWidget {
     Q_OBJECT
 public:
+    /// Overlay updates kept so a frame slot that missed some can still be
+    /// patched instead of re-uploaded (a few frames in flight, plus slack).
+    static constexpr std::size_t kOverlayHistory = 8;
+
     explicit RhiCanvasWidget(QWidget* parent = nullptr);
     ~RhiCanvasWidget() override;
 
     // ---- Frame data API (thread-safe, called from rhi_renderer) -------------
 
-    /// Full frame update: replace scene geometry, MVP, overlay, and
-    /// background. Marks both geometry and MVP dirty. Called after a
-    /// full @ref rhi_renderer::flush().
+    /// Full frame update: replace scene geometry, MVP, and background.
+    /// Marks geometry dirty. Called after a full @ref rhi_renderer::flush().
+    /// The overlay arrives separately through @ref set_overlay.
     void set_frame_data(SceneBuffers      scene_buffers,
                         const QMatrix4x4& world_to_ndc,
                         const rectangle&  visible_world,
-                        const QImage&     overlay,
                         QColor            bg_color);
 
-    /// MVP-only update for pan/zoom with no scene/overlay change. Marks
-    /// MVP dirty without invalidating geometry. The render thread will
-    /// re-render the cached scene with the new transform.
+    /// MVP-only update for pan/zoom with no scene change. Marks MVP dirty
+    /// without invalidating geometry. The render thread will re-render the
+    /// cached scene, and reproject the current overlay, with the new
+    /// transform. Used by @ref rhi_renderer::flush_mvp_only().
     void set_mvp_only(const QMatrix4x4& world_to_ndc,
                       const rectangle&  visible_world);
 
-    /// MVP + overlay update: scene geometry unchanged, but overlay text /
-    /// arcs were re-laid out for the new camera. Used by
-    /// @ref rhi_renderer::flush_mvp_only().
-    void set_mvp_and_overlay(const QMatrix4x4& world_to_ndc,
-                             const rectangle&  visible_world,
-                             const QImage&     overlay);
+    /// Replace the overlay images. @p overlay holds the WORLD content and
+    /// @p overlay_mvp is the world→NDC matrix it was laid out for;
+    /// @p update says how it differs from the previous image, which lets
+    /// the GPU texture be patched in place. @p screen holds the SCREEN
+    /// content, which is never reprojected. Safe to call from any thread;
+    /// the caller still has to schedule a repaint on the GUI thread.
+    void set_overlay(QImage overlay, QImage screen, const QMatrix4x4& overlay_mvp,
+                     const OverlayUpdate& update = {});
+
+    /// Keep (default) or drop the CPU scene after it has been uploaded.
+    /// See the memory-lean mode notes above.
+    void set_retain_cpu_scene(bool retain);
+
+    /// CPU-side scene bytes currently alive: the scene waiting in the
+    /// inbox plus the copy @ref RhiSceneRenderer retains (zero in
+    /// memory-lean mode once uploaded). Thread-safe.
+    std::size_t resident_cpu_scene_bytes() const;
+
+    /// Per-frame geometry upload budget in bytes; 0 (default) uploads a
+    /// new scene in one frame. Takes effect from the next frame.
+    void set_upload_budget(std::size_t bytes_per_frame);
+
+    /// The scene most recently passed to @ref set_frame_data, if it is
+    /// still alive (always, unless memory-lean mode dropped it after the
+    /// upload). Shared, not copied. Thread-safe.
+    std::shared_ptr<const SceneBuffers> presented_scene() const;
+
+    /// VRAM budget for cached overlay tiles in bytes; 0 (default) turns
+    /// tiling off. Takes effect from the next frame.
+    void set_overlay_tile_budget(std::size_t bytes);
+    std::size_t overlay_tile_budget() const;
+
+    /// Tiles the next frames should draw. A view of a new epoch forgets
+    /// every tile known so far; epoch 0 turns tiling off.
+    void set_overlay_tile_view(OverlayTileView view);
+
+    /// Hand over a rasterized tile for upload by the next frame. Safe to
+    /// call from any thread; the caller still has to schedule a repaint.
+    void add_overlay_tile(OverlayTile tile);
+
+    /// The subset of @p keys that is neither resident nor on its way to
+    /// the GPU for @p epoch, in the order given.
+    std::vector<OverlayTileKey> missing_overlay_tiles(std::uint64_t               epoch,
+                                                      std::vector<OverlayTileKey> keys) const;
 
     // ---- Headless rendering (no QRhiWidget::grab(), works on offscreen QPA) -
 
@@ -85,10 +162,12 @@ public:
      * shares the @ref RhiSceneRenderer setup logic with the on-screen
      * path.
      *
-     * Builds a standalone @c QRhi via @c create_headless_rhi (tries
-     * D3D11 on Windows / Metal on macOS / OpenGL 4.1 core elsewhere),
-     * runs @ref RhiSceneRenderer against an offscreen MSAA render
-     * target, then reads pixels back as a QImage.
+     * Renders through the shared @ref RhiOffscreenContext (a standalone
+     * @c QRhi: D3D11 on Windows / Metal on macOS / OpenGL 4.1 core
+     * elsewhere), which keeps the QRhi, the @ref RhiSceneRenderer
+     * pipelines and the render target between calls, then reads pixels
+     * back as a QImage. Off the GUI thread a private context is built and
+     * torn down for the call.
      *
      * The render target is a 4x-MSAA RGBA8 color texture with an
      * attached single-sample resolve texture. QRhi resolves MSAA into
@@ -102,20 +181,33 @@ public:
      * the headless visual regression tests under any QPA, including
      * @c offscreen.
      *
+     * @p scene is only read, so the live widget's scene can be passed
+     * as is (see @ref presented_scene).
+     *
      * @return The rendered QImage, or a null QImage if no backend can be
      *         created on this machine.
      */
-    static QImage render_offscreen(int               w,
-                                   int               h,
-                                   SceneBuffers      scene,
-                                   const QMatrix4x4& mvp,
-                                   const rectangle&  visible_world,
-                                   const QImage&     overlay,
-                                   QColor            bg);
+    static QImage render_offscreen(int                                 w,
+                                   int                                 h,
+                                   std::shared_ptr<const SceneBuffers> scene,
+                                   const QMatrix4x4&                   mvp,
+                                   const rectangle&                    visible_world,
+                                   const QImage&                       overlay,
+                                   QColor                              bg);
 
 signals:
     void resized(int w, int h);
 
+    /// Memory-lean mode only: the GPU geometry was lost and no CPU copy
+    /// is left to restore it. Connect to a full redraw.
+    void scene_lost();
+
+    /// Emitted after every frame that uploaded scene geometry, with the
+    /// bytes resident so far and the scene total. Every upload ends with
+    /// an emission where @p uploaded == @p total, including one that fit
+    /// in a single frame or ran without a budget.
+    void upload_progress(qulonglong uploaded, qulonglong total);
+
 protected:
     void initialize(QRhiCommandBuffer* cb) override;
     void render(QRhiCommandBuffer* cb) override;
@@ -130,19 +222,33 @@ private:
     // ---- Pending frame state (written by rhi_renderer, read by render()) ----
     mutable QMutex                       m_frame_mutex;
     std::shared_ptr<const SceneBuffers>  m_pending_scene_buffers;
+    std::weak_ptr<const SceneBuffers>    m_presented_scene; // owned by the inbox or RhiSceneRenderer
     QMatrix4x4                           m_pending_mvp;
     rectangle                            m_pending_visible_world;
-    QImage                               m_pending_overlay;
+    OverlayFrame                         m_pending_overlay;
     QColor                               m_pending_bg  { Qt::white };
     bool                                 m_frame_dirty = false;
     bool                                 m_mvp_dirty   = false;
+    std::size_t                          m_pending_scene_bytes  = 0;
+    bool                                 m_retain_cpu_scene     = true;
+    bool                                 m_scene_lost_signalled = false;
+    std::size_t                          m_upload_budget_bytes  = 0;
+    std::size_t                          m_overlay_tile_budget  = 0;
+    std::vector<OverlayTile>             m_pending_tiles;
+    // Tiles of m_pending_overlay.tiles.epoch uploaded or queued for upload
+    std::unordered_set<OverlayTileKey, OverlayTileKeyHash> m_known_tiles;
+
+    // Written after each render(), read by resident_cpu_scene_bytes().
+    std::atomic<std::size_t>             m_renderer_scene_bytes{0};
 };
 
 /**
  * Returns true if a GPU-accelerated QRhi backend can be created on this
  * machine (Metal on macOS, D3D11 on Windows, OpenGL on Linux/other). The
  * result is cached after the first call so the probe is only performed once
- * per process. Returns false on headless CI without a GPU or GPU drivers.
+ * per process; on the GUI thread the probed QRhi is kept as the shared
+ * @ref RhiOffscreenContext. Returns false on headless CI without a GPU or
+ * GPU drivers.
  */
 bool probe_rhi();
 
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "ezgl/qt/rhi_types.hpp"
+#include "ezgl/qt/rhi_scene_renderer.hpp"
+
+#include <QColor>
+#include <QImage>
+#include <QMatrix4x4>
+#include <QSize>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+QT_FORWARD_DECLARE_CLASS(QOffscreenSurface)
+QT_FORWARD_DECLARE_CLASS(QRhi)
+QT_FORWARD_DECLARE_CLASS(QRhiRenderPassDescriptor)
+QT_FORWARD_DECLARE_CLASS(QRhiTexture)
+QT_FORWARD_DECLARE_CLASS(QRhiTextureRenderTarget)
+
+namespace ezgl {
+
+/**
+ * @brief Long-lived headless QRhi plus everything needed to render scenes
+ * into it, shared by all offscreen renders of the process.
+ *
+ * Creating a QRhi, compiling the pipelines of @ref RhiSceneRenderer and
+ * allocating the MSAA and resolve targets costs far more than drawing one
+ * image. The context keeps all of it between calls, so every headless image
+ * after the first only pays for the geometry upload, the draw and the
+ * readback:
+ *  - the QRhi (and, on the OpenGL path, its offscreen surface) is created
+ *    once; @ref probe_rhi() uses the same instance instead of a throwaway;
+ *  - the pipelines are built once, against a render pass descriptor that
+ *    is kept across targets (every target has the same format and sample
+ *    count, so they are all compatible with it);
+ *  - the color and resolve textures are only re-created when the requested
+ *    size changes;
+ *  - a scene is only uploaded when it differs from the previous call's, so
+ *    rendering one scene from many cameras costs one upload.
+ *
+ * @par Batched readback
+ * QRhi offscreen frames are synchronous: @c endOffscreenFrame() waits for
+ * the GPU, so one frame per image pays a full CPU/GPU round trip each
+ * time. @ref submit() instead queues frames, and @ref flush() records up
+ * to @ref kRingSize of them, each into its own target of a ring, into one
+ * offscreen frame with one readback per target. The GPU draws the batch
+ * back to back and the CPU waits once per batch. The renderer is set up
+ * with one frame slot per ring entry so the batch's uniform and overlay
+ * uploads do not overwrite each other. Sequences, view batches and tile
+ * pyramids go through this path; @ref render() is a batch of one.
+ *
+ * @par Threading
+ * A QRhi belongs to the thread that created it (an OpenGL context cannot
+ * be current on two threads). @ref instance() therefore only hands out the
+ * shared context on the GUI thread; other threads get null and have to
+ * build a private context for their render. The shared context is destroyed
+ * from a Qt post routine, while the application object and its platform
+ * integration still exist.
+ */
+class RhiOffscreenContext {
+public:
+    /// Create the QRhi; check @ref is_valid() before use.
+    RhiOffscreenContext();
+    ~RhiOffscreenContext();
+
+    RhiOffscreenContext(const RhiOffscreenContext&)            = delete;
+    RhiOffscreenContext& operator=(const RhiOffscreenContext&) = delete;
+
+    /**
+     * The process-wide context, created on first use. Null when called off
+     * the GUI thread, before a QGuiApplication exists, or when no QRhi
+     * backend is available on this machine.
+     */
+    static RhiOffscreenContext* instance();
+
+    /// Frames recorded into one offscreen frame by @ref flush().
+    static constexpr std::size_t kRingSize = 4;
+
+    /// Receives a frame queued with @ref submit(); null on failure.
+    using image_sink_fn = std::function<void(QImage image)>;
+
+    bool  is_valid() const noexcept { return m_rhi != nullptr; }
+    QRhi* rhi() const noexcept { return m_rhi.get(); }
+
+    /// Largest width or height of a render target; 0 if invalid.
+    int max_texture_size() const;
+
+    /**
+     * Queue one frame at @p w x @p h device pixels. @p sink gets the image
+     * from the @ref flush() that renders it, on the calling thread, in
+     * submission order; submit() flushes by itself once @ref kRingSize
+     * frames are queued. @p scene and @p overlay are held until then.
+     */
+    void submit(int                                 w,
+                int                                 h,
+                std::shared_ptr<const SceneBuffers> scene,
+                const QMatrix4x4&                   mvp,
+                const rectangle&                    visible_world,
+                QImage                              overlay,
+                QColor                              bg,
+                image_sink_fn                       sink);
+
+    /// Render every queued frame in one offscreen frame, read them all
+    /// back and hand each to its sink.
+    void flush();
+
+    /// Frames submitted but not rendered yet.
+    std::size_t queued() const noexcept { return m_queue.size(); }
+
+    /**
+     * Render one frame at @p w x @p h device pixels and read it back. See
+     * @ref RhiCanvasWidget::render_offscreen for the target layout and the
+     * Y-flip. The geometry of @p scene is uploaded unless it is the same
+     * object as in the previous call. Flushes frames queued by
+     * @ref submit() along with it. Returns a null QImage on failure.
+     */
+    QImage render(int                                 w,
+                  int                                 h,
+                  std::shared_ptr<const SceneBuffers> scene,
+                  const QMatrix4x4&                   mvp,
+                  const rectangle&                    visible_world,
+                  const QImage&                       overlay,
+                  QColor                              bg);
+
+private:
+    /// One ring entry: MSAA color texture, resolve texture and target.
+    struct Target {
+        std::unique_ptr<QRhiTexture>             color_tex;
+        std::unique_ptr<QRhiTexture>             resolve_tex;
+        std::unique_ptr<QRhiTextureRenderTarget> rt;
+        QSize                                    size;
+    };
+
+    /// A frame waiting for flush().
+    struct PendingFrame {
+        QSize                               size;
+        std::shared_ptr<const SceneBuffers> scene;
+        QMatrix4x4                          mvp;
+        rectangle                           visible_world;
+        QImage                              overlay;
+        QColor                              bg;
+        image_sink_fn                       sink;
+    };
+
+    /// (Re)create @p target for @p size; false on failure.
+    bool ensure_target(Target& target, QSize size);
+    void release_target(Target& target);
+
+    // Declaration order is destruction order in reverse: the surface has to
+    // outlive the QRhi, and every resource has to go before it.
+    std::unique_ptr<QOffscreenSurface>        m_gl_surface; // OpenGL path only
+    std::unique_ptr<QRhi>                     m_rhi;
+    std::unique_ptr<QRhiRenderPassDescriptor> m_rp_desc;
+    std::array<Target, kRingSize>             m_targets;
+    std::vector<PendingFrame>                 m_queue;
+    std::weak_ptr<const SceneBuffers>         m_uploaded_scene;
+    std::unique_ptr<RhiSceneRenderer>         m_renderer;
+};
+
+} // namespace ezgl
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "ezgl/qt/rhi_types.hpp"
+
+#include <QMatrix4x4>
+#include <QSize>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+QT_FORWARD_DECLARE_CLASS(QRhiBuffer)
+QT_FORWARD_DECLARE_CLASS(QRhiCommandBuffer)
+QT_FORWARD_DECLARE_CLASS(QRhiGraphicsPipeline)
+QT_FORWARD_DECLARE_CLASS(QRhiRenderPassDescriptor)
+QT_FORWARD_DECLARE_CLASS(QRhiResourceUpdateBatch)
+QT_FORWARD_DECLARE_CLASS(QRhiSampler)
+QT_FORWARD_DECLARE_CLASS(QRhiShaderResourceBindings)
+QT_FORWARD_DECLARE_CLASS(QRhiTexture)
+QT_FORWARD_DECLARE_CLASS(QShader)
+QT_FORWARD_DECLARE_CLASS(QRhi)
+
+namespace ezgl {
+
+/**
+ * @brief GPU-resident overlay tiles, composited by @ref RhiSceneRenderer.
+ *
+ * Keeps one texture per @ref OverlayTile delivered by the overlay worker,
+ * keyed by @ref OverlayTileKey, and draws the tiles of the frame's
+ * @ref OverlayTileView as world-space quads over the scene. A tile stays
+ * resident after it leaves the view, so going back to a region (and zoom
+ * level) that was already seen draws it straight from VRAM: no replay, no
+ * rasterization, no upload.
+ *
+ * @par Budget and eviction
+ * Tiles are charged 4 bytes per texel against @ref set_budget. After each
+ * frame's uploads the tiles drawn longest ago are evicted until the cache
+ * fits; tiles drawn in the current frame never are, so a view larger than
+ * the budget overshoots it instead of flickering. Evicted keys are
+ * reported through @ref take_evicted so the owner requests them again when
+ * they come back into view.
+ *
+ * @par Epochs
+ * Tiles and views carry the epoch they were made for. A newer epoch (the
+ * overlay was re-recorded, the DPR changed) makes every resident tile
+ * stale. A stale tile is never drawn in its own right, but until the new
+ * epoch's tile for a slot arrives, stale tiles and tiles of other levels
+ * stand in for it, scissored to the slot (current epoch and nearest level
+ * first). Once every visible slot is current, stale tiles are dropped.
+ */
+class RhiOverlayTileCache {
+public:
+    RhiOverlayTileCache() = default;
+    ~RhiOverlayTileCache();
+
+    RhiOverlayTileCache(const RhiOverlayTileCache&)            = delete;
+    RhiOverlayTileCache& operator=(const RhiOverlayTileCache&) = delete;
+
+    /**
+     * Build the tile pipeline (the overlay shaders, with scissoring) and
+     * @p frame_slots vertex buffers. @p layout_srb is any SRB with one
+     * sampled texture at binding 0, used as the pipeline's layout.
+     */
+    void initialize(QRhi*                       rhi,
+                    QRhiRenderPassDescriptor*   rp_desc,
+                    int                         frame_slots,
+                    const QShader&              vs,
+                    const QShader&              fs,
+                    QRhiShaderResourceBindings* layout_srb);
+
+    /** Destroy all GPU objects and forget every tile. */
+    void release();
+
+    void set_budget(std::size_t bytes) noexcept { m_budget_bytes = bytes; }
+    std::size_t budget() const noexcept { return m_budget_bytes; }
+
+    /** Texture bytes of the tiles currently resident. */
+    std::size_t resident_bytes() const noexcept { return m_resident_bytes; }
+
+    /** Epoch of the newest view or tile seen. */
+    std::uint64_t epoch() const noexcept { return m_epoch; }
+
+    /** Queue @p tiles for upload by the next prepare(). */
+    void add(std::vector<OverlayTile> tiles);
+
+    /**
+     * Upload the queued tiles, choose what @p view draws and write its
+     * quads for @p frame_slot, then evict down to the budget. A view of
+     * epoch 0 empties the cache.
+     */
+    void prepare(QRhiResourceUpdateBatch* u,
+                 int                      frame_slot,
+                 const OverlayTileView&   view,
+                 const QMatrix4x4&        mvp,
+                 const QSize&             pixel_size);
+
+    /** Record the draws prepared for @p frame_slot. */
+    void draw(QRhiCommandBuffer* cb, int frame_slot) const;
+
+    /** Keys of the current epoch evicted since the last call. */
+    std::vector<OverlayTileKey> take_evicted();
+
+private:
+    struct Entry {
+        std::unique_ptr<QRhiTexture>                texture;
+        std::unique_ptr<QRhiShaderResourceBindings> srb;
+        rectangle                                   world;
+        std::uint64_t                               epoch           = 0;
+        std::uint64_t                               last_used_frame = 0;
+        std::size_t                                 bytes           = 0;
+    };
+
+    struct Draw {
+        QRhiShaderResourceBindings* srb = nullptr;
+        int                         scissor[4] = {0, 0, 0, 0}; ///< x, y (bottom-left origin), w, h
+    };
+
+    struct SlotResources {
+        std::unique_ptr<QRhiBuffer> vbuf;
+        std::vector<Draw>           draws;
+    };
+
+    using EntryMap = std::unordered_map<OverlayTileKey, Entry, OverlayTileKeyHash>;
+
+    void upload(QRhiResourceUpdateBatch* u, OverlayTile& tile);
+
+    /// Hand @p it's GPU objects to deleteLater() and erase it.
+    EntryMap::iterator retire(EntryMap::iterator it);
+
+    void clear();
+    void evict_to_budget();
+
+    QRhi*                                 m_rhi = nullptr;
+    std::unique_ptr<QRhiGraphicsPipeline> m_pso;
+    std::unique_ptr<QRhiSampler>          m_sampler;
+    std::vector<SlotResources>            m_slots;
+    EntryMap                              m_entries;
+    std::vector<OverlayTile>              m_incoming;
+    std::vector<OverlayTileKey>           m_evicted;
+    std::uint64_t                         m_epoch          = 0;
+    std::uint64_t                         m_frame          = 0;
+    std::size_t                           m_budget_bytes   = 0;
+    std::size_t                           m_resident_bytes = 0;
+};
+
+} // namespace ezgl
@@ -0,0 +1,247 @@
+#pragma once
+
+#include "ezgl/camera.hpp"
+#include "ezgl/qt/deferred_renderer.hpp"
+#include "ezgl/qt/painter.hpp"
+#include "ezgl/qt/rhi_types.hpp"
+
+#include <QImage>
+#include <QMatrix4x4>
+#include <QSize>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace ezgl {
+
+/**
+ * @brief One recorded overlay (text, arcs, surfaces, SCREEN primitives)
+ * plus the camera it is replayed against.
+ *
+ * The @ref deferred_renderer's transform is bound to @c cam — a copy owned
+ * by the layer — rather than to the live canvas camera. Recording happens
+ * on the GUI thread with @c cam synced from the live camera; rasterization
+ * happens on the @ref RhiOverlayWorker thread with @c cam overwritten by
+ * the camera snapshot of the job. Neither side ever reads the live camera
+ * while the other is running.
+ *
+ * Between replays the recorder paints into @c measure_painter, a 1x1
+ * surface that only serves text metrics at record time, so it never holds
+ * a pointer to a painter that belongs to another thread.
+ *
+ * @c revision is bumped by the GUI thread whenever the recording may have
+ * changed; the worker only reuses pixels rasterized from the same revision.
+ *
+ * @c queued_jobs counts worker jobs (pending or running) that reference
+ * this layer. The GUI thread must not touch @c recorder while it is
+ * non-zero; @ref rhi_renderer either waits (@ref RhiOverlayWorker::quiesce)
+ * or starts recording into a fresh layer.
+ */
+struct RhiOverlayLayer {
+    explicit RhiOverlayLayer(const camera& live_camera);
+
+    QImage                             measure_surface;
+    Painter                            measure_painter; // must be declared AFTER measure_surface
+    camera                             cam;
+    std::unique_ptr<deferred_renderer> recorder;
+    std::uint64_t                      revision = 0;
+    std::atomic<int>                   queued_jobs{0};
+};
+
+/**
+ * @brief World-space grid the overlay tile cache is keyed on.
+ *
+ * Level @c L rasterizes at @c 2^(L/kLevelsPerOctave) device pixels per world
+ * unit along x, and a tile is @c kTilePx device pixels square, so tile
+ * @c (x, y) of a level always covers the same world rectangle. A camera
+ * uses the level nearest its own scale; content laid out in screen pixels
+ * (text size, arrow heads) is then off by at most half a level step, about
+ * one percent. y uses the camera's y/x scale ratio, which is part of the
+ * grid and does not change with zoom.
+ */
+struct OverlayTileGrid {
+    static constexpr int kTilePx          = 256;
+    static constexpr int kLevelsPerOctave = 32;
+
+    int    level          = 0;
+    double px_per_world_x = 1.0; ///< device pixels per world unit at @c level
+    double px_per_world_y = 1.0;
+
+    /// Grid level nearest to @p cam's scale at @p dpr.
+    static OverlayTileGrid for_camera(const camera& cam, qreal dpr);
+
+    /// Tiles are laid out inside the camera's screen rectangle, so it has
+    /// to hold at least one tile in each direction.
+    static bool fits(const camera& cam, qreal dpr);
+
+    double    tile_width() const { return kTilePx / px_per_world_x; }
+    double    tile_height() const { return kTilePx / px_per_world_y; }
+    rectangle tile_world(const OverlayTileKey& key) const;
+
+    /// Keys of the tiles meeting @p world, grown by @p margin tiles on
+    /// every side, nearest to its centre first.
+    std::vector<OverlayTileKey> tiles_covering(const rectangle& world, int margin) const;
+};
+
+/**
+ * @brief Background thread that rasterizes @ref RhiOverlayLayer commands
+ * into overlay QImages for the rhi backend.
+ *
+ * QPainter text layout and glyph rasterization into a QImage is safe off
+ * the GUI thread, so camera-only redraws post a job here and return
+ * immediately. A job is delivered as two images: the WORLD content,
+ * together with the world→NDC matrix it was laid out for, so
+ * @ref RhiSceneRenderer can reproject the previous one until the new one
+ * arrives, and the SCREEN content (legends, HUD text), which stays where it
+ * is. The SCREEN image is reused as long as the layer, its revision and
+ * the viewport size are unchanged.
+ *
+ * @par Coalescing
+ * At most one job is pending at a time: posting replaces any job that has
+ * not started yet (latest camera wins). A job that is already running is
+ * never interrupted; its result is delivered and immediately superseded by
+ * the next one.
+ *
+ * @par Translate-only reuse
+ * When a job differs from the previous one only by a pan (same layer and
+ * revision, same size, same world width and height), the previous WORLD
+ * image is shifted by the pan rounded to whole device pixels and only the
+ * exposed strips are replayed, clipped, through
+ * @ref deferred_renderer::replay_overlay(const QRectF&, overlay_space). The
+ * image is laid out for the camera at that rounded position and delivered
+ * with its matching matrix, so the GPU's reprojection absorbs the sub-pixel
+ * rest and nothing drifts across a long drag. The @ref OverlayUpdate handed to the
+ * delivery callback describes the shift and the repainted strips.
+ *
+ * @par Tiles
+ * With the overlay tile cache on, @ref post_tiles queues world-space tiles
+ * (@ref OverlayTileGrid) instead: each is replayed with only the WORLD
+ * content, clipped to the tile, and delivered on its own through the tile
+ * callback. Tiles are rasterized one at a time, so a screen job or a newer
+ * tile list takes over between two tiles; the list is ordered visible
+ * first, and the prefetch ring behind it only runs while nothing newer is
+ * waiting.
+ */
+class RhiOverlayWorker {
+public:
+    struct Job {
+        std::shared_ptr<RhiOverlayLayer> layer;
+        camera                           cam;          ///< snapshot of the live camera
+        QSize                            logical_size; ///< framebuffer size in logical pixels
+        qreal                            dpr = 1.0;
+        QMatrix4x4                       mvp;          ///< world→NDC matching @c cam
+        std::uint64_t                    revision = 0; ///< @c layer->revision when posted
+        overlay_space                    space = overlay_space::all;
+    };
+
+    struct TileJob {
+        std::shared_ptr<RhiOverlayLayer> layer;
+        camera                           cam;       ///< supplies the screen rectangle tiles are laid out in
+        qreal                            dpr = 1.0;
+        OverlayTileGrid                  grid;
+        std::uint64_t                    epoch = 0; ///< stamped on every delivered tile
+        std::vector<OverlayTileKey>      keys;      ///< visible tiles first, then prefetch
+    };
+
+    /// Called on the worker thread with each finished overlay: @p overlay
+    /// holds the WORLD content laid out for @p overlay_mvp, @p screen the
+    /// SCREEN content. A job's @c space leaves the other one null.
+    using deliver_fn = std::function<void(QImage               overlay,
+                                          QImage               screen,
+                                          const QMatrix4x4&    overlay_mvp,
+                                          const OverlayUpdate& update)>;
+
+    /// Called on the worker thread with each finished tile.
+    using deliver_tile_fn = std::function<void(OverlayTile tile)>;
+
+    explicit RhiOverlayWorker(deliver_fn deliver, deliver_tile_fn deliver_tile = {});
+    ~RhiOverlayWorker();
+
+    RhiOverlayWorker(const RhiOverlayWorker&)            = delete;
+    RhiOverlayWorker& operator=(const RhiOverlayWorker&) = delete;
+
+    /// Queue @p job, replacing a job that has not started yet.
+    void post(Job job);
+
+    /// Queue the tiles of @p job, replacing the tiles of an earlier list
+    /// that have not been started yet.
+    void post_tiles(TileJob job);
+
+    /// Drop the pending job and tiles, if any. A running job is left alone.
+    void cancel_pending();
+
+    /// Drop the pending job and tiles and block until the running one (if
+    /// any) has been delivered. Only used on the rare paths that must mutate a layer
+    /// the worker may be reading.
+    void quiesce();
+
+    /// Block until the pending job and tiles (if any) have run too. For
+    /// readers of a layer that must not cancel what was queued for display.
+    void drain();
+
+    /// Replay @p layer for @p cam into a new transparent QImage of
+    /// @p logical_size at @p dpr. Runs on the calling thread; used by the
+    /// worker and by the synchronous headless capture path.
+    static QImage rasterize(RhiOverlayLayer& layer,
+                            const camera&    cam,
+                            QSize            logical_size,
+                            qreal            dpr,
+                            overlay_space    space = overlay_space::all);
+
+    /// Replay the WORLD content of @p layer inside tile @p key of @p grid
+    /// into a new transparent @c kTilePx square QImage at @p dpr.
+    static QImage rasterize_tile(RhiOverlayLayer&       layer,
+                                 const camera&          cam,
+                                 const OverlayTileGrid& grid,
+                                 const OverlayTileKey&  key,
+                                 qreal                  dpr);
+
+private:
+    /// Worker-thread record of the last delivered overlay.
+    struct Previous {
+        std::weak_ptr<RhiOverlayLayer> layer;
+        std::uint64_t                  revision = 0;
+        camera                         cam;   ///< camera the image is laid out for
+        QSize                          logical_size;
+        qreal                          dpr = 1.0;
+        QImage                         image;  ///< WORLD content
+        QImage                         screen; ///< SCREEN content
+    };
+
+    void run();
+    void drop_pending_locked();
+    void drop_tiles_locked();
+
+    /// True when @c m_previous was rasterized from the same layer revision
+    /// at the same viewport size as @p job.
+    bool same_layout(const Job& job) const;
+
+    /// Rasterize @p job by shifting @c m_previous when the camera only
+    /// panned. Returns false, leaving the outputs alone, when it cannot.
+    bool rasterize_shifted(const Job&     job,
+                           QImage&        overlay,
+                           QMatrix4x4&    overlay_mvp,
+                           camera&        laid_out_for,
+                           OverlayUpdate& update);
+
+    deliver_fn              m_deliver;
+    deliver_tile_fn         m_deliver_tile;
+    std::mutex              m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::optional<Job>      m_pending;
+    std::optional<TileJob>  m_tiles;
+    std::size_t             m_next_tile = 0; ///< index into m_tiles->keys
+    bool                    m_busy = false;
+    bool                    m_stop = false;
+    std::optional<Previous> m_previous; // worker thread only
+    std::thread             m_thread; // must be declared last: started in the constructor
+};
+
+} // namespace ezgl
@@ -2,13 +2,17 @@
 
 #include "ezgl/irenderer.hpp"
 #include "ezgl/qt/deferred_renderer.hpp"
+#include "ezgl/qt/pick_index.hpp"
 #include "ezgl/qt/rhi_types.hpp"
 #include "ezgl/qt/rhi_canvas_widget.hpp"
+#include "ezgl/qt/rhi_overlay_worker.hpp"
 
 #include <QMatrix4x4>
 #include <QImage>
+#include <atomic>
 #include <cstddef>
 #include <memory>
+#include <optional>
 #include <unordered_map>
 #include <vector>
 
@@ -40,6 +44,14 @@ namespace ezgl {
  * data is copied — record-time batches are intermediate, not the final
  * GPU-bound buffers.
  *
+ * @par Indexed fills
+ * @c fill_poly / @c fill_poly_with_holes record the whole triangulated
+ * polygon as one mesh (@c FillMeshCmd). At dispatch, triangles that lie
+ * inside a single tile share that tile's copy of their vertices, and only
+ * triangles cut by a tile edge are clipped into new vertices. Fill
+ * batches therefore carry a vertex array plus chunk-local indices (16-bit
+ * when the chunk has at most 65536 vertices), drawn with @c drawIndexed.
+ *
  * @par GPU vs CPU primitives
  * The following primitives are GPU-rendered through one of the six geometry
  * pipelines in @ref RhiSceneRenderer: @c draw_line, @c fill_rectangle,
@@ -48,10 +60,12 @@ namespace ezgl {
  * the fill_poly pipeline and the GPU arrow pipeline for
  * @c fill_arrow_pointer_triangle. All other primitives — @c draw_text,
  * @c draw_arc / @c fill_arc (and their elliptic variants), @c draw_surface,
- * SCREEN-coordinate-system overrides — forward to an owned
- * @ref deferred_renderer (@ref m_overlay_deferred) painting into the
- * @ref m_overlay QImage. That QImage is uploaded as a GPU texture and
- * composited on top of the GPU layers by the overlay pipeline.
+ * SCREEN-coordinate-system overrides — forward to the
+ * @ref deferred_renderer of the current @ref RhiOverlayLayer
+ * (@ref m_overlay_layer). The layer is rasterized into a QImage by
+ * @ref RhiOverlayWorker on a background thread; that QImage is uploaded
+ * as a GPU texture and composited on top of the GPU layers by the
+ * overlay pipeline.
  *
  * @par Parallel record
  * Per-primitive-type command vectors are sharded across N bands of tile
@@ -60,10 +74,13 @@ namespace ezgl {
  * are contention-free. See @c m_n_bands, @c m_rows_per_band.
  *
  * @par Camera-only redraws
- * On pan/zoom with no scene change, @ref flush_mvp_only() re-runs the
- * overlay callbacks (text/arc bounds depend on screen-space layout) but
- * leaves the GPU scene buffers untouched. The widget receives just a new
- * MVP + overlay image. The big win versus the deferred backend is here.
+ * On pan/zoom with no scene change, @ref flush_mvp_only() pushes a new
+ * MVP and leaves the GPU scene buffers untouched. The overlay (text/arc
+ * bounds depend on screen-space layout) is re-rasterized on the overlay
+ * worker; each delivered image carries the MVP it was laid out for, and
+ * @ref RhiSceneRenderer warps the last one to the current MVP until its
+ * replacement arrives. No frame ever waits on QPainter. The big win
+ * versus the deferred backend is here.
  *
  * @par Headless mode
  * The second constructor takes a @c QSize instead of a widget, and
@@ -84,11 +101,11 @@ public:
     /// so the caller can render it via RhiCanvasWidget::render_offscreen() without
     /// needing a live QRhiWidget or QRhiWidget::grab().
     struct HeadlessFrameData {
-        SceneBuffers scene;
-        QMatrix4x4   mvp;
-        rectangle    visible_world;
-        QImage       overlay;
-        QColor       bg;
+        std::shared_ptr<const SceneBuffers> scene;
+        QMatrix4x4                          mvp;
+        rectangle                           visible_world;
+        QImage                              overlay;
+        QColor                              bg;
     };
 
     /**
@@ -156,10 +173,12 @@ public:
     void draw_rectangle(const point2d& start, double width, double height) override;
     void draw_rectangle(const rectangle& r) override;
 
-    // ---- irenderer: overlay draw calls (forwarded to m_overlay_deferred) ---
+    // ---- irenderer: overlay draw calls (forwarded to overlay_recorder()) ---
 
     void fill_poly(const std::vector<point2d>& points) override;
     void fill_triangle(const point2d& a, const point2d& b, const point2d& c) override;
+    void fill_poly_with_holes(const std::vector<point2d>& outer,
+                              const std::vector<std::vector<point2d>>& holes) override;
     void fill_arrow_pointer_triangle(const point2d& anchor_world,
                                       const point2d& dir_world,
                                       float          arrow_size_px) override;
@@ -198,8 +217,8 @@ public:
     void begin_frame();
 
     /// Repack tile batches into @ref SceneBuffers, push frame data into
-    /// the bound @ref RhiCanvasWidget, and schedule a repaint. Also ends
-    /// the overlay painter so the QImage is fully flushed to bytes.
+    /// the bound @ref RhiCanvasWidget, and schedule a repaint. The overlay
+    /// is queued on the overlay worker and reaches the widget separately.
     void flush();
 
     /// Headless variant of @ref flush(): dispatches commands to tiles,
@@ -209,24 +228,100 @@ public:
     /// @ref RhiCanvasWidget::render_offscreen().
     HeadlessFrameData flush_capture(const QColor& bg);
 
-    /// Rebuild the overlay layer (text/arcs have screen-relative layout)
-    /// for the current camera and push a new MVP without re-running the
-    /// application draw callback or rebuilding any GPU scene buffers.
+    /// Capture what the bound widget shows, laid out for a @p size
+    /// framebuffer and the current camera, without re-running the draw
+    /// callback: the presented scene is shared, and only the MVP and the
+    /// overlay are redone. Waits for overlay jobs still reading the layer.
+    /// Returns std::nullopt if the widget no longer holds its scene
+    /// (memory-lean mode) or nothing was presented yet.
+    std::optional<HeadlessFrameData> capture_presented(QSize size, const QColor& bg);
+
+    /// Frame data for @p scene seen through the current camera on a
+    /// @p size framebuffer: only the MVP and the overlay are computed.
+    /// @p scene must have been assembled by this renderer (presented, or
+    /// returned by @ref flush_capture()) so it matches the overlay layer.
+    /// Call once per view to render many views of one recorded scene.
+    HeadlessFrameData capture_view(std::shared_ptr<const SceneBuffers> scene, QSize size, const QColor& bg);
+
+    /// Push a new MVP and queue an overlay rebuild (text/arcs have
+    /// screen-relative layout) for the current camera, without re-running
+    /// the application draw callback or rebuilding any GPU scene buffers.
+    /// Returns without waiting for the overlay.
     ///
-    /// What gets re-uploaded on this path: just @c mvp_ubuf (80 B) plus
-    /// the overlay QImage as a texture (because text/arc bounds depend
-    /// on the camera). Scene VBOs are untouched in VRAM. The cheapness
+    /// What gets re-uploaded on this path: just @c mvp_ubuf (80 B) plus,
+    /// once the worker delivers it, the overlay QImage as a texture
+    /// (because text/arc bounds depend on the camera). Scene VBOs are untouched in VRAM. The cheapness
     /// of camera-only pan/zoom relies on @ref RhiSceneRenderer::render()
     /// re-evaluating @ref ezgl::Chunk visibility against the new
     /// @c visible_world on every frame (not only on @c geom_dirty), so
     /// the freshly-pannned viewport's draw call set is recomputed
     /// without rebuilding any geometry.
-    void flush_mvp_only();
+    ///
+    /// With @p relayout_overlay false (intermediate frames of a camera
+    /// animation) no overlay job is queued: the GPU keeps warping the last
+    /// overlay to the new MVP, and the call costs only the MVP update.
+    void flush_mvp_only(bool relayout_overlay = true);
+
+    /// Snapshot variant of @ref flush(): assembles the scene, writes it
+    /// together with the recorded overlay to @p path (see
+    /// scene_snapshot.hpp), then presents it like @ref flush() when a
+    /// widget is bound. Returns whether the file was written.
+    bool save_snapshot(const QString& path);
+
+    /// Replace the current frame with a snapshot from @p path instead of
+    /// recording one: resets like @ref begin_frame(), restores the overlay
+    /// recording and presents the stored scene. In headless mode the scene
+    /// is kept for the next @ref flush_capture(). Returns false if the
+    /// file could not be loaded; the frame is then empty.
+    bool load_snapshot(const QString& path);
+
+    /// A scene recorded and assembled by one renderer for another to
+    /// present; see @ref assemble_detached().
+    struct AssembledFrame {
+        SceneBuffers                     scene;
+        std::shared_ptr<RhiOverlayLayer> overlay;
+        std::shared_ptr<const PickIndex> picks;
+    };
+
+    /// Stop recording as soon as @p *token becomes true: GPU-bound draw
+    /// calls turn into no-ops, so the draw callback runs out quickly, and
+    /// @ref assemble_detached() gives up. Pass nullptr to detach. The token
+    /// must outlive the renderer or be detached first.
+    void set_cancel_token(const std::atomic<bool>* token) { m_cancel = token; }
+
+    /// Background-build variant of @ref flush() for a headless renderer:
+    /// assembles the recorded frame and hands it over together with its
+    /// overlay layer (recording continues into a fresh layer). Returns
+    /// std::nullopt if the cancel token fired before or during assembly.
+    std::optional<AssembledFrame> assemble_detached();
+
+    /// Present a frame built by another renderer's @ref assemble_detached()
+    /// as if this renderer had recorded it: the overlay layer is adopted
+    /// and queued for the current camera, the scene goes to the widget.
+    /// Must be called on the GUI thread of a widget-bound renderer.
+    void present_detached(AssembledFrame frame);
+
+    /// Choose where the next scenes built by @ref flush() /
+    /// @ref flush_capture() keep their geometry arrays. With
+    /// @c out_of_core set, each scene gets its own @ref SceneScratchFile
+    /// (falling back to the heap if the file cannot be created).
+    void set_scene_storage(const SceneStorageOptions& options) { m_scene_storage = options; }
+    const SceneStorageOptions& scene_storage() const { return m_scene_storage; }
+
+    /// Pick index of the scene last presented: every WORLD primitive
+    /// recorded under a nonzero pick id (see @ref irenderer::set_pick_id),
+    /// binned into the same tile grid as the geometry by
+    /// @c dispatch_commands_to_tiles. Null if that frame recorded no pick
+    /// ids or came from a snapshot. Kept across camera-only redraws.
+    std::shared_ptr<const PickIndex> pick_index() const { return m_pick_index; }
 
 private:
     static constexpr int kTileGridDimension  = 32;
     static constexpr int kBatchInitialReserve = 1024;
 
+    /// Full redraws a cached triangulation may go unused before eviction.
+    static constexpr std::uint64_t kTriangulationMaxIdleFrames = 2;
+
     struct TileThinLineBatch {
         StyleKey               style_key = 0;
         std::uint32_t          rgba = 0;
@@ -242,9 +337,10 @@ private:
     };
 
     struct TileFillPolyBatch {
-        StyleKey               style_key = 0;
-        std::uint32_t          rgba = 0;
-        std::vector<PosVertex> verts;
+        StyleKey                   style_key = 0;
+        std::uint32_t              rgba = 0;
+        std::vector<PosVertex>     verts;
+        std::vector<std::uint32_t> indices; ///< 3 per triangle, local to @c verts
         TileFillPolyBatch(StyleKey sk, std::uint32_t c) : style_key(sk), rgba(c) {}
     };
 
@@ -290,6 +386,18 @@ private:
         }
     };
 
+    /// One cached polygon triangulation. @c indices address the flattened
+    /// input (outer ring, then holes). The input itself is not kept: the
+    /// ring sizes and the first and last point are a cheap check against
+    /// a collision of the hash key.
+    struct TriangulationEntry {
+        std::vector<std::uint32_t> ring_sizes;
+        point2d                    first{0, 0};
+        point2d                    last{0, 0};
+        std::vector<std::uint32_t> indices;   ///< 3 per triangle; empty if degenerate
+        std::uint64_t              last_used_frame = 0;
+    };
+
     // ---- helpers ------------------------------------------------------------
 
     StyleKey current_style_key(PrimitiveType primitive_type,
@@ -319,12 +427,11 @@ private:
                           const point2d& p1,
                           StyleKey      style_key,
                           std::uint32_t rgba);
-    void append_fill_triangle(RhiTileBatch& tile,
-                              const point2d& a,
-                              const point2d& b,
-                              const point2d& c,
-                              StyleKey      style_key,
-                              std::uint32_t rgba);
+    void append_fill_polygon(RhiTileBatch&  tile,
+                             const point2d* points,
+                             int            count,
+                             StyleKey       style_key,
+                             std::uint32_t  rgba);
     void append_line_to_tiles(const point2d& start,
                               const point2d& end,
                               StyleKey style_key,
@@ -367,12 +474,24 @@ private:
                                              const point2d& end,
                                              StyleKey   style_key,
                                              std::uint32_t rgba);
-    void begin_overlay_frame();
-    void render_cached_overlay();
+    void push_fill_tri(StyleKey sk, const point2d& a, const point2d& b, const point2d& c);
+    void push_fill_mesh(StyleKey                          sk,
+                        const std::vector<point2d>&       verts,
+                        const std::vector<std::uint32_t>* indices);
+    const TriangulationEntry& cached_triangulation(const std::vector<point2d>& outer,
+                                                   const std::vector<std::vector<point2d>>& holes);
+    void evict_stale_triangulations();
+    deferred_renderer& overlay_recorder();
+    void post_overlay_job(bool relayout = true);
+    void post_overlay_tiles(bool relayout);
     void ensure_tile_grid();
     void clear_tile_geometry();
     void clear_commands();
+    /// Run dispatch_commands_to_tiles on every band, building the pick
+    /// index into m_pick_build if @p build_picks and any were recorded.
+    void dispatch_commands(bool build_picks);
     void dispatch_commands_to_tiles(int band);
+    void record_pick(const point2d& a, const point2d& b, bool segment);
     int  band_for_tile_row(int ty) const { return std::min(ty / m_rows_per_band, m_n_bands - 1); }
     int  band_ty_min(int band) const { return band * m_rows_per_band; }
     int  band_ty_max(int band) const { return std::min((band + 1) * m_rows_per_band - 1, kTileGridDimension - 1); }
@@ -381,9 +500,20 @@ private:
     int tile_index(int tile_x, int tile_y) const;
     RhiTileBatch& tile_at(int tile_x, int tile_y);
     SceneBuffers build_scene_buffers() const;
+    /// Dispatch recorded commands to tiles and build the scene from them.
+    SceneBuffers assemble_scene();
+    /// Hand a finished scene to the widget and schedule a repaint.
+    void present_scene(SceneBuffers scene_buffers);
+
+    bool skip_recording() const
+    {
+        return m_skip_tile_writes
+            || (m_cancel != nullptr && m_cancel->load(std::memory_order_relaxed));
+    }
 
     /** Compute screen→NDC orthographic matrix from current widget size. */
-    QMatrix4x4 compute_mvp() const;
+    QMatrix4x4 compute_mvp() const { return compute_mvp(m_size); }
+    QMatrix4x4 compute_mvp(QSize size) const;
 
     // ---- state --------------------------------------------------------------
 
@@ -391,7 +521,10 @@ private:
     QSize                    m_size;       ///< logical (device-independent) framebuffer size
     qreal                    m_overlay_dpr = 1.0; ///< overlay QImage device pixel ratio (matches widget DPR; 1.0 headless)
     QColor                   m_bg_color;
+    SceneStorageOptions      m_scene_storage;
+    std::optional<SceneBuffers> m_loaded_scene; ///< headless load_snapshot() result, taken by flush_capture()
     bool                     m_skip_tile_writes = false;
+    const std::atomic<bool>* m_cancel = nullptr; ///< see set_cancel_token()
     std::uint32_t            m_current_rgba = 0;
 
     // Scene tiling metadata and CPU-side tile batches.
@@ -412,12 +545,23 @@ private:
     struct DashedLineCmd { StyleKey sk; float x0, y0, x1, y1; };
     struct ArrowCmd      { StyleKey sk; float ax, ay, dx, dy; };
 
+    // One triangulated polygon. Its vertices and triangle indices live in
+    // m_mesh_verts / m_mesh_indices (shared by every band, read-only during
+    // dispatch); the command is routed to each band its bounds overlap.
+    struct FillMeshCmd {
+        StyleKey      sk;
+        std::uint32_t first_vertex, vertex_count;
+        std::uint32_t first_index,  index_count;
+        float         x_min, y_min, x_max, y_max;
+    };
+
     int m_n_bands       = 1;
     int m_rows_per_band = kTileGridDimension;
 
     std::vector<std::vector<ThinLineCmd>>   m_cmd_thin_lines;
     std::vector<std::vector<FillRectCmd>>   m_cmd_fill_rects;
     std::vector<std::vector<FillTriCmd>>    m_cmd_fill_tris;
+    std::vector<std::vector<FillMeshCmd>>   m_cmd_fill_meshes;
     std::vector<std::vector<ThickLineCmd>>  m_cmd_thick_lines;
     std::vector<std::vector<DashedLineCmd>> m_cmd_dashed_lines;
 
@@ -427,14 +571,51 @@ private:
     // camera-only redraw path. The GPU draws every recorded instance.
     std::vector<ArrowCmd>                   m_cmd_arrows;
 
-    // QPainter overlay — overlay commands (text, arcs, …) are stored in
-    // m_overlay_deferred and replayed into this image.
-    QImage   m_overlay;
-    Painter  m_overlay_painter;   // must be declared AFTER m_overlay
-
-    // Overlay command storage and replay — independent deferred renderer
-    // painted into m_overlay_painter / m_overlay.
-    std::unique_ptr<deferred_renderer> m_overlay_deferred;
+    // Primitives recorded under a pick id, routed to bands like the draw
+    // commands. Text, arcs and surfaces are entered by their anchor or
+    // bounds even though they are drawn by the overlay.
+    std::vector<std::vector<PickEntry>>     m_cmd_picks;
+    std::uint32_t                           m_pick_sequence = 0;
+    std::shared_ptr<PickIndex>              m_pick_build;  ///< filled by the dispatch bands
+    std::shared_ptr<const PickIndex>        m_pick_index;  ///< of the presented scene
+
+    std::vector<PosVertex>                  m_mesh_verts;
+    std::vector<std::uint32_t>              m_mesh_indices;
+
+    // Triangulations of non-convex fill_poly / fill_poly_with_holes input,
+    // keyed by a hash of the points. Polygon data (device outlines, region
+    // shapes) rarely changes between full redraws, so re-triangulating it
+    // every frame is wasted work. Entries unused for
+    // kTriangulationMaxIdleFrames full redraws are dropped in begin_frame().
+    std::unordered_map<std::uint64_t, TriangulationEntry> m_triangulation_cache;
+    std::vector<point2d>                                  m_ring_scratch; // outer ring + holes, flattened
+    std::uint64_t                                         m_frame_index = 0;
+
+    // irenderer's state setters write through m_painter. The GPU path never
+    // paints with it, so it targets a 1x1 surface owned by the GUI thread.
+    QImage   m_state_surface;
+    Painter  m_state_painter;     // must be declared AFTER m_state_surface
+
+    // Overlay commands (text, arcs, …) for the frame being recorded. Shared
+    // with m_overlay_worker while a rasterization job references it; always
+    // reach the recorder through overlay_recorder().
+    std::shared_ptr<RhiOverlayLayer>  m_overlay_layer;
+
+    // Rasterizes m_overlay_layer off the GUI thread and hands the image to
+    // m_rhi_widget. null in headless mode. Declared last so its thread is
+    // joined before anything it might touch is destroyed.
+    std::unique_ptr<RhiOverlayWorker> m_overlay_worker;
+
+    // Overlay tile cache state (GUI thread). A new epoch is started whenever
+    // the tiles already made no longer match what would be rasterized now.
+    static constexpr int           kOverlayTilePrefetchRing = 1; ///< tiles requested around the view
+    std::weak_ptr<RhiOverlayLayer> m_tile_layer;
+    std::uint64_t                  m_tile_revision = 0;
+    qreal                          m_tile_dpr      = 0.0;
+    double                         m_tile_aspect   = 0.0; ///< grid y/x scale ratio
+    std::uint64_t                  m_tile_epoch    = 0;
+    bool                           m_tiles_active  = false;
+    QSize                          m_tile_screen_size;
 };
 
 } // namespace ezgl
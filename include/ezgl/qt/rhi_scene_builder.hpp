@@ -0,0 +1,102 @@
+#pragma once
+
+#include "ezgl/camera.hpp"
+#include "ezgl/qt/render_backend.hpp"
+#include "ezgl/qt/rhi_renderer.hpp"
+#include "ezgl/qt/scene_scratch.hpp"
+
+#include <QColor>
+#include <QSize>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace ezgl {
+
+/**
+ * @brief Background thread that runs the draw callback and assembles the
+ * resulting scene for the rhi backend's async redraw mode.
+ *
+ * Each job records into a headless @ref rhi_renderer owned by the thread,
+ * bound to the job's copy of the camera, so neither the draw callback nor
+ * the tile pipeline reads the live camera while the GUI thread pans and
+ * zooms. The finished @ref rhi_renderer::AssembledFrame is handed to the
+ * delivery callback, tagged with the job's generation.
+ *
+ * @par Cancellation
+ * Posting a job cancels the running one and replaces a pending one
+ * (latest request wins). The running job notices at its next safe point:
+ * every GPU-bound draw call becomes a no-op, so the callback returns
+ * quickly, and assembly is skipped or abandoned between stages. A
+ * cancelled job delivers nothing. The draw callback itself cannot be
+ * interrupted, so a callback dominated by its own work (not by draw
+ * calls) still runs to completion. Before running the callback on
+ * another thread, call @ref cancel_and_wait or @ref wait: the callback
+ * never runs twice at once.
+ *
+ * The callback runs off the GUI thread: it must not touch widgets and
+ * must not race the application's own updates to the data it draws.
+ */
+class RhiSceneBuilder {
+public:
+    struct Job {
+        std::uint64_t       generation = 0;
+        camera              cam;          ///< snapshot of the live camera
+        QSize               size;         ///< framebuffer size in logical pixels
+        SceneStorageOptions storage;
+    };
+
+    /// Called on the builder thread with each frame that was not cancelled.
+    using deliver_fn = std::function<void(std::uint64_t generation,
+                                          rhi_renderer::AssembledFrame frame)>;
+
+    RhiSceneBuilder(draw_canvas_fn draw_callback, QColor bg_color, deliver_fn deliver);
+    ~RhiSceneBuilder();
+
+    RhiSceneBuilder(const RhiSceneBuilder&)            = delete;
+    RhiSceneBuilder& operator=(const RhiSceneBuilder&) = delete;
+
+    /// Queue @p job, cancelling the running job and replacing a pending one.
+    void post(Job job);
+
+    /// Drop the pending job and cancel the running one without waiting.
+    void cancel();
+
+    /// Drop the pending job, cancel the running one and block until it has
+    /// left the draw callback.
+    void cancel_and_wait();
+
+    /// Block until the pending and running jobs (if any) have finished.
+    void wait();
+
+    /// True while a job is pending or running.
+    bool busy() const;
+
+private:
+    void run();
+
+    draw_canvas_fn           m_draw_callback;
+    QColor                   m_bg_color;
+    deliver_fn               m_deliver;
+
+    // Builder-thread only: the renderer keeps its triangulation cache
+    // across jobs, and its transform is bound to m_cam.
+    camera                        m_cam;
+    std::unique_ptr<rhi_renderer> m_renderer;
+
+    mutable std::mutex      m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::optional<Job>      m_pending;
+    bool                    m_busy = false;
+    bool                    m_stop = false;
+    std::atomic<bool>       m_cancel{false};
+    std::thread             m_thread; // must be declared last: started in the constructor
+};
+
+} // namespace ezgl
@@ -1,11 +1,13 @@
 #pragma once
 
+#include "ezgl/qt/rhi_overlay_tile_cache.hpp"
 #include "ezgl/qt/rhi_types.hpp"
 
 #include <QColor>
 #include <QImage>
 #include <QMatrix4x4>
 #include <QSize>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -16,6 +18,7 @@ QT_FORWARD_DECLARE_CLASS(QRhiCommandBuffer)
 QT_FORWARD_DECLARE_CLASS(QRhiGraphicsPipeline)
 QT_FORWARD_DECLARE_CLASS(QRhiRenderPassDescriptor)
 QT_FORWARD_DECLARE_CLASS(QRhiRenderTarget)
+QT_FORWARD_DECLARE_CLASS(QRhiResourceUpdateBatch)
 QT_FORWARD_DECLARE_CLASS(QRhiSampler)
 QT_FORWARD_DECLARE_CLASS(QRhiShaderResourceBindings)
 QT_FORWARD_DECLARE_CLASS(QRhiTexture)
@@ -23,12 +26,38 @@ QT_FORWARD_DECLARE_CLASS(QRhi)
 
 namespace ezgl {
 
+/**
+ * @brief The QPainter overlay handed to @ref RhiSceneRenderer::render.
+ *
+ * @c serial identifies the image; @c history holds the @ref OverlayUpdate
+ * that produced each of the last few serials, oldest first, the last one
+ * producing @c serial itself. A frame slot whose texture holds an older
+ * serial still covered by @c history is brought up to date by shifting and
+ * uploading only the changed strips. Serial 0 means untracked: the image is
+ * uploaded in full every time (headless rendering).
+ *
+ * @c image holds the WORLD content and is reprojected to the current
+ * camera; @c screen holds the SCREEN-coordinate content (legends, HUD
+ * text) and is drawn where it is, on top. @c screen_serial changes
+ * whenever @c screen does. When @c tiles names an epoch, the world content
+ * comes from the tile cache instead and @c image is null.
+ */
+struct OverlayFrame {
+    QImage                     image;
+    QMatrix4x4                 mvp;        ///< world→NDC @c image was laid out for
+    std::uint64_t              serial = 0;
+    std::vector<OverlayUpdate> history;
+    OverlayTileView            tiles;
+    QImage                     screen;
+    std::uint64_t              screen_serial = 0;
+};
+
 /**
  * @brief GPU pipeline state and per-frame resources for the rhi backend.
  *
  * Owns all @c QRhi objects: 7 graphics pipelines, shader resource
  * bindings, uniform/vertex buffers, overlay texture+sampler, and the
- * per-frame-slot geometry cache. Works with any @c QRhi instance — the
+ * device-local geometry pools. Works with any @c QRhi instance — the
  * display path hands it the @c QRhiWidget's internal @c QRhi, the
  * headless path hands it a standalone @c QRhi built on
  * @c QOffscreenSurface.
@@ -37,12 +66,13 @@ namespace ezgl {
  * | # | Pipeline           | Topology / instancing                          | Shader pair                          |
  * | - | ------------------ | ---------------------------------------------- | ------------------------------------ |
  * | 1 | m_fill_rect_pso    | TriangleStrip, instanced                       | fill_rect.vert + base.frag           |
- * | 2 | m_fill_poly_pso    | Triangles                                      | base.vert + base.frag                |
+ * | 2 | m_fill_poly_pso    | Triangles, indexed (16/32-bit per chunk)       | base.vert + base.frag                |
  * | 3 | m_line_pso         | Lines                                          | base.vert + base.frag                |
  * | 4 | m_dashed_line_pso  | TriangleStrip, instanced quad (corner buf)     | dashed_line.vert + dashed_line.frag  |
  * | 5 | m_thick_line_pso   | TriangleStrip, instanced quad (corner buf)     | thick_line.vert + base.frag          |
  * | 6 | m_arrow_pso        | Triangles, 3 verts/instance via gl_VertexIndex | arrow.vert + base.frag               |
- * | 7 | m_overlay_pso      | TriangleStrip, one full-screen quad            | overlay.vert + overlay.frag (sampler)|
+ * | 7 | m_overlay_pso      | TriangleStrip, reprojected WORLD + SCREEN quad | overlay.vert + overlay.frag (sampler)|
+ * | 8 | m_overlay_tiles    | TriangleStrip, one world quad per tile, scissor| overlay.vert + overlay.frag (sampler)|
  *
  * @c base.vert is the minimal pass-through vertex shader
  * (@c vec2 inPosition → @c mvp * pos) shared by every pipeline whose
@@ -63,16 +93,58 @@ namespace ezgl {
  * - binding 1 — @c vec4 color + @c vec4 line (per-style, dynamic-offset)
  *
  * Style UBO is one big buffer with one slot per unique @ref StyleKey,
- * written once per frame. Each draw binds the SRB with a
+ * written once per geometry revision. Each draw binds the SRB with a
  * @c DynamicOffset pointing at its style's slot.
  *
+ * @par Geometry pools
+ * Scene geometry never changes between revisions, so it lives in
+ * @c QRhiBuffer::Immutable (device-local) buffers uploaded once through
+ * the staging path and shared by every frame slot. All vertex and
+ * instance streams, of every primitive type, are sub-allocated from one
+ * vertex pool; all 16- and 32-bit fill indices from one index pool. A
+ * pool only grows past one buffer when it would exceed the 2 GiB
+ * @c QRhiBuffer size limit. A new revision allocates exact-size buffers
+ * and hands the old ones to @c deleteLater(), which QRhi defers until
+ * the frames still in flight have retired.
+ *
+ * @par Progressive upload
+ * Planning a revision allocates the pools and queues one staging upload
+ * per GPU chunk. Each render() drains that queue: all at once by
+ * default, or — with @ref set_upload_budget — at most that many bytes
+ * per frame, visible chunks first and then outward from the view centre
+ * (re-sorted whenever the camera moves mid-stream). Draw loops skip
+ * chunks that are not resident yet, so a style that is half uploaded
+ * draws the half it has. @ref upload_pending tells the owner to keep
+ * scheduling frames.
+ *
  * @par Per-frame-slot resources
- * QRhi pipelines frames-in-flight (2–3 GPU frames overlap). Each slot
- * gets its own @ref FrameResources with separate buffers, SRBs, and
- * overlay texture. @c m_frame_slot_geom_valid tracks which slots already
- * hold the current geometry revision; lazy re-upload via
- * @c m_cached_scene keeps stale slots in sync without re-uploading
- * every frame.
+ * QRhi pipelines frames-in-flight (2–3 GPU frames overlap). Everything
+ * the CPU rewrites while earlier frames may still read it — MVP and
+ * style UBOs, SRBs, the overlay texture — lives in a per-slot
+ * @ref FrameResources. @c m_frame_slot_style_valid tracks which slots
+ * already hold the current style table. @c m_cached_scene keeps the
+ * latest scene so the pools can be rebuilt after re-initialize().
+ *
+ * @par Ring-buffered overlay texture
+ * Each slot's overlay texture is addressed as a torus: logical overlay
+ * pixel @c p lives at texel @c (p + overlay_origin) mod size, and the
+ * overlay quad's texture coordinates carry the origin (the sampler
+ * repeats). A pan that shifts the overlay by whole pixels moves the
+ * origin instead of the texels, so only the exposed strips are uploaded,
+ * and a slot that already holds the current overlay uploads nothing.
+ *
+ * @par Overlay tile cache
+ * With a tile budget set (@ref overlay_tiles), the overlay's world content
+ * is drawn from @ref RhiOverlayTileCache, below the screen-space overlay.
+ * Tile textures are immutable once uploaded, so they are shared by all
+ * frame slots rather than kept per slot.
+ *
+ * @par Memory-lean mode
+ * With @ref set_retain_cpu_scene(false) the CPU scene is released as soon
+ * as its staging uploads are queued, so a large design is resident in
+ * VRAM only. The price is recovery: once the pools are lost (device loss,
+ * a new @c QRhi) nothing is left to rebuild them from, and
+ * @ref geometry_lost() asks the owner to re-run the draw callback.
  *
  * @par Lifecycle
  * - @ref initialize(rhi, rp_desc)   — call once when QRhi and render-pass are ready
@@ -91,8 +163,13 @@ public:
     /**
      * Create all GPU pipelines compatible with @p rp_desc.
      * Must be called before render(). Safe to call again after release().
+     *
+     * @p frame_slots is the number of per-frame resource sets; 0 (default)
+     * uses the QRhi's frames in flight. A caller that records several
+     * render() calls into one offscreen frame needs one slot per call,
+     * since dynamic buffers only take one update per slot and frame.
      */
-    void initialize(QRhi* rhi, QRhiRenderPassDescriptor* rp_desc);
+    void initialize(QRhi* rhi, QRhiRenderPassDescriptor* rp_desc, int frame_slots = 0);
 
     /**
      * Upload geometry / uniforms for @p frame_slot and record draw commands.
@@ -114,7 +191,14 @@ public:
      * @param scene         Geometry to render (may be nullptr if !geom_dirty).
      * @param mvp           World-to-NDC matrix.
      * @param visible_world Current visible world rectangle (for tile culling).
-     * @param overlay       QPainter overlay image (text, arcs, …).
+     * @param overlay       QPainter overlay (text, arcs, …) and the
+     *                      world-to-NDC matrix it was laid out for. When
+     *                      that differs from @p mvp the overlay quad is
+     *                      warped by @c mvp * inverse(overlay.mvp) so a
+     *                      stale overlay stays registered with the scene;
+     *                      its SCREEN image is drawn as is, on top.
+     *                      Its tile view, if any, picks the cached tiles
+     *                      drawn under it.
      * @param bg            Background clear colour.
      */
     void render(QRhiCommandBuffer*                         cb,
@@ -125,7 +209,7 @@ public:
                 const std::shared_ptr<const SceneBuffers>& scene,
                 const QMatrix4x4&                          mvp,
                 const rectangle&                           visible_world,
-                const QImage&                              overlay,
+                const OverlayFrame&                        overlay,
                 QColor                                     bg);
 
     /** Destroy all GPU objects. Safe to call multiple times. */
@@ -140,11 +224,61 @@ public:
     }
 
     /**
-     * Mark all frame slots as needing geometry re-upload (e.g. after resize
-     * or re-initialize).
+     * Mark the geometry pools and every slot's style table as needing
+     * re-upload (e.g. after resize or re-initialize).
      */
     void invalidate_geometry_cache();
 
+    /** Bytes currently allocated for the shared geometry pools. */
+    std::size_t geometry_pool_bytes() const noexcept;
+
+    /** The QRhi passed to the last initialize(), or nullptr after release(). */
+    QRhi* rhi() const noexcept { return m_rhi; }
+
+    /**
+     * Keep (default) or drop the CPU copy of the scene once it has been
+     * uploaded. Dropping it takes effect at the next upload.
+     */
+    void set_retain_cpu_scene(bool retain) noexcept { m_retain_cpu_scene = retain; }
+    bool retains_cpu_scene() const noexcept { return m_retain_cpu_scene; }
+
+    /**
+     * Cap the geometry uploaded per render() at @p bytes_per_frame
+     * (at least one chunk always goes). 0, the default, uploads a whole
+     * revision in its first frame.
+     */
+    void set_upload_budget(std::size_t bytes_per_frame) noexcept
+    {
+        m_upload_budget_bytes = bytes_per_frame;
+    }
+    std::size_t upload_budget() const noexcept { return m_upload_budget_bytes; }
+
+    /** True while chunks of the current revision are still waiting for upload. */
+    bool upload_pending() const noexcept { return m_upload_cursor < m_pending_uploads.size(); }
+
+    /** Bytes of the current revision uploaded so far, and in total. */
+    std::size_t uploaded_bytes() const noexcept { return m_uploaded_bytes; }
+    std::size_t total_upload_bytes() const noexcept { return m_total_upload_bytes; }
+
+    /**
+     * World-space overlay tiles. Tiles handed to it are uploaded by the
+     * next render(); its budget must be set before tiles are useful.
+     */
+    RhiOverlayTileCache& overlay_tiles() noexcept { return m_overlay_tiles; }
+
+    /** Bytes of CPU scene geometry this renderer is keeping alive. */
+    std::size_t resident_cpu_scene_bytes() const noexcept { return m_cached_scene_bytes; }
+
+    /**
+     * True when a scene was uploaded once but the pools have since been
+     * lost and there is no CPU copy to rebuild them from. Only happens in
+     * memory-lean mode; the owner must supply a fresh scene.
+     */
+    bool geometry_lost() const noexcept
+    {
+        return m_had_scene && !m_geom_valid && !m_cached_scene;
+    }
+
 private:
     // ---- GPU-side data structures (mirror the CPU-side SceneBuffers) --------
 
@@ -153,6 +287,7 @@ private:
         quint32   buffer_index = 0;
         quint32   byte_offset  = 0;
         quint32   count        = 0;
+        quint32   resident_slot = 0; ///< Index into m_chunk_resident
     };
 
     struct GpuStyleBuffer {
@@ -162,13 +297,33 @@ private:
         std::vector<GpuChunk> chunks;
     };
 
+    /// Indexed counterpart of GpuChunk (filled polygons). The chunk's
+    /// vertices and its indices each live in a single pool buffer.
+    struct GpuIndexedChunk {
+        rectangle world_bounds;
+        quint32   vertex_buffer_index = 0;
+        quint32   vertex_byte_offset  = 0;
+        quint32   index_buffer_index  = 0;
+        quint32   index_byte_offset   = 0;
+        quint32   index_count         = 0;
+        bool      wide_indices        = false; ///< 32-bit vs 16-bit indices
+        quint32   resident_slot       = 0;     ///< Index into m_chunk_resident
+    };
+
+    struct GpuIndexedStyleBuffer {
+        StyleKey                     style_key    = 0;
+        std::uint32_t                rgba         = 0;
+        quint32                      style_offset = 0;
+        std::vector<GpuIndexedChunk> chunks;
+    };
+
     struct GpuSceneBuffers {
-        std::vector<GpuStyleBuffer> thin_lines;
-        std::vector<GpuStyleBuffer> fill_rects;
-        std::vector<GpuStyleBuffer> fill_polys;
-        std::vector<GpuStyleBuffer> thick_lines;
-        std::vector<GpuStyleBuffer> dashed_lines;
-        std::vector<GpuStyleBuffer> arrows;
+        std::vector<GpuStyleBuffer>        thin_lines;
+        std::vector<GpuStyleBuffer>        fill_rects;
+        std::vector<GpuIndexedStyleBuffer> fill_polys;
+        std::vector<GpuStyleBuffer>        thick_lines;
+        std::vector<GpuStyleBuffer>        dashed_lines;
+        std::vector<GpuStyleBuffer>        arrows;
 
         void clear()
         {
@@ -180,18 +335,57 @@ private:
     struct FrameResources {
         std::unique_ptr<QRhiBuffer>                 mvp_ubuf;
         std::unique_ptr<QRhiBuffer>                 style_ubuf;
-        std::vector<std::unique_ptr<QRhiBuffer>>    thin_line_vbufs;
-        std::vector<std::unique_ptr<QRhiBuffer>>    fill_rect_instance_vbufs;
-        std::vector<std::unique_ptr<QRhiBuffer>>    fill_poly_vbufs;
-        std::vector<std::unique_ptr<QRhiBuffer>>    thick_line_instance_vbufs;
-        std::vector<std::unique_ptr<QRhiBuffer>>    dashed_line_instance_vbufs;
-        std::vector<std::unique_ptr<QRhiBuffer>>    arrow_instance_vbufs;
         std::unique_ptr<QRhiTexture>                overlay_tex;
         std::unique_ptr<QRhiShaderResourceBindings> overlay_srb;
+        std::uint64_t                               overlay_serial = 0; ///< 0: contents unknown
+        QPoint                                      overlay_origin;     ///< ring offset, texels
+        std::unique_ptr<QRhiBuffer>                 overlay_quad_vbuf;
+        std::unique_ptr<QRhiTexture>                screen_tex;
+        std::unique_ptr<QRhiShaderResourceBindings> screen_srb;
+        std::uint64_t                               screen_serial = 0; ///< 0: contents unknown
         std::unique_ptr<QRhiShaderResourceBindings> srb;
-        GpuSceneBuffers                             gpu_scene;
     };
 
+    /// One GPU chunk's staging upload (vertex range plus, for indexed
+    /// fills, index range), waiting for its turn under the budget. The
+    /// data pointers reference m_cached_scene.
+    struct PendingChunkUpload {
+        rectangle   world_bounds;
+        double      priority            = 0.0;
+        quint32     resident_slot       = 0;
+        quint32     vertex_buffer_index = 0;
+        quint32     vertex_byte_offset  = 0;
+        quint32     vertex_byte_size    = 0;
+        const void* vertex_data         = nullptr;
+        quint32     index_buffer_index  = 0;
+        quint32     index_byte_offset   = 0;
+        quint32     index_byte_size     = 0;
+        const void* index_data          = nullptr;
+    };
+
+    /// Plan @p scene into fresh geometry pools, queue one upload per GPU
+    /// chunk, and rebuild m_gpu_scene / m_style_uniform_bytes.
+    void plan_scene_geometry(const SceneBuffers& scene);
+
+    /// Queue pending chunk uploads on @p u, visible-first, up to the
+    /// per-frame budget.
+    void upload_pending_chunks(QRhiResourceUpdateBatch* u, const rectangle& visible_world);
+
+    /// Write the current style table into @p fr's style UBO, growing it
+    /// (and rebuilding the SRB that references it) when necessary.
+    void upload_style_uniforms(QRhiResourceUpdateBatch* u, FrameResources& fr);
+
+    /// (Re)create @p tex at @p size, with the SRB that samples it. Returns
+    /// false when the existing texture already has that size.
+    bool ensure_overlay_texture(std::unique_ptr<QRhiTexture>&                tex,
+                                std::unique_ptr<QRhiShaderResourceBindings>& srb,
+                                const QSize&                                 size);
+
+    /// Bring @p fr's overlay texture up to @p overlay, uploading only the
+    /// strips changed since the serial the slot holds when @c history
+    /// allows it.
+    void upload_overlay(QRhiResourceUpdateBatch* u, FrameResources& fr, const OverlayFrame& overlay);
+
     // ---- state --------------------------------------------------------------
 
     QRhi*                                  m_rhi           = nullptr;
@@ -208,16 +402,41 @@ private:
 
     // Shared buffers (constant geometry, shared across all frame slots)
     std::unique_ptr<QRhiBuffer>            m_thick_line_corner_vbuf;
-    std::unique_ptr<QRhiBuffer>            m_overlay_quad_vbuf;
+    std::unique_ptr<QRhiBuffer>            m_screen_quad_vbuf;
     std::unique_ptr<QRhiSampler>           m_overlay_sampler;
+    bool                                   m_corner_upload_pending = false;
+
+    // World-space overlay tiles, shared across all frame slots
+    RhiOverlayTileCache                    m_overlay_tiles;
+
+    // Device-local scene geometry, shared across all frame slots
+    std::vector<std::unique_ptr<QRhiBuffer>> m_geom_vertex_pool;
+    std::vector<std::unique_ptr<QRhiBuffer>> m_geom_index_pool;
+    GpuSceneBuffers                        m_gpu_scene;
+    std::vector<std::uint8_t>              m_style_uniform_bytes;
+    bool                                   m_geom_valid = false;
+
+    // Progressive upload queue for the current revision
+    std::vector<PendingChunkUpload>        m_pending_uploads;
+    std::vector<std::uint8_t>              m_chunk_resident;
+    std::size_t                            m_upload_cursor       = 0;
+    std::size_t                            m_upload_budget_bytes = 0;
+    std::size_t                            m_uploaded_bytes      = 0;
+    std::size_t                            m_total_upload_bytes  = 0;
+    rectangle                              m_upload_order_view;
+    bool                                   m_upload_order_valid  = false;
 
     // Per-frame-slot resources
     std::vector<FrameResources>            m_frame_resources;
-    std::vector<bool>                      m_frame_slot_geom_valid;
+    std::vector<bool>                      m_frame_slot_style_valid;
 
-    // Latest complete scene — used to lazily re-upload to frame slots that
-    // haven't yet received the current geometry revision.
+    // Latest complete scene — used to rebuild the geometry pools after
+    // re-initialize() or invalidate_geometry_cache(). Released right after
+    // upload when m_retain_cpu_scene is false.
     std::shared_ptr<const SceneBuffers>    m_cached_scene;
+    std::size_t                            m_cached_scene_bytes = 0;
+    bool                                   m_retain_cpu_scene   = true;
+    bool                                   m_had_scene          = false;
 };
 
 } // namespace ezgl
@@ -1,8 +1,15 @@
 #pragma once
 
 #include "ezgl/rectangle.hpp"
+#include "ezgl/qt/scene_scratch.hpp"
 
+#include <QImage>
+#include <QPoint>
+#include <QRect>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <memory_resource>
 #include <unordered_map>
 #include <vector>
 
@@ -153,8 +160,8 @@ inline constexpr std::uint8_t style_key_line_dash(StyleKey key) noexcept
 /// draw loop can skip non-visible chunks without touching the vertex
 /// data — coarse but cheap (one AABB test per chunk).
 ///
-/// Non-visible chunks: the bytes stay in VRAM (the style's VBO is
-/// uploaded whole) but no @c cmdDraw is emitted and the vertex shader
+/// Non-visible chunks: the bytes stay in VRAM (every chunk is uploaded
+/// once per revision) but no @c cmdDraw is emitted and the vertex shader
 /// never runs on them. The alternative (per-frame partial vertex upload)
 /// was rejected because VRAM is cheap, but PCIe re-upload is expensive.
 struct Chunk {
@@ -163,6 +170,28 @@ struct Chunk {
     std::uint32_t count  = 0;     ///< Number of vertices/instances belonging to this tile cell.
 };
 
+/// A tile cell's slice of an indexed style buffer. Indices are local to
+/// the chunk (0 addresses @c verts[vertex_offset]) so each chunk can pick
+/// its own index width: chunks of at most @ref kMaxNarrowIndexedVertices
+/// vertices store 16-bit indices in @c indices16, larger ones 32-bit
+/// indices in @c indices32. @c index_offset counts elements of whichever
+/// of the two arrays @c wide_indices selects.
+struct IndexedChunk {
+    rectangle     world_bounds;
+    std::uint32_t vertex_offset = 0;
+    std::uint32_t vertex_count  = 0;
+    std::uint32_t index_offset  = 0;
+    std::uint32_t index_count   = 0;
+    bool          wide_indices  = false;
+};
+
+/// Largest chunk that can be addressed with 16-bit indices.
+inline constexpr std::uint32_t kMaxNarrowIndexedVertices = 65536;
+
+/// Vertex/instance/index arrays are @c std::pmr::vector so an out-of-core
+/// scene can place them in its @ref SceneScratchFile; chunk tables are
+/// small and always stay on the heap. @c geometry_byte_size() counts only
+/// the pmr-allocated arrays.
 struct StyleBufferCommon {
     StyleKey           style_key = 0;
     std::uint32_t      rgba      = 0;
@@ -170,39 +199,95 @@ struct StyleBufferCommon {
 };
 
 struct ThinLineStyleBuffer : StyleBufferCommon {
-    std::vector<PosVertex> verts;
+    std::pmr::vector<PosVertex> verts;
+    ThinLineStyleBuffer() = default;
+    explicit ThinLineStyleBuffer(std::pmr::memory_resource* mr) : verts(mr) {}
     bool empty()  const noexcept { return verts.empty(); }
     void clear()        noexcept { chunks.clear(); verts.clear(); }
+    std::size_t geometry_byte_size() const noexcept { return verts.capacity() * sizeof(PosVertex); }
+    std::size_t byte_size() const noexcept
+    {
+        return chunks.capacity() * sizeof(Chunk) + geometry_byte_size();
+    }
 };
 
 struct FillRectStyleBuffer : StyleBufferCommon {
-    std::vector<FillRectInstance> instances;
+    std::pmr::vector<FillRectInstance> instances;
+    FillRectStyleBuffer() = default;
+    explicit FillRectStyleBuffer(std::pmr::memory_resource* mr) : instances(mr) {}
     bool empty()  const noexcept { return instances.empty(); }
     void clear()        noexcept { chunks.clear(); instances.clear(); }
+    std::size_t geometry_byte_size() const noexcept { return instances.capacity() * sizeof(FillRectInstance); }
+    std::size_t byte_size() const noexcept
+    {
+        return chunks.capacity() * sizeof(Chunk) + geometry_byte_size();
+    }
 };
 
-struct FillPolyStyleBuffer : StyleBufferCommon {
-    std::vector<PosVertex> verts;
+/// Filled polygons are indexed: a polygon's triangles share their
+/// vertices inside each tile instead of storing three @ref PosVertex per
+/// triangle. Uses @ref IndexedChunk rather than @c StyleBufferCommon::chunks.
+struct FillPolyStyleBuffer {
+    StyleKey                        style_key = 0;
+    std::uint32_t                   rgba      = 0;
+    std::vector<IndexedChunk>       chunks;
+    std::pmr::vector<PosVertex>     verts;
+    std::pmr::vector<std::uint16_t> indices16;
+    std::pmr::vector<std::uint32_t> indices32;
+    FillPolyStyleBuffer() = default;
+    explicit FillPolyStyleBuffer(std::pmr::memory_resource* mr)
+        : verts(mr), indices16(mr), indices32(mr) {}
     bool empty()  const noexcept { return verts.empty(); }
-    void clear()        noexcept { chunks.clear(); verts.clear(); }
+    void clear()        noexcept { chunks.clear(); verts.clear(); indices16.clear(); indices32.clear(); }
+    std::size_t geometry_byte_size() const noexcept
+    {
+        return verts.capacity() * sizeof(PosVertex)
+             + indices16.capacity() * sizeof(std::uint16_t)
+             + indices32.capacity() * sizeof(std::uint32_t);
+    }
+    std::size_t byte_size() const noexcept
+    {
+        return chunks.capacity() * sizeof(IndexedChunk) + geometry_byte_size();
+    }
 };
 
 struct ThickLineStyleBuffer : StyleBufferCommon {
-    std::vector<ThickLineInstance> instances;
+    std::pmr::vector<ThickLineInstance> instances;
+    ThickLineStyleBuffer() = default;
+    explicit ThickLineStyleBuffer(std::pmr::memory_resource* mr) : instances(mr) {}
     bool empty()  const noexcept { return instances.empty(); }
     void clear()        noexcept { chunks.clear(); instances.clear(); }
+    std::size_t geometry_byte_size() const noexcept { return instances.capacity() * sizeof(ThickLineInstance); }
+    std::size_t byte_size() const noexcept
+    {
+        return chunks.capacity() * sizeof(Chunk) + geometry_byte_size();
+    }
 };
 
 struct DashedLineStyleBuffer : StyleBufferCommon {
-    std::vector<DashedLineInstance> instances;
+    std::pmr::vector<DashedLineInstance> instances;
+    DashedLineStyleBuffer() = default;
+    explicit DashedLineStyleBuffer(std::pmr::memory_resource* mr) : instances(mr) {}
     bool empty()  const noexcept { return instances.empty(); }
     void clear()        noexcept { chunks.clear(); instances.clear(); }
+    std::size_t geometry_byte_size() const noexcept { return instances.capacity() * sizeof(DashedLineInstance); }
+    std::size_t byte_size() const noexcept
+    {
+        return chunks.capacity() * sizeof(Chunk) + geometry_byte_size();
+    }
 };
 
 struct ArrowStyleBuffer : StyleBufferCommon {
-    std::vector<ArrowInstance> instances;
+    std::pmr::vector<ArrowInstance> instances;
+    ArrowStyleBuffer() = default;
+    explicit ArrowStyleBuffer(std::pmr::memory_resource* mr) : instances(mr) {}
     bool empty()  const noexcept { return instances.empty(); }
     void clear()        noexcept { chunks.clear(); instances.clear(); }
+    std::size_t geometry_byte_size() const noexcept { return instances.capacity() * sizeof(ArrowInstance); }
+    std::size_t byte_size() const noexcept
+    {
+        return chunks.capacity() * sizeof(Chunk) + geometry_byte_size();
+    }
 };
 
 /// One frame's worth of CPU-side geometry, grouped by primitive type and
@@ -211,7 +296,13 @@ struct ArrowStyleBuffer : StyleBufferCommon {
 /// by @ref RhiSceneRenderer::render(). Passed between threads by
 /// @c shared_ptr<const SceneBuffers> so the render thread can keep
 /// rendering an old scene while the main thread builds the next one.
+///
+/// An out-of-core scene (see @ref SceneStorageOptions) allocates its
+/// geometry arrays from @c scratch. It is declared first so it outlives
+/// the maps whose arrays point into its mapping.
 struct SceneBuffers {
+    std::shared_ptr<SceneScratchFile> scratch;
+
     std::unordered_map<StyleKey, ThinLineStyleBuffer>   thin_lines;
     std::unordered_map<StyleKey, FillRectStyleBuffer>   fill_rects;
     std::unordered_map<StyleKey, FillPolyStyleBuffer>   fill_polys;
@@ -230,6 +321,85 @@ struct SceneBuffers {
         thin_lines.clear(); fill_rects.clear(); fill_polys.clear();
         thick_lines.clear(); dashed_lines.clear(); arrows.clear();
     }
+
+    /// Bytes held by the vertex/instance/index/chunk arrays (by capacity,
+    /// i.e. what is actually resident). For an out-of-core scene the
+    /// geometry part is the scratch file's resident estimate instead.
+    /// Map node overhead is not counted; it is negligible next to the
+    /// geometry.
+    std::size_t byte_size() const noexcept
+    {
+        std::size_t total = 0, geometry = 0;
+        const auto add = [&](const auto& buffers) {
+            for (const auto& [sk, b] : buffers) {
+                (void)sk;
+                total    += b.byte_size();
+                geometry += b.geometry_byte_size();
+            }
+        };
+        add(thin_lines); add(fill_rects); add(fill_polys);
+        add(thick_lines); add(dashed_lines); add(arrows);
+        if (scratch)
+            total = total - geometry + scratch->resident_bytes();
+        return total;
+    }
+};
+
+/// How an overlay image differs from the one delivered just before it.
+/// A pan that keeps the zoom level moves the previous overlay by whole
+/// device pixels and repaints only the strips it exposed; @ref
+/// RhiSceneRenderer then shifts its overlay texture and uploads just those
+/// strips instead of the whole image.
+struct OverlayUpdate {
+    bool               incremental = false; ///< false: treat the whole image as new
+    QPoint             shift;               ///< content moved by this many device pixels
+    std::vector<QRect> exposed;             ///< device-pixel rects repainted after the shift
+};
+
+// ---- Overlay tiles ----------------------------------------------------------
+
+/// One cell of the world-space overlay tile grid: a zoom level and a column
+/// and row in that level's grid (see @ref OverlayTileGrid).
+struct OverlayTileKey {
+    int          level = 0;
+    std::int64_t x     = 0;
+    std::int64_t y     = 0;
+
+    bool operator==(const OverlayTileKey&) const = default;
+};
+
+struct OverlayTileKeyHash {
+    std::size_t operator()(const OverlayTileKey& k) const noexcept
+    {
+        std::uint64_t h = std::uint64_t(std::uint32_t(k.level)) * 0x9E3779B97F4A7C15ull;
+        h ^= std::uint64_t(k.x) + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+        h ^= std::uint64_t(k.y) + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+        return std::size_t(h);
+    }
+};
+
+/// A tile of the overlay's world-space content, rasterized on the overlay
+/// worker and on its way to the GPU tile cache. @c epoch names the
+/// recording and grid it was rasterized for; tiles of an older epoch are
+/// dropped on arrival.
+struct OverlayTile {
+    OverlayTileKey key;
+    rectangle      world;     ///< world rectangle the image covers
+    std::uint64_t  epoch = 0;
+    QImage         image;
+};
+
+/// The tiles one frame wants on screen. @c visible lists every tile that
+/// meets the visible world at the current level, resident or not; epoch 0
+/// means the overlay is not tiled.
+struct OverlayTileView {
+    struct Slot {
+        OverlayTileKey key;
+        rectangle      world;
+    };
+
+    std::uint64_t     epoch = 0;
+    std::vector<Slot> visible;
 };
 
 } // namespace ezgl
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <QString>
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+QT_FORWARD_DECLARE_CLASS(QTemporaryFile)
+
+namespace ezgl {
+
+/// Where @ref SceneBuffers keeps its per-style geometry arrays.
+struct SceneStorageOptions {
+    /// Back the arrays with a memory-mapped scratch file instead of the heap.
+    bool        out_of_core           = false;
+    /// Geometry bytes allowed to stay resident before written pages are
+    /// flushed to the scratch file and dropped from memory. Used as given:
+    /// a budget well below the 64 MB mapping segment trims very often.
+    std::size_t resident_budget_bytes = std::size_t(256) * 1024 * 1024;
+    /// Directory for the scratch file; empty means @c QDir::tempPath().
+    QString     scratch_dir;
+};
+
+/**
+ * @brief File-backed @c std::pmr::memory_resource for out-of-core scenes.
+ *
+ * Allocations are carved monotonically out of a temporary file that is
+ * mapped in fixed-size segments (larger requests get a segment of their
+ * own), so geometry arrays live in the page cache rather than in
+ * anonymous memory and can be evicted without touching swap.
+ * Deallocation is a no-op: a scene's arrays are sized exactly before
+ * they are filled and all die together with the scene, which also owns
+ * the last reference to this resource.
+ *
+ * Residency is bounded cooperatively. Writers and readers report the
+ * bytes they touch through @ref note_touched; once that exceeds the
+ * budget, @ref trim writes dirty pages back and drops every mapped page
+ * from memory (and from the page cache where the platform allows it).
+ * Later accesses fault the data back in from the file.
+ *
+ * Thread-safe: the GUI thread fills a scene while the render thread may
+ * still be reading the previous one from a different instance, and the
+ * render thread reads the new one once it is handed over.
+ */
+class SceneScratchFile final : public std::pmr::memory_resource {
+public:
+    /// Create the scratch file. Returns nullptr (after a warning) when the
+    /// file cannot be created, so callers fall back to heap storage.
+    static std::shared_ptr<SceneScratchFile> create(const SceneStorageOptions& options);
+
+    ~SceneScratchFile() override;
+
+    SceneScratchFile(const SceneScratchFile&)            = delete;
+    SceneScratchFile& operator=(const SceneScratchFile&) = delete;
+
+    /// Record that @p bytes of mapped data were written or read, and trim
+    /// if the resident estimate now exceeds the budget.
+    void note_touched(std::size_t bytes);
+
+    /// Flush dirty pages and drop all mapped pages from memory.
+    void trim();
+
+    /// Bytes that may currently be resident (touched since the last trim).
+    std::size_t resident_bytes() const;
+
+    /// Bytes handed out so far, i.e. the size of the scene on disk.
+    std::size_t allocated_bytes() const;
+
+private:
+    struct Segment {
+        unsigned char* base = nullptr;
+        std::size_t    file_offset = 0;
+        std::size_t    size = 0;
+        std::size_t    used = 0;
+    };
+
+    explicit SceneScratchFile(const SceneStorageOptions& options);
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void  do_deallocate(void*, std::size_t, std::size_t) override {}
+    bool  do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    void trim_locked();
+
+    mutable std::mutex              m_mutex;
+    std::unique_ptr<QTemporaryFile> m_file;
+    std::vector<Segment>            m_segments;
+    std::size_t                     m_file_size      = 0;
+    std::size_t                     m_allocated      = 0;
+    std::size_t                     m_touched        = 0;
+    std::size_t                     m_budget_bytes   = 0;
+};
+
+} // namespace ezgl
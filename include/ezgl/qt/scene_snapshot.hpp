@@ -0,0 +1,64 @@
+#pragma once
+
+#include "ezgl/qt/rhi_types.hpp"
+#include "ezgl/qt/scene_scratch.hpp"
+
+#include <QByteArray>
+#include <QString>
+
+#include <cstdint>
+#include <optional>
+
+/**
+ * @file scene_snapshot.hpp
+ *
+ * @brief On-disk snapshot of an assembled rhi scene.
+ *
+ * A snapshot holds everything @ref rhi_renderer hands to the GPU after a
+ * full redraw — the per-style @ref SceneBuffers and the recorded overlay
+ * (text, arcs, surfaces) — so a view can be re-opened without running the
+ * application's draw callback or the tile pipeline.
+ *
+ * @par Layout
+ * @code
+ *   SnapshotHeader                 magic, version, byte-order mark, scene bounds
+ *   SnapshotStyleRecord[n]         one per style buffer: key, color, section offsets
+ *   sections                       chunk tables and raw vertex/instance/index arrays,
+ *                                  each starting on a 16-byte boundary
+ *   overlay                        deferred_renderer::save_recording() stream
+ * @endcode
+ * Geometry arrays are stored in the exact in-memory layout of
+ * @ref PosVertex, @ref FillRectInstance etc., so the reader maps the file
+ * and copies each array in one go. A file with another version or byte
+ * order is rejected rather than converted.
+ */
+
+namespace ezgl {
+
+/// Bumped whenever the file layout or any stored vertex layout changes.
+inline constexpr std::uint32_t kSceneSnapshotVersion = 3;
+
+/// A snapshot read back from disk.
+struct SceneSnapshot {
+    SceneBuffers scene;
+    rectangle    scene_bounds; ///< camera initial world at save time
+    QByteArray   overlay;      ///< stream for deferred_renderer::load_recording()
+};
+
+/// Write @p scene and an overlay stream to @p path, replacing it atomically.
+/// Returns false (after a warning) on I/O failure.
+bool write_scene_snapshot(const QString&      path,
+                          const SceneBuffers& scene,
+                          const rectangle&    scene_bounds,
+                          const QByteArray&   overlay);
+
+/// Read a snapshot, allocating its geometry arrays as @p storage asks.
+/// Returns std::nullopt (after a warning) if the file is missing, from
+/// another version, or inconsistent.
+std::optional<SceneSnapshot> read_scene_snapshot(const QString&             path,
+                                                 const SceneStorageOptions& storage);
+
+/// Cheap check that @p path looks like a loadable snapshot (header only).
+bool probe_scene_snapshot(const QString& path);
+
+} // namespace ezgl
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <QFile>
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+#include <memory>
+
+namespace ezgl {
+
+/**
+ * @brief Writes an image file from consecutive bands of rows, without ever
+ * holding the whole image.
+ *
+ * Meant for exports too large for one @c QImage (a 30k x 30k poster is
+ * 3.6 GB as RGBA). The caller hands over rows top to bottom, in bands of
+ * any height, and each band is compressed and appended to the file before
+ * the next arrives. Pixels are stored as 8-bit RGB; alpha is dropped.
+ *
+ * The format follows the file suffix:
+ *  - @c .tif / @c .tiff: Deflate-compressed strips of @ref kTiffRowsPerStrip
+ *    rows, each compressed on its own. The directory goes after the
+ *    strips. Files that could pass 4 GB are written as BigTIFF.
+ *  - anything else: PNG, one zlib stream across all rows split into IDAT
+ *    chunks. Needs zlib at build time (@c EZGL_HAVE_ZLIB); without it
+ *    only TIFF is available.
+ *
+ * Not thread-safe; one writer per file.
+ */
+class StreamingImageWriter {
+public:
+    /// Rows per TIFF strip (the last strip may be shorter).
+    static constexpr int kTiffRowsPerStrip = 64;
+
+    /// Open @p path for a @p size image. Returns nullptr (after a warning)
+    /// if the file cannot be created or the format is unavailable.
+    static std::unique_ptr<StreamingImageWriter> create(const QString& path, QSize size);
+
+    virtual ~StreamingImageWriter();
+
+    StreamingImageWriter(const StreamingImageWriter&)            = delete;
+    StreamingImageWriter& operator=(const StreamingImageWriter&) = delete;
+
+    QSize size() const noexcept { return m_size; }
+    int   rows_written() const noexcept { return m_rows_written; }
+
+    /// Append the rows of @p band below those written so far. Its width
+    /// must match the image; rows past the image height are ignored.
+    /// Returns false once anything failed.
+    bool write_rows(const QImage& band);
+
+    /// Complete the file. False if any write failed or fewer rows than
+    /// the image height were given.
+    bool finish();
+
+protected:
+    StreamingImageWriter(const QString& path, QSize size);
+
+    /// Write the file header; @c m_file is open.
+    virtual bool write_header() = 0;
+
+    /// Compress and append @p count rows of packed RGB888 data.
+    virtual bool encode_rows(const uchar* rgb, qsizetype bytes_per_line, int count) = 0;
+
+    /// Write whatever the format needs after the last row.
+    virtual bool finish_file() = 0;
+
+    QFile m_file;
+    QSize m_size;
+
+private:
+    int  m_rows_written = 0;
+    bool m_ok           = true;
+    bool m_finished     = false;
+};
+
+} // namespace ezgl
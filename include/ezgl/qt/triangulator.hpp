@@ -0,0 +1,40 @@
+#pragma once
+
+#include "ezgl/point.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace ezgl {
+
+/**
+ * @brief Triangulate a simple polygon, optionally with holes.
+ *
+ * Earcut-style ear clipping over a doubly linked vertex ring. Holes are
+ * merged into the outer ring through bridge edges (leftmost hole vertex
+ * to the nearest visible outer vertex), so the clipper only ever sees one
+ * ring. Above @c kTriangulatorHashThreshold vertices, candidate ears are
+ * tested only against vertices whose z-order (Morton) code lies inside the
+ * ear's bounding box, which keeps large region outlines near O(n log n)
+ * instead of the O(n²) of naive ear clipping.
+ *
+ * Either winding is accepted for every ring; consecutive duplicates and a
+ * repeated closing vertex are tolerated. Self-intersecting input is
+ * triangulated best-effort (local intersections are cut off, the rest is
+ * split along valid diagonals) rather than rejected.
+ *
+ * @param outer  Outer boundary.
+ * @param holes  Hole boundaries, each expected to lie inside @p outer.
+ *
+ * @return Three indices per triangle into the concatenation
+ *         @c outer ++ holes[0] ++ holes[1] ++ ... . Empty when the input
+ *         is degenerate (fewer than 3 distinct vertices or zero area).
+ */
+std::vector<std::uint32_t> triangulate_polygon(const std::vector<point2d>& outer,
+                                               const std::vector<std::vector<point2d>>& holes = {});
+
+/// Vertex count above which @ref triangulate_polygon switches to z-order
+/// hashed ear tests.
+inline constexpr std::size_t kTriangulatorHashThreshold = 80;
+
+} // namespace ezgl
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "ezgl/irenderer.hpp"
+
+#include <QColor>
+#include <QFont>
+#include <QImage>
+#include <QPointF>
+#include <QRectF>
+#include <QSize>
+#include <QString>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ezgl {
+
+class Painter;
+
+enum class vector_format { svg, pdf };
+
+/// Paint attributes shared by every subpath of a @ref vector_path.
+struct vector_style {
+    QColor    color;
+    double    line_width = 1.0;  ///< page units; strokes only
+    line_cap  cap        = line_cap::butt;
+    line_dash dash       = line_dash::none;
+    bool      fill       = false; ///< nonzero-winding fill instead of a stroke
+
+    bool operator==(const vector_style&) const = default;
+};
+
+/// Subpaths in page units (y down) that are painted with one style.
+struct vector_path {
+    struct subpath {
+        std::uint32_t first  = 0;
+        std::uint32_t count  = 0;
+        bool          closed = false;
+    };
+
+    std::vector<QPointF> points;
+    std::vector<subpath> subpaths;
+
+    void move_to(QPointF p);
+    void line_to(QPointF p);
+    void close();
+    void clear();
+    bool empty() const { return subpaths.empty(); }
+};
+
+/**
+ * @brief Output file of a @ref vector_renderer.
+ *
+ * Everything is written as it arrives, in paint order, so the document
+ * holds no more than one buffered content chunk. Coordinates are page
+ * units: one output pixel is one SVG user unit or one PDF point, with y
+ * growing downwards.
+ *
+ * @par Formats
+ *  - SVG: one @c path element per merged path, @c text elements with the
+ *    canvas font, surfaces as embedded PNG.
+ *  - PDF: a single page whose content is split into Flate-compressed
+ *    streams of about 1 MB; text uses the built-in Helvetica, so glyph
+ *    widths differ slightly from the canvas font; surfaces are RGB image
+ *    XObjects with a soft mask for alpha.
+ */
+class vector_document {
+public:
+    /// Create (truncate) @p path for a @p page_size page. Returns nullptr,
+    /// after a warning, if the file cannot be opened.
+    static std::unique_ptr<vector_document> create(const QString& path,
+                                                   QSize          page_size,
+                                                   vector_format  format);
+
+    virtual ~vector_document() = default;
+
+    virtual void write_path(const vector_style& style, const vector_path& path) = 0;
+
+    /// @p origin is the start of the baseline; @p rotation is in degrees,
+    /// clockwise on the page.
+    virtual void write_text(const QString& text, QPointF origin, double rotation,
+                            const QFont& font, const QColor& color) = 0;
+
+    virtual void write_image(const QImage& image, const QRectF& target) = 0;
+
+    /// Complete the file. False if any write failed.
+    virtual bool finish() = 0;
+};
+
+/**
+ * @brief @ref irenderer that turns the draw callback's primitives into
+ * vector paths instead of pixels, for print_svg / print_pdf.
+ *
+ * Consecutive primitives of the same style are merged into one path, so a
+ * file carries one element per run of identically styled calls rather
+ * than one per call, and paint order is kept exactly:
+ *  - a line that starts (or ends) where the previous one ended extends
+ *    that polyline, and a collinear continuation only moves its end point;
+ *  - rectangles, polygons, triangles and pies of one fill color become
+ *    subpaths of one path. Every ring is oriented the same way (holes the
+ *    other way) and filled nonzero, so overlapping shapes stay solid.
+ *
+ * WORLD primitives outside the visible world are culled and lines are
+ * clipped to it, so exporting a zoomed view only writes what is visible.
+ * A run is handed to the @ref vector_document once its style changes,
+ * text or a surface is drawn, or it reaches @ref kMaxRunPoints, which
+ * bounds memory independently of the scene size. Arcs are flattened to
+ * polylines of about two page units per segment.
+ *
+ * Text metrics come from a private QPainter on a 1x1 image, so placement
+ * matches the immediate renderer.
+ */
+class vector_renderer final : public irenderer {
+public:
+    /// Points a run may hold before it is written out.
+    static constexpr std::size_t kMaxRunPoints = 4096;
+
+    vector_renderer(vector_document& out, transform_fn transform, camera* cam);
+    ~vector_renderer() override;
+
+    void draw_line(const point2d& start, const point2d& end) override;
+
+    void draw_rectangle(const point2d& start, const point2d& end) override;
+    void draw_rectangle(const point2d& start, double width, double height) override;
+    void draw_rectangle(const rectangle& r) override;
+
+    void fill_rectangle(const point2d& start, const point2d& end) override;
+    void fill_rectangle(const point2d& start, double width, double height) override;
+    void fill_rectangle(const rectangle& r) override;
+
+    void fill_poly(const std::vector<point2d>& points) override;
+    void fill_triangle(const point2d& a, const point2d& b, const point2d& c) override;
+    void fill_poly_with_holes(const std::vector<point2d>& outer,
+                              const std::vector<std::vector<point2d>>& holes) override;
+
+    void draw_elliptic_arc(const point2d& center, double radius_x, double radius_y,
+                           double start_angle, double extent_angle) override;
+    void draw_arc(const point2d& center, double radius,
+                  double start_angle, double extent_angle) override;
+    void fill_elliptic_arc(const point2d& center, double radius_x, double radius_y,
+                           double start_angle, double extent_angle) override;
+    void fill_arc(const point2d& center, double radius,
+                  double start_angle, double extent_angle) override;
+
+    void draw_text(const point2d& point, const std::string& text) override;
+    void draw_text(const point2d& point, const std::string& text,
+                   double bound_x, double bound_y) override;
+
+    void draw_surface(surface* p_surface, const point2d& anchor_point,
+                      double scale_factor = 1) override;
+
+    /// Write out the run being merged. The destructor does this too.
+    void flush();
+
+private:
+    vector_style stroke_style() const;
+    vector_style fill_style() const;
+    QPointF      to_page(const point2d& p) const;
+    /// Continue the current run with @p style, or flush and start anew.
+    void         begin_run(const vector_style& style, std::size_t extra_points);
+    void         add_rectangle(const point2d& start, const point2d& end, bool fill);
+    /// Add a closed ring, oriented positive (@p hole false) or negative.
+    void         add_ring(std::vector<QPointF> ring, bool hole);
+    void         add_arc(const point2d& center, double radius_x, double radius_y,
+                         double start_angle, double extent_angle, bool fill);
+    void         add_text(const point2d& point, const std::string& text,
+                          double bound_x, double bound_y);
+
+    vector_document&         m_out;
+    QImage                   m_metrics_surface;
+    std::unique_ptr<Painter> m_metrics_painter;
+    vector_style             m_run_style;
+    vector_path              m_run;
+};
+
+} // namespace ezgl
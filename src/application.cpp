@@ -753,13 +753,17 @@ void application::refresh_drawing()
   canvas *cnv = get_canvas(m_canvas_id);
 
   if (cnv) {
-    // force redrawing
-    cnv->redraw();
+    // Coalesced with pan/zoom into the next displayed frame.
+    cnv->request_redraw();
   }
 }
 
 void application::flush_drawing()
 {
+  // run a scheduled redraw first so the flushed frame includes it
+  if (canvas *cnv = get_canvas(m_canvas_id))
+    cnv->flush_scheduled_redraw();
+
   // get the main drawing area widget
   QWidget *drawing_area = find_widget(m_canvas_id.c_str());
 
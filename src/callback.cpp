@@ -39,7 +39,7 @@ struct mouse_pan {
   /**
    * Holds the timestamp of the last panning event
    */
-  int last_panning_event_time = 0;
+  quint64 last_panning_event_time = 0;
   /**
    * The old x and y positions of the mouse pointer, in the previous pan 
    * event.
@@ -50,8 +50,21 @@ struct mouse_pan {
   /* Has any panning happened since the mouse button was held down?
    */
   bool has_panned = false; 
+
+  /**
+   * Smoothed drag velocity in widget pixels per millisecond, used to start
+   * a kinetic pan on release.
+   */
+  double velocity_x = 0;
+  double velocity_y = 0;
 } g_mouse_pan;
 
+/**
+ * A release this long after the last drag movement counts as a stop, not a
+ * throw.
+ */
+static constexpr quint64 FLING_MAX_IDLE_MS = 50;
+
 bool press_key(QWidget*, QKeyEvent* event, void* data)
 {
   auto application = static_cast<ezgl::application*>(data);
@@ -84,6 +97,14 @@ bool press_mouse(QWidget*, QMouseEvent* event, void* data)
       g_mouse_pan.prev_x = pos.x();
       g_mouse_pan.prev_y = pos.y();
       g_mouse_pan.has_panned = false;  /* Haven't shifted the view yet */
+      g_mouse_pan.velocity_x = 0;
+      g_mouse_pan.velocity_y = 0;
+      g_mouse_pan.last_panning_event_time = event->timestamp();
+
+      // Grabbing the view stops a kinetic pan or smooth zoom in progress.
+      ezgl::canvas *canvas = application->get_canvas(application->get_main_canvas_id());
+      if (canvas != nullptr)
+        canvas->stop_camera_animation();
     }
     // Call the user-defined mouse press callback if defined
     // The user-defined callback is called for mouse buttons other than
@@ -134,6 +155,18 @@ bool release_mouse(QWidget*, QMouseEvent* event, void* data)
         ezgl::point2d const world = canvas->get_camera().widget_to_world(widget_coordinates);
         application->mouse_press_callback(application, event, world.x, world.y);
       }
+      // Throw the view if the pointer was still moving when released.
+      else if (g_mouse_pan.has_panned
+               && event->timestamp() - g_mouse_pan.last_panning_event_time < FLING_MAX_IDLE_MS) {
+        ezgl::canvas *canvas = application->get_canvas(application->get_main_canvas_id());
+        if (canvas != nullptr && canvas->is_kinetic_pan()) {
+          // Widget y grows downwards, world y upwards; the view moves
+          // against the drag.
+          point2d const scale = canvas->get_camera().get_world_scale_factor();
+          canvas->fling_camera({-g_mouse_pan.velocity_x * scale.x * 1000.0,
+                                g_mouse_pan.velocity_y * scale.y * 1000.0});
+        }
+      }
       g_mouse_pan.has_panned = false;  /* Done pan; reset for next time */
     }
   }
@@ -151,6 +184,15 @@ bool move_mouse(QWidget*, QMouseEvent* event, void* data)
     // Check if the mouse button is pressed to support dragging
     if(g_mouse_pan.panning_mouse_button_pressed) {
 
+      // Exponentially smoothed so one jittery sample doesn't decide the throw.
+      quint64 const elapsed_ms = event->timestamp() - g_mouse_pan.last_panning_event_time;
+      if (elapsed_ms > 0) {
+        double const alpha = 0.8;
+        g_mouse_pan.velocity_x = alpha * (pos.x() - g_mouse_pan.prev_x) / elapsed_ms
+                                 + (1.0 - alpha) * g_mouse_pan.velocity_x;
+        g_mouse_pan.velocity_y = alpha * (pos.y() - g_mouse_pan.prev_y) / elapsed_ms
+                                 + (1.0 - alpha) * g_mouse_pan.velocity_y;
+      }
       g_mouse_pan.last_panning_event_time = event->timestamp();
 
       std::string main_canvas_id = application->get_main_canvas_id();
@@ -20,9 +20,16 @@
 #include "ezgl/qt/deferred_backend.hpp"
 #include "ezgl/qt/drawingareawidget.hpp"
 #include "ezgl/qt/immediate_backend.hpp"
+#include "ezgl/qt/pick_index.hpp"
 #include "ezgl/qt/rhi_backend.hpp"
+#include "ezgl/qt/scene_snapshot.hpp"
 #include "ezgl/qt/rhi_canvas_widget.hpp"
+#include "ezgl/qt/rhi_offscreen_context.hpp"
+#include "ezgl/qt/streaming_image_writer.hpp"
+#include "ezgl/qt/vector_renderer.hpp"
 
+#include <QDir>
+#include <QImageWriter>
 #include <QWidget>
 #include <QPainter>
 #include <QPdfWriter>
@@ -31,8 +38,16 @@
 #include "ezgl/logutils.hpp"
 #include "ezgl/qt/painter.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <functional>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
 
 namespace {
 
@@ -81,6 +96,79 @@ static std::pair<int,int> resolve_output_size(int req_w, int req_h,
     return {1024, 768};
 }
 
+// Image encoding is far slower than drawing a view, so batch exports hand
+// the images to a few encoder threads. The queue is bounded: rendering
+// waits when the encoders fall behind instead of piling up images.
+class image_encoder_pool {
+public:
+  explicit image_encoder_pool(const char *format) : m_format(format)
+  {
+    const unsigned n = std::clamp(std::thread::hardware_concurrency(), 2u, 5u) - 1;
+    m_capacity = 2 * n;
+    for (unsigned i = 0; i < n; ++i)
+      m_threads.emplace_back([this]() { run(); });
+  }
+
+  ~image_encoder_pool()
+  {
+    finish();
+  }
+
+  void push(QString path, QImage image)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_space.wait(lock, [this]() { return m_queue.size() < m_capacity; });
+    m_queue.emplace_back(std::move(path), std::move(image));
+    m_work.notify_one();
+  }
+
+  // Encode everything queued, stop the threads; false if any file failed.
+  bool finish()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_done = true;
+    }
+    m_work.notify_all();
+    for (std::thread &t : m_threads)
+      t.join();
+    m_threads.clear();
+    return m_ok;
+  }
+
+private:
+  void run()
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+      m_work.wait(lock, [this]() { return m_done || !m_queue.empty(); });
+      if (m_queue.empty())
+        return;
+      auto [path, image] = std::move(m_queue.front());
+      m_queue.pop_front();
+      m_space.notify_one();
+      lock.unlock();
+
+      const bool ok = !image.isNull() && image.save(path, m_format);
+      if (!ok)
+        ezgl::q_warning("canvas: could not write %s.", qPrintable(path));
+
+      lock.lock();
+      m_ok = m_ok && ok;
+    }
+  }
+
+  const char *m_format;
+  std::mutex m_mutex;
+  std::condition_variable m_work;
+  std::condition_variable m_space;
+  std::deque<std::pair<QString, QImage>> m_queue;
+  std::size_t m_capacity = 2;
+  bool m_done = false;
+  bool m_ok = true;
+  std::vector<std::thread> m_threads;
+};
+
 } // anonymous namespace
 
 namespace ezgl {
@@ -89,8 +177,10 @@ namespace ezgl {
 // shared by print_pdf / print_svg / print_png / draw_offscreen.
 QImage canvas::render_to_image(int surface_width, int surface_height)
 {
-  if (!m_backend)
+  if (!m_backend) {
     m_backend = make_backend(m_renderer_type, nullptr, m_draw_callback, &m_camera, m_background_color);
+    apply_backend_settings();
+  }
 
   // Retarget the camera for the (w, h) framebuffer so compute_mvp produces
   // the right world→NDC matrix; restore afterward so the next live paint
@@ -104,10 +194,49 @@ QImage canvas::render_to_image(int surface_width, int surface_height)
   return out;
 }
 
+// Runs the draw callback into a vector_renderer writing the given document;
+// shared by print_pdf / print_svg.
+bool canvas::render_to_vector(const char *file_name, int surface_width, int surface_height, vector_format format)
+{
+  std::unique_ptr<vector_document> doc =
+      vector_document::create(QString::fromUtf8(file_name), QSize(surface_width, surface_height), format);
+  if (!doc)
+    return false;
+
+  const rectangle saved_widget = m_camera.get_widget();
+  m_camera.update_widget(surface_width, surface_height);
+
+  // The background, including any letterbox margins.
+  vector_style background;
+  background.color = QColor(m_background_color.red, m_background_color.green, m_background_color.blue);
+  background.fill = true;
+  vector_path page;
+  page.move_to({0.0, 0.0});
+  page.line_to({double(surface_width), 0.0});
+  page.line_to({double(surface_width), double(surface_height)});
+  page.line_to({0.0, double(surface_height)});
+  page.close();
+  doc->write_path(background, page);
+
+  {
+    using namespace std::placeholders;
+    vector_renderer g(*doc, std::bind(&camera::world_to_screen, m_camera, _1), &m_camera);
+    m_draw_callback(&g);
+  }
+
+  m_camera.update_widget(int(saved_widget.width()), int(saved_widget.height()));
+  return doc->finish();
+}
+
 bool canvas::print_pdf(const char *file_name, int output_width, int output_height)
 {
   const auto [w, h] = resolve_output_size(output_width, output_height, m_drawing_area);
 
+  // A loaded snapshot stands in for the draw callback, so it can only be
+  // exported as pixels.
+  if (m_scene_snapshot.isEmpty())
+    return render_to_vector(file_name, w, h, vector_format::pdf);
+
   const QImage surface = render_to_image(w, h);
 
   QPdfWriter writer(file_name);
@@ -128,6 +257,9 @@ bool canvas::print_svg(const char *file_name, int output_width, int output_heigh
 {
   const auto [w, h] = resolve_output_size(output_width, output_height, m_drawing_area);
 
+  if (m_scene_snapshot.isEmpty())
+    return render_to_vector(file_name, w, h, vector_format::svg);
+
   const QImage surface = render_to_image(w, h);
 
   QSvgGenerator generator;
@@ -148,15 +280,342 @@ bool canvas::print_png(const char *file_name, int output_width, int output_heigh
 {
   const auto [w, h] = resolve_output_size(output_width, output_height, m_drawing_area);
 
+  if (!m_backend) {
+    m_backend = make_backend(m_renderer_type, nullptr, m_draw_callback, &m_camera, m_background_color);
+    apply_backend_settings();
+  }
+  const int limit = m_backend->max_image_size();
+  if (limit > 0 && (w > limit || h > limit))
+    return print_tiled(file_name, w, h);
+
   const QImage surface = render_to_image(w, h);
   return surface.save(file_name, "PNG");
 }
 
+bool canvas::print_tiled(const char *file_name, int output_width, int output_height, int tile_size)
+{
+  return_val_if_fail("print_tiled tile size", tile_size > 0, false);
+  const auto [w, h] = resolve_output_size(output_width, output_height, m_drawing_area);
+
+  if (!m_backend) {
+    m_backend = make_backend(m_renderer_type, nullptr, m_draw_callback, &m_camera, m_background_color);
+    apply_backend_settings();
+  }
+  const int limit = m_backend->max_image_size();
+  const int tile = limit > 0 ? std::min(tile_size, limit) : tile_size;
+
+  std::unique_ptr<StreamingImageWriter> writer = StreamingImageWriter::create(QString::fromUtf8(file_name), {w, h});
+  if (!writer)
+    return false;
+
+  // The whole image, margins included, as print_png() would frame it: the
+  // world spanned by one output pixel and the world at the top-left corner.
+  camera probe = m_camera;
+  probe.update_widget(w, h);
+  const rectangle screen = probe.get_screen();
+  const rectangle world = probe.get_world();
+  const double px_x = world.width() / screen.width();
+  const double px_y = world.height() / screen.height();
+  const point2d image_top_left(world.left() - screen.left() * px_x, world.top() + screen.bottom() * px_y);
+
+  // As in print_tile_pyramid(): choose each view's world such that the
+  // whole tile-sized widget, letterbox margins included, shows the tile.
+  probe.update_widget(tile, tile);
+  const rectangle tile_screen = probe.get_screen();
+  const double fx0 = tile_screen.left() / tile;
+  const double fy0 = tile_screen.bottom() / tile;
+  const double fw = tile_screen.width() / tile;
+  const double fh = tile_screen.height() / tile;
+  const double step_x = tile * px_x;
+  const double step_y = tile * px_y;
+
+  const int cols = (w + tile - 1) / tile;
+  const int rows = (h + tile - 1) / tile;
+  std::vector<rectangle> worlds;
+  worlds.reserve(std::size_t(cols) * std::size_t(rows));
+  for (int r = 0; r < rows; ++r) {
+    for (int c = 0; c < cols; ++c) {
+      const point2d tile_top_left(image_top_left.x + c * step_x, image_top_left.y - r * step_y);
+      worlds.emplace_back(point2d(tile_top_left.x + fx0 * step_x, tile_top_left.y - (fy0 + fh) * step_y),
+                          fw * step_x,
+                          fh * step_y);
+    }
+  }
+
+  // Views arrive in order, so each row of tiles is assembled in one band
+  // and streamed out as soon as its last tile lands. Edge tiles are cropped.
+  QImage band(w, tile, QImage::Format_RGB888);
+  band.fill(Qt::black);
+  bool ok = true;
+  render_views_to(worlds, tile, tile, [&](std::size_t index, QImage image) {
+    const int c = int(index % std::size_t(cols));
+    const int x0 = c * tile;
+    if (image.isNull()) {
+      q_warning("print_tiled: tile %zu could not be rendered.", index);
+      ok = false;
+    } else {
+      const QImage rgb = image.convertToFormat(QImage::Format_RGB888);
+      const std::size_t bytes = std::size_t(std::min(tile, w - x0)) * 3;
+      for (int y = 0; y < tile; ++y)
+        std::memcpy(band.scanLine(y) + std::size_t(x0) * 3, rgb.constScanLine(y), bytes);
+    }
+    if (c == cols - 1)
+      ok = writer->write_rows(band) && ok;
+  });
+  ok = writer->finish() && ok;
+  q_debug("print_tiled: %dx%d image from %zu tile(s) of %d px.", w, h, worlds.size(), tile);
+  return ok;
+}
+
 void canvas::draw_offscreen(int output_width, int output_height)
 {
   render_to_image(output_width, output_height);
 }
 
+void canvas::render_views_to(std::span<const rectangle> worlds,
+                             int surface_width,
+                             int surface_height,
+                             const render_backend::view_sink_fn &sink)
+{
+  render_views_to(worlds.size(), [worlds](std::size_t index) { return worlds[index]; }, surface_width, surface_height,
+                  sink);
+}
+
+void canvas::render_views_to(std::size_t count,
+                             const render_backend::view_world_fn &world_of,
+                             int surface_width,
+                             int surface_height,
+                             const render_backend::view_sink_fn &sink)
+{
+  if (!m_backend) {
+    m_backend = make_backend(m_renderer_type, nullptr, m_draw_callback, &m_camera, m_background_color);
+    apply_backend_settings();
+  }
+
+  // Same retargeting as render_to_image, plus the world of each view.
+  const rectangle saved_widget = m_camera.get_widget();
+  const rectangle saved_world = m_camera.get_world();
+  m_camera.update_widget(surface_width, surface_height);
+
+  if (!m_backend->render_views(count, world_of, surface_width, surface_height, sink)) {
+    for (std::size_t i = 0; i < count; ++i) {
+      m_camera.set_world(world_of(i));
+      sink(i, m_backend->render_to_image(surface_width, surface_height));
+    }
+  }
+
+  m_camera.update_widget(int(saved_widget.width()), int(saved_widget.height()));
+  m_camera.set_world(saved_world);
+}
+
+std::vector<QImage> canvas::render_views(std::span<const rectangle> worlds, int output_width, int output_height)
+{
+  const auto [w, h] = resolve_output_size(output_width, output_height, m_drawing_area);
+
+  std::vector<QImage> images(worlds.size());
+  render_views_to(worlds, w, h, [&images](std::size_t index, QImage image) {
+    images[index] = std::move(image);
+  });
+  return images;
+}
+
+bool canvas::print_views_png(std::span<const rectangle> worlds,
+                             const char *file_pattern,
+                             int output_width,
+                             int output_height)
+{
+  // Without a placeholder every view would overwrite the same file.
+  const QString pattern = QString::fromUtf8(file_pattern);
+  return_val_if_fail("print_views_png file_pattern", pattern.contains(QLatin1String("%1")), false);
+  const auto [w, h] = resolve_output_size(output_width, output_height, m_drawing_area);
+
+  image_encoder_pool encoders("PNG");
+  render_views_to(worlds, w, h, [&](std::size_t index, QImage image) {
+    encoders.push(pattern.arg(qulonglong(index)), std::move(image));
+  });
+  return encoders.finish();
+}
+
+bool canvas::print_tile_pyramid(const char *directory, int max_level, int tile_size, const char *format)
+{
+  return_val_if_fail("print_tile_pyramid levels", max_level >= 0 && max_level < 24, false);
+  return_val_if_fail("print_tile_pyramid tile size", tile_size > 0, false);
+  const QByteArray fmt = QByteArray(format).toLower();
+  if (!QImageWriter::supportedImageFormats().contains(fmt)) {
+    q_warning("print_tile_pyramid: no image writer for format '%s'.", format);
+    return false;
+  }
+
+  // Square up the world so every tile is square in world units too.
+  const rectangle initial = m_camera.get_initial_world();
+  const double side = std::max(initial.width(), initial.height());
+  const point2d origin = initial.center() - point2d(side / 2, side / 2);
+  const rectangle bounds(origin, side, side);
+
+  // The camera keeps the initial world's aspect ratio inside the widget, so
+  // a square tile may be letterboxed. Pick each view's world such that the
+  // whole widget, margins included, shows exactly the tile.
+  camera probe = m_camera;
+  probe.update_widget(tile_size, tile_size);
+  const rectangle screen = probe.get_screen();
+  const double fx0 = screen.left() / tile_size;
+  const double fy0 = screen.bottom() / tile_size;
+  const double fw = screen.width() / tile_size;
+  const double fh = screen.height() / tile_size;
+
+  // Every directory exists before the first tile is written.
+  const QDir root(QString::fromUtf8(directory));
+  std::size_t count = 0;
+  for (int z = 0; z <= max_level; ++z) {
+    const int n = 1 << z;
+    for (int x = 0; x < n; ++x) {
+      if (!root.mkpath(QString("%1/%2").arg(z).arg(x))) {
+        q_warning("print_tile_pyramid: could not create %s/%d/%d.", directory, z, x);
+        return false;
+      }
+    }
+    count += std::size_t(n) * std::size_t(n);
+  }
+
+  // Tile `index` counts level by level, column by column. The deeper
+  // levels hold far more tiles than fit in memory as a list, so each
+  // tile's world is derived from its index as it is rendered, all in one
+  // render_views pass over one recorded scene.
+  struct tile_id {
+    int z;
+    int x;
+    int y;
+  };
+  const auto tile_at = [](std::size_t index) {
+    int z = 0;
+    std::size_t level_size = 1;
+    while (index >= level_size) {
+      index -= level_size;
+      ++z;
+      level_size *= 4;
+    }
+    const std::size_t n = std::size_t(1) << z;
+    return tile_id{z, int(index / n), int(index % n)};
+  };
+  const auto world_of = [&](std::size_t index) {
+    const tile_id id = tile_at(index);
+    const double step = side / (1 << id.z);
+    // XYZ rows count down from the top of the world.
+    const point2d tile_top_left(bounds.left() + id.x * step, bounds.top() - id.y * step);
+    return rectangle(point2d(tile_top_left.x + fx0 * step, tile_top_left.y - (fy0 + fh) * step), fw * step, fh * step);
+  };
+
+  const QString suffix = QString::fromLatin1(fmt);
+  image_encoder_pool encoders(fmt.constData());
+  render_views_to(count, world_of, tile_size, tile_size, [&](std::size_t index, QImage image) {
+    const tile_id id = tile_at(index);
+    encoders.push(root.filePath(QString("%1/%2/%3.%4").arg(id.z).arg(id.x).arg(id.y).arg(suffix)), std::move(image));
+  });
+
+  const bool ok = encoders.finish();
+  q_debug("print_tile_pyramid: wrote %zu tile(s) to %s.", count, directory);
+  return ok;
+}
+
+struct canvas::image_sequence {
+  int width = 0;
+  int height = 0;
+  std::size_t next_frame = 0;
+  frame_sink_fn sink;
+  std::unique_ptr<image_encoder_pool> encoders; // file pattern form only
+  bool ok = true;
+
+  void deliver(std::size_t frame, const QImage &image)
+  {
+    if (image.isNull()) {
+      q_warning("canvas: frame %zu of the image sequence could not be captured.", frame);
+      ok = false;
+      return;
+    }
+    sink(frame, image);
+  }
+};
+
+void canvas::begin_image_sequence(const char *file_pattern, int output_width, int output_height)
+{
+  // Without a placeholder every frame would overwrite the same file. Like
+  // any begin, a rejected one still ends the running sequence.
+  if (m_image_sequence)
+    end_image_sequence();
+  const QString pattern = QString::fromUtf8(file_pattern);
+  return_if_fail("begin_image_sequence file_pattern", pattern.contains(QLatin1String("%1")));
+  auto encoders = std::make_unique<image_encoder_pool>("PNG");
+  image_encoder_pool *pool = encoders.get();
+  begin_image_sequence([pool, pattern](std::size_t frame, const QImage &image) {
+    pool->push(pattern.arg(qulonglong(frame)), image);
+  }, output_width, output_height);
+  m_image_sequence->encoders = std::move(encoders);
+}
+
+void canvas::begin_image_sequence(frame_sink_fn sink, int output_width, int output_height)
+{
+  if (m_image_sequence)
+    end_image_sequence();
+  const auto [w, h] = resolve_output_size(output_width, output_height, m_drawing_area);
+  m_image_sequence = std::make_unique<image_sequence>();
+  m_image_sequence->width = w;
+  m_image_sequence->height = h;
+  m_image_sequence->sink = std::move(sink);
+}
+
+void canvas::begin_raw_sequence(raw_frame_sink_fn sink, int output_width, int output_height)
+{
+  // RGBA8888 rows are 4-byte aligned, so a QImage in that format is
+  // tightly packed; the rhi backend already reads back in it.
+  begin_image_sequence([sink = std::move(sink)](std::size_t frame, const QImage &image) {
+    const QImage rgba = image.convertToFormat(QImage::Format_RGBA8888);
+    sink(frame, rgba.constBits(), std::size_t(rgba.sizeInBytes()));
+  }, output_width, output_height);
+}
+
+void canvas::capture_sequence_frame()
+{
+  return_if_fail("capture_sequence_frame", m_image_sequence != nullptr);
+  if (!m_backend) {
+    m_backend = make_backend(m_renderer_type, nullptr, m_draw_callback, &m_camera, m_background_color);
+    apply_backend_settings();
+  }
+
+  // Same retargeting as render_to_image; the backend takes everything that
+  // depends on the camera before returning, even if it renders later.
+  image_sequence *sequence = m_image_sequence.get();
+  const std::size_t frame = sequence->next_frame++;
+  const rectangle saved_widget = m_camera.get_widget();
+  m_camera.update_widget(sequence->width, sequence->height);
+
+  if (!m_backend->queue_frame(sequence->width, sequence->height, [sequence, frame](QImage image) {
+        sequence->deliver(frame, image);
+      }))
+    sequence->deliver(frame, m_backend->render_to_image(sequence->width, sequence->height));
+
+  m_camera.update_widget(int(saved_widget.width()), int(saved_widget.height()));
+}
+
+bool canvas::end_image_sequence()
+{
+  if (!m_image_sequence)
+    return false;
+  // Queued frames hold a pointer to the sequence and live in the shared
+  // offscreen context, which outlives a backend dropped after a render
+  // failure, so flush that context whether or not the backend exists.
+  if (m_backend)
+    m_backend->flush_frames();
+  if (RhiOffscreenContext *context = RhiOffscreenContext::instance())
+    context->flush();
+
+  bool ok = m_image_sequence->ok;
+  if (m_image_sequence->encoders)
+    ok = m_image_sequence->encoders->finish() && ok;
+  q_debug("canvas: image sequence of %zu frame(s) ended.", m_image_sequence->next_frame);
+  m_image_sequence.reset();
+  return ok;
+}
+
 canvas::canvas(std::string canvas_id,
                draw_canvas_fn draw_callback,
                rectangle coordinate_system,
@@ -165,15 +624,32 @@ canvas::canvas(std::string canvas_id,
     , m_draw_callback(draw_callback)
     , m_camera(coordinate_system)
     , m_background_color(background_color)
+    , m_camera_animator(m_camera)
 {
 }
 
+canvas::~canvas()
+{
+  if (m_image_sequence)
+    end_image_sequence();
+}
+
 void canvas::initialize(QWidget *drawing_area)
 {
   return_if_fail("initialize drawing_area", drawing_area != nullptr);
 
   m_drawing_area = drawing_area;
   m_backend = make_backend(m_renderer_type, drawing_area, m_draw_callback, &m_camera, m_background_color);
+  apply_backend_settings();
+  m_frame_scheduler = std::make_unique<FrameScheduler>(
+      drawing_area,
+      [this]() { redraw(); },
+      [this]() { redraw_camera_only(); },
+      [this]() {
+        if (m_backend)
+          m_backend->redraw_camera_transient();
+      });
+  m_frame_scheduler->set_animation_hook([this]() { return m_camera_animator.advance(); });
 
   // Wire up widget-specific signals after backend creation.
   if (RhiCanvasWidget* rw = qobject_cast<RhiCanvasWidget*>(drawing_area)) {
@@ -187,6 +663,17 @@ void canvas::initialize(QWidget *drawing_area)
       m_camera.update_widget(w, h);
       if (m_backend) m_backend->on_resize(w, h);
     });
+    // Queued: the widget emits from inside its paint, and a redraw posts
+    // new frame data back into it.
+    QObject::connect(rw, &RhiCanvasWidget::scene_lost, rw, [this]() {
+      redraw();
+    }, Qt::QueuedConnection);
+    QObject::connect(rw, &RhiCanvasWidget::upload_progress, rw, [this](qulonglong done, qulonglong total) {
+      if (m_upload_progress_fn) m_upload_progress_fn(std::size_t(done), std::size_t(total));
+    });
+    rw->set_retain_cpu_scene(!m_memory_lean);
+    rw->set_upload_budget(m_upload_budget_bytes);
+    rw->set_overlay_tile_budget(m_overlay_tile_budget_bytes);
     if (rw->width() > 0 && rw->height() > 0)
       m_camera.update_widget(rw->width(), rw->height());
   } else if (DrawingAreaWidget* daw = qobject_cast<DrawingAreaWidget*>(drawing_area)) {
@@ -203,6 +690,114 @@ void canvas::initialize(QWidget *drawing_area)
   q_debug("canvas::initialize successful.");
 }
 
+void canvas::set_memory_lean(bool enabled)
+{
+  m_memory_lean = enabled;
+  if (RhiCanvasWidget* rw = qobject_cast<RhiCanvasWidget*>(m_drawing_area))
+    rw->set_retain_cpu_scene(!enabled);
+}
+
+void canvas::set_upload_budget(std::size_t bytes_per_frame)
+{
+  m_upload_budget_bytes = bytes_per_frame;
+  if (RhiCanvasWidget* rw = qobject_cast<RhiCanvasWidget*>(m_drawing_area))
+    rw->set_upload_budget(bytes_per_frame);
+}
+
+void canvas::set_overlay_tile_cache(std::size_t vram_bytes)
+{
+  m_overlay_tile_budget_bytes = vram_bytes;
+  if (RhiCanvasWidget* rw = qobject_cast<RhiCanvasWidget*>(m_drawing_area)) {
+    rw->set_overlay_tile_budget(vram_bytes);
+    // Switch the overlay between tiles and a single image on the next frame.
+    if (m_backend)
+      request_redraw_camera_only();
+  }
+}
+
+void canvas::set_scene_storage(const SceneStorageOptions &options)
+{
+  m_scene_storage = options;
+  apply_backend_settings();
+}
+
+void canvas::set_async_redraw(bool enabled)
+{
+  m_async_redraw = enabled;
+  apply_backend_settings();
+}
+
+bool canvas::save_scene_snapshot(const char *file_name)
+{
+  if (!m_backend) {
+    m_backend = make_backend(m_renderer_type, nullptr, m_draw_callback, &m_camera, m_background_color);
+    apply_backend_settings();
+  }
+  rhi_backend *rb = dynamic_cast<rhi_backend *>(m_backend.get());
+  if (!rb) {
+    q_warning("canvas: scene snapshots need the rhi renderer.");
+    return false;
+  }
+  return rb->save_snapshot(QString::fromUtf8(file_name));
+}
+
+bool canvas::load_scene_snapshot(const char *file_name)
+{
+  if (m_renderer_type != renderer_type::rhi) {
+    q_warning("canvas: scene snapshots need the rhi renderer.");
+    return false;
+  }
+  const QString path = QString::fromUtf8(file_name);
+  if (!probe_scene_snapshot(path))
+    return false;
+  m_scene_snapshot = path;
+  apply_backend_settings();
+  // Before initialize() the first paint picks the snapshot up.
+  if (m_backend && m_drawing_area)
+    redraw();
+  return true;
+}
+
+void canvas::clear_scene_snapshot()
+{
+  m_scene_snapshot.clear();
+  apply_backend_settings();
+}
+
+void canvas::apply_backend_settings()
+{
+  if (rhi_backend *rb = dynamic_cast<rhi_backend *>(m_backend.get())) {
+    rb->set_scene_storage(m_scene_storage);
+    rb->set_scene_snapshot(m_scene_snapshot);
+    rb->set_async_redraw(m_async_redraw);
+  }
+}
+
+std::size_t canvas::resident_cpu_scene_bytes() const
+{
+  if (RhiCanvasWidget* rw = qobject_cast<RhiCanvasWidget*>(m_drawing_area))
+    return rw->resident_cpu_scene_bytes();
+  return 0;
+}
+
+std::uint32_t canvas::pick(point2d world_point, double tolerance_px) const
+{
+  const std::shared_ptr<const PickIndex> index = m_backend ? m_backend->pick_index() : nullptr;
+  if (!index)
+    return 0;
+  const point2d world_per_px = m_camera.get_world_scale_factor();
+  return index->pick(world_point,
+                     {std::abs(world_per_px.x) * tolerance_px, std::abs(world_per_px.y) * tolerance_px});
+}
+
+std::vector<std::uint32_t> canvas::pick_rect(const rectangle &world_rect) const
+{
+  const std::shared_ptr<const PickIndex> index = m_backend ? m_backend->pick_index() : nullptr;
+  if (!index)
+    return {};
+  return index->pick_rect(world_rect);
+}
+
 int canvas::width() const
 {
   // Headless mode (e.g. --disp off + save_graphics): the widget tree is
@@ -239,8 +834,62 @@ void canvas::redraw_camera_only()
     m_backend->redraw_camera_only();
 }
 
+void canvas::request_redraw()
+{
+  if (m_frame_scheduler)
+    m_frame_scheduler->request_redraw();
+  else
+    redraw();
+}
+
+void canvas::request_redraw_camera_only()
+{
+  if (m_frame_scheduler)
+    m_frame_scheduler->request_redraw_camera_only();
+  else
+    redraw_camera_only();
+}
+
+void canvas::flush_scheduled_redraw()
+{
+  if (m_frame_scheduler)
+    m_frame_scheduler->flush();
+}
+
+void canvas::animate_camera_to(rectangle world)
+{
+  if (m_smooth_zoom_ms <= 0 || !m_frame_scheduler) {
+    stop_camera_animation();
+    m_camera.set_world(world);
+    request_redraw_camera_only();
+    return;
+  }
+  m_camera_animator.animate_to(world, m_smooth_zoom_ms);
+  m_frame_scheduler->start_animation();
+}
+
+void canvas::fling_camera(point2d world_per_second)
+{
+  if (!m_kinetic_pan || !m_frame_scheduler)
+    return;
+  m_camera_animator.fling(world_per_second);
+  m_frame_scheduler->start_animation();
+}
+
+void canvas::stop_camera_animation()
+{
+  if (!m_camera_animator.active())
+    return;
+  m_camera_animator.stop();
+  if (m_frame_scheduler)
+    m_frame_scheduler->stop_animation();
+}
+
 renderer *canvas::create_animation_renderer()
 {
+  // Animation drawing goes on top of the current frame, so a scheduled
+  // redraw must not land after it and paint over it.
+  flush_scheduled_redraw();
   if (m_backend)
     return m_backend->create_animation_renderer();
   return nullptr;
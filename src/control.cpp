@@ -45,55 +45,63 @@ static rectangle zoom_out_world(point2d zoom_point, rectangle world, double zoom
   return {{left, bottom}, {right, top}};
 }
 
+// Map a widget point into the world the camera is heading to, so that zoom
+// steps issued during a smooth zoom keep the same world point under the cursor
+// once the camera settles.
+static point2d widget_to_target_world(canvas *cnv, point2d widget_point)
+{
+  camera target = cnv->get_camera();
+  target.set_world(cnv->camera_target_world());
+  return target.widget_to_world(widget_point);
+}
+
 void zoom_in(canvas *cnv, double zoom_factor)
 {
-  point2d const zoom_point = cnv->get_camera().get_world().center();
-  rectangle const world = cnv->get_camera().get_world();
+  rectangle const world = cnv->camera_target_world();
+  point2d const zoom_point = world.center();
 
-  cnv->get_camera().set_world(zoom_in_world(zoom_point, world, zoom_factor));
-  cnv->redraw_camera_only();
+  cnv->animate_camera_to(zoom_in_world(zoom_point, world, zoom_factor));
 }
 
 void zoom_in(canvas *cnv, point2d zoom_point, double zoom_factor)
 {
-  zoom_point = cnv->get_camera().widget_to_world(zoom_point);
-  rectangle const world = cnv->get_camera().get_world();
+  zoom_point = widget_to_target_world(cnv, zoom_point);
+  rectangle const world = cnv->camera_target_world();
 
-  cnv->get_camera().set_world(zoom_in_world(zoom_point, world, zoom_factor));
-  cnv->redraw_camera_only();
+  cnv->animate_camera_to(zoom_in_world(zoom_point, world, zoom_factor));
 }
 
 void zoom_out(canvas *cnv, double zoom_factor)
 {
-  point2d const zoom_point = cnv->get_camera().get_world().center();
-  rectangle const world = cnv->get_camera().get_world();
+  rectangle const world = cnv->camera_target_world();
+  point2d const zoom_point = world.center();
 
-  cnv->get_camera().set_world(zoom_out_world(zoom_point, world, zoom_factor));
-  cnv->redraw_camera_only();
+  cnv->animate_camera_to(zoom_out_world(zoom_point, world, zoom_factor));
 }
 
 void zoom_out(canvas *cnv, point2d zoom_point, double zoom_factor)
 {
-  zoom_point = cnv->get_camera().widget_to_world(zoom_point);
-  rectangle const world = cnv->get_camera().get_world();
+  zoom_point = widget_to_target_world(cnv, zoom_point);
+  rectangle const world = cnv->camera_target_world();
 
-  cnv->get_camera().set_world(zoom_out_world(zoom_point, world, zoom_factor));
-  cnv->redraw_camera_only();
+  cnv->animate_camera_to(zoom_out_world(zoom_point, world, zoom_factor));
 }
 
 void zoom_fit(canvas *cnv, rectangle region)
 {
-  cnv->get_camera().set_world(region);
-  cnv->redraw_camera_only();
+  cnv->animate_camera_to(region);
 }
 
 void translate(canvas *cnv, double dx, double dy)
 {
+  // Panning grabs the view: a running zoom or fling stops where it is.
+  cnv->stop_camera_animation();
+
   rectangle new_world = cnv->get_camera().get_world();
   new_world += ezgl::point2d(dx, dy);
 
   cnv->get_camera().set_world(new_world);
-  cnv->redraw_camera_only();
+  cnv->request_redraw_camera_only();
 }
 
 void translate_up(canvas *cnv, double translate_factor)
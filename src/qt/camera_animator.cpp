@@ -0,0 +1,94 @@
+#include "ezgl/qt/camera_animator.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ezgl {
+
+namespace {
+
+double ease_out_cubic(double t)
+{
+    const double u = 1.0 - t;
+    return 1.0 - u * u * u;
+}
+
+rectangle lerp_world(const rectangle& a, const rectangle& b, double w)
+{
+    return {{a.left() + (b.left() - a.left()) * w, a.bottom() + (b.bottom() - a.bottom()) * w},
+            {a.right() + (b.right() - a.right()) * w, a.top() + (b.top() - a.top()) * w}};
+}
+
+} // namespace
+
+void camera_animator::animate_to(rectangle target, int duration_ms)
+{
+    m_from       = m_camera.get_world();
+    m_to         = target;
+    m_duration_s = std::max(duration_ms, 1) / 1000.0;
+    m_mode       = mode::zoom;
+    m_clock.start();
+}
+
+void camera_animator::fling(point2d world_per_s)
+{
+    m_velocity = world_per_s;
+    m_mode     = mode::fling;
+    m_clock.start();
+    m_last_ns  = 0;
+}
+
+rectangle camera_animator::target_world() const
+{
+    return m_mode == mode::zoom ? m_to : m_camera.get_world();
+}
+
+bool camera_animator::advance()
+{
+    switch (m_mode) {
+        case mode::idle:
+            return false;
+
+        case mode::zoom: {
+            const double t = std::min(m_clock.nsecsElapsed() * 1e-9 / m_duration_s, 1.0);
+            if (t >= 1.0) {
+                m_camera.set_world(m_to);
+                m_mode = mode::idle;
+                return false;
+            }
+            const double e  = ease_out_cubic(t);
+            const double w0 = m_from.width();
+            const double w1 = m_to.width();
+            double weight = e;
+            if (w0 > 0.0 && w1 > 0.0 && std::fabs(w1 - w0) > 1e-9 * w0)
+                weight = (w0 * std::pow(w1 / w0, e) - w0) / (w1 - w0);
+            m_camera.set_world(lerp_world(m_from, m_to, weight));
+            return true;
+        }
+
+        case mode::fling: {
+            const qint64 now_ns = m_clock.nsecsElapsed();
+            const double dt     = (now_ns - m_last_ns) * 1e-9;
+            m_last_ns = now_ns;
+
+            // Exact integral of v * exp(-t / tau) over the frame.
+            const double decay = std::exp(-dt / kFlingTimeConstantS);
+            const double k     = kFlingTimeConstantS * (1.0 - decay);
+            rectangle world = m_camera.get_world();
+            world += point2d(m_velocity.x * k, m_velocity.y * k);
+            m_camera.set_world(world);
+            m_velocity = point2d(m_velocity.x * decay, m_velocity.y * decay);
+
+            const double px_per_world = m_camera.get_widget().width() / world.width();
+            const double speed_px     = std::hypot(m_velocity.x, m_velocity.y) * px_per_world;
+            if (speed_px < kFlingStopPxPerS) {
+                m_mode = mode::idle;
+                return false;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace ezgl
@@ -6,6 +6,7 @@
 #include "ezgl/logutils.hpp"
 
 #include <functional>
+#include <memory>
 
 namespace ezgl {
 
@@ -23,6 +24,7 @@ deferred_backend::deferred_backend(QWidget*       drawing_area,
 
 deferred_backend::~deferred_backend()
 {
+    m_recording.reset();
     delete m_painter;
     delete m_animation_renderer;
 }
@@ -43,23 +45,32 @@ void deferred_backend::recreate_surface()
     m_painter->setSmoothPixmap(false);
 }
 
-void deferred_backend::redraw()
+void deferred_backend::paint_background()
 {
-    if (!m_painter)
-        return;
-
     m_painter->set_source_rgb(m_background_color.red   / 255.0,
                               m_background_color.green / 255.0,
                               m_background_color.blue  / 255.0);
     m_painter->paint();
+}
+
+void deferred_backend::redraw()
+{
+    if (!m_painter)
+        return;
 
+    paint_background();
+
+    // The recording is kept, bound to the live camera, for camera-only
+    // redraws; it holds every WORLD primitive, not just the visible ones.
     using namespace std::placeholders;
-    deferred_renderer g(m_painter,
-                        std::bind(&camera::world_to_screen, m_camera, _1),
-                        m_camera,
-                        m_surface);
-    m_draw_callback(&g);
-    g.flush();
+    m_recording = std::make_unique<deferred_renderer>(m_painter,
+                                                      std::bind(&camera::world_to_screen, m_camera, _1),
+                                                      m_camera,
+                                                      m_surface);
+    m_recording->set_replay_threads(0);
+    m_recording->set_retain_recording(true);
+    m_draw_callback(m_recording.get());
+    m_recording->replay_overlay();
 
     m_drawing_area->update();
     q_debug("The canvas will be redrawn (deferred path).");
@@ -67,11 +78,22 @@ void deferred_backend::redraw()
 
 void deferred_backend::redraw_camera_only()
 {
-    redraw();
+    if (!m_recording || !m_painter) {
+        redraw();
+        return;
+    }
+
+    // Pan / zoom: re-project the kept recording, without the draw callback.
+    paint_background();
+    m_recording->replay_overlay();
+
+    m_drawing_area->update();
+    q_debug("The canvas will be redrawn from the kept recording (deferred path).");
 }
 
 void deferred_backend::on_resize(int /*w*/, int /*h*/)
 {
+    m_recording.reset();
     if (m_painter) {
         delete m_painter;
         m_painter = nullptr;
@@ -109,6 +131,7 @@ QImage deferred_backend::render_to_image(int w, int h)
 
     using namespace std::placeholders;
     deferred_renderer g(&painter, std::bind(&camera::world_to_screen, *m_camera, _1), m_camera, &surface);
+    g.set_replay_threads(0);
     m_draw_callback(&g);
     g.flush();
     return surface;
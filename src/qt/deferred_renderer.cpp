@@ -6,11 +6,16 @@
 #include <cfloat>
 #include <QBrush>
 #include <QColor>
+#include <QDataStream>
+#include <QTransform>
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <iterator>
 #include <limits>
+#include <thread>
 #include <type_traits>
+#include <utility>
 #include <variant>
 
 namespace ezgl {
@@ -20,6 +25,10 @@ namespace ezgl {
 static constexpr double kMinReadableTextSize = 8.0;
 static constexpr int kOverlaySpatialGridDimension = 256;
 
+// Banded replay only pays off with enough rows and primitives per band.
+static constexpr int         kMinReplayBandRows = 32;
+static constexpr std::size_t kMinReplayBandPrimitives = 2048;
+
 struct DeferredVisibleStats {
     std::size_t lines = 0;
     std::size_t filled_rects = 0;
@@ -58,6 +67,52 @@ static void print_visible_stats(const DeferredVisibleStats& stats)
         << " surfaces=" << stats.surfaces;
 }
 
+// The batched primitives that survived culling, in replay order.
+struct DeferredVisibleBatches {
+    struct Lines {
+        LineStyleKey        style;
+        std::vector<QLineF> lines;
+    };
+
+    struct Rects {
+        FillStyleKey        fill_style;
+        LineStyleKey        line_style;
+        std::vector<QRectF> rects;
+    };
+
+    struct Polys {
+        FillStyleKey           style;
+        std::vector<QPolygonF> polys;
+        std::vector<QRectF>    bounds; // one per polygon
+    };
+
+    std::vector<Rects> fill_rects;
+    std::vector<Polys> fill_polys;
+    std::vector<Rects> draw_rects;
+    std::vector<Lines> lines;
+
+    std::size_t primitives() const
+    {
+        std::size_t n = 0;
+        for (const Rects& b : fill_rects) n += b.rects.size();
+        for (const Polys& b : fill_polys) n += b.polys.size();
+        for (const Rects& b : draw_rects) n += b.rects.size();
+        for (const Lines& b : lines) n += b.lines.size();
+        return n;
+    }
+};
+
+// Logical y range a band painter can reach; see paint_visible_batches().
+struct ReplayBandRows {
+    double top;
+    double bottom;
+
+    bool reaches(double y0, double y1, double padding) const
+    {
+        return std::max(y0, y1) + padding >= top && std::min(y0, y1) - padding <= bottom;
+    }
+};
+
 static QColor unpack_color(uint32_t rgba)
 {
     return QColor(
@@ -85,6 +140,75 @@ static QPen make_pen(const LineStyleKey &s)
     return pen;
 }
 
+// Paint the culled batches in replay order: filled rects, filled polygons,
+// outlined rects, lines. With a band, only primitives that may reach its
+// rows are handed to the painter; its clip does the rest.
+static void paint_visible_batches(QPainter&                     painter,
+                                  const DeferredVisibleBatches& visible,
+                                  const ReplayBandRows*         band)
+{
+    std::vector<QRectF> band_rects;
+    std::vector<QLineF> band_lines;
+    auto rects_in_band = [&](const std::vector<QRectF>& rects, double padding) {
+        if (!band)
+            return &rects;
+        band_rects.clear();
+        for (const QRectF& rect : rects)
+            if (band->reaches(rect.top(), rect.bottom(), padding))
+                band_rects.push_back(rect);
+        return &band_rects;
+    };
+
+    for (const auto& batch : visible.fill_rects) {
+        const std::vector<QRectF>* rects = rects_in_band(batch.rects, 1.0);
+        if (rects->empty())
+            continue;
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(QBrush(unpack_color(batch.fill_style.color_rgba)));
+        painter.drawRects(rects->data(), int(rects->size()));
+    }
+
+    for (const auto& batch : visible.fill_polys) {
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(QBrush(unpack_color(batch.style.color_rgba)));
+        for (std::size_t i = 0; i < batch.polys.size(); ++i) {
+            if (band && !band->reaches(batch.bounds[i].top(), batch.bounds[i].bottom(), 1.0))
+                continue;
+            painter.drawPolygon(batch.polys[i]);
+        }
+    }
+
+    for (const auto& batch : visible.draw_rects) {
+        const double width = batch.line_style.line_width == 0 ? 1.0 : double(batch.line_style.line_width);
+        const std::vector<QRectF>* rects = rects_in_band(batch.rects, width);
+        if (rects->empty())
+            continue;
+        painter.setPen(make_pen(batch.line_style));
+        painter.setBrush(Qt::NoBrush);
+        painter.drawRects(rects->data(), int(rects->size()));
+    }
+
+    for (const auto& batch : visible.lines) {
+        const QLineF* lines = batch.lines.data();
+        std::size_t   count = batch.lines.size();
+        if (band) {
+            // A cap reaches at most a full width past the end point.
+            const double width = batch.style.line_width == 0 ? 1.0 : double(batch.style.line_width);
+            band_lines.clear();
+            for (const QLineF& line : batch.lines)
+                if (band->reaches(line.y1(), line.y2(), width))
+                    band_lines.push_back(line);
+            lines = band_lines.data();
+            count = band_lines.size();
+        }
+        if (count == 0)
+            continue;
+        painter.setPen(make_pen(batch.style));
+        painter.setBrush(Qt::NoBrush);
+        painter.drawLines(lines, int(count));
+    }
+}
+
 // ---- construction --------------------------------------------------------
 
 deferred_renderer::deferred_renderer(Painter *painter,
@@ -218,49 +342,53 @@ void deferred_renderer::apply_painter_state(const DeferredPainterState& state)
 
 // ---- batch insertion -----------------------------------------------------
 
-void deferred_renderer::add_line(const LineStyleKey &s, QLineF line)
+// Top bit of the line_cap byte, which no cap sets: WORLD and SCREEN
+// primitives of one style get their own batches.
+static constexpr int kWorldBatchKeyBit = 55;
+
+void deferred_renderer::add_line(const LineStyleKey &s, QLineF line, bool world)
 {
-    uint64_t k = s.key() ^ (uint64_t(1) << 60);
+    uint64_t k = s.key() ^ (uint64_t(1) << 60) ^ (uint64_t(world) << kWorldBatchKeyBit);
     auto it = m_line_idx.find(k);
     if (it == m_line_idx.end()) {
         m_line_idx[k] = m_line_batches.size();
-        m_line_batches.push_back({s, {}});
+        m_line_batches.push_back({s, {}, world});
         it = m_line_idx.find(k);
     }
     m_line_batches[it->second].lines.push_back(line);
 }
 
-void deferred_renderer::add_fill_rect(const FillStyleKey &s, QRectF rect)
+void deferred_renderer::add_fill_rect(const FillStyleKey &s, QRectF rect, bool world)
 {
-    uint64_t k = s.key() ^ (uint64_t(2) << 60);
+    uint64_t k = s.key() ^ (uint64_t(2) << 60) ^ (uint64_t(world) << kWorldBatchKeyBit);
     auto it = m_fill_rect_idx.find(k);
     if (it == m_fill_rect_idx.end()) {
         m_fill_rect_idx[k] = m_fill_rect_batches.size();
-        m_fill_rect_batches.push_back({s, {}});
+        m_fill_rect_batches.push_back({s, {}, world});
         it = m_fill_rect_idx.find(k);
     }
     m_fill_rect_batches[it->second].rects.push_back(rect);
 }
 
-void deferred_renderer::add_draw_rect(const LineStyleKey &s, QRectF rect)
+void deferred_renderer::add_draw_rect(const LineStyleKey &s, QRectF rect, bool world)
 {
-    uint64_t k = s.key() ^ (uint64_t(3) << 60);
+    uint64_t k = s.key() ^ (uint64_t(3) << 60) ^ (uint64_t(world) << kWorldBatchKeyBit);
     auto it = m_draw_rect_idx.find(k);
     if (it == m_draw_rect_idx.end()) {
         m_draw_rect_idx[k] = m_draw_rect_batches.size();
-        m_draw_rect_batches.push_back({s, {}});
+        m_draw_rect_batches.push_back({s, {}, world});
         it = m_draw_rect_idx.find(k);
     }
     m_draw_rect_batches[it->second].rects.push_back(rect);
 }
 
-void deferred_renderer::add_fill_poly(const FillStyleKey &s, QPolygonF poly)
+void deferred_renderer::add_fill_poly(const FillStyleKey &s, QPolygonF poly, bool world)
 {
-    uint64_t k = s.key() ^ (uint64_t(4) << 60);
+    uint64_t k = s.key() ^ (uint64_t(4) << 60) ^ (uint64_t(world) << kWorldBatchKeyBit);
     auto it = m_fill_poly_idx.find(k);
     if (it == m_fill_poly_idx.end()) {
         m_fill_poly_idx[k] = m_fill_poly_batches.size();
-        m_fill_poly_batches.push_back({s, {}});
+        m_fill_poly_batches.push_back({s, {}, world});
         it = m_fill_poly_idx.find(k);
     }
     m_fill_poly_batches[it->second].polys.push_back(std::move(poly));
@@ -268,25 +396,44 @@ void deferred_renderer::add_fill_poly(const FillStyleKey &s, QPolygonF poly)
 
 // ---- coordinate helper ---------------------------------------------------
 
-QRectF deferred_renderer::to_screen_rect(const point2d& start, const point2d& end)
+static QRectF screen_rect_between(const point2d& a, const point2d& b)
 {
-    point2d rect_start = start;
-    point2d rect_end = end;
-    if (current_coordinate_system == WORLD) {
-        rect_start = m_transform(rect_start);
-        rect_end   = m_transform(rect_end);
-    }
-    double x = std::min(rect_start.x, rect_end.x);
-    double y = std::min(rect_start.y, rect_end.y);
-    double w = std::abs(rect_end.x - rect_start.x);
-    double h = std::abs(rect_end.y - rect_start.y);
-    return QRectF(x, y, w, h);
+    return QRectF(std::min(a.x, b.x), std::min(a.y, b.y), std::abs(b.x - a.x), std::abs(b.y - a.y));
+}
+
+// WORLD rects keep their corners as recorded; replay projects them and
+// builds the screen rect then.
+QRectF deferred_renderer::to_batch_rect(const point2d& start, const point2d& end) const
+{
+    if (current_coordinate_system == WORLD)
+        return QRectF(QPointF(start.x, start.y), QPointF(end.x, end.y));
+    return screen_rect_between(start, end);
+}
+
+// Same test as rectangle_off_screen, against a view computed once.
+static bool world_off_view(const rectangle& view, const point2d& a, const point2d& b)
+{
+    return std::max(a.x, b.x) < view.left() || std::min(a.x, b.x) > view.right()
+        || std::max(a.y, b.y) < view.bottom() || std::min(a.y, b.y) > view.top();
 }
 
 QRectF deferred_renderer::screen_viewport_rect() const
 {
     rectangle viewport = irenderer::get_visible_screen();
-    return QRectF(viewport.left(), viewport.bottom(), viewport.width(), viewport.height());
+    const QRectF rect(viewport.left(), viewport.bottom(), viewport.width(), viewport.height());
+    return m_replay_clip.isNull() ? rect : rect.intersected(m_replay_clip);
+}
+
+rectangle deferred_renderer::replay_visible_world()
+{
+    const rectangle visible = irenderer::get_visible_world();
+    if (m_replay_clip.isNull())
+        return visible;
+    // Widget y grows downwards: the clip's top-left is the world's top-left.
+    const point2d top_left     = m_camera->widget_to_world({m_replay_clip.left(), m_replay_clip.top()});
+    const point2d bottom_right = m_camera->widget_to_world({m_replay_clip.right(), m_replay_clip.bottom()});
+    return {{std::max(visible.left(), top_left.x), std::max(visible.bottom(), bottom_right.y)},
+            {std::min(visible.right(), bottom_right.x), std::min(visible.top(), top_left.y)}};
 }
 
 bool deferred_renderer::screen_rect_visible(const QRectF& rect, double padding) const
@@ -395,29 +542,22 @@ bool deferred_renderer::screen_surface_visible(surface *p_surface,
 
 // ---- hot-path draw calls (batched) ---------------------------------------
 
+// WORLD primitives are stored in world units and clipped / projected at
+// replay, so the same recording can be replayed after the camera moves.
+
 void deferred_renderer::draw_line(const point2d& start, const point2d& end)
 {
-    if (rectangle_off_screen({start, end}))
+    if (!m_retain_recording && rectangle_off_screen({start, end}))
         return;
-
-    point2d draw_start = start;
-    point2d draw_end = end;
-    if (current_coordinate_system == WORLD) {
-        rectangle clip = irenderer::get_visible_world();
-        if (!clip_line_world(clip, draw_start, draw_end))
-            return;
-        draw_start = m_transform(draw_start);
-        draw_end   = m_transform(draw_end);
-    }
-
-    add_line(current_line_style(), QLineF(draw_start.x, draw_start.y, draw_end.x, draw_end.y));
+    add_line(current_line_style(), QLineF(start.x, start.y, end.x, end.y),
+             current_coordinate_system == WORLD);
 }
 
 void deferred_renderer::fill_rectangle(const point2d& start, const point2d& end)
 {
-    if (rectangle_off_screen({start, end}))
+    if (!m_retain_recording && rectangle_off_screen({start, end}))
         return;
-    add_fill_rect(current_fill_style(), to_screen_rect(start, end));
+    add_fill_rect(current_fill_style(), to_batch_rect(start, end), current_coordinate_system == WORLD);
 }
 
 void deferred_renderer::fill_rectangle(const point2d& start, double width, double height)
@@ -432,9 +572,9 @@ void deferred_renderer::fill_rectangle(const rectangle& r)
 
 void deferred_renderer::draw_rectangle(const point2d& start, const point2d& end)
 {
-    if (rectangle_off_screen({start, end}))
+    if (!m_retain_recording && rectangle_off_screen({start, end}))
         return;
-    add_draw_rect(current_line_style(), to_screen_rect(start, end));
+    add_draw_rect(current_line_style(), to_batch_rect(start, end), current_coordinate_system == WORLD);
 }
 
 void deferred_renderer::draw_rectangle(const point2d& start, double width, double height)
@@ -452,19 +592,10 @@ void deferred_renderer::draw_rectangle(const rectangle& r)
 void deferred_renderer::fill_triangle(const point2d& a, const point2d& b, const point2d& c)
 {
     QPolygonF poly(3);
-    if (current_coordinate_system == WORLD) {
-        const point2d sa = m_transform(a);
-        const point2d sb = m_transform(b);
-        const point2d sc = m_transform(c);
-        poly[0] = QPointF(sa.x, sa.y);
-        poly[1] = QPointF(sb.x, sb.y);
-        poly[2] = QPointF(sc.x, sc.y);
-    } else {
-        poly[0] = QPointF(a.x, a.y);
-        poly[1] = QPointF(b.x, b.y);
-        poly[2] = QPointF(c.x, c.y);
-    }
-    add_fill_poly(current_fill_style(), std::move(poly));
+    poly[0] = QPointF(a.x, a.y);
+    poly[1] = QPointF(b.x, b.y);
+    poly[2] = QPointF(c.x, c.y);
+    add_fill_poly(current_fill_style(), std::move(poly), current_coordinate_system == WORLD);
 }
 
 void deferred_renderer::fill_poly(const std::vector<point2d>& points)
@@ -473,17 +604,10 @@ void deferred_renderer::fill_poly(const std::vector<point2d>& points)
 
     QPolygonF poly;
     poly.reserve(int(points.size()));
-    if (current_coordinate_system == WORLD) {
-        for (const auto& p : points) {
-            const point2d sp = m_transform(p);
-            poly.append(QPointF(sp.x, sp.y));
-        }
-    } else {
-        for (const auto& p : points) {
-            poly.append(QPointF(p.x, p.y));
-        }
+    for (const auto& p : points) {
+        poly.append(QPointF(p.x, p.y));
     }
-    add_fill_poly(current_fill_style(), std::move(poly));
+    add_fill_poly(current_fill_style(), std::move(poly), current_coordinate_system == WORLD);
 }
 
 void deferred_renderer::push_arc_command(const point2d& center, double radius_x,
@@ -589,38 +713,50 @@ void deferred_renderer::draw_text(const point2d& point, std::string const& text,
         bound_y,
         current_coordinate_system == WORLD,
         std::max(recorded_world_scale.x, std::numeric_limits<double>::epsilon()),
-        text_screen_offset_px
+        text_screen_offset_px,
+        recorded_world_scale.y
     });
     // Auto-reset so the offset only applies to this draw_text. Mirrors
     // what irenderer::paint_text does in the immediate path.
     text_screen_offset_px = {0.0, 0.0};
-    if (current_coordinate_system == WORLD) {
-        text_extents_t text_extents{0, 0, 0, 0, 0, 0};
-        m_painter->text_extents(text.c_str(), &text_extents);
-
-        const bool bounded_x = std::isfinite(bound_x) && bound_x < DBL_MAX;
-        const bool bounded_y = std::isfinite(bound_y) && bound_y < DBL_MAX;
-        const double clip_width = bounded_x ? bound_x : text_extents.width * recorded_world_scale.x;
-        const double clip_height = bounded_y ? bound_y : text_extents.height * recorded_world_scale.y;
-
-        point2d center = point;
-        if (horiz_justification == justification::left)
-            center.x += clip_width / 2.0;
-        else if (horiz_justification == justification::right)
-            center.x -= clip_width / 2.0;
-        if (vert_justification == justification::top)
-            center.y -= clip_height / 2.0;
-        else if (vert_justification == justification::bottom)
-            center.y += clip_height / 2.0;
+    index_text_command(command_index,
+                       std::get<DeferredTextCommand>(m_overlay_commands.back()),
+                       recorded_world_scale);
+}
 
-        index_world_overlay_command(
-            command_index,
-            {{center.x - clip_width / 2.0, center.y - clip_height / 2.0},
-             clip_width,
-             clip_height});
-    } else {
+void deferred_renderer::index_text_command(std::uint32_t              command_index,
+                                           const DeferredTextCommand& cmd,
+                                           point2d                    world_scale)
+{
+    if (!cmd.scale_font_with_camera) {
         m_unindexed_overlay_commands.push_back(command_index);
+        return;
     }
+
+    // Measured with the painter's current font, which is cmd.state.font.
+    text_extents_t text_extents{0, 0, 0, 0, 0, 0};
+    m_painter->text_extents(cmd.text.c_str(), &text_extents);
+
+    const bool bounded_x = std::isfinite(cmd.bound_x) && cmd.bound_x < DBL_MAX;
+    const bool bounded_y = std::isfinite(cmd.bound_y) && cmd.bound_y < DBL_MAX;
+    const double clip_width = bounded_x ? cmd.bound_x : text_extents.width * world_scale.x;
+    const double clip_height = bounded_y ? cmd.bound_y : text_extents.height * world_scale.y;
+
+    point2d center = cmd.point;
+    if (cmd.state.horiz_just == justification::left)
+        center.x += clip_width / 2.0;
+    else if (cmd.state.horiz_just == justification::right)
+        center.x -= clip_width / 2.0;
+    if (cmd.state.vert_just == justification::top)
+        center.y -= clip_height / 2.0;
+    else if (cmd.state.vert_just == justification::bottom)
+        center.y += clip_height / 2.0;
+
+    index_world_overlay_command(
+        command_index,
+        {{center.x - clip_width / 2.0, center.y - clip_height / 2.0},
+         clip_width,
+         clip_height});
 }
 
 void deferred_renderer::draw_surface(surface *p_surface, const point2d& point,
@@ -640,22 +776,6 @@ void deferred_renderer::draw_surface(surface *p_surface, const point2d& point,
 
 void deferred_renderer::replay()
 {
-    struct VisibleLineBatch {
-        LineStyleKey        style;
-        std::vector<QLineF> lines;
-    };
-
-    struct VisibleRectBatch {
-        FillStyleKey        fill_style;
-        LineStyleKey        line_style;
-        std::vector<QRectF> rects;
-    };
-
-    struct VisiblePolyBatch {
-        FillStyleKey           style;
-        std::vector<QPolygonF> polys;
-    };
-
     auto resolve_text_replay_state =
         [this](const DeferredTextCommand& cmd, DeferredPainterState& state) {
             state = cmd.state;
@@ -747,17 +867,11 @@ void deferred_renderer::replay()
             return !rectangle_off_screen({{top_left.x, top_left.y - s_height}, s_width, s_height});
         };
 
-    std::vector<VisibleLineBatch> visible_line_batches;
-    visible_line_batches.reserve(m_line_batches.size());
-
-    std::vector<VisibleRectBatch> visible_fill_rect_batches;
-    visible_fill_rect_batches.reserve(m_fill_rect_batches.size());
-
-    std::vector<VisibleRectBatch> visible_draw_rect_batches;
-    visible_draw_rect_batches.reserve(m_draw_rect_batches.size());
-
-    std::vector<VisiblePolyBatch> visible_fill_poly_batches;
-    visible_fill_poly_batches.reserve(m_fill_poly_batches.size());
+    DeferredVisibleBatches visible;
+    visible.lines.reserve(m_line_batches.size());
+    visible.fill_rects.reserve(m_fill_rect_batches.size());
+    visible.draw_rects.reserve(m_draw_rect_batches.size());
+    visible.fill_polys.reserve(m_fill_poly_batches.size());
 
     std::vector<const DeferredOverlayCommand*> visible_overlay_commands;
     visible_overlay_commands.reserve(m_overlay_commands.size());
@@ -766,72 +880,16 @@ void deferred_renderer::replay()
     DeferredVisibleStats stats;
 #endif // EZGL_RENDERER_DEBUG
 
-    // lines
-    for (const auto &batch : m_line_batches) {
-        std::vector<QLineF> visible_lines;
-        visible_lines.reserve(batch.lines.size());
-        const double line_width = batch.style.line_width == 0 ? 1.0 : double(batch.style.line_width);
-        for (const QLineF& line : batch.lines) {
-            if (screen_line_visible(line, line_width))
-                visible_lines.push_back(line);
-        }
-        if (visible_lines.empty())
-            continue;
-
-#ifdef EZGL_RENDERER_DEBUG
-        stats.lines += visible_lines.size();
-#endif // EZGL_RENDERER_DEBUG
-        visible_line_batches.push_back({batch.style, std::move(visible_lines)});
-    }
-
-    // filled rects
-    for (const auto &batch : m_fill_rect_batches) {
-        std::vector<QRectF> visible_rects;
-        visible_rects.reserve(batch.rects.size());
-        for (const QRectF& rect : batch.rects) {
-            if (screen_rect_visible(rect))
-                visible_rects.push_back(rect);
-        }
-        if (visible_rects.empty())
-            continue;
-
-#ifdef EZGL_RENDERER_DEBUG
-        stats.filled_rects += visible_rects.size();
-#endif // EZGL_RENDERER_DEBUG
-        visible_fill_rect_batches.push_back({batch.style, {}, std::move(visible_rects)});
-    }
-
-    // outline rects
-    for (const auto &batch : m_draw_rect_batches) {
-        std::vector<QRectF> visible_rects;
-        visible_rects.reserve(batch.rects.size());
-        const double padding = (batch.style.line_width == 0 ? 1.0 : double(batch.style.line_width)) * 0.5;
-        for (const QRectF& rect : batch.rects) {
-            if (screen_rect_visible(rect, padding))
-                visible_rects.push_back(rect);
-        }
-        if (visible_rects.empty())
-            continue;
-#ifdef EZGL_RENDERER_DEBUG
-        stats.outlined_rects += visible_rects.size();
-#endif // EZGL_RENDERER_DEBUG
-        visible_draw_rect_batches.push_back({{}, batch.style, std::move(visible_rects)});
-    }
-
-    // filled polys
-    for (const auto &batch : m_fill_poly_batches) {
-        std::vector<QPolygonF> visible_polys;
-        visible_polys.reserve(batch.polys.size());
-        for (const QPolygonF& poly : batch.polys) {
-            if (screen_rect_visible(poly.boundingRect()))
-                visible_polys.push_back(poly);
-        }
-        if (visible_polys.empty())
-            continue;
+    // Batched primitives are painted in screen pixels, so a world-only
+    // replay (an overlay tile) leaves them to the screen layer.
+    if (m_replay_space != overlay_space::world) {
+        cull_batches(visible);
 #ifdef EZGL_RENDERER_DEBUG
-        stats.filled_polys += visible_polys.size();
+        for (const auto& batch : visible.lines)      stats.lines          += batch.lines.size();
+        for (const auto& batch : visible.fill_rects) stats.filled_rects   += batch.rects.size();
+        for (const auto& batch : visible.draw_rects) stats.outlined_rects += batch.rects.size();
+        for (const auto& batch : visible.fill_polys) stats.filled_polys   += batch.polys.size();
 #endif // EZGL_RENDERER_DEBUG
-        visible_fill_poly_batches.push_back({batch.style, std::move(visible_polys)});
     }
 
     std::vector<std::uint32_t> candidate_overlay_indices;
@@ -840,9 +898,11 @@ void deferred_renderer::replay()
                                      m_unindexed_overlay_commands.begin(),
                                      m_unindexed_overlay_commands.end());
 
-    const rectangle visible_world = irenderer::get_visible_world();
+    const rectangle visible_world = replay_visible_world();
 
-    if (!m_indexed_world_overlay_buckets.empty()
+    // The spatial index only holds WORLD commands.
+    if (m_replay_space != overlay_space::screen
+        && !m_indexed_world_overlay_buckets.empty()
         && !m_overlay_commands.empty()
         && m_overlay_index_scene_bounds.right() >= visible_world.left()
         && m_overlay_index_scene_bounds.left() <= visible_world.right()
@@ -879,6 +939,13 @@ void deferred_renderer::replay()
     for (const std::uint32_t command_index : candidate_overlay_indices) {
         const DeferredOverlayCommand& command =
             m_overlay_commands[std::size_t(command_index)];
+        if (m_replay_space != overlay_space::all) {
+            const bool screen_command = std::visit([](const auto& cmd) {
+                return cmd.state.coordinate_system == SCREEN;
+            }, command);
+            if (screen_command != (m_replay_space == overlay_space::screen))
+                continue;
+        }
         const bool visible = std::visit([&](const auto& cmd) -> bool {
             using T = std::decay_t<decltype(cmd)>;
             if constexpr (std::is_same_v<T, DeferredArcCommand>) {
@@ -941,34 +1008,8 @@ void deferred_renderer::replay()
     print_visible_stats(stats);
 #endif // EZGL_RENDERER_DEBUG
 
-    for (const auto& batch : visible_fill_rect_batches) {
-        QColor c = unpack_color(batch.fill_style.color_rgba);
-        m_painter->setPen(Qt::NoPen);
-        m_painter->setBrush(QBrush(c));
-        m_painter->drawRects(batch.rects.data(), int(batch.rects.size()));
-    }
-
-    for (const auto& batch : visible_fill_poly_batches) {
-        QColor c = unpack_color(batch.style.color_rgba);
-        m_painter->setPen(Qt::NoPen);
-        m_painter->setBrush(QBrush(c));
-        for (const QPolygonF& poly : batch.polys)
-            m_painter->drawPolygon(poly);
-    }
-
-    for (const auto& batch : visible_draw_rect_batches) {
-        QPen pen = make_pen(batch.line_style);
-        m_painter->setPen(pen);
-        m_painter->setBrush(Qt::NoBrush);
-        m_painter->drawRects(batch.rects.data(), int(batch.rects.size()));
-    }
-
-    for (const auto& batch : visible_line_batches) {
-        QPen pen = make_pen(batch.style);
-        m_painter->setPen(pen);
-        m_painter->setBrush(Qt::NoBrush);
-        m_painter->drawLines(batch.lines.data(), int(batch.lines.size()));
-    }
+    if (!replay_batches_banded(visible))
+        paint_visible_batches(*m_painter, visible, nullptr);
 
     for (const DeferredOverlayCommand* command : visible_overlay_commands) {
         std::visit([this, &resolve_text_replay_state](const auto& cmd) {
@@ -1014,19 +1055,262 @@ void deferred_renderer::replay()
     }
 }
 
+// Run keep(batch, item, out) over the items of every batch, splitting each
+// batch evenly across up to max_threads threads. Returns the kept outputs
+// per batch, in item order.
+template <typename Out, typename Batch, typename Items, typename Keep>
+static std::vector<std::vector<Out>> cull_batches_parallel(const std::vector<Batch>& batches,
+                                                           Items Batch::*items,
+                                                           int max_threads,
+                                                           Keep keep)
+{
+    std::size_t total = 0;
+    for (const Batch& batch : batches)
+        total += (batch.*items).size();
+    const int threads = std::max(1, int(std::min<std::size_t>(std::size_t(max_threads),
+                                                              total / kMinReplayBandPrimitives)));
+
+    // parts[t][b]: what thread t kept of its share of batch b.
+    std::vector<std::vector<std::vector<Out>>> parts(std::size_t(threads),
+                                                     std::vector<std::vector<Out>>(batches.size()));
+    auto run = [&](int t) {
+        for (std::size_t b = 0; b < batches.size(); ++b) {
+            const auto&       list  = batches[b].*items;
+            const std::size_t first = list.size() * std::size_t(t) / std::size_t(threads);
+            const std::size_t last  = list.size() * std::size_t(t + 1) / std::size_t(threads);
+            std::vector<Out>& out   = parts[std::size_t(t)][b];
+            out.reserve(last - first);
+            for (std::size_t i = first; i < last; ++i)
+                keep(batches[b], list[i], out);
+        }
+    };
+    if (threads == 1) {
+        run(0);
+        return std::move(parts[0]);
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(std::size_t(threads));
+    for (int t = 0; t < threads; ++t)
+        workers.emplace_back(run, t);
+    for (auto& w : workers) w.join();
+
+    std::vector<std::vector<Out>> kept = std::move(parts[0]);
+    for (std::size_t b = 0; b < batches.size(); ++b) {
+        for (int t = 1; t < threads; ++t) {
+            std::vector<Out>& part = parts[std::size_t(t)][b];
+            kept[b].insert(kept[b].end(), std::make_move_iterator(part.begin()),
+                           std::make_move_iterator(part.end()));
+        }
+    }
+    return kept;
+}
+
+int deferred_renderer::replay_thread_count() const
+{
+    return m_replay_threads > 0 ? m_replay_threads
+                                : int(std::max(1u, std::thread::hardware_concurrency()));
+}
+
+void deferred_renderer::cull_batches(DeferredVisibleBatches& visible)
+{
+    // WORLD items are culled against the visible world, then projected with
+    // the current camera; everything is then culled in screen pixels.
+    const rectangle view    = irenderer::get_visible_world();
+    const int       threads = replay_thread_count();
+    auto project = [this](double x, double y) {
+        const point2d p = m_transform({x, y});
+        return QPointF(p.x, p.y);
+    };
+    auto width_of = [](const LineStyleKey& s) {
+        return s.line_width == 0 ? 1.0 : double(s.line_width);
+    };
+
+    auto lines = cull_batches_parallel<QLineF>(
+        m_line_batches, &LineBatch::lines, threads,
+        [&](const LineBatch& batch, const QLineF& line, std::vector<QLineF>& out) {
+            QLineF screen = line;
+            if (batch.world) {
+                point2d a{line.x1(), line.y1()};
+                point2d b{line.x2(), line.y2()};
+                if (world_off_view(view, a, b) || !clip_line_world(view, a, b))
+                    return;
+                screen = QLineF(project(a.x, a.y), project(b.x, b.y));
+            }
+            if (screen_line_visible(screen, width_of(batch.style)))
+                out.push_back(screen);
+        });
+    for (std::size_t b = 0; b < lines.size(); ++b)
+        if (!lines[b].empty())
+            visible.lines.push_back({m_line_batches[b].style, std::move(lines[b])});
+
+    auto screen_rect_of = [&](bool world, const QRectF& rect, QRectF& screen) {
+        if (!world) {
+            screen = rect;
+            return true;
+        }
+        if (world_off_view(view, {rect.left(), rect.top()}, {rect.right(), rect.bottom()}))
+            return false;
+        const QPointF a = project(rect.left(), rect.top());
+        const QPointF b = project(rect.right(), rect.bottom());
+        screen = screen_rect_between({a.x(), a.y()}, {b.x(), b.y()});
+        return true;
+    };
+
+    auto fill_rects = cull_batches_parallel<QRectF>(
+        m_fill_rect_batches, &FillRectBatch::rects, threads,
+        [&](const FillRectBatch& batch, const QRectF& rect, std::vector<QRectF>& out) {
+            QRectF screen;
+            if (screen_rect_of(batch.world, rect, screen) && screen_rect_visible(screen))
+                out.push_back(screen);
+        });
+    for (std::size_t b = 0; b < fill_rects.size(); ++b)
+        if (!fill_rects[b].empty())
+            visible.fill_rects.push_back({m_fill_rect_batches[b].style, {}, std::move(fill_rects[b])});
+
+    auto draw_rects = cull_batches_parallel<QRectF>(
+        m_draw_rect_batches, &DrawRectBatch::rects, threads,
+        [&](const DrawRectBatch& batch, const QRectF& rect, std::vector<QRectF>& out) {
+            QRectF screen;
+            if (screen_rect_of(batch.world, rect, screen)
+                && screen_rect_visible(screen, width_of(batch.style) * 0.5))
+                out.push_back(screen);
+        });
+    for (std::size_t b = 0; b < draw_rects.size(); ++b)
+        if (!draw_rects[b].empty())
+            visible.draw_rects.push_back({{}, m_draw_rect_batches[b].style, std::move(draw_rects[b])});
+
+    using PolyWithBounds = std::pair<QPolygonF, QRectF>;
+    auto fill_polys = cull_batches_parallel<PolyWithBounds>(
+        m_fill_poly_batches, &FillPolyBatch::polys, threads,
+        [&](const FillPolyBatch& batch, const QPolygonF& poly, std::vector<PolyWithBounds>& out) {
+            if (!batch.world) {
+                const QRectF bounds = poly.boundingRect();
+                if (screen_rect_visible(bounds))
+                    out.emplace_back(poly, bounds);
+                return;
+            }
+            const QRectF world_bounds = poly.boundingRect();
+            if (world_off_view(view, {world_bounds.left(), world_bounds.top()},
+                               {world_bounds.right(), world_bounds.bottom()}))
+                return;
+            QPolygonF screen;
+            screen.reserve(poly.size());
+            for (const QPointF& p : poly)
+                screen.append(project(p.x(), p.y()));
+            const QRectF bounds = screen.boundingRect();
+            if (screen_rect_visible(bounds))
+                out.emplace_back(std::move(screen), bounds);
+        });
+    for (std::size_t b = 0; b < fill_polys.size(); ++b) {
+        if (fill_polys[b].empty())
+            continue;
+        DeferredVisibleBatches::Polys polys{m_fill_poly_batches[b].style, {}, {}};
+        polys.polys.reserve(fill_polys[b].size());
+        polys.bounds.reserve(fill_polys[b].size());
+        for (auto& [poly, bounds] : fill_polys[b]) {
+            polys.polys.push_back(std::move(poly));
+            polys.bounds.push_back(bounds);
+        }
+        visible.fill_polys.push_back(std::move(polys));
+    }
+}
+
+bool deferred_renderer::replay_batches_banded(const DeferredVisibleBatches& visible)
+{
+    if (m_replay_threads == 1)
+        return false;
+
+    // Bands are painted into QImages sharing the surface's rows, which
+    // only works for a plain scale/translate onto an image with an integer
+    // pixel ratio, and a clip that is known (the replay_overlay() rect).
+    QPaintDevice* device = m_painter->device();
+    if (!device || device->devType() != QInternal::Image)
+        return false;
+    const QImage*    image = static_cast<QImage*>(device);
+    const QTransform xform = m_painter->transform();
+    const double     dpr   = image->devicePixelRatio();
+    if (xform.type() > QTransform::TxScale || xform.m22() == 0.0 || dpr != std::floor(dpr)
+        || (m_painter->hasClipping() && m_replay_clip.isNull()))
+        return false;
+
+    const std::size_t primitives = visible.primitives();
+    const int bands = std::min({replay_thread_count(),
+                                image->height() / kMinReplayBandRows,
+                                int(std::min<std::size_t>(primitives / kMinReplayBandPrimitives, 1024))});
+    if (bands < 2)
+        return false;
+
+    // Whole logical rows per band, so every band painter is offset by an
+    // exact amount. constBits() is the buffer m_painter paints into; bits()
+    // could detach the image away from it.
+    const int                       step    = int(dpr);
+    const int                       rows    = ((image->height() + bands - 1) / bands + step - 1) / step * step;
+    uchar* const                    bits    = const_cast<uchar*>(image->constBits());
+    const qsizetype                 stride  = image->bytesPerLine();
+    const int                       width   = image->width();
+    const int                       height  = image->height();
+    const QImage::Format            format  = image->format();
+    const QPainter::RenderHints     hints   = m_painter->renderHints();
+    const QPainter::CompositionMode mode    = m_painter->compositionMode();
+    const double                    opacity = m_painter->opacity();
+    const QRectF                    clip    = m_replay_clip;
+
+    std::vector<std::thread> workers;
+    workers.reserve(std::size_t(bands));
+    for (int y0 = 0; y0 < height; y0 += rows) {
+        const int y1 = std::min(height, y0 + rows);
+        workers.emplace_back([&, y0, y1]() {
+            QImage band(bits + qsizetype(y0) * stride, width, y1 - y0, stride, format);
+            band.setDevicePixelRatio(dpr);
+            QPainter painter(&band);
+            painter.setRenderHints(hints);
+            painter.setCompositionMode(mode);
+            painter.setOpacity(opacity);
+            painter.setTransform(xform * QTransform::fromTranslate(0.0, -y0 / dpr));
+            if (!clip.isNull())
+                painter.setClipRect(clip);
+
+            // The band's rows, two pixels wider each way, before the transform.
+            const double a = ((y0 - 2.0) / dpr - xform.dy()) / xform.m22();
+            const double b = ((y1 + 2.0) / dpr - xform.dy()) / xform.m22();
+            const ReplayBandRows rows_reached{std::min(a, b), std::max(a, b)};
+            paint_visible_batches(painter, visible, &rows_reached);
+        });
+    }
+    for (auto& w : workers) w.join();
+    return true;
+}
+
 void deferred_renderer::flush()
 {
     replay();
     reset();
 }
 
-void deferred_renderer::replay_overlay()
+void deferred_renderer::replay_overlay(overlay_space space)
 {
+    m_replay_space = space;
     replay();
+    m_replay_space = overlay_space::all;
     // Commands are preserved — not reset — so the overlay can be replayed
     // again on the next camera-only update.
 }
 
+void deferred_renderer::replay_overlay(const QRectF& clip, overlay_space space)
+{
+    if (clip.isEmpty())
+        return;
+    m_replay_clip  = clip;
+    m_replay_space = space;
+    m_painter->save();
+    m_painter->setClipRect(clip);
+    replay();
+    m_painter->restore();
+    m_replay_clip  = QRectF();
+    m_replay_space = overlay_space::all;
+}
+
 void deferred_renderer::clear_overlay_and_batches()
 {
     reset();
@@ -1042,6 +1326,239 @@ void deferred_renderer::clear_deferred_primitives()
     reset();
 }
 
+// ---- snapshot serialization ----------------------------------------------
+
+static void write_point(QDataStream& out, const point2d& p)
+{
+    out << p.x << p.y;
+}
+
+static point2d read_point(QDataStream& in)
+{
+    point2d p;
+    in >> p.x >> p.y;
+    return p;
+}
+
+static void write_state(QDataStream& out, const DeferredPainterState& state)
+{
+    out << qint32(state.coordinate_system)
+        << quint8(state.draw_color.red) << quint8(state.draw_color.green)
+        << quint8(state.draw_color.blue) << quint8(state.draw_color.alpha)
+        << qint32(state.line_width)
+        << qint32(state.line_cap_style)
+        << qint32(state.line_dash_style)
+        << state.rotation_radians
+        << qint32(state.horiz_just)
+        << qint32(state.vert_just)
+        << state.font;
+}
+
+static DeferredPainterState read_state(QDataStream& in)
+{
+    DeferredPainterState state;
+    qint32 coordinate_system = 0, line_width = 0, cap = 0, dash = 0, horiz = 0, vert = 0;
+    quint8 r = 0, g = 0, b = 0, a = 0;
+    in >> coordinate_system >> r >> g >> b >> a >> line_width >> cap >> dash
+       >> state.rotation_radians >> horiz >> vert >> state.font;
+    state.coordinate_system = t_coordinate_system(coordinate_system);
+    state.draw_color        = color(r, g, b, a);
+    state.line_width        = line_width;
+    state.line_cap_style    = line_cap(cap);
+    state.line_dash_style   = line_dash(dash);
+    state.horiz_just        = justification(horiz);
+    state.vert_just         = justification(vert);
+    return state;
+}
+
+static void write_line_style(QDataStream& out, const LineStyleKey& s)
+{
+    out << quint32(s.color_rgba) << quint16(s.line_width) << quint8(s.line_cap) << quint8(s.line_dash);
+}
+
+static LineStyleKey read_line_style(QDataStream& in)
+{
+    quint32 rgba = 0;
+    quint16 width = 0;
+    quint8  cap = 0, dash = 0;
+    in >> rgba >> width >> cap >> dash;
+    return LineStyleKey{rgba, width, cap, dash};
+}
+
+template <typename Batch, typename Items>
+static void write_batches(QDataStream& out, const std::vector<Batch>& batches, Items Batch::*items)
+{
+    out << quint32(batches.size());
+    for (const Batch& batch : batches) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(batch.style)>, LineStyleKey>)
+            write_line_style(out, batch.style);
+        else
+            out << quint32(batch.style.color_rgba);
+        out << quint8(batch.world) << quint32((batch.*items).size());
+        for (const auto& item : batch.*items)
+            out << item;
+    }
+}
+
+void deferred_renderer::save_recording(QDataStream& out) const
+{
+    write_batches(out, m_line_batches,      &LineBatch::lines);
+    write_batches(out, m_fill_rect_batches, &FillRectBatch::rects);
+    write_batches(out, m_draw_rect_batches, &DrawRectBatch::rects);
+    write_batches(out, m_fill_poly_batches, &FillPolyBatch::polys);
+
+    out << quint32(m_overlay_commands.size());
+    for (const DeferredOverlayCommand& command : m_overlay_commands) {
+        out << quint8(command.index());
+        std::visit([&out](const auto& cmd) {
+            using T = std::decay_t<decltype(cmd)>;
+            write_state(out, cmd.state);
+            if constexpr (std::is_same_v<T, DeferredArcCommand>) {
+                write_point(out, cmd.center);
+                out << cmd.radius_x << cmd.radius_y << cmd.start_angle << cmd.extent_angle << cmd.fill;
+            } else if constexpr (std::is_same_v<T, DeferredTextCommand>) {
+                write_point(out, cmd.point);
+                out << QByteArray::fromStdString(cmd.text) << cmd.bound_x << cmd.bound_y
+                    << cmd.scale_font_with_camera << cmd.recorded_world_scale;
+                write_point(out, cmd.screen_offset_px);
+                out << cmd.recorded_world_scale_y;
+            } else if constexpr (std::is_same_v<T, DeferredSurfaceCommand>) {
+                // The surface is owned by the application; store its pixels.
+                out << (cmd.p_surface ? *cmd.p_surface : QImage());
+                write_point(out, cmd.anchor_point);
+                out << cmd.scale_factor;
+            } else {
+                write_point(out, cmd.anchor_world);
+                write_point(out, cmd.offset_a_px);
+                write_point(out, cmd.offset_b_px);
+                write_point(out, cmd.offset_c_px);
+            }
+        }, command);
+    }
+}
+
+bool deferred_renderer::load_recording(QDataStream& in)
+{
+    reset();
+    const DeferredPainterState saved_state = capture_painter_state();
+
+    quint32 n = 0, count = 0;
+    quint8  world = 0;
+    in >> n;
+    for (quint32 b = 0; b < n && in.status() == QDataStream::Ok; ++b) {
+        const LineStyleKey style = read_line_style(in);
+        in >> world >> count;
+        for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+            QLineF line;
+            in >> line;
+            add_line(style, line, world != 0);
+        }
+    }
+    in >> n;
+    for (quint32 b = 0; b < n && in.status() == QDataStream::Ok; ++b) {
+        quint32 rgba = 0;
+        in >> rgba >> world >> count;
+        for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+            QRectF rect;
+            in >> rect;
+            add_fill_rect(FillStyleKey{rgba}, rect, world != 0);
+        }
+    }
+    in >> n;
+    for (quint32 b = 0; b < n && in.status() == QDataStream::Ok; ++b) {
+        const LineStyleKey style = read_line_style(in);
+        in >> world >> count;
+        for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+            QRectF rect;
+            in >> rect;
+            add_draw_rect(style, rect, world != 0);
+        }
+    }
+    in >> n;
+    for (quint32 b = 0; b < n && in.status() == QDataStream::Ok; ++b) {
+        quint32 rgba = 0;
+        in >> rgba >> world >> count;
+        for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+            QPolygonF poly;
+            in >> poly;
+            add_fill_poly(FillStyleKey{rgba}, std::move(poly), world != 0);
+        }
+    }
+
+    in >> n;
+    for (quint32 c = 0; c < n && in.status() == QDataStream::Ok; ++c) {
+        const std::uint32_t command_index = std::uint32_t(m_overlay_commands.size());
+        quint8 kind = 0;
+        in >> kind;
+        const DeferredPainterState state = read_state(in);
+        switch (kind) {
+        case 0: {
+            DeferredArcCommand cmd{state};
+            cmd.center = read_point(in);
+            in >> cmd.radius_x >> cmd.radius_y >> cmd.start_angle >> cmd.extent_angle >> cmd.fill;
+            m_overlay_commands.emplace_back(cmd);
+            if (cmd.state.coordinate_system == WORLD) {
+                index_world_overlay_command(
+                    command_index,
+                    {{cmd.center.x - cmd.radius_x, cmd.center.y - cmd.radius_y},
+                     {cmd.center.x + cmd.radius_x, cmd.center.y + cmd.radius_y}});
+            } else {
+                m_unindexed_overlay_commands.push_back(command_index);
+            }
+            break;
+        }
+        case 1: {
+            DeferredTextCommand cmd{state};
+            QByteArray text;
+            cmd.point = read_point(in);
+            in >> text >> cmd.bound_x >> cmd.bound_y >> cmd.scale_font_with_camera >> cmd.recorded_world_scale;
+            cmd.screen_offset_px = read_point(in);
+            in >> cmd.recorded_world_scale_y;
+            cmd.text = text.toStdString();
+            m_painter->setFont(cmd.state.font);
+            index_text_command(command_index, cmd,
+                               {cmd.recorded_world_scale, cmd.recorded_world_scale_y});
+            m_overlay_commands.emplace_back(std::move(cmd));
+            break;
+        }
+        case 2: {
+            DeferredSurfaceCommand cmd{state};
+            auto image = std::make_unique<surface>();
+            in >> *image;
+            cmd.anchor_point = read_point(in);
+            in >> cmd.scale_factor;
+            if (!image->isNull()) {
+                cmd.p_surface = image.get();
+                m_loaded_surfaces.push_back(std::move(image));
+            }
+            m_overlay_commands.emplace_back(cmd);
+            m_unindexed_overlay_commands.push_back(command_index);
+            break;
+        }
+        case 3: {
+            DeferredArrowTriangleCommand cmd{state};
+            cmd.anchor_world = read_point(in);
+            cmd.offset_a_px  = read_point(in);
+            cmd.offset_b_px  = read_point(in);
+            cmd.offset_c_px  = read_point(in);
+            m_overlay_commands.emplace_back(cmd);
+            m_unindexed_overlay_commands.push_back(command_index);
+            break;
+        }
+        default:
+            in.setStatus(QDataStream::ReadCorruptData);
+            break;
+        }
+    }
+
+    apply_painter_state(saved_state);
+    if (in.status() != QDataStream::Ok) {
+        reset();
+        return false;
+    }
+    return true;
+}
+
 void deferred_renderer::reset()
 {
     m_line_batches.clear();
@@ -1058,6 +1575,7 @@ void deferred_renderer::reset()
     m_unindexed_overlay_commands.clear();
     m_overlay_query_marks.clear();
     m_overlay_query_generation = 1;
+    m_loaded_surfaces.clear();
 }
 
 } // namespace ezgl
@@ -0,0 +1,906 @@
+#include "ezgl/qt/draw_capture.hpp"
+#include "ezgl/logutils.hpp"
+
+#include <QBuffer>
+#include <QFile>
+#include <QImage>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace ezgl {
+
+namespace {
+
+constexpr char         kMagic[8]      = {'E', 'Z', 'G', 'L', 'C', 'A', 'P', '\0'};
+constexpr std::uint8_t kFrameTag      = 'F';
+constexpr double       kScreenQuantum = 1.0 / 64.0;
+constexpr std::size_t  kHeaderBytes   = sizeof(kMagic) + 4 + 5 * 8;
+
+// Coordinates further than this many quanta from the origin are clamped;
+// keeps the zigzag delta of two clamped values inside int64.
+constexpr double kMaxQuanta = 4.0e18;
+
+enum class op_code : std::uint8_t {
+    set_coordinate_system = 1,
+    set_visible_world,
+    set_color,
+    set_line_cap,
+    set_line_dash,
+    set_line_width,
+    set_font_size,
+    format_font,
+    format_font_sized,
+    set_text_rotation,
+    set_horiz_justification,
+    set_vert_justification,
+    set_text_screen_offset,
+    set_pick_id,
+
+    draw_line = 32,
+    draw_rectangle,
+    fill_rectangle,
+    fill_poly,
+    fill_triangle,
+    fill_poly_with_holes,
+    fill_arrow_pointer_triangle,
+    draw_elliptic_arc,
+    fill_elliptic_arc,
+    draw_text,
+    draw_text_bounded,
+    define_surface,
+    draw_surface,
+};
+
+// ---- encoding ----
+
+void put_u8(std::vector<std::uint8_t>& out, std::uint8_t v)
+{
+    out.push_back(v);
+}
+
+void put_varint(std::vector<std::uint8_t>& out, std::uint64_t v)
+{
+    while (v >= 0x80) {
+        out.push_back(std::uint8_t(v) | 0x80);
+        v >>= 7;
+    }
+    out.push_back(std::uint8_t(v));
+}
+
+void put_zigzag(std::vector<std::uint8_t>& out, std::int64_t v)
+{
+    put_varint(out, (std::uint64_t(v) << 1) ^ std::uint64_t(v >> 63));
+}
+
+void put_u32(std::vector<std::uint8_t>& out, std::uint32_t v)
+{
+    for (int i = 0; i < 4; ++i)
+        out.push_back(std::uint8_t(v >> (8 * i)));
+}
+
+void put_f64(std::vector<std::uint8_t>& out, double v)
+{
+    const auto bits = std::bit_cast<std::uint64_t>(v);
+    for (int i = 0; i < 8; ++i)
+        out.push_back(std::uint8_t(bits >> (8 * i)));
+}
+
+void put_bytes(std::vector<std::uint8_t>& out, const void* data, std::size_t size)
+{
+    put_varint(out, size);
+    const auto* p = static_cast<const std::uint8_t*>(data);
+    out.insert(out.end(), p, p + size);
+}
+
+void put_rect(std::vector<std::uint8_t>& out, const rectangle& r)
+{
+    put_f64(out, r.left());
+    put_f64(out, r.bottom());
+    put_f64(out, r.right());
+    put_f64(out, r.top());
+}
+
+std::int64_t quantize(double v, double quantum)
+{
+    const double q = std::round(v / quantum);
+    if (!(q == q)) return 0; // NaN
+    return std::int64_t(std::clamp(q, -kMaxQuanta, kMaxQuanta));
+}
+
+// Power-of-two quantum giving about 2^30 steps across the world extent.
+double world_quantum_for(const rectangle& world)
+{
+    double extent = std::max({std::abs(world.left()), std::abs(world.right()),
+                              std::abs(world.bottom()), std::abs(world.top()),
+                              world.width(), world.height()});
+    if (!(extent > 0.0) || !std::isfinite(extent))
+        extent = 1.0;
+    return std::ldexp(1.0, std::ilogb(extent) - 30);
+}
+
+// ---- decoding ----
+
+// Bounds-checked cursor over the caller's buffer. Any overrun latches
+// ok = false and yields zeros, so callers check once per op.
+struct cursor {
+    const std::uint8_t* p;
+    const std::uint8_t* end;
+    bool                ok = true;
+
+    bool at_end() const { return p >= end; }
+
+    std::uint8_t u8()
+    {
+        if (p >= end) { ok = false; return 0; }
+        return *p++;
+    }
+
+    std::uint64_t varint()
+    {
+        std::uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p >= end) break;
+            const std::uint8_t b = *p++;
+            v |= std::uint64_t(b & 0x7f) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        ok = false;
+        return 0;
+    }
+
+    std::int64_t zigzag()
+    {
+        const std::uint64_t v = varint();
+        return std::int64_t(v >> 1) ^ -std::int64_t(v & 1);
+    }
+
+    std::uint32_t u32()
+    {
+        if (end - p < 4) { ok = false; p = end; return 0; }
+        std::uint32_t v = 0;
+        for (int i = 0; i < 4; ++i)
+            v |= std::uint32_t(p[i]) << (8 * i);
+        p += 4;
+        return v;
+    }
+
+    double f64()
+    {
+        if (end - p < 8) { ok = false; p = end; return 0.0; }
+        std::uint64_t bits = 0;
+        for (int i = 0; i < 8; ++i)
+            bits |= std::uint64_t(p[i]) << (8 * i);
+        p += 8;
+        return std::bit_cast<double>(bits);
+    }
+
+    /// View of the next length-prefixed byte run, without copying.
+    std::pair<const std::uint8_t*, std::size_t> bytes()
+    {
+        const std::uint64_t n = varint();
+        if (!ok || std::uint64_t(end - p) < n) { ok = false; p = end; return {nullptr, 0}; }
+        const std::uint8_t* data = p;
+        p += n;
+        return {data, std::size_t(n)};
+    }
+
+    rectangle rect()
+    {
+        const double l = f64(), b = f64(), r = f64(), t = f64();
+        return rectangle({l, b}, {r, t});
+    }
+};
+
+} // namespace
+
+// ---- capture_writer ----
+
+capture_writer::capture_writer(const std::string& path, const rectangle& world)
+    : m_file(std::make_unique<QFile>(QString::fromStdString(path)))
+    , m_world_quantum(world_quantum_for(world))
+{
+    if (!m_file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        q_warning("EZGL: cannot open draw capture '%s': %s",
+                  path.c_str(), qPrintable(m_file->errorString()));
+        m_file.reset();
+        return;
+    }
+
+    std::vector<std::uint8_t> header;
+    header.reserve(kHeaderBytes);
+    header.insert(header.end(), std::begin(kMagic), std::end(kMagic));
+    put_u32(header, kDrawCaptureVersion);
+    put_rect(header, world);
+    put_f64(header, m_world_quantum);
+    if (m_file->write(reinterpret_cast<const char*>(header.data()), qint64(header.size()))
+        != qint64(header.size())) {
+        q_warning("EZGL: cannot write draw capture '%s'", path.c_str());
+        m_file.reset();
+        return;
+    }
+    m_bytes = header.size();
+}
+
+capture_writer::~capture_writer() = default;
+
+bool capture_writer::is_open() const
+{
+    return m_file != nullptr;
+}
+
+void capture_writer::write_frame(const std::vector<std::uint8_t>& header,
+                                 const std::vector<std::uint8_t>& ops)
+{
+    if (!m_file)
+        return;
+
+    std::vector<std::uint8_t> prefix;
+    put_u8(prefix, kFrameTag);
+    put_varint(prefix, header.size() + ops.size());
+    prefix.insert(prefix.end(), header.begin(), header.end());
+
+    const bool ok =
+        m_file->write(reinterpret_cast<const char*>(prefix.data()), qint64(prefix.size()))
+            == qint64(prefix.size())
+        && m_file->write(reinterpret_cast<const char*>(ops.data()), qint64(ops.size()))
+            == qint64(ops.size());
+    if (!ok) {
+        q_warning("EZGL: draw capture write failed after %zu frames: %s",
+                  m_frames, qPrintable(m_file->errorString()));
+        m_file.reset();
+        return;
+    }
+    m_file->flush();
+    m_bytes += prefix.size() + ops.size();
+    ++m_frames;
+}
+
+// ---- recording_renderer ----
+
+recording_renderer::recording_renderer(irenderer& target, capture_writer& out)
+    : irenderer(nullptr, {}, nullptr, nullptr)
+    , m_target(target)
+    , m_out(out)
+{
+    // The camera is sampled up front: the callback may move it.
+    const rectangle screen = target.get_visible_screen();
+    put_rect(m_frame_header, target.get_visible_world());
+    put_varint(m_frame_header, std::uint64_t(std::max(0.0, screen.width())));
+    put_varint(m_frame_header, std::uint64_t(std::max(0.0, screen.height())));
+}
+
+recording_renderer::~recording_renderer()
+{
+    put_varint(m_frame_header, m_ops);
+    m_out.write_frame(m_frame_header, m_payload);
+}
+
+void recording_renderer::op(std::uint8_t code)
+{
+    put_u8(m_payload, code);
+    ++m_ops;
+}
+
+void recording_renderer::put_point(const point2d& p)
+{
+    const double quantum = m_system == WORLD ? m_out.m_world_quantum : kScreenQuantum;
+    std::int64_t* last   = m_last[m_system == WORLD ? 0 : 1];
+    const std::int64_t x = quantize(p.x, quantum);
+    const std::int64_t y = quantize(p.y, quantum);
+    put_zigzag(m_payload, x - last[0]);
+    put_zigzag(m_payload, y - last[1]);
+    last[0] = x;
+    last[1] = y;
+}
+
+void recording_renderer::put_points(const std::vector<point2d>& points)
+{
+    put_varint(m_payload, points.size());
+    for (const point2d& p : points)
+        put_point(p);
+}
+
+void recording_renderer::set_coordinate_system(t_coordinate_system new_coordinate_system)
+{
+    m_target.set_coordinate_system(new_coordinate_system);
+    m_system = new_coordinate_system;
+    op(std::uint8_t(op_code::set_coordinate_system));
+    put_u8(m_payload, std::uint8_t(new_coordinate_system));
+}
+
+void recording_renderer::set_visible_world(rectangle new_world)
+{
+    m_target.set_visible_world(new_world);
+    op(std::uint8_t(op_code::set_visible_world));
+    put_rect(m_payload, new_world);
+}
+
+rectangle recording_renderer::get_visible_world()
+{
+    return m_target.get_visible_world();
+}
+
+rectangle recording_renderer::get_visible_screen() const
+{
+    return m_target.get_visible_screen();
+}
+
+rectangle recording_renderer::world_to_screen(const rectangle& box)
+{
+    return m_target.world_to_screen(box);
+}
+
+void recording_renderer::set_color(color new_color)
+{
+    set_color(new_color.red, new_color.green, new_color.blue, new_color.alpha);
+}
+
+void recording_renderer::set_color(color new_color, uint_fast8_t alpha)
+{
+    set_color(new_color.red, new_color.green, new_color.blue, alpha);
+}
+
+void recording_renderer::set_color(uint_fast8_t red, uint_fast8_t green, uint_fast8_t blue,
+                                   uint_fast8_t alpha)
+{
+    m_target.set_color(red, green, blue, alpha);
+    op(std::uint8_t(op_code::set_color));
+    put_u8(m_payload, std::uint8_t(red));
+    put_u8(m_payload, std::uint8_t(green));
+    put_u8(m_payload, std::uint8_t(blue));
+    put_u8(m_payload, std::uint8_t(alpha));
+}
+
+void recording_renderer::set_line_cap(line_cap cap)
+{
+    m_target.set_line_cap(cap);
+    op(std::uint8_t(op_code::set_line_cap));
+    put_u8(m_payload, std::uint8_t(cap));
+}
+
+void recording_renderer::set_line_dash(line_dash dash)
+{
+    m_target.set_line_dash(dash);
+    op(std::uint8_t(op_code::set_line_dash));
+    put_u8(m_payload, std::uint8_t(dash));
+}
+
+void recording_renderer::set_line_width(int width)
+{
+    m_target.set_line_width(width);
+    op(std::uint8_t(op_code::set_line_width));
+    put_zigzag(m_payload, width);
+}
+
+void recording_renderer::set_font_size(double new_size)
+{
+    m_target.set_font_size(new_size);
+    op(std::uint8_t(op_code::set_font_size));
+    put_f64(m_payload, new_size);
+}
+
+void recording_renderer::format_font(std::string const& family, font_slant slant,
+                                     font_weight weight)
+{
+    m_target.format_font(family, slant, weight);
+    op(std::uint8_t(op_code::format_font));
+    put_bytes(m_payload, family.data(), family.size());
+    put_zigzag(m_payload, int(slant));
+    put_zigzag(m_payload, int(weight));
+}
+
+void recording_renderer::format_font(std::string const& family, font_slant slant,
+                                     font_weight weight, double new_size)
+{
+    m_target.format_font(family, slant, weight, new_size);
+    op(std::uint8_t(op_code::format_font_sized));
+    put_bytes(m_payload, family.data(), family.size());
+    put_zigzag(m_payload, int(slant));
+    put_zigzag(m_payload, int(weight));
+    put_f64(m_payload, new_size);
+}
+
+void recording_renderer::set_text_rotation(double degrees)
+{
+    m_target.set_text_rotation(degrees);
+    op(std::uint8_t(op_code::set_text_rotation));
+    put_f64(m_payload, degrees);
+}
+
+void recording_renderer::set_horiz_justification(justification horiz_just)
+{
+    m_target.set_horiz_justification(horiz_just);
+    op(std::uint8_t(op_code::set_horiz_justification));
+    put_u8(m_payload, std::uint8_t(horiz_just));
+}
+
+void recording_renderer::set_vert_justification(justification vert_just)
+{
+    m_target.set_vert_justification(vert_just);
+    op(std::uint8_t(op_code::set_vert_justification));
+    put_u8(m_payload, std::uint8_t(vert_just));
+}
+
+void recording_renderer::set_text_screen_offset(point2d offset_px)
+{
+    m_target.set_text_screen_offset(offset_px);
+    op(std::uint8_t(op_code::set_text_screen_offset));
+    put_f64(m_payload, offset_px.x);
+    put_f64(m_payload, offset_px.y);
+}
+
+void recording_renderer::set_pick_id(std::uint32_t id)
+{
+    m_target.set_pick_id(id);
+    op(std::uint8_t(op_code::set_pick_id));
+    put_varint(m_payload, id);
+}
+
+void recording_renderer::draw_line(const point2d& start, const point2d& end)
+{
+    m_target.draw_line(start, end);
+    op(std::uint8_t(op_code::draw_line));
+    put_point(start);
+    put_point(end);
+}
+
+// The width/height and rectangle overloads are recorded as corner pairs;
+// every backend implements them in terms of the corners anyway.
+void recording_renderer::draw_rectangle(const point2d& start, const point2d& end)
+{
+    m_target.draw_rectangle(start, end);
+    op(std::uint8_t(op_code::draw_rectangle));
+    put_point(start);
+    put_point(end);
+}
+
+void recording_renderer::draw_rectangle(const point2d& start, double width, double height)
+{
+    m_target.draw_rectangle(start, width, height);
+    op(std::uint8_t(op_code::draw_rectangle));
+    put_point(start);
+    put_point({start.x + width, start.y + height});
+}
+
+void recording_renderer::draw_rectangle(const rectangle& r)
+{
+    m_target.draw_rectangle(r);
+    op(std::uint8_t(op_code::draw_rectangle));
+    put_point(r.bottom_left());
+    put_point(r.top_right());
+}
+
+void recording_renderer::fill_rectangle(const point2d& start, const point2d& end)
+{
+    m_target.fill_rectangle(start, end);
+    op(std::uint8_t(op_code::fill_rectangle));
+    put_point(start);
+    put_point(end);
+}
+
+void recording_renderer::fill_rectangle(const point2d& start, double width, double height)
+{
+    m_target.fill_rectangle(start, width, height);
+    op(std::uint8_t(op_code::fill_rectangle));
+    put_point(start);
+    put_point({start.x + width, start.y + height});
+}
+
+void recording_renderer::fill_rectangle(const rectangle& r)
+{
+    m_target.fill_rectangle(r);
+    op(std::uint8_t(op_code::fill_rectangle));
+    put_point(r.bottom_left());
+    put_point(r.top_right());
+}
+
+void recording_renderer::fill_poly(const std::vector<point2d>& points)
+{
+    m_target.fill_poly(points);
+    op(std::uint8_t(op_code::fill_poly));
+    put_points(points);
+}
+
+void recording_renderer::fill_triangle(const point2d& a, const point2d& b, const point2d& c)
+{
+    m_target.fill_triangle(a, b, c);
+    op(std::uint8_t(op_code::fill_triangle));
+    put_point(a);
+    put_point(b);
+    put_point(c);
+}
+
+void recording_renderer::fill_poly_with_holes(const std::vector<point2d>& outer,
+                                              const std::vector<std::vector<point2d>>& holes)
+{
+    m_target.fill_poly_with_holes(outer, holes);
+    op(std::uint8_t(op_code::fill_poly_with_holes));
+    put_points(outer);
+    put_varint(m_payload, holes.size());
+    for (const auto& hole : holes)
+        put_points(hole);
+}
+
+void recording_renderer::fill_arrow_pointer_triangle(const point2d& anchor_world,
+                                                     const point2d& dir_world,
+                                                     float          arrow_size_px)
+{
+    m_target.fill_arrow_pointer_triangle(anchor_world, dir_world, arrow_size_px);
+    op(std::uint8_t(op_code::fill_arrow_pointer_triangle));
+    // Always WORLD, whatever the current coordinate system.
+    const t_coordinate_system saved = m_system;
+    m_system = WORLD;
+    put_point(anchor_world);
+    m_system = saved;
+    put_f64(m_payload, dir_world.x);
+    put_f64(m_payload, dir_world.y);
+    put_f64(m_payload, arrow_size_px);
+}
+
+void recording_renderer::draw_elliptic_arc(const point2d& center, double radius_x, double radius_y,
+                                           double start_angle, double extent_angle)
+{
+    m_target.draw_elliptic_arc(center, radius_x, radius_y, start_angle, extent_angle);
+    op(std::uint8_t(op_code::draw_elliptic_arc));
+    put_point(center);
+    put_f64(m_payload, radius_x);
+    put_f64(m_payload, radius_y);
+    put_f64(m_payload, start_angle);
+    put_f64(m_payload, extent_angle);
+}
+
+// Circular arcs are recorded as elliptic ones, which is what every backend
+// turns them into.
+void recording_renderer::draw_arc(const point2d& center, double radius,
+                                  double start_angle, double extent_angle)
+{
+    m_target.draw_arc(center, radius, start_angle, extent_angle);
+    op(std::uint8_t(op_code::draw_elliptic_arc));
+    put_point(center);
+    put_f64(m_payload, radius);
+    put_f64(m_payload, radius);
+    put_f64(m_payload, start_angle);
+    put_f64(m_payload, extent_angle);
+}
+
+void recording_renderer::fill_elliptic_arc(const point2d& center, double radius_x, double radius_y,
+                                           double start_angle, double extent_angle)
+{
+    m_target.fill_elliptic_arc(center, radius_x, radius_y, start_angle, extent_angle);
+    op(std::uint8_t(op_code::fill_elliptic_arc));
+    put_point(center);
+    put_f64(m_payload, radius_x);
+    put_f64(m_payload, radius_y);
+    put_f64(m_payload, start_angle);
+    put_f64(m_payload, extent_angle);
+}
+
+void recording_renderer::fill_arc(const point2d& center, double radius,
+                                  double start_angle, double extent_angle)
+{
+    m_target.fill_arc(center, radius, start_angle, extent_angle);
+    op(std::uint8_t(op_code::fill_elliptic_arc));
+    put_point(center);
+    put_f64(m_payload, radius);
+    put_f64(m_payload, radius);
+    put_f64(m_payload, start_angle);
+    put_f64(m_payload, extent_angle);
+}
+
+void recording_renderer::draw_text(const point2d& point, std::string const& text)
+{
+    m_target.draw_text(point, text);
+    op(std::uint8_t(op_code::draw_text));
+    put_point(point);
+    put_bytes(m_payload, text.data(), text.size());
+}
+
+void recording_renderer::draw_text(const point2d& point, std::string const& text,
+                                   double bound_x, double bound_y)
+{
+    m_target.draw_text(point, text, bound_x, bound_y);
+    op(std::uint8_t(op_code::draw_text_bounded));
+    put_point(point);
+    put_bytes(m_payload, text.data(), text.size());
+    put_f64(m_payload, bound_x);
+    put_f64(m_payload, bound_y);
+}
+
+void recording_renderer::draw_surface(surface* p_surface, const point2d& anchor_point,
+                                      double scale_factor)
+{
+    m_target.draw_surface(p_surface, anchor_point, scale_factor);
+    if (p_surface == nullptr)
+        return;
+
+    auto [it, added] = m_surface_ids.try_emplace(p_surface, std::uint32_t(m_surface_ids.size()));
+    if (added) {
+        QByteArray png;
+        QBuffer    buffer(&png);
+        buffer.open(QIODevice::WriteOnly);
+        p_surface->save(&buffer, "PNG");
+        op(std::uint8_t(op_code::define_surface));
+        put_varint(m_payload, it->second);
+        put_bytes(m_payload, png.constData(), std::size_t(png.size()));
+    }
+    op(std::uint8_t(op_code::draw_surface));
+    put_varint(m_payload, it->second);
+    put_point(anchor_point);
+    put_f64(m_payload, scale_factor);
+}
+
+// ---- capture_reader ----
+
+capture_reader::capture_reader(const std::uint8_t* data, std::size_t size)
+{
+    if (data == nullptr || size < kHeaderBytes
+        || std::memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+        q_warning("EZGL: not a draw capture");
+        return;
+    }
+
+    cursor in{data + sizeof(kMagic), data + size};
+    const std::uint32_t version = in.u32();
+    if (version != kDrawCaptureVersion) {
+        q_warning("EZGL: draw capture version %u, expected %u", version, kDrawCaptureVersion);
+        return;
+    }
+    m_world         = in.rect();
+    m_world_quantum = in.f64();
+    if (!(m_world_quantum > 0.0)) {
+        q_warning("EZGL: draw capture has an invalid coordinate quantum");
+        return;
+    }
+
+    while (!in.at_end()) {
+        if (in.u8() != kFrameTag) {
+            q_warning("EZGL: draw capture frame %zu is corrupt", m_frames.size());
+            return;
+        }
+        auto [payload, bytes] = in.bytes();
+        if (!in.ok) {
+            q_warning("EZGL: draw capture truncated in frame %zu", m_frames.size());
+            return;
+        }
+
+        cursor      frame{payload, payload + bytes};
+        frame_entry entry;
+        entry.info.visible_world = frame.rect();
+        entry.info.screen_width  = int(frame.varint());
+        entry.info.screen_height = int(frame.varint());
+        entry.info.ops           = std::size_t(frame.varint());
+        entry.info.bytes         = bytes;
+        entry.ops_begin          = frame.p;
+        entry.ops_end            = frame.end;
+        if (!frame.ok) {
+            q_warning("EZGL: draw capture frame %zu has a bad header", m_frames.size());
+            return;
+        }
+        m_frames.push_back(entry);
+    }
+    m_valid = true;
+}
+
+capture_reader::frame_info capture_reader::frame(std::size_t index) const
+{
+    return m_frames.at(index).info;
+}
+
+bool capture_reader::replay(std::size_t index, irenderer& target) const
+{
+    const frame_entry& entry = m_frames.at(index);
+
+    cursor              in{entry.ops_begin, entry.ops_end};
+    t_coordinate_system system = WORLD;
+    std::int64_t        last[2][2] = {};
+    std::vector<std::unique_ptr<surface>> surfaces;
+    std::vector<point2d>                  points;
+
+    auto point = [&]() -> point2d {
+        const int    s       = system == WORLD ? 0 : 1;
+        const double quantum = system == WORLD ? m_world_quantum : kScreenQuantum;
+        // Wrapping (unsigned) adds: a crafted delta must not overflow.
+        last[s][0] = std::int64_t(std::uint64_t(last[s][0]) + std::uint64_t(in.zigzag()));
+        last[s][1] = std::int64_t(std::uint64_t(last[s][1]) + std::uint64_t(in.zigzag()));
+        return {double(last[s][0]) * quantum, double(last[s][1]) * quantum};
+    };
+    auto read_points = [&](std::vector<point2d>& out) {
+        const std::uint64_t n = in.varint();
+        out.clear();
+        // Each point takes at least two bytes; guards the reserve.
+        if (n > std::uint64_t(in.end - in.p) / 2) { in.ok = false; return; }
+        out.reserve(std::size_t(n));
+        for (std::uint64_t i = 0; i < n; ++i)
+            out.push_back(point());
+    };
+    auto string = [&]() {
+        auto [data, size] = in.bytes();
+        return std::string(reinterpret_cast<const char*>(data), size);
+    };
+
+    while (in.ok && !in.at_end()) {
+        const auto code = op_code(in.u8());
+        switch (code) {
+        case op_code::set_coordinate_system: {
+            system = in.u8() == std::uint8_t(SCREEN) ? SCREEN : WORLD;
+            target.set_coordinate_system(system);
+            break;
+        }
+        case op_code::set_visible_world: {
+            const rectangle r = in.rect();
+            if (in.ok) target.set_visible_world(r);
+            break;
+        }
+        case op_code::set_color: {
+            const std::uint8_t r = in.u8(), g = in.u8(), b = in.u8(), a = in.u8();
+            if (in.ok) target.set_color(r, g, b, a);
+            break;
+        }
+        case op_code::set_line_cap: {
+            const std::uint8_t v = in.u8();
+            if (in.ok) target.set_line_cap(line_cap(v));
+            break;
+        }
+        case op_code::set_line_dash: {
+            const std::uint8_t v = in.u8();
+            if (in.ok) target.set_line_dash(line_dash(v));
+            break;
+        }
+        case op_code::set_line_width: {
+            const std::int64_t v = in.zigzag();
+            if (v < std::numeric_limits<int>::min() || v > std::numeric_limits<int>::max())
+                in.ok = false;
+            if (in.ok) target.set_line_width(int(v));
+            break;
+        }
+        case op_code::set_font_size: {
+            const double v = in.f64();
+            if (in.ok) target.set_font_size(v);
+            break;
+        }
+        case op_code::format_font:
+        case op_code::format_font_sized: {
+            const bool        sized  = code == op_code::format_font_sized;
+            const std::string family = string();
+            const auto        slant  = font_slant(in.zigzag());
+            const auto        weight = font_weight(in.zigzag());
+            const double      size   = sized ? in.f64() : 0.0;
+            if (!in.ok) break;
+            if (sized)
+                target.format_font(family, slant, weight, size);
+            else
+                target.format_font(family, slant, weight);
+            break;
+        }
+        case op_code::set_text_rotation: {
+            const double v = in.f64();
+            if (in.ok) target.set_text_rotation(v);
+            break;
+        }
+        case op_code::set_horiz_justification: {
+            const std::uint8_t v = in.u8();
+            if (in.ok) target.set_horiz_justification(justification(v));
+            break;
+        }
+        case op_code::set_vert_justification: {
+            const std::uint8_t v = in.u8();
+            if (in.ok) target.set_vert_justification(justification(v));
+            break;
+        }
+        case op_code::set_text_screen_offset: {
+            const double x = in.f64(), y = in.f64();
+            if (in.ok) target.set_text_screen_offset({x, y});
+            break;
+        }
+        case op_code::set_pick_id: {
+            const std::uint64_t v = in.varint();
+            if (in.ok) target.set_pick_id(std::uint32_t(v));
+            break;
+        }
+        case op_code::draw_line: {
+            const point2d a = point(), b = point();
+            if (in.ok) target.draw_line(a, b);
+            break;
+        }
+        case op_code::draw_rectangle: {
+            const point2d a = point(), b = point();
+            if (in.ok) target.draw_rectangle(a, b);
+            break;
+        }
+        case op_code::fill_rectangle: {
+            const point2d a = point(), b = point();
+            if (in.ok) target.fill_rectangle(a, b);
+            break;
+        }
+        case op_code::fill_poly: {
+            read_points(points);
+            if (in.ok) target.fill_poly(points);
+            break;
+        }
+        case op_code::fill_triangle: {
+            const point2d a = point(), b = point(), c = point();
+            if (in.ok) target.fill_triangle(a, b, c);
+            break;
+        }
+        case op_code::fill_poly_with_holes: {
+            read_points(points);
+            const std::uint64_t hole_count = in.varint();
+            if (!in.ok || hole_count > std::uint64_t(in.end - in.p)) { in.ok = false; break; }
+            std::vector<std::vector<point2d>> holes(std::size_t(hole_count));
+            for (auto& hole : holes)
+                read_points(hole);
+            if (in.ok) target.fill_poly_with_holes(points, holes);
+            break;
+        }
+        case op_code::fill_arrow_pointer_triangle: {
+            const t_coordinate_system saved = system;
+            system = WORLD;
+            const point2d anchor = point();
+            system = saved;
+            const double dx = in.f64(), dy = in.f64(), size = in.f64();
+            if (in.ok) target.fill_arrow_pointer_triangle(anchor, {dx, dy}, float(size));
+            break;
+        }
+        case op_code::draw_elliptic_arc:
+        case op_code::fill_elliptic_arc: {
+            const bool    fill   = code == op_code::fill_elliptic_arc;
+            const point2d center = point();
+            const double  rx = in.f64(), ry = in.f64(), start = in.f64(), extent = in.f64();
+            if (!in.ok) break;
+            if (fill)
+                target.fill_elliptic_arc(center, rx, ry, start, extent);
+            else
+                target.draw_elliptic_arc(center, rx, ry, start, extent);
+            break;
+        }
+        case op_code::draw_text: {
+            const point2d     at   = point();
+            const std::string text = string();
+            if (in.ok) target.draw_text(at, text);
+            break;
+        }
+        case op_code::draw_text_bounded: {
+            const point2d     at   = point();
+            const std::string text = string();
+            const double      bx = in.f64(), by = in.f64();
+            if (in.ok) target.draw_text(at, text, bx, by);
+            break;
+        }
+        case op_code::define_surface: {
+            const std::uint64_t id = in.varint();
+            auto [png, size] = in.bytes();
+            if (!in.ok || id > surfaces.size()) { in.ok = false; break; }
+            auto image = std::make_unique<surface>();
+            image->loadFromData(png, int(size), "PNG");
+            if (id == surfaces.size())
+                surfaces.push_back(std::move(image));
+            else
+                surfaces[std::size_t(id)] = std::move(image);
+            break;
+        }
+        case op_code::draw_surface: {
+            const std::uint64_t id     = in.varint();
+            const point2d       anchor = point();
+            const double        scale  = in.f64();
+            if (!in.ok || id >= surfaces.size()) { in.ok = false; break; }
+            target.draw_surface(surfaces[std::size_t(id)].get(), anchor, scale);
+            break;
+        }
+        default:
+            in.ok = false;
+            break;
+        }
+    }
+
+    if (!in.ok)
+        q_warning("EZGL: draw capture frame %zu is corrupt at byte %td",
+                  index, in.p - entry.ops_begin);
+    return in.ok;
+}
+
+} // namespace ezgl
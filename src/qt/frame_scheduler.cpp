@@ -0,0 +1,127 @@
+#include "ezgl/qt/frame_scheduler.hpp"
+
+#include <QEvent>
+#include <QRhiWidget>
+
+#include <utility>
+
+namespace ezgl {
+
+FrameScheduler::FrameScheduler(QWidget*              widget,
+                               std::function<void()> redraw,
+                               std::function<void()> redraw_camera_only,
+                               std::function<void()> redraw_camera_transient)
+    : QObject(nullptr)
+    , m_widget(widget)
+    , m_redraw(std::move(redraw))
+    , m_redraw_camera_only(std::move(redraw_camera_only))
+    , m_redraw_camera_transient(std::move(redraw_camera_transient))
+{
+    m_present_timeout.setSingleShot(true);
+    m_present_timeout.setInterval(kPresentTimeoutMs);
+    connect(&m_present_timeout, &QTimer::timeout, this, &FrameScheduler::frame_presented);
+
+    // QRhiWidget renders from its own paint path and reports each submitted
+    // frame; plain widgets are gated on their paint event instead.
+    if (auto* rhi_widget = qobject_cast<QRhiWidget*>(widget))
+        connect(rhi_widget, &QRhiWidget::frameSubmitted, this, &FrameScheduler::frame_presented);
+    else
+        widget->installEventFilter(this);
+}
+
+void FrameScheduler::request_redraw()
+{
+    m_full = true;
+    schedule_tick();
+}
+
+void FrameScheduler::request_redraw_camera_only()
+{
+    m_camera_only = true;
+    schedule_tick();
+}
+
+void FrameScheduler::set_animation_hook(std::function<bool()> advance)
+{
+    m_advance_animation = std::move(advance);
+}
+
+void FrameScheduler::start_animation()
+{
+    if (!m_advance_animation)
+        return;
+    m_animating = true;
+    schedule_tick();
+}
+
+void FrameScheduler::stop_animation()
+{
+    if (!m_animating)
+        return;
+    m_animating = false;
+    // Lay the overlay out for wherever the camera stopped.
+    request_redraw_camera_only();
+}
+
+void FrameScheduler::flush()
+{
+    if (!pending())
+        return;
+    const bool full        = m_full;
+    const bool camera_only = m_camera_only;
+    m_full        = false;
+    m_camera_only = false;
+    m_transient   = false;
+    if (full)
+        m_redraw();
+    else if (camera_only)
+        m_redraw_camera_only();
+    else
+        m_redraw_camera_transient();
+}
+
+bool FrameScheduler::eventFilter(QObject* watched, QEvent* event)
+{
+    // Seen before the widget paints; the tick it schedules is queued, so it
+    // runs after the paint has finished.
+    if (watched == m_widget && event->type() == QEvent::Paint)
+        frame_presented();
+    return QObject::eventFilter(watched, event);
+}
+
+void FrameScheduler::schedule_tick()
+{
+    if (m_tick_queued || m_frame_in_flight)
+        return;
+    m_tick_queued = true;
+    QMetaObject::invokeMethod(this, &FrameScheduler::tick, Qt::QueuedConnection);
+}
+
+void FrameScheduler::tick()
+{
+    m_tick_queued = false;
+    if (m_animating) {
+        m_animating = m_advance_animation();
+        if (m_animating)
+            m_transient = true;
+        else
+            m_camera_only = true;
+    }
+    if (!pending())
+        return;
+    m_frame_in_flight = true;
+    m_present_timeout.start();
+    flush();
+}
+
+void FrameScheduler::frame_presented()
+{
+    if (!m_frame_in_flight)
+        return;
+    m_frame_in_flight = false;
+    m_present_timeout.stop();
+    if (pending() || m_animating)
+        schedule_tick();
+}
+
+} // namespace ezgl
@@ -88,6 +88,14 @@ void immediate_renderer::fill_poly(const std::vector<point2d>& points)
     paint_poly(points);
 }
 
+void immediate_renderer::fill_poly_with_holes(const std::vector<point2d>& outer,
+                                              const std::vector<std::vector<point2d>>& holes)
+{
+    if (outer.size() < 3)
+        return;
+    paint_poly_with_holes(outer, holes);
+}
+
 void immediate_renderer::draw_elliptic_arc(const point2d& center, double radius_x,
                                            double radius_y, double start_angle,
                                            double extent_angle)
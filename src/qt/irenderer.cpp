@@ -3,6 +3,7 @@
 #include "ezgl/logutils.hpp"
 #include "ezgl/qt/painter.hpp"
 #include "ezgl/qt/qtutils.hpp"
+#include "ezgl/qt/triangulator.hpp"
 
 #include <algorithm>
 #include <cassert>
@@ -203,6 +204,11 @@ void irenderer::set_text_screen_offset(point2d offset_px)
     text_screen_offset_px = offset_px;
 }
 
+void irenderer::set_pick_id(std::uint32_t id)
+{
+    current_pick_id = id;
+}
+
 void irenderer::fill_arrow_pointer_triangle(const point2d& anchor_world,
                                              const point2d& dir_world,
                                              float          arrow_size_px)
@@ -233,6 +239,26 @@ void irenderer::fill_arrow_pointer_triangle(const point2d& anchor_world,
     fill_triangle(tip, left, right);
 }
 
+void irenderer::fill_poly_with_holes(const std::vector<point2d>& outer,
+                                     const std::vector<std::vector<point2d>>& holes)
+{
+    const std::vector<std::uint32_t> indices = triangulate_polygon(outer, holes);
+    if (indices.empty())
+        return;
+
+    // Indices address outer ++ holes[0] ++ holes[1] ++ ...
+    std::vector<const point2d*> vertices;
+    vertices.reserve(indices.size());
+    for (const point2d& p : outer)
+        vertices.push_back(&p);
+    for (const std::vector<point2d>& hole : holes)
+        for (const point2d& p : hole)
+            vertices.push_back(&p);
+
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+        fill_triangle(*vertices[indices[i]], *vertices[indices[i + 1]], *vertices[indices[i + 2]]);
+}
+
 void irenderer::set_visible_world(rectangle new_world)
 {
     point2d n_center = new_world.center();
@@ -317,6 +343,41 @@ void irenderer::paint_poly(const std::vector<point2d>& points)
     m_painter->fill();
 }
 
+void irenderer::paint_poly_with_holes(const std::vector<point2d>& outer,
+                                      const std::vector<std::vector<point2d>>& holes)
+{
+    assert(outer.size() > 2);
+
+    double x_min = outer[0].x, x_max = outer[0].x;
+    double y_min = outer[0].y, y_max = outer[0].y;
+    for (const point2d& p : outer) {
+        x_min = std::min(x_min, p.x);
+        x_max = std::max(x_max, p.x);
+        y_min = std::min(y_min, p.y);
+        y_max = std::max(y_max, p.y);
+    }
+    if (rectangle_off_screen({{x_min, y_min}, {x_max, y_max}}))
+        return;
+
+    // One subpath per ring; the painter path fills even-odd, so the hole
+    // rings cut out of the outer ring regardless of winding.
+    auto add_ring = [this](const std::vector<point2d>& ring) {
+        if (ring.size() < 3)
+            return;
+        point2d first = (current_coordinate_system == WORLD) ? m_transform(ring[0]) : ring[0];
+        m_painter->move_to(first.x, first.y);
+        for (std::size_t i = 1; i < ring.size(); ++i) {
+            point2d p = (current_coordinate_system == WORLD) ? m_transform(ring[i]) : ring[i];
+            m_painter->line_to(p.x, p.y);
+        }
+        m_painter->close_path();
+    };
+    add_ring(outer);
+    for (const std::vector<point2d>& hole : holes)
+        add_ring(hole);
+    m_painter->fill();
+}
+
 void irenderer::paint_arc_path(const point2d& center, double radius, double start_angle,
                                double extent_angle, double stretch_factor, bool fill)
 {
@@ -0,0 +1,260 @@
+#include "ezgl/qt/pick_index.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace {
+
+using Box = ezgl::PickTree::Box;
+
+bool overlaps(const Box& a, const Box& b)
+{
+    return a.x0 <= b.x1 && b.x0 <= a.x1 && a.y0 <= b.y1 && b.y0 <= a.y1;
+}
+
+Box entry_box(const ezgl::PickEntry& e)
+{
+    return {e.left(), e.bottom(), e.right(), e.top()};
+}
+
+void expand(Box& box, const Box& other)
+{
+    box.x0 = std::min(box.x0, other.x0);
+    box.y0 = std::min(box.y0, other.y0);
+    box.x1 = std::max(box.x1, other.x1);
+    box.y1 = std::max(box.y1, other.y1);
+}
+
+// Liang-Barsky: does the segment a-b touch the box?
+bool segment_touches(double ax, double ay, double bx, double by, const Box& box)
+{
+    double t0 = 0.0, t1 = 1.0;
+    const double dx = bx - ax, dy = by - ay;
+    const double p[4] = {-dx, dx, -dy, dy};
+    const double q[4] = {ax - box.x0, box.x1 - ax, ay - box.y0, box.y1 - ay};
+    for (int i = 0; i < 4; ++i) {
+        if (p[i] == 0.0) {
+            if (q[i] < 0.0)
+                return false;
+            continue;
+        }
+        const double t = q[i] / p[i];
+        if (p[i] < 0.0)
+            t0 = std::max(t0, t);
+        else
+            t1 = std::min(t1, t);
+        if (t0 > t1)
+            return false;
+    }
+    return true;
+}
+
+// Squared distance from the origin to segment a-b.
+double segment_distance2(double ax, double ay, double bx, double by)
+{
+    const double dx = bx - ax, dy = by - ay;
+    const double len2 = dx * dx + dy * dy;
+    const double t = len2 > 0.0 ? std::clamp(-(ax * dx + ay * dy) / len2, 0.0, 1.0) : 0.0;
+    const double px = ax + t * dx, py = ay + t * dy;
+    return px * px + py * py;
+}
+
+} // anonymous namespace
+
+namespace ezgl {
+
+// ---- PickTree ----------------------------------------------------------------
+
+void PickTree::build(std::vector<PickEntry> entries)
+{
+    m_entries = std::move(entries);
+    m_entries.shrink_to_fit();
+    m_nodes.clear();
+    m_level_begin.clear();
+    if (m_entries.empty())
+        return;
+
+    // Sort-tile-recursive packing: vertical slices by x centre, each
+    // sorted by y centre, so every run of kNodeSize entries is compact.
+    const std::size_t n      = m_entries.size();
+    const std::size_t leaves = (n + kNodeSize - 1) / kNodeSize;
+    const std::size_t slices = std::size_t(std::ceil(std::sqrt(double(leaves))));
+    const std::size_t per_slice = slices * kNodeSize;
+    auto cx = [](const PickEntry& e) { return e.x0 + e.x1; };
+    auto cy = [](const PickEntry& e) { return e.y0 + e.y1; };
+    std::sort(m_entries.begin(), m_entries.end(),
+              [&](const PickEntry& a, const PickEntry& b) { return cx(a) < cx(b); });
+    for (std::size_t begin = 0; begin < n; begin += per_slice) {
+        const auto first = m_entries.begin() + std::ptrdiff_t(begin);
+        const auto last  = m_entries.begin() + std::ptrdiff_t(std::min(n, begin + per_slice));
+        std::sort(first, last, [&](const PickEntry& a, const PickEntry& b) { return cy(a) < cy(b); });
+    }
+
+    // Leaf parents, then each level above from the one below, up to the root.
+    m_nodes.reserve(leaves + leaves / (kNodeSize - 1) + 1);
+    m_level_begin.push_back(0);
+    for (std::size_t i = 0; i < n; i += kNodeSize) {
+        Box box = entry_box(m_entries[i]);
+        for (std::size_t j = i + 1; j < std::min(n, i + kNodeSize); ++j)
+            expand(box, entry_box(m_entries[j]));
+        m_nodes.push_back(box);
+    }
+    while (m_nodes.size() - m_level_begin.back() > 1) {
+        const std::size_t below_begin = m_level_begin.back();
+        const std::size_t below_end   = m_nodes.size();
+        m_level_begin.push_back(below_end);
+        for (std::size_t i = below_begin; i < below_end; i += kNodeSize) {
+            Box box = m_nodes[i];
+            for (std::size_t j = i + 1; j < std::min(below_end, i + kNodeSize); ++j)
+                expand(box, m_nodes[j]);
+            m_nodes.push_back(box);
+        }
+    }
+    m_level_begin.push_back(m_nodes.size());
+}
+
+void PickTree::query(const Box& q, std::vector<const PickEntry*>& out) const
+{
+    if (m_entries.empty())
+        return;
+
+    // (level, index within level); level 0 nodes own entries. Each level
+    // leaves at most kNodeSize - 1 siblings pending, and 2^32 entries need
+    // no more than eight levels.
+    struct Item { std::size_t level, index; };
+    Item stack[kNodeSize * 8];
+    int  top = 0;
+    const std::size_t levels = m_level_begin.size() - 1;
+    stack[top++] = {levels - 1, 0};
+    while (top > 0) {
+        const Item item = stack[--top];
+        if (!overlaps(m_nodes[m_level_begin[item.level] + item.index], q))
+            continue;
+        const std::size_t first = item.index * kNodeSize;
+        if (item.level == 0) {
+            const std::size_t last = std::min(m_entries.size(), first + kNodeSize);
+            for (std::size_t i = first; i < last; ++i)
+                if (overlaps(entry_box(m_entries[i]), q))
+                    out.push_back(&m_entries[i]);
+            continue;
+        }
+        const std::size_t below = m_level_begin[item.level] - m_level_begin[item.level - 1];
+        const std::size_t last  = std::min(below, first + kNodeSize);
+        for (std::size_t i = last; i-- > first;)
+            stack[top++] = {item.level - 1, i};
+    }
+}
+
+// ---- PickIndex ---------------------------------------------------------------
+
+PickIndex::PickIndex(const rectangle& bounds, int dimension)
+    : m_bounds(bounds)
+    , m_dimension(dimension)
+    , m_tile_width(bounds.width() / double(dimension))
+    , m_tile_height(bounds.height() / double(dimension))
+    , m_tile_bounds(std::size_t(dimension * dimension))
+    , m_tiles(std::size_t(dimension * dimension))
+{
+    for (int ty = 0; ty < dimension; ++ty) {
+        const double bottom = bounds.bottom() + double(ty) * m_tile_height;
+        const double top    = ty + 1 == dimension ? bounds.top() : bottom + m_tile_height;
+        for (int tx = 0; tx < dimension; ++tx) {
+            const double left  = bounds.left() + double(tx) * m_tile_width;
+            const double right = tx + 1 == dimension ? bounds.right() : left + m_tile_width;
+            m_tile_bounds[std::size_t(ty * dimension + tx)] = rectangle{{left, bottom}, {right, top}};
+        }
+    }
+}
+
+const rectangle& PickIndex::tile_bounds(int tile_x, int tile_y) const
+{
+    return m_tile_bounds[std::size_t(tile_y * m_dimension + tile_x)];
+}
+
+PickTree& PickIndex::tile(int tile_x, int tile_y)
+{
+    return m_tiles[std::size_t(tile_y * m_dimension + tile_x)];
+}
+
+int PickIndex::clamp_tile_x(double x) const
+{
+    return std::clamp(int(std::floor((x - m_bounds.left()) / m_tile_width)), 0, m_dimension - 1);
+}
+
+int PickIndex::clamp_tile_y(double y) const
+{
+    return std::clamp(int(std::floor((y - m_bounds.bottom()) / m_tile_height)), 0, m_dimension - 1);
+}
+
+std::uint32_t PickIndex::pick(point2d p, point2d tolerance) const
+{
+    const double tx = std::max(tolerance.x, std::numeric_limits<double>::min());
+    const double ty = std::max(tolerance.y, std::numeric_limits<double>::min());
+    const Box q{float(p.x - tx), float(p.y - ty), float(p.x + tx), float(p.y + ty)};
+
+    std::vector<const PickEntry*> candidates;
+    for (int y = clamp_tile_y(q.y0); y <= clamp_tile_y(q.y1); ++y)
+        for (int x = clamp_tile_x(q.x0); x <= clamp_tile_x(q.x1); ++x)
+            m_tiles[std::size_t(y * m_dimension + x)].query(q, candidates);
+
+    // Distances in units of the tolerance, relative to p.
+    std::uint32_t best_id    = 0;
+    double        best_d2    = 1.0;
+    std::uint32_t best_order = 0;
+    for (const PickEntry* e : candidates) {
+        double d2;
+        if (e->is_segment()) {
+            d2 = segment_distance2((e->x0 - p.x) / tx, (e->y0 - p.y) / ty,
+                                   (e->x1 - p.x) / tx, (e->y1 - p.y) / ty);
+        } else {
+            const double dx = std::max({double(e->left()) - p.x, 0.0, p.x - double(e->right())}) / tx;
+            const double dy = std::max({double(e->bottom()) - p.y, 0.0, p.y - double(e->top())}) / ty;
+            d2 = dx * dx + dy * dy;
+        }
+        if (d2 > best_d2 || (d2 == best_d2 && best_id != 0 && e->order < best_order))
+            continue;
+        best_id    = e->id;
+        best_d2    = d2;
+        best_order = e->order;
+    }
+    return best_id;
+}
+
+std::vector<std::uint32_t> PickIndex::pick_rect(const rectangle& r) const
+{
+    const Box q{float(r.left()), float(r.bottom()), float(r.right()), float(r.top())};
+
+    std::vector<const PickEntry*> candidates;
+    for (int y = clamp_tile_y(q.y0); y <= clamp_tile_y(q.y1); ++y)
+        for (int x = clamp_tile_x(q.x0); x <= clamp_tile_x(q.x1); ++x)
+            m_tiles[std::size_t(y * m_dimension + x)].query(q, candidates);
+
+    std::vector<std::uint32_t> ids;
+    ids.reserve(candidates.size());
+    for (const PickEntry* e : candidates)
+        if (!e->is_segment() || segment_touches(e->x0, e->y0, e->x1, e->y1, q))
+            ids.push_back(e->id);
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    return ids;
+}
+
+std::size_t PickIndex::entry_count() const
+{
+    std::size_t count = 0;
+    for (const PickTree& tree : m_tiles)
+        count += tree.size();
+    return count;
+}
+
+std::size_t PickIndex::byte_size() const
+{
+    std::size_t bytes = 0;
+    for (const PickTree& tree : m_tiles)
+        bytes += tree.byte_size();
+    return bytes;
+}
+
+} // namespace ezgl
@@ -1,9 +1,12 @@
 #include "ezgl/qt/rhi_backend.hpp"
+#include "ezgl/qt/rhi_offscreen_context.hpp"
 #include "ezgl/qt/rhi_renderer.hpp"
+#include "ezgl/qt/rhi_scene_builder.hpp"
 #include "ezgl/logutils.hpp"
 #include "ezgl/camera.hpp"
 
 #include <functional>
+#include <optional>
 #include <QImage>
 
 namespace ezgl {
@@ -38,12 +41,28 @@ void rhi_backend::redraw()
             m_camera,
             m_draw_callback,
             m_bg_color);
-    } else {
-        m_renderer->begin_frame();
+        m_renderer->set_scene_storage(m_scene_storage);
     }
 
-    m_draw_callback(m_renderer.get());
-    m_renderer->flush();
+    if (m_async_redraw && m_snapshot_path.isEmpty()) {
+        post_background_build();
+        m_defer_redraw        = false;
+        m_pending_redraw      = false;
+        m_pending_camera_only = false;
+        q_debug("The canvas will be redrawn in the background (RHI path).");
+        return;
+    }
+    cancel_background_build();
+
+    if (!m_snapshot_path.isEmpty() && !m_renderer->load_snapshot(m_snapshot_path)) {
+        q_warning("Dropping scene snapshot %s; running the draw callback.", qPrintable(m_snapshot_path));
+        m_snapshot_path.clear();
+    }
+    if (m_snapshot_path.isEmpty()) {
+        m_renderer->begin_frame();
+        m_draw_callback(m_renderer.get());
+        m_renderer->flush();
+    }
 
     m_defer_redraw        = false;
     m_pending_redraw      = false;
@@ -54,6 +73,10 @@ void rhi_backend::redraw()
 
 void rhi_backend::redraw_camera_only()
 {
+    // The first background build is presented with whatever the camera is
+    // when it lands; restarting it here would starve it during a pan.
+    if (!m_has_drawn_frame && background_build_busy())
+        return;
     if (m_renderer && m_has_drawn_frame) {
         m_renderer->flush_mvp_only();
         m_pending_redraw      = false;
@@ -65,6 +88,16 @@ void rhi_backend::redraw_camera_only()
     redraw();
 }
 
+void rhi_backend::redraw_camera_transient()
+{
+    if (!m_renderer || !m_has_drawn_frame) {
+        redraw_camera_only();
+        return;
+    }
+    m_renderer->flush_mvp_only(/*relayout_overlay=*/false);
+    q_debug("The canvas MVP will be updated (animation frame, RHI path).");
+}
+
 void rhi_backend::begin_deferred_redraw_cycle()
 {
     m_defer_redraw        = true;
@@ -77,11 +110,11 @@ void rhi_backend::end_deferred_redraw_cycle()
     if (!m_defer_redraw)
         return;
     m_defer_redraw = false;
-    if (m_pending_redraw || !m_has_drawn_frame)
+    if (m_pending_redraw || (!m_has_drawn_frame && !background_build_busy()))
         redraw();
     else if (m_pending_camera_only)
         redraw_camera_only();
-    else if (m_renderer)
+    else if (m_renderer && !background_build_busy())
         redraw();
 }
 
@@ -101,7 +134,7 @@ void rhi_backend::on_resize(int w, int h)
         }
     } else if (can_reuse_geometry) {
         redraw_camera_only();
-    } else {
+    } else if (m_has_drawn_frame || !background_build_busy()) {
         redraw();
     }
 }
@@ -111,8 +144,9 @@ renderer* rhi_backend::create_animation_renderer()
     // The rhi_renderer is the live scene renderer and implements the full
     // irenderer interface. Draw calls route to one of two places:
     //   - world-space lines/rectangles/fills  → GPU tile batches (VBOs)
-    //   - text, arcs, polys, screen-space primitives → m_overlay_deferred
-    //     → overlay QImage composited above the GPU scene as a texture
+    //   - text, arcs, polys, screen-space primitives → overlay layer
+    //     → overlay QImage (rasterized on the overlay worker) composited
+    //     above the GPU scene as a texture
     // Unlike the immediate/deferred backends — which paint synchronously
     // into a live QImage — animation draws here are recorded and only
     // become visible on the next flush() (i.e. the next refresh_drawing()).
@@ -128,10 +162,115 @@ renderer* rhi_backend::create_animation_renderer()
             m_camera,
             m_draw_callback,
             m_bg_color);
+        m_renderer->set_scene_storage(m_scene_storage);
     }
     return m_renderer.get();
 }
 
+bool rhi_backend::save_snapshot(const QString& path)
+{
+    using namespace std::placeholders;
+
+    if (!m_widget) {
+        // Headless: record into a transient renderer, nothing to present.
+        const rectangle widget = m_camera->get_widget();
+        rhi_renderer renderer(QSize(int(widget.width()), int(widget.height())),
+                              std::bind(&camera::world_to_screen, *m_camera, _1),
+                              m_camera,
+                              m_draw_callback,
+                              m_bg_color);
+        renderer.set_scene_storage(m_scene_storage);
+        renderer.begin_frame();
+        m_draw_callback(&renderer);
+        return renderer.save_snapshot(path);
+    }
+
+    if (!m_renderer) {
+        m_renderer = std::make_unique<rhi_renderer>(
+            m_widget,
+            std::bind(&camera::world_to_screen, m_camera, _1),
+            m_camera,
+            m_draw_callback,
+            m_bg_color);
+        m_renderer->set_scene_storage(m_scene_storage);
+    }
+    cancel_background_build();
+    m_renderer->begin_frame();
+    m_draw_callback(m_renderer.get());
+    const bool ok = m_renderer->save_snapshot(path);
+
+    m_pending_redraw      = false;
+    m_pending_camera_only = false;
+    m_has_drawn_frame     = true;
+    return ok;
+}
+
+void rhi_backend::set_scene_storage(const SceneStorageOptions& options)
+{
+    m_scene_storage = options;
+    if (m_renderer)
+        m_renderer->set_scene_storage(options);
+}
+
+void rhi_backend::set_async_redraw(bool enabled)
+{
+    if (enabled == m_async_redraw)
+        return;
+    m_async_redraw = enabled;
+    if (!enabled && background_build_busy()) {
+        cancel_background_build();
+        redraw();
+    }
+}
+
+void rhi_backend::post_background_build()
+{
+    if (!m_builder) {
+        m_async_context = std::make_unique<QObject>();
+        QObject* context = m_async_context.get();
+        m_builder = std::make_unique<RhiSceneBuilder>(
+            m_draw_callback,
+            m_bg_color,
+            [this, context](std::uint64_t generation, rhi_renderer::AssembledFrame frame) {
+                // Runs on the builder thread. The frame is handed back through
+                // a shared_ptr because queued functors must be copyable.
+                auto shared = std::make_shared<rhi_renderer::AssembledFrame>(std::move(frame));
+                QMetaObject::invokeMethod(context, [this, generation, shared]() {
+                    if (generation != m_build_generation || !m_renderer) {
+                        q_debug("Dropping stale background scene build %llu.",
+                                static_cast<unsigned long long>(generation));
+                        return;
+                    }
+                    m_renderer->present_detached(std::move(*shared));
+                    m_has_drawn_frame = true;
+                    q_debug("The canvas was redrawn from a background build (RHI path).");
+                }, Qt::QueuedConnection);
+            });
+    }
+    m_builder->post({++m_build_generation,
+                     *m_camera,
+                     QSize(m_widget->width(), m_widget->height()),
+                     m_scene_storage});
+}
+
+bool rhi_backend::live_scene_current() const
+{
+    return m_renderer && m_has_drawn_frame && !m_pending_redraw && !background_build_busy();
+}
+
+bool rhi_backend::background_build_busy() const
+{
+    return m_builder && m_builder->busy();
+}
+
+void rhi_backend::cancel_background_build()
+{
+    if (!m_builder)
+        return;
+    m_builder->cancel_and_wait();
+    ++m_build_generation;
+}
+
 QImage rhi_backend::render_to_image(int w, int h)
 {
     // Always render off-screen at exactly (w, h) — never grab the live
@@ -143,16 +282,25 @@ QImage rhi_backend::render_to_image(int w, int h)
     // for the target dimensions), causing a visible jump on screen.
     //
     // The off-screen path uses an independent QRhi + render target, so the
-    // live widget and live renderer are not touched at all.
-    using namespace std::placeholders;
-    rhi_renderer renderer(QSize(w, h),
-                          std::bind(&camera::world_to_screen, *m_camera, _1),
-                          m_camera,
-                          m_draw_callback,
-                          m_bg_color);
-    renderer.begin_frame();
-    m_draw_callback(&renderer);
-    auto frame = renderer.flush_capture(m_bg_color);
+    // live widget is not touched at all.
+    //
+    // When the widget shows an up-to-date scene, share it instead of
+    // running the draw callback again: only the MVP and the overlay depend
+    // on the output size. A redraw still pending (deferred or in the
+    // background) means the data changed, so the scene is rebuilt then.
+    if (live_scene_current()) {
+        if (auto frame = m_renderer->capture_presented(QSize(w, h), m_bg_color)) {
+            q_debug("Capturing the presented scene (RHI path, no redraw).");
+            return RhiCanvasWidget::render_offscreen(w, h,
+                                                     std::move(frame->scene),
+                                                     frame->mvp,
+                                                     frame->visible_world,
+                                                     frame->overlay,
+                                                     frame->bg);
+        }
+    }
+
+    auto frame = record_headless(QSize(w, h))->flush_capture(m_bg_color);
     return RhiCanvasWidget::render_offscreen(w, h,
                                              std::move(frame.scene),
                                              frame.mvp,
@@ -161,4 +309,105 @@ QImage rhi_backend::render_to_image(int w, int h)
                                              frame.bg);
 }
 
+int rhi_backend::max_image_size() const
+{
+    const RhiOffscreenContext* context = RhiOffscreenContext::instance();
+    return context ? context->max_texture_size() : 0;
+}
+
+std::shared_ptr<const PickIndex> rhi_backend::pick_index() const
+{
+    return m_renderer ? m_renderer->pick_index() : nullptr;
+}
+
+bool rhi_backend::render_views(std::size_t          count,
+                               const view_world_fn& world_of,
+                               int                  w,
+                               int                  h,
+                               const view_sink_fn&  sink)
+{
+    RhiOffscreenContext*                 context = RhiOffscreenContext::instance();
+    std::unique_ptr<RhiOffscreenContext> own_context;
+    if (!context) {
+        own_context = std::make_unique<RhiOffscreenContext>();
+        if (!own_context->is_valid()) {
+            q_warning("render_views: no usable QRhi backend available.");
+            return false;
+        }
+        context = own_context.get();
+    }
+
+    // One scene for every view: the one on screen if it is current (see
+    // render_to_image()), otherwise recorded once here. Only the MVP and
+    // the overlay layout depend on the camera.
+    std::shared_ptr<const SceneBuffers> scene;
+    rhi_renderer*                       source = nullptr;
+    std::unique_ptr<rhi_renderer>       headless;
+    if (live_scene_current() && (scene = m_widget->presented_scene()))
+        source = m_renderer.get();
+    if (!source) {
+        headless = record_headless(QSize(w, h));
+        scene    = headless->flush_capture(m_bg_color).scene;
+        source = headless.get();
+    }
+    q_debug("render_views: %zu view(s) of one %.1f MB scene (RHI path).",
+            count, double(scene->byte_size()) / (1024.0 * 1024.0));
+
+    // Submitted, not rendered: the context draws and reads back a ring's
+    // worth of views per offscreen frame.
+    for (std::size_t i = 0; i < count; ++i) {
+        m_camera->set_world(world_of(i));
+        auto frame = source->capture_view(scene, QSize(w, h), m_bg_color);
+        context->submit(w, h, std::move(frame.scene), frame.mvp, frame.visible_world,
+                        std::move(frame.overlay), frame.bg,
+                        [&sink, i](QImage image) { sink(i, std::move(image)); });
+    }
+    context->flush();
+    return true;
+}
+
+bool rhi_backend::queue_frame(int w, int h, frame_sink_fn sink)
+{
+    RhiOffscreenContext* context = RhiOffscreenContext::instance();
+    if (!context)
+        return false;
+
+    // Captured now, as render_to_image() would: the scene and the camera
+    // may change before the batch is rendered.
+    std::optional<rhi_renderer::HeadlessFrameData> frame;
+    if (live_scene_current())
+        frame = m_renderer->capture_presented(QSize(w, h), m_bg_color);
+    if (!frame)
+        frame = record_headless(QSize(w, h))->flush_capture(m_bg_color);
+    context->submit(w, h, std::move(frame->scene), frame->mvp, frame->visible_world,
+                    std::move(frame->overlay), frame->bg, std::move(sink));
+    return true;
+}
+
+void rhi_backend::flush_frames()
+{
+    if (RhiOffscreenContext* context = RhiOffscreenContext::instance())
+        context->flush();
+}
+
+std::unique_ptr<rhi_renderer> rhi_backend::record_headless(QSize size) const
+{
+    using namespace std::placeholders;
+    auto renderer = std::make_unique<rhi_renderer>(size,
+                                                   std::bind(&camera::world_to_screen, *m_camera, _1),
+                                                   m_camera,
+                                                   m_draw_callback,
+                                                   m_bg_color);
+    renderer->set_scene_storage(m_scene_storage);
+    if (m_snapshot_path.isEmpty() || !renderer->load_snapshot(m_snapshot_path)) {
+        // Let a background build finish (its result is still wanted)
+        // rather than run the draw callback next to it.
+        if (m_builder)
+            m_builder->wait();
+        renderer->begin_frame();
+        m_draw_callback(renderer.get());
+    }
+    return renderer;
+}
+
 } // namespace ezgl
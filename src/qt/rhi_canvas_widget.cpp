@@ -1,25 +1,15 @@
 #include "ezgl/qt/rhi_canvas_widget.hpp"
+#include "ezgl/qt/rhi_offscreen_context.hpp"
 #include "ezgl/qt/render_backend.hpp"
 #include "ezgl/logutils.hpp"
 
 #include <rhi/qrhi.h>
-#include <QOffscreenSurface>
-#include <QSurfaceFormat>
-// Qt 6.7+ consolidates platform-specific RHI init params into qrhi_platform.h.
-// Older Qt versions exposed rhi/qrhid3d11.h and rhi/qrhimetal.h separately.
-#if __has_include(<rhi/qrhi_platform.h>)
-#  include <rhi/qrhi_platform.h>
-#else
-#  if defined(Q_OS_WIN)
-#    include <rhi/qrhid3d11.h>
-#  elif defined(Q_OS_MACOS) || defined(Q_OS_IOS)
-#    include <rhi/qrhimetal.h>
-#  endif
-#endif
 #include <QResizeEvent>
 #include <QShowEvent>
 #include <QMutexLocker>
 
+#include <algorithm>
+
 // Q_INIT_RESOURCE must be called at global scope (not inside a namespace).
 // For static libraries, Qt resources are not automatically registered, so
 // we force initialization once via a file-scope static. The shader QRC
@@ -53,18 +43,19 @@ RhiCanvasWidget::~RhiCanvasWidget() = default;
 void RhiCanvasWidget::set_frame_data(SceneBuffers       scene_buffers,
                                      const QMatrix4x4& world_to_ndc,
                                      const rectangle&  visible_world,
-                                     const QImage&     overlay,
                                      QColor            bg_color)
 {
     QMutexLocker lock(&m_frame_mutex);
     auto scene_ptr = std::make_shared<const SceneBuffers>(std::move(scene_buffers));
+    m_pending_scene_bytes   = scene_ptr->byte_size();
     m_pending_scene_buffers = scene_ptr;
+    m_presented_scene       = scene_ptr;
     m_pending_mvp           = world_to_ndc;
     m_pending_visible_world = visible_world;
-    m_pending_overlay       = overlay;
     m_pending_bg            = bg_color;
     m_frame_dirty           = true;
     m_mvp_dirty             = false;
+    m_scene_lost_signalled  = false;
     if (m_scene_renderer)
         m_scene_renderer->invalidate_geometry_cache();
 }
@@ -78,15 +69,104 @@ void RhiCanvasWidget::set_mvp_only(const QMatrix4x4& world_to_ndc,
     m_mvp_dirty             = true;
 }
 
-void RhiCanvasWidget::set_mvp_and_overlay(const QMatrix4x4& world_to_ndc,
-                                          const rectangle&  visible_world,
-                                          const QImage&     overlay)
+void RhiCanvasWidget::set_overlay(QImage               overlay,
+                                  QImage               screen,
+                                  const QMatrix4x4&    overlay_mvp,
+                                  const OverlayUpdate& update)
 {
     QMutexLocker lock(&m_frame_mutex);
-    m_pending_mvp           = world_to_ndc;
-    m_pending_visible_world = visible_world;
-    m_pending_overlay       = overlay;
-    m_mvp_dirty             = true;
+    m_pending_overlay.image = std::move(overlay);
+    m_pending_overlay.mvp   = overlay_mvp;
+    ++m_pending_overlay.serial;
+    // The worker hands back the same (shared) image while the SCREEN
+    // content is unchanged; only a new one needs uploading.
+    if (screen.cacheKey() != m_pending_overlay.screen.cacheKey()) {
+        m_pending_overlay.screen = std::move(screen);
+        ++m_pending_overlay.screen_serial;
+    }
+    std::vector<OverlayUpdate>& history = m_pending_overlay.history;
+    if (!update.incremental)
+        history.clear(); // nothing before a full update is useful any more
+    history.push_back(update);
+    if (history.size() > kOverlayHistory)
+        history.erase(history.begin());
+    m_mvp_dirty = true; // repaint without touching geometry
+}
+
+void RhiCanvasWidget::set_retain_cpu_scene(bool retain)
+{
+    QMutexLocker lock(&m_frame_mutex);
+    m_retain_cpu_scene = retain;
+    if (m_scene_renderer)
+        m_scene_renderer->set_retain_cpu_scene(retain);
+}
+
+void RhiCanvasWidget::set_upload_budget(std::size_t bytes_per_frame)
+{
+    QMutexLocker lock(&m_frame_mutex);
+    m_upload_budget_bytes = bytes_per_frame;
+}
+
+void RhiCanvasWidget::set_overlay_tile_budget(std::size_t bytes)
+{
+    QMutexLocker lock(&m_frame_mutex);
+    m_overlay_tile_budget = bytes;
+}
+
+std::size_t RhiCanvasWidget::overlay_tile_budget() const
+{
+    QMutexLocker lock(&m_frame_mutex);
+    return m_overlay_tile_budget;
+}
+
+void RhiCanvasWidget::set_overlay_tile_view(OverlayTileView view)
+{
+    QMutexLocker lock(&m_frame_mutex);
+    if (view.epoch != m_pending_overlay.tiles.epoch) {
+        m_known_tiles.clear();
+        m_pending_tiles.erase(
+            std::remove_if(m_pending_tiles.begin(), m_pending_tiles.end(),
+                           [&](const OverlayTile& t) { return view.epoch == 0 || t.epoch < view.epoch; }),
+            m_pending_tiles.end());
+    }
+    m_pending_overlay.tiles = std::move(view);
+    m_mvp_dirty = true;
+}
+
+void RhiCanvasWidget::add_overlay_tile(OverlayTile tile)
+{
+    QMutexLocker lock(&m_frame_mutex);
+    if (tile.epoch < m_pending_overlay.tiles.epoch)
+        return; // finished after the view moved on to a new epoch
+    if (tile.epoch == m_pending_overlay.tiles.epoch)
+        m_known_tiles.insert(tile.key);
+    m_pending_tiles.push_back(std::move(tile));
+    m_mvp_dirty = true;
+}
+
+std::vector<OverlayTileKey> RhiCanvasWidget::missing_overlay_tiles(std::uint64_t               epoch,
+                                                                   std::vector<OverlayTileKey> keys) const
+{
+    QMutexLocker lock(&m_frame_mutex);
+    if (epoch != m_pending_overlay.tiles.epoch)
+        return keys;
+    keys.erase(std::remove_if(keys.begin(), keys.end(),
+                              [&](const OverlayTileKey& k) { return m_known_tiles.count(k) != 0; }),
+               keys.end());
+    return keys;
+}
+
+std::shared_ptr<const SceneBuffers> RhiCanvasWidget::presented_scene() const
+{
+    QMutexLocker lock(&m_frame_mutex);
+    return m_presented_scene.lock();
+}
+
+std::size_t RhiCanvasWidget::resident_cpu_scene_bytes() const
+{
+    QMutexLocker lock(&m_frame_mutex);
+    const std::size_t pending = m_pending_scene_buffers ? m_pending_scene_bytes : 0;
+    return pending + m_renderer_scene_bytes.load(std::memory_order_relaxed);
 }
 
 // ---- QRhiWidget overrides --------------------------------------------------
@@ -95,6 +175,19 @@ void RhiCanvasWidget::initialize(QRhiCommandBuffer* /*cb*/)
 {
     if (!m_scene_renderer)
         m_scene_renderer = std::make_unique<RhiSceneRenderer>();
+
+    // QRhiWidget also calls initialize() when only the backing texture was
+    // resized. Pipelines stay compatible with the new render target (same
+    // format and sample count), so keep the renderer — and with it the
+    // device-local geometry — unless the QRhi itself changed.
+    if (m_scene_renderer->is_initialized() && m_scene_renderer->rhi() == rhi())
+        return;
+
+    {
+        QMutexLocker lock(&m_frame_mutex);
+        m_scene_renderer->set_retain_cpu_scene(m_retain_cpu_scene);
+        m_known_tiles.clear(); // a new QRhi starts with an empty tile cache
+    }
     m_scene_renderer->initialize(rhi(), renderTarget()->renderPassDescriptor());
     q_debug("RhiCanvasWidget: scene renderer initialized (%d frame slot(s)).",
            m_scene_renderer->frame_count());
@@ -105,18 +198,41 @@ void RhiCanvasWidget::render(QRhiCommandBuffer* cb)
     if (!m_scene_renderer || !m_scene_renderer->is_initialized())
         return;
 
+    // Memory-lean mode: the pools went away with the old QRhi and there is
+    // no CPU copy to rebuild them. Ask for a redraw once per loss.
+    if (m_scene_renderer->geometry_lost()) {
+        bool notify = false;
+        {
+            QMutexLocker lock(&m_frame_mutex);
+            notify = !m_pending_scene_buffers && !m_scene_lost_signalled;
+            if (notify)
+                m_scene_lost_signalled = true;
+        }
+        if (notify) {
+            q_debug("RhiCanvasWidget: GPU scene lost in memory-lean mode; requesting redraw.");
+            emit scene_lost();
+        }
+    }
+
     // Snapshot pending state under the mutex.
     std::shared_ptr<const SceneBuffers> scene;
     QMatrix4x4 mvp;
     rectangle   visible_world;
-    QImage      overlay;
+    OverlayFrame overlay;
     QColor      bg;
     bool        geom_dirty;
+    std::vector<OverlayTile> tiles;
+
+    // A scene still streaming in needs frames even when nothing changed.
+    const bool streaming = m_scene_renderer->upload_pending();
 
     {
         QMutexLocker lock(&m_frame_mutex);
-        if (!m_frame_dirty && !m_mvp_dirty)
+        if (!m_frame_dirty && !m_mvp_dirty && !streaming)
             return;
+        m_scene_renderer->set_upload_budget(m_upload_budget_bytes);
+        m_scene_renderer->overlay_tiles().set_budget(m_overlay_tile_budget);
+        tiles.swap(m_pending_tiles);
         geom_dirty      = m_frame_dirty;
         scene           = m_pending_scene_buffers;
         mvp             = m_pending_mvp;
@@ -128,16 +244,50 @@ void RhiCanvasWidget::render(QRhiCommandBuffer* cb)
         m_pending_scene_buffers.reset();
     }
 
+    RhiOverlayTileCache& tile_cache = m_scene_renderer->overlay_tiles();
+    if (!tiles.empty())
+        tile_cache.add(std::move(tiles));
+
     const int frame_slot = rhi()->currentFrameSlot();
     m_scene_renderer->render(cb, renderTarget(), renderTarget()->pixelSize(),
                               frame_slot, geom_dirty, scene,
                               mvp, visible_world, overlay, bg);
+
+    // Evicted tiles have to be requested again when they come back.
+    const std::vector<OverlayTileKey> evicted = tile_cache.take_evicted();
+    if (!evicted.empty()) {
+        QMutexLocker lock(&m_frame_mutex);
+        if (tile_cache.epoch() == m_pending_overlay.tiles.epoch) {
+            for (const OverlayTileKey& key : evicted)
+                m_known_tiles.erase(key);
+        }
+    }
+
+    m_renderer_scene_bytes.store(m_scene_renderer->resident_cpu_scene_bytes(),
+                                 std::memory_order_relaxed);
+
+    // A new scene reports even when it went up in one frame (no budget,
+    // or a small scene), so the final (total, total) is always seen.
+    if (streaming || (geom_dirty && scene) || m_scene_renderer->upload_pending()) {
+        emit upload_progress(qulonglong(m_scene_renderer->uploaded_bytes()),
+                             qulonglong(m_scene_renderer->total_upload_bytes()));
+        if (m_scene_renderer->upload_pending())
+            update();
+    }
+    if (geom_dirty && scene) {
+        q_debug("RhiCanvasWidget: scene uploaded (%.1f MB GPU); resident CPU scene %.1f MB%s.",
+                double(m_scene_renderer->geometry_pool_bytes()) / (1024.0 * 1024.0),
+                double(m_scene_renderer->resident_cpu_scene_bytes()) / (1024.0 * 1024.0),
+                m_scene_renderer->retains_cpu_scene() ? "" : " (memory-lean)");
+    }
 }
 
 void RhiCanvasWidget::releaseResources()
 {
     if (m_scene_renderer)
         m_scene_renderer->release();
+    QMutexLocker lock(&m_frame_mutex);
+    m_known_tiles.clear();
 }
 
 void RhiCanvasWidget::resizeEvent(QResizeEvent* e)
@@ -154,151 +304,42 @@ void RhiCanvasWidget::showEvent(QShowEvent* e)
         emit resized(width(), height());
 }
 
-// ---- Headless QRhi creation ------------------------------------------------
-
-// Pick the best available QRhi backend for offscreen rendering. We try the
-// platform-native API first (D3D11 on Windows, Metal on macOS/iOS), and fall
-// back to OpenGL everywhere else. Each candidate is attempted independently so
-// a failure in one (driver missing, headless QPA without GPU, etc.) advances
-// to the next instead of returning nullptr.
-//
-// gl_surface is an output parameter: if the OpenGL path is taken it must
-// outlive the returned QRhi (the GL context is bound to that surface).
-static std::unique_ptr<QRhi> create_headless_rhi(QOffscreenSurface& gl_surface)
-{
-#if defined(Q_OS_WIN)
-    {
-        QRhiD3D11InitParams params;
-        if (auto rhi = std::unique_ptr<QRhi>(QRhi::create(QRhi::D3D11, &params)))
-            return rhi;
-        q_warning("create_headless_rhi: D3D11 unavailable, trying OpenGL.");
-    }
-#elif defined(Q_OS_MACOS) || defined(Q_OS_IOS)
-    {
-        QRhiMetalInitParams params;
-        if (auto rhi = std::unique_ptr<QRhi>(QRhi::create(QRhi::Metal, &params)))
-            return rhi;
-        q_warning("create_headless_rhi: Metal unavailable, trying OpenGL.");
-    }
-#endif
-
-    // OpenGL path. Request a GL 4.1 core profile (max version supported on
-    // macOS, and widely available everywhere else) so QRhi compiles the
-    // GLSL 410 shader variant: that one carries native UBO bindings and
-    // explicit `layout(location = N)` vertex-attribute qualifiers. On the
-    // GL 3.2 / GLSL 150 path the locations are stripped and QRhi has to
-    // resolve attributes by name, which silently aliases the two `vec2`
-    // inputs of fill_rect (inMin/inMax) and produces large stray quads in
-    // the readback — visible as "brush-stroke" artefacts spanning each row.
-    // If a higher-version default has already been installed by the host
-    // application we keep it.
-    QSurfaceFormat fmt = QSurfaceFormat::defaultFormat();
-    if (fmt.renderableType() != QSurfaceFormat::OpenGL
-        || fmt.majorVersion() < 4
-        || (fmt.majorVersion() == 4 && fmt.minorVersion() < 1)) {
-        fmt.setRenderableType(QSurfaceFormat::OpenGL);
-        fmt.setProfile(QSurfaceFormat::CoreProfile);
-        fmt.setMajorVersion(4);
-        fmt.setMinorVersion(1);
-    }
-    gl_surface.setFormat(fmt);
-    gl_surface.create();
-    if (!gl_surface.isValid()) {
-        q_warning("create_headless_rhi: offscreen GL surface creation failed.");
-        return nullptr;
-    }
-    QRhiGles2InitParams gl_params;
-    gl_params.fallbackSurface = &gl_surface;
-    gl_params.format          = fmt;
-    return std::unique_ptr<QRhi>(QRhi::create(QRhi::OpenGLES2, &gl_params));
-}
-
 // ---- probe_rhi -------------------------------------------------------------
 
 bool probe_rhi()
 {
+    // On the GUI thread the probe creates the shared offscreen context, which
+    // the first save_graphics() then reuses instead of building its own.
     static const bool available = []() {
-        QOffscreenSurface surface; // lifetime covers QRhi creation only
-        return create_headless_rhi(surface) != nullptr;
+        if (RhiOffscreenContext::instance())
+            return true;
+        return RhiOffscreenContext().is_valid();
     }();
     return available;
 }
 
 // ---- render_offscreen ------------------------------------------------------
 
-QImage RhiCanvasWidget::render_offscreen(int               w,
-                                         int               h,
-                                         SceneBuffers      scene,
-                                         const QMatrix4x4& mvp,
-                                         const rectangle&  visible_world,
-                                         const QImage&     overlay,
-                                         QColor            bg)
+QImage RhiCanvasWidget::render_offscreen(int                                 w,
+                                         int                                 h,
+                                         std::shared_ptr<const SceneBuffers> scene,
+                                         const QMatrix4x4&                   mvp,
+                                         const rectangle&                    visible_world,
+                                         const QImage&                       overlay,
+                                         QColor                              bg)
 {
-    // Create a standalone QRhi using the best available backend for this
-    // platform (Metal on macOS, D3D11 on Windows, OpenGL elsewhere).
     // No QRhiWidget is involved so this works on QT_QPA_PLATFORM=offscreen.
-    QOffscreenSurface gl_surface; // only used if OpenGL is the chosen backend
-    std::unique_ptr<QRhi> rhi = create_headless_rhi(gl_surface);
-    if (!rhi) {
+    // The shared context keeps the QRhi, pipelines and targets between
+    // calls; off the GUI thread a private one is built for this call.
+    if (RhiOffscreenContext* context = RhiOffscreenContext::instance())
+        return context->render(w, h, std::move(scene), mvp, visible_world, overlay, bg);
+
+    RhiOffscreenContext context;
+    if (!context.is_valid()) {
         qWarning("render_offscreen: no usable QRhi backend available");
         return {};
     }
-
-    // MSAA color target + single-sample resolve texture. The pipelines (built
-    // with sampleCount=EZGL_RHI_SAMPLE_COUNT) render into color_tex; the GPU
-    // resolves to resolve_tex at render-pass end. Readback then pulls pixels
-    // from the single-sample resolve target (MSAA textures can't be read
-    // back directly).
-    std::unique_ptr<QRhiTexture> color_tex(
-        rhi->newTexture(QRhiTexture::RGBA8, QSize(w, h), EZGL_RHI_SAMPLE_COUNT,
-                        QRhiTexture::RenderTarget));
-    if (!color_tex->create()) return {};
-
-    std::unique_ptr<QRhiTexture> resolve_tex(
-        rhi->newTexture(QRhiTexture::RGBA8, QSize(w, h), 1,
-                        QRhiTexture::RenderTarget | QRhiTexture::UsedAsTransferSource));
-    if (!resolve_tex->create()) return {};
-
-    QRhiColorAttachment color_att(color_tex.get());
-    color_att.setResolveTexture(resolve_tex.get());
-    QRhiTextureRenderTargetDescription rt_desc;
-    rt_desc.setColorAttachments({color_att});
-
-    std::unique_ptr<QRhiTextureRenderTarget> rt(rhi->newTextureRenderTarget(rt_desc));
-    std::unique_ptr<QRhiRenderPassDescriptor> rp(rt->newCompatibleRenderPassDescriptor());
-    rt->setRenderPassDescriptor(rp.get());
-    if (!rt->create()) return {};
-
-    // Render using RhiSceneRenderer — the same pipeline code used by the widget
-    RhiSceneRenderer renderer;
-    renderer.initialize(rhi.get(), rp.get());
-
-    QRhiCommandBuffer* cb = nullptr;
-    if (rhi->beginOffscreenFrame(&cb) != QRhi::FrameOpSuccess) return {};
-
-    auto scene_ptr = std::make_shared<const SceneBuffers>(std::move(scene));
-    renderer.render(cb, rt.get(), QSize(w, h),
-                    /*frame_slot=*/0, /*geom_dirty=*/true,
-                    scene_ptr, mvp, visible_world, overlay, bg);
-
-    // Pixel readback — from the resolved (single-sample) texture, not the MSAA one.
-    QRhiReadbackResult readback;
-    QRhiResourceUpdateBatch* rb = rhi->nextResourceUpdateBatch();
-    rb->readBackTexture({resolve_tex.get()}, &readback);
-    cb->resourceUpdate(rb);
-
-    rhi->endOffscreenFrame();
-
-    if (readback.data.isEmpty()) return {};
-
-    QImage result(reinterpret_cast<const uchar*>(readback.data.constData()),
-                  w, h, QImage::Format_RGBA8888);
-    // OpenGL-style backends report Y-up framebuffer coordinates, so the raw
-    // readback rows are bottom-to-top relative to QImage's top-down layout.
-    // Mirror vertically in that case; D3D/Metal/Vulkan are already top-down.
-    if (rhi->isYUpInFramebuffer())
-        return result.flipped(Qt::Vertical);
-    return result.copy();
+    return context.render(w, h, std::move(scene), mvp, visible_world, overlay, bg);
 }
 
 } // namespace ezgl
@@ -0,0 +1,286 @@
+#include "ezgl/qt/rhi_offscreen_context.hpp"
+#include "ezgl/qt/render_backend.hpp"
+#include "ezgl/logutils.hpp"
+
+#include <rhi/qrhi.h>
+#include <QCoreApplication>
+#include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QSurfaceFormat>
+#include <QThread>
+// Qt 6.7+ consolidates platform-specific RHI init params into qrhi_platform.h.
+// Older Qt versions exposed rhi/qrhid3d11.h and rhi/qrhimetal.h separately.
+#if __has_include(<rhi/qrhi_platform.h>)
+#  include <rhi/qrhi_platform.h>
+#else
+#  if defined(Q_OS_WIN)
+#    include <rhi/qrhid3d11.h>
+#  elif defined(Q_OS_MACOS) || defined(Q_OS_IOS)
+#    include <rhi/qrhimetal.h>
+#  endif
+#endif
+
+namespace {
+
+// ---- Headless QRhi creation ------------------------------------------------
+
+// Pick the best available QRhi backend for offscreen rendering. We try the
+// platform-native API first (D3D11 on Windows, Metal on macOS/iOS), and fall
+// back to OpenGL everywhere else. Each candidate is attempted independently so
+// a failure in one (driver missing, headless QPA without GPU, etc.) advances
+// to the next instead of returning nullptr.
+//
+// gl_surface is an output parameter: if the OpenGL path is taken it must
+// outlive the returned QRhi (the GL context is bound to that surface).
+std::unique_ptr<QRhi> create_headless_rhi(QOffscreenSurface& gl_surface)
+{
+#if defined(Q_OS_WIN)
+    {
+        QRhiD3D11InitParams params;
+        if (auto rhi = std::unique_ptr<QRhi>(QRhi::create(QRhi::D3D11, &params)))
+            return rhi;
+        q_warning("create_headless_rhi: D3D11 unavailable, trying OpenGL.");
+    }
+#elif defined(Q_OS_MACOS) || defined(Q_OS_IOS)
+    {
+        QRhiMetalInitParams params;
+        if (auto rhi = std::unique_ptr<QRhi>(QRhi::create(QRhi::Metal, &params)))
+            return rhi;
+        q_warning("create_headless_rhi: Metal unavailable, trying OpenGL.");
+    }
+#endif
+
+    // OpenGL path. Request a GL 4.1 core profile (max version supported on
+    // macOS, and widely available everywhere else) so QRhi compiles the
+    // GLSL 410 shader variant: that one carries native UBO bindings and
+    // explicit `layout(location = N)` vertex-attribute qualifiers. On the
+    // GL 3.2 / GLSL 150 path the locations are stripped and QRhi has to
+    // resolve attributes by name, which silently aliases the two `vec2`
+    // inputs of fill_rect (inMin/inMax) and produces large stray quads in
+    // the readback — visible as "brush-stroke" artefacts spanning each row.
+    // If a higher-version default has already been installed by the host
+    // application we keep it.
+    QSurfaceFormat fmt = QSurfaceFormat::defaultFormat();
+    if (fmt.renderableType() != QSurfaceFormat::OpenGL
+        || fmt.majorVersion() < 4
+        || (fmt.majorVersion() == 4 && fmt.minorVersion() < 1)) {
+        fmt.setRenderableType(QSurfaceFormat::OpenGL);
+        fmt.setProfile(QSurfaceFormat::CoreProfile);
+        fmt.setMajorVersion(4);
+        fmt.setMinorVersion(1);
+    }
+    gl_surface.setFormat(fmt);
+    gl_surface.create();
+    if (!gl_surface.isValid()) {
+        q_warning("create_headless_rhi: offscreen GL surface creation failed.");
+        return nullptr;
+    }
+    QRhiGles2InitParams gl_params;
+    gl_params.fallbackSurface = &gl_surface;
+    gl_params.format          = fmt;
+    return std::unique_ptr<QRhi>(QRhi::create(QRhi::OpenGLES2, &gl_params));
+}
+
+// ---- Shared instance -------------------------------------------------------
+
+// Owned by the GUI thread; destroyed by a post routine. A failed creation
+// is remembered so machines without a backend don't retry on every call.
+ezgl::RhiOffscreenContext* s_shared_context = nullptr;
+bool                       s_shared_context_failed = false;
+
+void destroy_shared_context()
+{
+    delete s_shared_context;
+    s_shared_context        = nullptr;
+    s_shared_context_failed = false;
+}
+
+} // anonymous namespace
+
+namespace ezgl {
+
+RhiOffscreenContext::RhiOffscreenContext()
+    : m_gl_surface(std::make_unique<QOffscreenSurface>())
+{
+    m_rhi = create_headless_rhi(*m_gl_surface);
+}
+
+RhiOffscreenContext::~RhiOffscreenContext()
+{
+    m_queue.clear();
+    m_renderer.reset();
+    for (Target& target : m_targets)
+        release_target(target);
+    m_rp_desc.reset();
+    m_rhi.reset();
+}
+
+RhiOffscreenContext* RhiOffscreenContext::instance()
+{
+    if (!qobject_cast<QGuiApplication*>(QCoreApplication::instance())
+        || QThread::currentThread() != QCoreApplication::instance()->thread())
+        return nullptr;
+    if (!s_shared_context && !s_shared_context_failed) {
+        auto context = std::make_unique<RhiOffscreenContext>();
+        if (!context->is_valid()) {
+            s_shared_context_failed = true;
+            return nullptr;
+        }
+        s_shared_context = context.release();
+        q_debug("RhiOffscreenContext: created shared %s context.", s_shared_context->rhi()->backendName());
+        qAddPostRoutine(destroy_shared_context);
+    }
+    return s_shared_context;
+}
+
+int RhiOffscreenContext::max_texture_size() const
+{
+    return m_rhi ? m_rhi->resourceLimit(QRhi::TextureSizeMax) : 0;
+}
+
+bool RhiOffscreenContext::ensure_target(Target& target, QSize size)
+{
+    if (target.rt && size == target.size)
+        return true;
+    release_target(target);
+
+    // MSAA color target + single-sample resolve texture. The pipelines (built
+    // with sampleCount=EZGL_RHI_SAMPLE_COUNT) render into the color texture;
+    // the GPU resolves to the resolve texture at render-pass end. Readback
+    // then pulls pixels from the single-sample resolve target (MSAA textures
+    // can't be read back directly).
+    target.color_tex.reset(m_rhi->newTexture(QRhiTexture::RGBA8, size, EZGL_RHI_SAMPLE_COUNT,
+                                             QRhiTexture::RenderTarget));
+    target.resolve_tex.reset(m_rhi->newTexture(QRhiTexture::RGBA8, size, 1,
+                                               QRhiTexture::RenderTarget | QRhiTexture::UsedAsTransferSource));
+    if (!target.color_tex->create() || !target.resolve_tex->create()) {
+        release_target(target);
+        return false;
+    }
+
+    QRhiColorAttachment color_att(target.color_tex.get());
+    color_att.setResolveTexture(target.resolve_tex.get());
+    QRhiTextureRenderTargetDescription rt_desc;
+    rt_desc.setColorAttachments({color_att});
+    target.rt.reset(m_rhi->newTextureRenderTarget(rt_desc));
+
+    // Every target has the same attachment formats and sample count, so the
+    // first one's render pass descriptor — and the pipelines built against
+    // it — stay valid for all later ones.
+    if (!m_rp_desc)
+        m_rp_desc.reset(target.rt->newCompatibleRenderPassDescriptor());
+    target.rt->setRenderPassDescriptor(m_rp_desc.get());
+    if (!target.rt->create()) {
+        release_target(target);
+        return false;
+    }
+    target.size = size;
+    return true;
+}
+
+void RhiOffscreenContext::release_target(Target& target)
+{
+    target.rt.reset();
+    target.resolve_tex.reset();
+    target.color_tex.reset();
+    target.size = {};
+}
+
+void RhiOffscreenContext::submit(int                                 w,
+                                 int                                 h,
+                                 std::shared_ptr<const SceneBuffers> scene,
+                                 const QMatrix4x4&                   mvp,
+                                 const rectangle&                    visible_world,
+                                 QImage                              overlay,
+                                 QColor                              bg,
+                                 image_sink_fn                       sink)
+{
+    m_queue.push_back({QSize(w, h), std::move(scene), mvp, visible_world,
+                       std::move(overlay), bg, std::move(sink)});
+    if (m_queue.size() >= kRingSize)
+        flush();
+}
+
+void RhiOffscreenContext::flush()
+{
+    if (m_queue.empty())
+        return;
+    // Taken first: a sink may submit the next frames.
+    std::vector<PendingFrame> frames;
+    frames.swap(m_queue);
+
+    bool ok = m_rhi != nullptr;
+    for (std::size_t i = 0; ok && i < frames.size(); ++i)
+        ok = ensure_target(m_targets[i], frames[i].size);
+
+    // Built once: the same pipeline code used by the widget, with one
+    // frame slot per ring entry. The CPU scene is not kept between images;
+    // the caller holds it.
+    if (ok && !m_renderer) {
+        m_renderer = std::make_unique<RhiSceneRenderer>();
+        m_renderer->set_retain_cpu_scene(false);
+        m_renderer->initialize(m_rhi.get(), m_rp_desc.get(), int(kRingSize));
+    }
+
+    QRhiCommandBuffer* cb = nullptr;
+    if (!ok || m_rhi->beginOffscreenFrame(&cb) != QRhi::FrameOpSuccess) {
+        for (PendingFrame& frame : frames)
+            frame.sink({});
+        return;
+    }
+
+    std::array<QRhiReadbackResult, kRingSize> readbacks;
+    for (std::size_t i = 0; i < frames.size(); ++i) {
+        const PendingFrame& frame = frames[i];
+        // The renderer drops its CPU copy after the upload but keeps the
+        // device-local pools, so a scene seen last time is drawn from VRAM.
+        // A new scene gets fresh pools, and the old ones stay alive until
+        // the frames of this batch that still read them are done.
+        const bool geom_dirty = !frame.scene || m_uploaded_scene.lock() != frame.scene;
+        m_uploaded_scene      = frame.scene;
+        m_renderer->render(cb, m_targets[i].rt.get(), frame.size,
+                           /*frame_slot=*/int(i), geom_dirty,
+                           frame.scene, frame.mvp, frame.visible_world,
+                           OverlayFrame{frame.overlay, frame.mvp, /*serial=*/0, {}}, frame.bg);
+
+        // Pixel readback — from the resolved (single-sample) texture, not the MSAA one.
+        QRhiResourceUpdateBatch* rb = m_rhi->nextResourceUpdateBatch();
+        rb->readBackTexture({m_targets[i].resolve_tex.get()}, &readbacks[i]);
+        cb->resourceUpdate(rb);
+    }
+
+    // The one wait of the batch.
+    m_rhi->endOffscreenFrame();
+
+    for (std::size_t i = 0; i < frames.size(); ++i) {
+        const QSize size = frames[i].size;
+        if (readbacks[i].data.isEmpty()) {
+            frames[i].sink({});
+            continue;
+        }
+        QImage result(reinterpret_cast<const uchar*>(readbacks[i].data.constData()),
+                      size.width(), size.height(), QImage::Format_RGBA8888);
+        // OpenGL-style backends report Y-up framebuffer coordinates, so the raw
+        // readback rows are bottom-to-top relative to QImage's top-down layout.
+        // Mirror vertically in that case; D3D/Metal/Vulkan are already top-down.
+        frames[i].sink(m_rhi->isYUpInFramebuffer() ? result.flipped(Qt::Vertical)
+                                                   : result.copy());
+    }
+}
+
+QImage RhiOffscreenContext::render(int                                 w,
+                                   int                                 h,
+                                   std::shared_ptr<const SceneBuffers> scene,
+                                   const QMatrix4x4&                   mvp,
+                                   const rectangle&                    visible_world,
+                                   const QImage&                       overlay,
+                                   QColor                              bg)
+{
+    QImage image;
+    submit(w, h, std::move(scene), mvp, visible_world, overlay, bg,
+           [&image](QImage result) { image = std::move(result); });
+    flush();
+    return image;
+}
+
+} // namespace ezgl
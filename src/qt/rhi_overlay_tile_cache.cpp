@@ -0,0 +1,345 @@
+#include "ezgl/qt/rhi_overlay_tile_cache.hpp"
+#include "ezgl/qt/render_backend.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+#include <rhi/qrhi.h>
+#include <rhi/qshader.h>
+
+namespace {
+
+struct TileVertex { float x, y, u, v; };
+static_assert(sizeof(TileVertex) == 16, "TileVertex must be 16 bytes");
+
+constexpr std::size_t kQuadBytes = 4 * sizeof(TileVertex);
+
+// Tiles of another epoch only stand in after every tile of the current one.
+constexpr int kStaleFallbackPenalty = 1 << 20;
+
+bool overlaps(const ezgl::rectangle& a, const ezgl::rectangle& b)
+{
+    return a.left() < b.right() && b.left() < a.right()
+        && a.bottom() < b.top() && b.bottom() < a.top();
+}
+
+// Framebuffer-pixel rectangle (bottom-left origin, as QRhiScissor wants it)
+// of `world` under `mvp`, clipped to the render target. False if empty.
+bool world_to_scissor(const ezgl::rectangle& world, const QMatrix4x4& mvp,
+                      const QSize& pixel_size, int out[4])
+{
+    const QPointF a = mvp.map(QPointF(world.left(),  world.bottom()));
+    const QPointF b = mvp.map(QPointF(world.right(), world.top()));
+    const double  w = pixel_size.width();
+    const double  h = pixel_size.height();
+    const double  x0 = std::clamp((std::min(a.x(), b.x()) + 1.0) * 0.5 * w, 0.0, w);
+    const double  x1 = std::clamp((std::max(a.x(), b.x()) + 1.0) * 0.5 * w, 0.0, w);
+    const double  y0 = std::clamp((std::min(a.y(), b.y()) + 1.0) * 0.5 * h, 0.0, h);
+    const double  y1 = std::clamp((std::max(a.y(), b.y()) + 1.0) * 0.5 * h, 0.0, h);
+    out[0] = int(std::floor(x0));
+    out[1] = int(std::floor(y0));
+    out[2] = int(std::ceil(x1)) - out[0];
+    out[3] = int(std::ceil(y1)) - out[1];
+    return out[2] > 0 && out[3] > 0;
+}
+
+// TriangleStrip quad over `world`, image top-left at the world's top-left.
+void write_quad(TileVertex* quad, const ezgl::rectangle& world, const QMatrix4x4& mvp)
+{
+    const QPointF tl = mvp.map(QPointF(world.left(),  world.top()));
+    const QPointF br = mvp.map(QPointF(world.right(), world.bottom()));
+    quad[0] = {float(tl.x()), float(tl.y()), 0.0f, 0.0f};
+    quad[1] = {float(tl.x()), float(br.y()), 0.0f, 1.0f};
+    quad[2] = {float(br.x()), float(tl.y()), 1.0f, 0.0f};
+    quad[3] = {float(br.x()), float(br.y()), 1.0f, 1.0f};
+}
+
+} // anonymous namespace
+
+namespace ezgl {
+
+RhiOverlayTileCache::~RhiOverlayTileCache()
+{
+    release();
+}
+
+void RhiOverlayTileCache::initialize(QRhi*                       rhi,
+                                     QRhiRenderPassDescriptor*   rp_desc,
+                                     int                         frame_slots,
+                                     const QShader&              vs,
+                                     const QShader&              fs,
+                                     QRhiShaderResourceBindings* layout_srb)
+{
+    release();
+    m_rhi = rhi;
+
+    // Clamp, not Repeat: a tile's edge texels must not pick up the
+    // opposite edge under linear filtering.
+    m_sampler.reset(rhi->newSampler(
+        QRhiSampler::Linear, QRhiSampler::Linear, QRhiSampler::None,
+        QRhiSampler::ClampToEdge, QRhiSampler::ClampToEdge));
+    m_sampler->create();
+
+    m_slots.resize(std::size_t(std::max(1, frame_slots)));
+
+    QRhiVertexInputLayout layout;
+    layout.setBindings({ QRhiVertexInputBinding(sizeof(TileVertex)) });
+    layout.setAttributes({
+        QRhiVertexInputAttribute(0, 0, QRhiVertexInputAttribute::Float2,
+                                 offsetof(TileVertex, x)),
+        QRhiVertexInputAttribute(0, 1, QRhiVertexInputAttribute::Float2,
+                                 offsetof(TileVertex, u))
+    });
+
+    QRhiGraphicsPipeline::TargetBlend blend;
+    blend.enable   = true;
+    blend.srcColor = QRhiGraphicsPipeline::One;             // premultiplied tiles
+    blend.dstColor = QRhiGraphicsPipeline::OneMinusSrcAlpha;
+    blend.srcAlpha = QRhiGraphicsPipeline::One;
+    blend.dstAlpha = QRhiGraphicsPipeline::OneMinusSrcAlpha;
+
+    m_pso.reset(rhi->newGraphicsPipeline());
+    m_pso->setFlags(QRhiGraphicsPipeline::UsesScissor);
+    m_pso->setTopology(QRhiGraphicsPipeline::TriangleStrip);
+    m_pso->setVertexInputLayout(layout);
+    m_pso->setShaderStages({{ QRhiShaderStage::Vertex, vs }, { QRhiShaderStage::Fragment, fs }});
+    m_pso->setShaderResourceBindings(layout_srb);
+    m_pso->setRenderPassDescriptor(rp_desc);
+    m_pso->setTargetBlends({ blend });
+    m_pso->setDepthTest(false);
+    m_pso->setDepthWrite(false);
+    m_pso->setSampleCount(EZGL_RHI_SAMPLE_COUNT);
+    m_pso->create();
+}
+
+void RhiOverlayTileCache::release()
+{
+    // Only called with the QRhi idle (re-initialize or teardown), so the
+    // tiles can go right away.
+    m_entries.clear();
+    m_incoming.clear();
+    m_evicted.clear();
+    m_slots.clear();
+    m_pso.reset();
+    m_sampler.reset();
+    m_resident_bytes = 0;
+    m_rhi            = nullptr;
+}
+
+void RhiOverlayTileCache::add(std::vector<OverlayTile> tiles)
+{
+    if (m_incoming.empty())
+        m_incoming = std::move(tiles);
+    else
+        m_incoming.insert(m_incoming.end(), std::make_move_iterator(tiles.begin()),
+                          std::make_move_iterator(tiles.end()));
+}
+
+std::vector<OverlayTileKey> RhiOverlayTileCache::take_evicted()
+{
+    return std::exchange(m_evicted, {});
+}
+
+void RhiOverlayTileCache::prepare(QRhiResourceUpdateBatch* u,
+                                  int                      frame_slot,
+                                  const OverlayTileView&   view,
+                                  const QMatrix4x4&        mvp,
+                                  const QSize&             pixel_size)
+{
+    if (!m_rhi || m_slots.empty())
+        return;
+    SlotResources& slot = m_slots[std::size_t(frame_slot) % m_slots.size()];
+    slot.draws.clear();
+    ++m_frame;
+
+    if (view.epoch == 0) {
+        clear();
+        return;
+    }
+    m_epoch = std::max(m_epoch, view.epoch);
+
+    for (OverlayTile& tile : m_incoming) {
+        m_epoch = std::max(m_epoch, tile.epoch);
+        if (tile.epoch == m_epoch)
+            upload(u, tile);
+    }
+    m_incoming.clear();
+
+    // ---- What to draw ------------------------------------------------------
+    std::vector<TileVertex> vertices;
+    vertices.reserve(view.visible.size() * 4);
+    auto add_draw = [&](Entry& entry, const int scissor[4]) {
+        entry.last_used_frame = m_frame;
+        Draw d;
+        d.srb = entry.srb.get();
+        std::copy(scissor, scissor + 4, d.scissor);
+        slot.draws.push_back(d);
+        vertices.resize(vertices.size() + 4);
+        write_quad(vertices.data() + vertices.size() - 4, entry.world, mvp);
+    };
+
+    const int full[4] = {0, 0, pixel_size.width(), pixel_size.height()};
+    bool complete = view.epoch == m_epoch;
+    for (const OverlayTileView::Slot& want : view.visible) {
+        auto it = m_entries.find(want.key);
+        if (it != m_entries.end() && it->second.epoch == m_epoch) {
+            add_draw(it->second, full);
+            continue;
+        }
+        complete = false;
+
+        // Missing: borrow the best-matching resident tiles, scissored to
+        // the slot so nothing is drawn twice.
+        int scissor[4];
+        if (!world_to_scissor(want.world, mvp, pixel_size, scissor))
+            continue;
+        // Current-epoch tiles of the slot's own level are its neighbours.
+        constexpr int kNoMatch = std::numeric_limits<int>::max();
+        auto score = [&](const OverlayTileKey& key, const Entry& entry) {
+            const bool stale = entry.epoch != m_epoch;
+            if ((!stale && key.level == want.key.level) || !overlaps(entry.world, want.world))
+                return kNoMatch;
+            return (stale ? kStaleFallbackPenalty : 0) + std::abs(key.level - want.key.level);
+        };
+        int best = kNoMatch;
+        for (const auto& [key, entry] : m_entries)
+            best = std::min(best, score(key, entry));
+        if (best == kNoMatch)
+            continue;
+        for (auto& [key, entry] : m_entries) {
+            if (score(key, entry) == best)
+                add_draw(entry, scissor);
+        }
+    }
+
+    // Stale tiles only ever stand in; once the view is whole they are dead.
+    if (complete) {
+        for (auto it = m_entries.begin(); it != m_entries.end();) {
+            if (it->second.epoch != m_epoch)
+                it = retire(it);
+            else
+                ++it;
+        }
+    }
+    evict_to_budget();
+
+    // ---- Quads --------------------------------------------------------------
+    if (vertices.empty())
+        return;
+    const std::size_t bytes = vertices.size() * sizeof(TileVertex);
+    if (!slot.vbuf || std::size_t(slot.vbuf->size()) < bytes) {
+        std::size_t capacity = slot.vbuf ? std::size_t(slot.vbuf->size()) : 64 * kQuadBytes;
+        while (capacity < bytes)
+            capacity *= 2;
+        if (QRhiBuffer* old = slot.vbuf.release())
+            old->deleteLater();
+        slot.vbuf.reset(m_rhi->newBuffer(QRhiBuffer::Dynamic, QRhiBuffer::VertexBuffer, int(capacity)));
+        slot.vbuf->create();
+    }
+    u->updateDynamicBuffer(slot.vbuf.get(), 0, int(bytes), vertices.data());
+}
+
+void RhiOverlayTileCache::draw(QRhiCommandBuffer* cb, int frame_slot) const
+{
+    if (m_slots.empty())
+        return;
+    const SlotResources& slot = m_slots[std::size_t(frame_slot) % m_slots.size()];
+    if (slot.draws.empty())
+        return;
+
+    cb->setGraphicsPipeline(m_pso.get());
+    for (std::size_t i = 0; i < slot.draws.size(); ++i) {
+        const Draw& d = slot.draws[i];
+        cb->setScissor(QRhiScissor(d.scissor[0], d.scissor[1], d.scissor[2], d.scissor[3]));
+        cb->setShaderResources(d.srb);
+        const QRhiCommandBuffer::VertexInput vi{slot.vbuf.get(), quint32(i * kQuadBytes)};
+        cb->setVertexInput(0, 1, &vi);
+        cb->draw(4);
+    }
+}
+
+void RhiOverlayTileCache::upload(QRhiResourceUpdateBatch* u, OverlayTile& tile)
+{
+    if (tile.image.isNull())
+        return;
+
+    auto it = m_entries.find(tile.key);
+    if (it != m_entries.end())
+        retire(it); // a stale copy, or a duplicate that raced the request
+
+    Entry entry;
+    entry.texture.reset(m_rhi->newTexture(QRhiTexture::RGBA8, tile.image.size()));
+    entry.texture->create();
+    entry.srb.reset(m_rhi->newShaderResourceBindings());
+    entry.srb->setBindings({
+        QRhiShaderResourceBinding::sampledTexture(
+            0, QRhiShaderResourceBinding::FragmentStage,
+            entry.texture.get(), m_sampler.get())
+    });
+    entry.srb->create();
+    u->uploadTexture(entry.texture.get(),
+                     tile.image.convertToFormat(QImage::Format_RGBA8888_Premultiplied));
+
+    entry.world           = tile.world;
+    entry.epoch           = tile.epoch;
+    entry.last_used_frame = m_frame;
+    entry.bytes           = std::size_t(tile.image.width()) * std::size_t(tile.image.height()) * 4;
+    m_resident_bytes += entry.bytes;
+    m_entries.emplace(tile.key, std::move(entry));
+}
+
+RhiOverlayTileCache::EntryMap::iterator RhiOverlayTileCache::retire(EntryMap::iterator it)
+{
+    // Frames still in flight may sample the texture; QRhi frees it once
+    // they have retired.
+    Entry& entry = it->second;
+    if (QRhiShaderResourceBindings* srb = entry.srb.release())
+        srb->deleteLater();
+    if (QRhiTexture* texture = entry.texture.release())
+        texture->deleteLater();
+    m_resident_bytes -= entry.bytes;
+    return m_entries.erase(it);
+}
+
+void RhiOverlayTileCache::clear()
+{
+    for (auto it = m_entries.begin(); it != m_entries.end();)
+        it = retire(it);
+    m_incoming.clear();
+    m_evicted.clear();
+}
+
+void RhiOverlayTileCache::evict_to_budget()
+{
+    if (m_resident_bytes <= m_budget_bytes)
+        return;
+
+    // Least recently drawn first; stale tiles before current ones.
+    std::vector<std::pair<std::uint64_t, OverlayTileKey>> order;
+    order.reserve(m_entries.size());
+    for (const auto& [key, entry] : m_entries) {
+        if (entry.last_used_frame == m_frame)
+            continue;
+        const std::uint64_t rank = entry.epoch == m_epoch ? entry.last_used_frame : 0;
+        order.emplace_back(rank, key);
+    }
+    std::sort(order.begin(), order.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+    });
+
+    for (const auto& [rank, key] : order) {
+        if (m_resident_bytes <= m_budget_bytes)
+            break;
+        auto it = m_entries.find(key);
+        if (it->second.epoch == m_epoch)
+            m_evicted.push_back(key);
+        retire(it);
+    }
+}
+
+} // namespace ezgl
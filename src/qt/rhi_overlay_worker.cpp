@@ -0,0 +1,436 @@
+#include "ezgl/qt/rhi_overlay_worker.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+namespace ezgl {
+
+// Physical pixel size for an overlay QImage that pairs with a logical-size
+// `logical` framebuffer at device pixel ratio `dpr`. With this size + a
+// matching QImage::setDevicePixelRatio(dpr), QPainter accepts logical
+// coordinates as before but rasterizes glyphs at the framebuffer's physical
+// resolution, and the GPU blit to the framebuffer becomes 1:1 (no upscale).
+static QSize physical_overlay_size(QSize logical, qreal dpr)
+{
+    return {std::max(1, int(std::lround(logical.width()  * dpr))),
+            std::max(1, int(std::lround(logical.height() * dpr)))};
+}
+
+// Two world extents that a pan leaves untouched compare equal; a zoom by
+// even one part in 10^9 does not.
+static bool same_extent(double a, double b)
+{
+    return std::fabs(a - b) <= 1e-9 * std::max(std::fabs(a), std::fabs(b));
+}
+
+// Copy `src` into the transparent `dst` (same size and format) moved by
+// (dx, dy) device pixels; pixels moved out of the image are dropped.
+static void shift_pixels(const QImage& src, QImage& dst, int dx, int dy)
+{
+    const int w   = src.width();
+    const int h   = src.height();
+    const int bpp = src.depth() / 8;
+    const int dst_x = std::max(0, dx);
+    const int src_x = dst_x - dx;
+    const int count = w - std::abs(dx);
+    for (int y = std::max(0, dy); y < std::min(h, h + dy); ++y) {
+        std::memcpy(dst.scanLine(y) + std::size_t(dst_x) * bpp,
+                    src.constScanLine(y - dy) + std::size_t(src_x) * bpp,
+                    std::size_t(count) * bpp);
+    }
+}
+
+// ---- OverlayTileGrid -------------------------------------------------------
+
+OverlayTileGrid OverlayTileGrid::for_camera(const camera& cam, qreal dpr)
+{
+    const rectangle world  = cam.get_world();
+    const rectangle screen = cam.get_screen();
+    const double    px_x   = screen.width()  / world.width()  * dpr;
+    const double    px_y   = screen.height() / world.height() * dpr;
+
+    OverlayTileGrid grid;
+    grid.level          = int(std::lround(std::log2(px_x) * kLevelsPerOctave));
+    grid.px_per_world_x = std::exp2(double(grid.level) / kLevelsPerOctave);
+    grid.px_per_world_y = grid.px_per_world_x * (px_y / px_x);
+    return grid;
+}
+
+bool OverlayTileGrid::fits(const camera& cam, qreal dpr)
+{
+    const rectangle screen = cam.get_screen();
+    return screen.width() * dpr >= kTilePx && screen.height() * dpr >= kTilePx;
+}
+
+rectangle OverlayTileGrid::tile_world(const OverlayTileKey& key) const
+{
+    const double w = tile_width();
+    const double h = tile_height();
+    return {{double(key.x) * w, double(key.y) * h}, w, h};
+}
+
+std::vector<OverlayTileKey> OverlayTileGrid::tiles_covering(const rectangle& world, int margin) const
+{
+    const double w  = tile_width();
+    const double h  = tile_height();
+    const auto   x0 = std::int64_t(std::floor(world.left()   / w)) - margin;
+    const auto   x1 = std::int64_t(std::floor(world.right()  / w)) + margin;
+    const auto   y0 = std::int64_t(std::floor(world.bottom() / h)) - margin;
+    const auto   y1 = std::int64_t(std::floor(world.top()    / h)) + margin;
+
+    std::vector<OverlayTileKey> keys;
+    keys.reserve(std::size_t((x1 - x0 + 1) * (y1 - y0 + 1)));
+    for (std::int64_t y = y0; y <= y1; ++y) {
+        for (std::int64_t x = x0; x <= x1; ++x)
+            keys.push_back({level, x, y});
+    }
+
+    // Distance in tiles from the centre of `world`.
+    const double cx = world.center().x / w - 0.5;
+    const double cy = world.center().y / h - 0.5;
+    auto distance = [cx, cy](const OverlayTileKey& k) {
+        const double dx = double(k.x) - cx;
+        const double dy = double(k.y) - cy;
+        return dx * dx + dy * dy;
+    };
+    std::stable_sort(keys.begin(), keys.end(), [&](const OverlayTileKey& a, const OverlayTileKey& b) {
+        return distance(a) < distance(b);
+    });
+    return keys;
+}
+
+// ---- RhiOverlayLayer -------------------------------------------------------
+
+RhiOverlayLayer::RhiOverlayLayer(const camera& live_camera)
+    : measure_surface(1, 1, QImage::Format_ARGB32_Premultiplied)
+    , measure_painter(&measure_surface)
+    , cam(live_camera)
+{
+    using namespace std::placeholders;
+    recorder = std::make_unique<deferred_renderer>(
+        &measure_painter,
+        std::bind(&camera::world_to_screen, &cam, _1),
+        &cam,
+        &measure_surface);
+}
+
+// ---- RhiOverlayWorker ------------------------------------------------------
+
+RhiOverlayWorker::RhiOverlayWorker(deliver_fn deliver, deliver_tile_fn deliver_tile)
+    : m_deliver(std::move(deliver))
+    , m_deliver_tile(std::move(deliver_tile))
+    , m_thread(&RhiOverlayWorker::run, this)
+{
+}
+
+RhiOverlayWorker::~RhiOverlayWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        drop_pending_locked();
+        drop_tiles_locked();
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    m_thread.join();
+}
+
+void RhiOverlayWorker::post(Job job)
+{
+    job.layer->queued_jobs.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        drop_pending_locked();
+        m_pending.emplace(std::move(job));
+    }
+    m_wake.notify_one();
+}
+
+void RhiOverlayWorker::post_tiles(TileJob job)
+{
+    if (job.keys.empty()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        drop_tiles_locked();
+        return;
+    }
+    job.layer->queued_jobs.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        drop_tiles_locked();
+        m_tiles.emplace(std::move(job));
+        m_next_tile = 0;
+    }
+    m_wake.notify_one();
+}
+
+void RhiOverlayWorker::cancel_pending()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    drop_pending_locked();
+    drop_tiles_locked();
+}
+
+void RhiOverlayWorker::quiesce()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    drop_pending_locked();
+    drop_tiles_locked();
+    m_idle.wait(lock, [this]() { return !m_busy; });
+}
+
+void RhiOverlayWorker::drain()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this]() { return !m_busy && !m_pending && !m_tiles; });
+}
+
+void RhiOverlayWorker::drop_pending_locked()
+{
+    if (!m_pending)
+        return;
+    m_pending->layer->queued_jobs.fetch_sub(1, std::memory_order_release);
+    m_pending.reset();
+}
+
+void RhiOverlayWorker::drop_tiles_locked()
+{
+    if (!m_tiles)
+        return;
+    m_tiles->layer->queued_jobs.fetch_sub(1, std::memory_order_release);
+    m_tiles.reset();
+    m_next_tile = 0;
+}
+
+void RhiOverlayWorker::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wake.wait(lock, [this]() { return m_stop || m_pending.has_value() || m_tiles.has_value(); });
+        if (m_stop)
+            return;
+
+        if (m_pending) {
+            Job job = std::move(*m_pending);
+            m_pending.reset();
+            m_busy = true;
+            lock.unlock();
+
+            QImage        overlay;
+            QImage        screen;
+            QMatrix4x4    overlay_mvp  = job.mvp;
+            camera        laid_out_for = job.cam;
+            OverlayUpdate update;
+            if (job.space != overlay_space::screen
+                && !rasterize_shifted(job, overlay, overlay_mvp, laid_out_for, update))
+                overlay = rasterize(*job.layer, job.cam, job.logical_size, job.dpr, overlay_space::world);
+            // SCREEN content only depends on the layout, not on the camera.
+            if (job.space == overlay_space::all && same_layout(job))
+                screen = m_previous->screen;
+            else if (job.space != overlay_space::world)
+                screen = rasterize(*job.layer, job.cam, job.logical_size, job.dpr, overlay_space::screen);
+            // Only a full overlay can be shifted by the next job.
+            if (job.space == overlay_space::all)
+                m_previous.emplace(Previous{job.layer, job.revision, laid_out_for,
+                                            job.logical_size, job.dpr, overlay, screen});
+            else
+                m_previous.reset();
+
+            // Release the layer before delivering: once the image exists the
+            // GUI thread is free to record into this layer again.
+            job.layer->queued_jobs.fetch_sub(1, std::memory_order_release);
+            job.layer.reset();
+            m_deliver(std::move(overlay), std::move(screen), overlay_mvp, update);
+        } else {
+            // One tile per pass, so anything posted meanwhile is picked up
+            // before the next tile. The running tile holds its own count on
+            // the layer: the list may be replaced while it is painted.
+            const TileJob&                   tiles = *m_tiles;
+            const OverlayTileKey             key   = tiles.keys[m_next_tile++];
+            std::shared_ptr<RhiOverlayLayer> layer = tiles.layer;
+            const camera                     cam   = tiles.cam;
+            const OverlayTileGrid            grid  = tiles.grid;
+            const qreal                      dpr   = tiles.dpr;
+            const std::uint64_t              epoch = tiles.epoch;
+            layer->queued_jobs.fetch_add(1, std::memory_order_relaxed);
+            if (m_next_tile == tiles.keys.size())
+                drop_tiles_locked();
+            m_busy = true;
+            lock.unlock();
+
+            OverlayTile tile{key, grid.tile_world(key), epoch,
+                             rasterize_tile(*layer, cam, grid, key, dpr)};
+            layer->queued_jobs.fetch_sub(1, std::memory_order_release);
+            layer.reset();
+            if (m_deliver_tile)
+                m_deliver_tile(std::move(tile));
+        }
+
+        lock.lock();
+        m_busy = false;
+        m_idle.notify_all();
+    }
+}
+
+bool RhiOverlayWorker::same_layout(const Job& job) const
+{
+    return m_previous
+        && m_previous->layer.lock() == job.layer
+        && m_previous->revision == job.revision
+        && m_previous->logical_size == job.logical_size
+        && m_previous->dpr == job.dpr
+        && m_previous->cam.get_screen() == job.cam.get_screen();
+}
+
+bool RhiOverlayWorker::rasterize_shifted(const Job&     job,
+                                         QImage&        overlay,
+                                         QMatrix4x4&    overlay_mvp,
+                                         camera&        laid_out_for,
+                                         OverlayUpdate& update)
+{
+    if (job.space != overlay_space::all || !same_layout(job))
+        return false;
+
+    const rectangle from = m_previous->cam.get_world();
+    const rectangle to   = job.cam.get_world();
+    if (!same_extent(from.width(), to.width()) || !same_extent(from.height(), to.height()))
+        return false;
+
+    // Content motion in device pixels. Panning the world right moves the
+    // content left; panning it up moves the content down (widget y grows
+    // downwards).
+    const QImage&   previous  = m_previous->image;
+    const rectangle screen    = job.cam.get_screen();
+    const double    px_per_x  = screen.width()  / to.width()  * job.dpr;
+    const double    px_per_y  = screen.height() / to.height() * job.dpr;
+    const double    shift_x   = -(to.left()   - from.left())   * px_per_x;
+    const double    shift_y   =  (to.bottom() - from.bottom()) * px_per_y;
+    if (!(std::fabs(shift_x) < previous.width()) || !(std::fabs(shift_y) < previous.height()))
+        return false;
+
+    const int dx = int(std::lround(shift_x));
+    const int dy = int(std::lround(shift_y));
+    const int w  = previous.width();
+    const int h  = previous.height();
+
+    // Lay the image out for the camera at the rounded position, so the
+    // retained pixels and the repainted strips line up exactly.
+    camera snapped = job.cam;
+    snapped.set_world(from + point2d(-dx / px_per_x, dy / px_per_y));
+
+    QImage out(previous.size(), previous.format());
+    out.setDevicePixelRatio(job.dpr);
+    out.fill(Qt::transparent);
+    shift_pixels(previous, out, dx, dy);
+
+    std::vector<QRect> exposed;
+    if (dx > 0)
+        exposed.emplace_back(0, 0, dx, h);
+    else if (dx < 0)
+        exposed.emplace_back(w + dx, 0, -dx, h);
+    const int kept_x = std::max(0, dx);
+    const int kept_w = w - std::abs(dx);
+    if (dy > 0)
+        exposed.emplace_back(kept_x, 0, kept_w, dy);
+    else if (dy < 0)
+        exposed.emplace_back(kept_x, h + dy, kept_w, -dy);
+
+    if (!exposed.empty()) {
+        RhiOverlayLayer& layer = *job.layer;
+        layer.cam = snapped;
+        {
+            Painter painter(&out);
+            painter.setAntialias(false);
+            painter.setSmoothPixmap(false);
+            layer.recorder->set_painter_surface(&painter, &out);
+            for (const QRect& r : exposed) {
+                layer.recorder->replay_overlay(QRectF(r.x() / job.dpr, r.y() / job.dpr,
+                                                      r.width() / job.dpr, r.height() / job.dpr),
+                                               overlay_space::world);
+            }
+            painter.end();
+        }
+        layer.recorder->set_painter_surface(&layer.measure_painter, &layer.measure_surface);
+    }
+
+    // mvp_snapped(p) == mvp(p - (snapped - to)) for a pure translation.
+    const rectangle snapped_world = snapped.get_world();
+    overlay_mvp = job.mvp;
+    overlay_mvp.translate(float(to.left() - snapped_world.left()),
+                          float(to.bottom() - snapped_world.bottom()));
+
+    overlay            = std::move(out);
+    laid_out_for       = snapped;
+    update.incremental = true;
+    update.shift       = QPoint(dx, dy);
+    update.exposed     = std::move(exposed);
+    return true;
+}
+
+QImage RhiOverlayWorker::rasterize(RhiOverlayLayer& layer,
+                                   const camera&    cam,
+                                   QSize            logical_size,
+                                   qreal            dpr,
+                                   overlay_space    space)
+{
+    layer.cam = cam;
+
+    // QImage::setDevicePixelRatio must be set BEFORE the Painter begins so
+    // QPainter sees logical coordinates while rasterizing at physical
+    // resolution.
+    QImage overlay(physical_overlay_size(logical_size, dpr),
+                   QImage::Format_ARGB32_Premultiplied);
+    overlay.setDevicePixelRatio(dpr);
+    overlay.fill(Qt::transparent);
+
+    {
+        Painter painter(&overlay);
+        painter.setAntialias(false);
+        painter.setSmoothPixmap(false);
+        layer.recorder->set_painter_surface(&painter, &overlay);
+        layer.recorder->replay_overlay(space);
+        painter.end();
+    }
+    // Never leave the recorder pointing at a destroyed painter.
+    layer.recorder->set_painter_surface(&layer.measure_painter, &layer.measure_surface);
+    return overlay;
+}
+
+QImage RhiOverlayWorker::rasterize_tile(RhiOverlayLayer&       layer,
+                                        const camera&          cam,
+                                        const OverlayTileGrid& grid,
+                                        const OverlayTileKey&  key,
+                                        qreal                  dpr)
+{
+    // Keep the camera's screen rectangle (replay culls against it) but give
+    // it the grid's scale, with the tile's top-left corner at the screen's
+    // top-left corner. The painter then moves that corner to (0, 0).
+    const rectangle tile    = grid.tile_world(key);
+    const rectangle screen  = cam.get_screen();
+    const double    world_w = screen.width()  * dpr / grid.px_per_world_x;
+    const double    world_h = screen.height() * dpr / grid.px_per_world_y;
+    layer.cam = cam;
+    layer.cam.set_world({{tile.left(), tile.top() - world_h}, world_w, world_h});
+
+    QImage image(OverlayTileGrid::kTilePx, OverlayTileGrid::kTilePx,
+                 QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(dpr);
+    image.fill(Qt::transparent);
+
+    {
+        const double extent = OverlayTileGrid::kTilePx / dpr;
+        Painter painter(&image);
+        painter.setAntialias(false);
+        painter.setSmoothPixmap(false);
+        painter.translate(-screen.left(), -screen.bottom());
+        layer.recorder->set_painter_surface(&painter, &image);
+        layer.recorder->replay_overlay(QRectF(screen.left(), screen.bottom(), extent, extent),
+                                       overlay_space::world);
+        painter.end();
+    }
+    layer.recorder->set_painter_surface(&layer.measure_painter, &layer.measure_surface);
+    return image;
+}
+
+} // namespace ezgl
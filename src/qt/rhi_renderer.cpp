@@ -1,17 +1,23 @@
 #include "ezgl/qt/rhi_renderer.hpp"
 #include "ezgl/camera.hpp"
 #include "ezgl/logutils.hpp"
+#include "ezgl/qt/scene_snapshot.hpp"
+#include "ezgl/qt/triangulator.hpp"
 #include <functional>
 
+#include <QDataStream>
+#include <QMetaObject>
 #include <QtGlobal>
 
 #include <algorithm>
 #include <array>
+#include <bit>
 #include <cassert>
 #include <cmath>
 #include <cstdint>
 #include <limits>
 #include <thread>
+#include <unordered_set>
 
 namespace {
 
@@ -25,23 +31,6 @@ std::uint32_t pack_color_rgba(const ezgl::color& c)
          | (std::uint32_t(c.alpha) << 24);
 }
 
-struct Triangle {
-    ezgl::point2d a;
-    ezgl::point2d b;
-    ezgl::point2d c;
-};
-
-double signed_twice_area(const std::vector<ezgl::point2d>& polygon)
-{
-    double area = 0.0;
-    for (std::size_t i = 0; i < polygon.size(); ++i) {
-        const ezgl::point2d& p = polygon[i];
-        const ezgl::point2d& q = polygon[(i + 1) % polygon.size()];
-        area += p.x * q.y - q.x * p.y;
-    }
-    return area;
-}
-
 double cross(const ezgl::point2d& a,
              const ezgl::point2d& b,
              const ezgl::point2d& c)
@@ -49,21 +38,6 @@ double cross(const ezgl::point2d& a,
     return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
 }
 
-bool point_in_triangle(const ezgl::point2d& p,
-                       const ezgl::point2d& a,
-                       const ezgl::point2d& b,
-                       const ezgl::point2d& c)
-{
-    const double c0 = cross(a, b, p);
-    const double c1 = cross(b, c, p);
-    const double c2 = cross(c, a, p);
-    const bool non_negative =
-        c0 >= -kPolygonEpsilon && c1 >= -kPolygonEpsilon && c2 >= -kPolygonEpsilon;
-    const bool non_positive =
-        c0 <= kPolygonEpsilon && c1 <= kPolygonEpsilon && c2 <= kPolygonEpsilon;
-    return non_negative || non_positive;
-}
-
 std::vector<ezgl::point2d> normalized_polygon_points(const std::vector<ezgl::point2d>& input)
 {
     std::vector<ezgl::point2d> polygon;
@@ -128,81 +102,6 @@ static bool is_convex_polygon(const std::vector<ezgl::point2d>& pts)
     return true;
 }
 
-std::vector<Triangle> triangulate_simple_polygon(const std::vector<ezgl::point2d>& input)
-{
-    const std::vector<ezgl::point2d> polygon = normalized_polygon_points(input);
-    if (polygon.size() < 3)
-        return {};
-
-    const double area = signed_twice_area(polygon);
-    if (std::abs(area) <= kPolygonEpsilon)
-        return {};
-
-    const bool ccw = area > 0.0;
-    std::vector<std::size_t> remaining;
-    remaining.reserve(polygon.size());
-    for (std::size_t i = 0; i < polygon.size(); ++i)
-        remaining.push_back(i);
-
-    std::vector<Triangle> triangles;
-    triangles.reserve(polygon.size() - 2);
-
-    std::size_t guard = 0;
-    const std::size_t max_guard = polygon.size() * polygon.size();
-    while (remaining.size() > 3 && guard < max_guard) {
-        bool ear_found = false;
-        for (std::size_t i = 0; i < remaining.size(); ++i) {
-            const std::size_t prev = remaining[(i + remaining.size() - 1) % remaining.size()];
-            const std::size_t curr = remaining[i];
-            const std::size_t next = remaining[(i + 1) % remaining.size()];
-
-            const double corner_cross = cross(polygon[prev], polygon[curr], polygon[next]);
-            if ((ccw && corner_cross <= kPolygonEpsilon)
-                || (!ccw && corner_cross >= -kPolygonEpsilon)) {
-                continue;
-            }
-
-            bool contains_other_vertex = false;
-            for (std::size_t j = 0; j < remaining.size(); ++j) {
-                const std::size_t candidate = remaining[j];
-                if (candidate == prev || candidate == curr || candidate == next)
-                    continue;
-                if (point_in_triangle(polygon[candidate],
-                                      polygon[prev],
-                                      polygon[curr],
-                                      polygon[next])) {
-                    contains_other_vertex = true;
-                    break;
-                }
-            }
-            if (contains_other_vertex)
-                continue;
-
-            triangles.emplace_back(polygon[prev], polygon[curr], polygon[next]);
-            remaining.erase(remaining.begin() + std::ptrdiff_t(i));
-            ear_found = true;
-            break;
-        }
-
-        if (!ear_found)
-            break;
-        ++guard;
-    }
-
-    if (remaining.size() == 3) {
-        triangles.emplace_back(
-            polygon[remaining[0]],
-            polygon[remaining[1]],
-            polygon[remaining[2]]
-        );
-    }
-
-    if (triangles.size() != polygon.size() - 2)
-        return {};
-
-    return triangles;
-}
-
 ezgl::point2d intersect_vertical(const ezgl::point2d& a,
                                  const ezgl::point2d& b,
                                  double                x)
@@ -326,58 +225,48 @@ static QSize clamp_size(QSize s)
     return {std::max(1, s.width()), std::max(1, s.height())};
 }
 
-// Physical pixel size for an overlay QImage that pairs with a logical-size
-// `logical` framebuffer at device pixel ratio `dpr`. With this size + a
-// matching QImage::setDevicePixelRatio(dpr), QPainter accepts logical
-// coordinates as before but rasterizes glyphs at the framebuffer's physical
-// resolution, and the GPU blit to the framebuffer becomes 1:1 (no upscale).
-static QSize physical_overlay_size(QSize logical, qreal dpr)
-{
-    return {std::max(1, int(std::lround(logical.width()  * dpr))),
-            std::max(1, int(std::lround(logical.height() * dpr)))};
-}
-
 rhi_renderer::rhi_renderer(RhiCanvasWidget* widget,
                              transform_fn     transform,
                              camera*          cam,
                              draw_callback_fn draw_callback,
                              QColor           bg_color)
-    : irenderer(nullptr, transform, cam, nullptr)
+    : irenderer(nullptr, std::move(transform), cam, nullptr)
     , m_rhi_widget(widget)
     , m_size(clamp_size({widget->width(), widget->height()}))
     , m_overlay_dpr(widget->devicePixelRatioF())
     , m_bg_color(bg_color)
-    , m_overlay(physical_overlay_size(m_size, m_overlay_dpr),
-                QImage::Format_ARGB32_Premultiplied)
-    , m_overlay_painter(&m_overlay)
-    , m_overlay_deferred(std::make_unique<deferred_renderer>(
-          &m_overlay_painter,
-          std::move(transform),   // move the second copy into overlay renderer
-          cam,
-          &m_overlay))
+    , m_state_surface(1, 1, QImage::Format_ARGB32_Premultiplied)
+    , m_state_painter(&m_state_surface)
+    , m_overlay_layer(std::make_shared<RhiOverlayLayer>(*cam))
+    , m_overlay_worker(std::make_unique<RhiOverlayWorker>(
+          [widget](QImage overlay, QImage screen, const QMatrix4x4& overlay_mvp,
+                   const OverlayUpdate& update) {
+              widget->set_overlay(std::move(overlay), std::move(screen), overlay_mvp, update);
+              // Runs on the overlay worker thread; QWidget::update() must
+              // be called from the GUI thread.
+              QMetaObject::invokeMethod(widget, [widget]() { widget->update(); },
+                                        Qt::QueuedConnection);
+          },
+          [widget](OverlayTile tile) {
+              widget->add_overlay_tile(std::move(tile));
+              QMetaObject::invokeMethod(widget, [widget]() { widget->update(); },
+                                        Qt::QueuedConnection);
+          }))
 {
     (void)draw_callback;
-    // QImage::setDevicePixelRatio must be set BEFORE Painter begin() so the
-    // QPainter sees logical coordinates while rasterizing at physical
-    // resolution. We constructed m_overlay_painter on m_overlay in the
-    // initializer list, but the QImage carries DPR=1 by default; calling
-    // setDevicePixelRatio now is fine because no draws have happened yet.
-    m_overlay.setDevicePixelRatio(m_overlay_dpr);
   //    m_n_bands       = 1;
     m_n_bands       = int(std::max(1u, std::thread::hardware_concurrency()));
     m_rows_per_band = (kTileGridDimension + m_n_bands - 1) / m_n_bands;
     m_cmd_thin_lines.resize(m_n_bands);
     m_cmd_fill_rects.resize(m_n_bands);
     m_cmd_fill_tris.resize(m_n_bands);
+    m_cmd_fill_meshes.resize(m_n_bands);
     m_cmd_thick_lines.resize(m_n_bands);
     m_cmd_dashed_lines.resize(m_n_bands);
+    m_cmd_picks.resize(m_n_bands);
     ensure_tile_grid();
     clear_tile_geometry();
-    m_overlay_deferred->clear_overlay_and_batches();
-    m_overlay.fill(Qt::transparent);
-    update_painter(&m_overlay_painter, &m_overlay);
-    m_overlay_painter.setAntialias(false);
-    m_overlay_painter.setSmoothPixmap(false);
+    update_painter(&m_state_painter, &m_state_surface);
 }
 
 rhi_renderer::rhi_renderer(QSize            size,
@@ -385,34 +274,30 @@ rhi_renderer::rhi_renderer(QSize            size,
                              camera*          cam,
                              draw_callback_fn draw_callback,
                              QColor           bg_color)
-    : irenderer(nullptr, transform, cam, nullptr)
+    : irenderer(nullptr, std::move(transform), cam, nullptr)
     , m_rhi_widget(nullptr)
     , m_size(clamp_size(size))
     , m_overlay_dpr(1.0) // headless: caller passes raw pixel size, no DPR scaling
     , m_bg_color(bg_color)
-    , m_overlay(m_size, QImage::Format_ARGB32_Premultiplied)
-    , m_overlay_painter(&m_overlay)
-    , m_overlay_deferred(std::make_unique<deferred_renderer>(
-          &m_overlay_painter,
-          std::move(transform),
-          cam,
-          &m_overlay))
+    , m_state_surface(1, 1, QImage::Format_ARGB32_Premultiplied)
+    , m_state_painter(&m_state_surface)
+    , m_overlay_layer(std::make_shared<RhiOverlayLayer>(*cam))
 {
+    // No overlay worker: flush_capture() rasterizes the overlay inline
+    // because the caller needs the finished image immediately.
     (void)draw_callback;
     m_n_bands       = int(std::max(1u, std::thread::hardware_concurrency()));
     m_rows_per_band = (kTileGridDimension + m_n_bands - 1) / m_n_bands;
     m_cmd_thin_lines.resize(m_n_bands);
     m_cmd_fill_rects.resize(m_n_bands);
     m_cmd_fill_tris.resize(m_n_bands);
+    m_cmd_fill_meshes.resize(m_n_bands);
     m_cmd_thick_lines.resize(m_n_bands);
     m_cmd_dashed_lines.resize(m_n_bands);
+    m_cmd_picks.resize(m_n_bands);
     ensure_tile_grid();
     clear_tile_geometry();
-    m_overlay_deferred->clear_overlay_and_batches();
-    m_overlay.fill(Qt::transparent);
-    update_painter(&m_overlay_painter, &m_overlay);
-    m_overlay_painter.setAntialias(false);
-    m_overlay_painter.setSmoothPixmap(false);
+    update_painter(&m_state_painter, &m_state_surface);
 }
 
 // ---- irenderer: coordinate system / viewport ------------------------------
@@ -420,13 +305,13 @@ rhi_renderer::rhi_renderer(QSize            size,
 void rhi_renderer::set_coordinate_system(t_coordinate_system cs)
 {
     irenderer::set_coordinate_system(cs);
-    m_overlay_deferred->set_coordinate_system(cs);
+    overlay_recorder().set_coordinate_system(cs);
 }
 
 void rhi_renderer::set_visible_world(rectangle new_world)
 {
     irenderer::set_visible_world(new_world);
-    m_overlay_deferred->set_visible_world(new_world);
+    overlay_recorder().set_visible_world(new_world);
 }
 
 rectangle rhi_renderer::get_visible_world()
@@ -450,14 +335,14 @@ void rhi_renderer::set_color(color c)
 {
     irenderer::set_color(c);
     m_current_rgba = pack_color_rgba(current_color);
-    m_overlay_deferred->set_color(c);
+    overlay_recorder().set_color(c);
 }
 
 void rhi_renderer::set_color(color c, uint_fast8_t alpha)
 {
     irenderer::set_color(c, alpha);
     m_current_rgba = pack_color_rgba(current_color);
-    m_overlay_deferred->set_color(c, alpha);
+    overlay_recorder().set_color(c, alpha);
 }
 
 void rhi_renderer::set_color(uint_fast8_t r, uint_fast8_t g,
@@ -465,38 +350,38 @@ void rhi_renderer::set_color(uint_fast8_t r, uint_fast8_t g,
 {
     irenderer::set_color(r, g, b, a);
     m_current_rgba = pack_color_rgba(current_color);
-    m_overlay_deferred->set_color(r, g, b, a);
+    overlay_recorder().set_color(r, g, b, a);
 }
 
 void rhi_renderer::set_line_cap(line_cap cap)
 {
     irenderer::set_line_cap(cap);
-    m_overlay_deferred->set_line_cap(cap);
+    overlay_recorder().set_line_cap(cap);
 }
 
 void rhi_renderer::set_line_dash(line_dash dash)
 {
     irenderer::set_line_dash(dash);
-    m_overlay_deferred->set_line_dash(dash);
+    overlay_recorder().set_line_dash(dash);
 }
 
 void rhi_renderer::set_line_width(int width)
 {
     irenderer::set_line_width(width);
-    m_overlay_deferred->set_line_width(width);
+    overlay_recorder().set_line_width(width);
 }
 
 void rhi_renderer::set_font_size(double size)
 {
     irenderer::set_font_size(size);
-    m_overlay_deferred->set_font_size(size);
+    overlay_recorder().set_font_size(size);
 }
 
 void rhi_renderer::format_font(std::string const& family,
                                 font_slant slant, font_weight weight)
 {
     irenderer::format_font(family, slant, weight);
-    m_overlay_deferred->format_font(family, slant, weight);
+    overlay_recorder().format_font(family, slant, weight);
 }
 
 void rhi_renderer::format_font(std::string const& family,
@@ -504,31 +389,31 @@ void rhi_renderer::format_font(std::string const& family,
                                 double new_size)
 {
     irenderer::format_font(family, slant, weight, new_size);
-    m_overlay_deferred->format_font(family, slant, weight, new_size);
+    overlay_recorder().format_font(family, slant, weight, new_size);
 }
 
 void rhi_renderer::set_text_rotation(double degrees)
 {
     irenderer::set_text_rotation(degrees);
-    m_overlay_deferred->set_text_rotation(degrees);
+    overlay_recorder().set_text_rotation(degrees);
 }
 
 void rhi_renderer::set_horiz_justification(justification j)
 {
     irenderer::set_horiz_justification(j);
-    m_overlay_deferred->set_horiz_justification(j);
+    overlay_recorder().set_horiz_justification(j);
 }
 
 void rhi_renderer::set_vert_justification(justification j)
 {
     irenderer::set_vert_justification(j);
-    m_overlay_deferred->set_vert_justification(j);
+    overlay_recorder().set_vert_justification(j);
 }
 
 void rhi_renderer::set_text_screen_offset(point2d offset_px)
 {
     irenderer::set_text_screen_offset(offset_px);
-    m_overlay_deferred->set_text_screen_offset(offset_px);
+    overlay_recorder().set_text_screen_offset(offset_px);
 }
 
 // ---- irenderer: overlay draw calls ----------------------------------------
@@ -536,40 +421,60 @@ void rhi_renderer::set_text_screen_offset(point2d offset_px)
 void rhi_renderer::fill_poly(const std::vector<point2d>& points)
 {
     if (current_coordinate_system != WORLD) {
-        m_overlay_deferred->fill_poly(points);
+        overlay_recorder().fill_poly(points);
         return;
     }
-    if (m_skip_tile_writes)
+    if (skip_recording())
         return;
 
     assert(points.size() > 3 && "if points.size() == 3 use fill_triangle method instead, it's much faster");
 
     const StyleKey sk = current_style_key(PrimitiveType::FilledPoly);
-
-    auto push_tri = [&](const point2d& pa, const point2d& pb, const point2d& pc) {
-        const FillTriCmd cmd{sk,
-            float(pa.x), float(pa.y), float(pb.x), float(pb.y), float(pc.x), float(pc.y)};
-        const int b0 = band_for_tile_row(clamp_tile_y(std::min({pa.y, pb.y, pc.y})));
-        const int b1 = band_for_tile_row(clamp_tile_y(std::max({pa.y, pb.y, pc.y})));
-        for (int b = b0; b <= b1; ++b) m_cmd_fill_tris[b].push_back(cmd);
-    };
+    if (current_pick_id != 0) {
+        const auto [x_min, x_max] = std::minmax_element(points.begin(), points.end(),
+            [](const point2d& l, const point2d& r) { return l.x < r.x; });
+        const auto [y_min, y_max] = std::minmax_element(points.begin(), points.end(),
+            [](const point2d& l, const point2d& r) { return l.y < r.y; });
+        record_pick({x_min->x, y_min->y}, {x_max->x, y_max->y}, false);
+    }
 
     // Fast path: convex polygon — O(n) fan triangulation, zero intermediate allocs.
     if (is_convex_polygon(points)) {
-        for (std::size_t i = 1; i + 1 < points.size(); ++i)
-            push_tri(points[0], points[i], points[i + 1]);
+        push_fill_mesh(sk, points, nullptr);
         return;
     }
 
-    // General case: O(n²) ear-clipping for non-convex polygons.
-    const std::vector<Triangle> triangles = triangulate_simple_polygon(points);
-    if (triangles.empty()) {
-        qWarning("rhi_renderer: failed to triangulate polygon with %llu points",
-                 static_cast<unsigned long long>(points.size()));
+    // General case: earcut triangulation, reused across redraws while the
+    // polygon is unchanged.
+    const TriangulationEntry& entry = cached_triangulation(points, {});
+    if (!entry.indices.empty())
+        push_fill_mesh(sk, points, &entry.indices);
+}
+
+void rhi_renderer::fill_poly_with_holes(const std::vector<point2d>& outer,
+                                         const std::vector<std::vector<point2d>>& holes)
+{
+    if (current_coordinate_system != WORLD) {
+        overlay_recorder().fill_poly_with_holes(outer, holes);
         return;
     }
-    for (const Triangle& t : triangles)
-        push_tri(t.a, t.b, t.c);
+    if (skip_recording())
+        return;
+    if (current_pick_id != 0 && !outer.empty()) {
+        const auto [x_min, x_max] = std::minmax_element(outer.begin(), outer.end(),
+            [](const point2d& l, const point2d& r) { return l.x < r.x; });
+        const auto [y_min, y_max] = std::minmax_element(outer.begin(), outer.end(),
+            [](const point2d& l, const point2d& r) { return l.y < r.y; });
+        record_pick({x_min->x, y_min->y}, {x_max->x, y_max->y}, false);
+    }
+
+    const TriangulationEntry& entry = cached_triangulation(outer, holes);
+    if (entry.indices.empty())
+        return;
+    m_ring_scratch.assign(outer.begin(), outer.end());
+    for (const std::vector<point2d>& hole : holes)
+        m_ring_scratch.insert(m_ring_scratch.end(), hole.begin(), hole.end());
+    push_fill_mesh(current_style_key(PrimitiveType::FilledPoly), m_ring_scratch, &entry.indices);
 }
 
 void rhi_renderer::fill_arrow_pointer_triangle(const point2d& anchor_world,
@@ -579,7 +484,7 @@ void rhi_renderer::fill_arrow_pointer_triangle(const point2d& anchor_world,
     // Push one GPU instance and let the arrow vertex shader synthesise the
     // 3-vertex triangle at constant pixel size in screen space. The size
     // is encoded in the style key's line-width slot (reused for arrows).
-    if (m_skip_tile_writes)
+    if (skip_recording())
         return;
     const std::uint16_t size_packed =
         std::uint16_t(std::clamp(int(std::lround(arrow_size_px)), 0, 65535));
@@ -590,64 +495,70 @@ void rhi_renderer::fill_arrow_pointer_triangle(const point2d& anchor_world,
     m_cmd_arrows.push_back({sk,
                             float(anchor_world.x), float(anchor_world.y),
                             float(dir_world.x),    float(dir_world.y)});
+    record_pick(anchor_world, anchor_world, false);
 }
 
 void rhi_renderer::fill_triangle(const point2d& a, const point2d& b, const point2d& c)
 {
     if (current_coordinate_system != WORLD) {
-        m_overlay_deferred->fill_triangle(a, b, c);
+        overlay_recorder().fill_triangle(a, b, c);
         return;
     }
-    if (m_skip_tile_writes)
+    if (skip_recording())
         return;
-    const FillTriCmd cmd{current_style_key(PrimitiveType::FilledPoly),
-        float(a.x), float(a.y), float(b.x), float(b.y), float(c.x), float(c.y)};
-    const int b0 = band_for_tile_row(clamp_tile_y(std::min({a.y, b.y, c.y})));
-    const int b1 = band_for_tile_row(clamp_tile_y(std::max({a.y, b.y, c.y})));
-    for (int band = b0; band <= b1; ++band) m_cmd_fill_tris[band].push_back(cmd);
+    push_fill_tri(current_style_key(PrimitiveType::FilledPoly), a, b, c);
+    record_pick({std::min({a.x, b.x, c.x}), std::min({a.y, b.y, c.y})},
+                {std::max({a.x, b.x, c.x}), std::max({a.y, b.y, c.y})}, false);
 }
 
 void rhi_renderer::draw_elliptic_arc(const point2d& center, double radius_x, double radius_y,
                                       double start_angle, double extent_angle)
 {
-    m_overlay_deferred->draw_elliptic_arc(center, radius_x, radius_y,
+    overlay_recorder().draw_elliptic_arc(center, radius_x, radius_y,
                                           start_angle, extent_angle);
+    record_pick({center.x - radius_x, center.y - radius_y}, {center.x + radius_x, center.y + radius_y}, false);
 }
 
 void rhi_renderer::draw_arc(const point2d& center, double radius,
                              double start_angle, double extent_angle)
 {
-    m_overlay_deferred->draw_arc(center, radius, start_angle, extent_angle);
+    overlay_recorder().draw_arc(center, radius, start_angle, extent_angle);
+    record_pick({center.x - radius, center.y - radius}, {center.x + radius, center.y + radius}, false);
 }
 
 void rhi_renderer::fill_elliptic_arc(const point2d& center, double radius_x, double radius_y,
                                       double start_angle, double extent_angle)
 {
-    m_overlay_deferred->fill_elliptic_arc(center, radius_x, radius_y,
+    overlay_recorder().fill_elliptic_arc(center, radius_x, radius_y,
                                           start_angle, extent_angle);
+    record_pick({center.x - radius_x, center.y - radius_y}, {center.x + radius_x, center.y + radius_y}, false);
 }
 
 void rhi_renderer::fill_arc(const point2d& center, double radius,
                              double start_angle, double extent_angle)
 {
-    m_overlay_deferred->fill_arc(center, radius, start_angle, extent_angle);
+    overlay_recorder().fill_arc(center, radius, start_angle, extent_angle);
+    record_pick({center.x - radius, center.y - radius}, {center.x + radius, center.y + radius}, false);
 }
 
 void rhi_renderer::draw_text(const point2d& point, std::string const& text)
 {
-    m_overlay_deferred->draw_text(point, text);
+    overlay_recorder().draw_text(point, text);
+    record_pick(point, point, false);
 }
 
 void rhi_renderer::draw_text(const point2d& point, std::string const& text,
                               double bound_x, double bound_y)
 {
-    m_overlay_deferred->draw_text(point, text, bound_x, bound_y);
+    overlay_recorder().draw_text(point, text, bound_x, bound_y);
+    record_pick(point, point, false);
 }
 
 void rhi_renderer::draw_surface(surface* p_surface, const point2d& anchor_point,
                                  double scale_factor)
 {
-    m_overlay_deferred->draw_surface(p_surface, anchor_point, scale_factor);
+    overlay_recorder().draw_surface(p_surface, anchor_point, scale_factor);
+    record_pick(anchor_point, anchor_point, false);
 }
 
 // ---- frame lifecycle -------------------------------------------------------
@@ -656,12 +567,24 @@ void rhi_renderer::begin_frame()
 {
     ensure_tile_grid();
     clear_tile_geometry();
-    m_overlay_deferred->clear_overlay_and_batches();
+    m_loaded_scene.reset();
     m_skip_tile_writes = false;
-
-    // End painter if still active (shouldn't normally happen).
-    if (m_overlay_painter.isActive())
-        m_overlay_painter.end();
+    ++m_frame_index;
+    evict_stale_triangulations();
+
+    // A queued overlay job belongs to the scene being replaced, so drop it.
+    // If the worker is still rasterizing the current layer, record into a
+    // fresh layer rather than waiting; the old one is freed when its job
+    // finishes.
+    if (m_overlay_worker)
+        m_overlay_worker->cancel_pending();
+    if (m_overlay_layer->queued_jobs.load(std::memory_order_acquire) != 0) {
+        m_overlay_layer = std::make_shared<RhiOverlayLayer>(*m_camera);
+    } else {
+        m_overlay_layer->cam = *m_camera;
+        m_overlay_layer->recorder->clear_overlay_and_batches();
+        ++m_overlay_layer->revision;
+    }
 
     // Refresh size + DPR from widget (it may have been resized since construction,
     // and DPR may have changed too if the window crossed monitors with different
@@ -671,32 +594,16 @@ void rhi_renderer::begin_frame()
         m_overlay_dpr = m_rhi_widget->devicePixelRatioF();
     }
 
-    const QSize wanted_overlay_px = physical_overlay_size(m_size, m_overlay_dpr);
-    if (m_overlay.size() != wanted_overlay_px
-        || m_overlay.devicePixelRatio() != m_overlay_dpr) {
-        m_overlay = QImage(wanted_overlay_px, QImage::Format_ARGB32_Premultiplied);
-        m_overlay.setDevicePixelRatio(m_overlay_dpr);
-    }
-
-    m_overlay.fill(Qt::transparent);
-
-    // Restart the overlay painter on the (possibly resized) image.
-    m_overlay_painter.begin(&m_overlay);
-    m_overlay_painter.setAntialias(false);
-    m_overlay_painter.setSmoothPixmap(false);
-    update_painter(&m_overlay_painter, &m_overlay);
-    m_overlay_deferred->set_painter_surface(&m_overlay_painter, &m_overlay);
-
     // Match the deferred path semantics: each redraw starts from the renderer
     // defaults rather than inheriting state from the previous frame.
     //
     // Use the virtual setters here, NOT direct member writes: the rhi_renderer
-    // overrides propagate state to m_overlay_deferred. A direct write would
-    // leave m_overlay_deferred holding whatever state apply_painter_state()
-    // last applied during replay — typically the SCREEN coord of the final
-    // legend text command — and the next frame's WORLD-coord text (e.g. CLB
-    // labels in draw_place) would be silently captured as SCREEN, producing
-    // text at fixed screen positions that does not follow camera moves.
+    // overrides propagate state to the overlay recorder. A direct write would
+    // leave the recorder holding whatever state apply_painter_state() last
+    // applied during replay — typically the SCREEN coord of the final legend
+    // text command — and the next frame's WORLD-coord text (e.g. CLB labels
+    // in draw_place) would be silently captured as SCREEN, producing text at
+    // fixed screen positions that does not follow camera moves.
     set_coordinate_system(WORLD);
     set_text_rotation(0);
     set_horiz_justification(justification::center);
@@ -705,43 +612,222 @@ void rhi_renderer::begin_frame()
     current_line_width = 0;
     current_line_cap = line_cap::butt;
     current_line_dash = line_dash::none;
+    current_pick_id = 0;
     set_color(current_color);
     set_line_width(current_line_width);
     set_line_cap(current_line_cap);
     set_line_dash(current_line_dash);
 }
 
-void rhi_renderer::begin_overlay_frame()
+deferred_renderer& rhi_renderer::overlay_recorder()
 {
-    // End painter if still active from a previous pass.
-    if (m_overlay_painter.isActive())
-        m_overlay_painter.end();
+    // Recording between flush() and the next begin_frame() (e.g. through
+    // the animation renderer) can reach a layer the worker is still
+    // replaying. That is rare, so wait for it instead of copying the layer.
+    if (m_overlay_worker
+        && m_overlay_layer->queued_jobs.load(std::memory_order_acquire) != 0)
+        m_overlay_worker->quiesce();
+    // Anything recorded from here on invalidates pixels the worker kept.
+    ++m_overlay_layer->revision;
+    return *m_overlay_layer->recorder;
+}
 
-    const QSize wanted_overlay_px = physical_overlay_size(m_size, m_overlay_dpr);
-    if (m_overlay.size() != wanted_overlay_px
-        || m_overlay.devicePixelRatio() != m_overlay_dpr) {
-        m_overlay = QImage(wanted_overlay_px, QImage::Format_ARGB32_Premultiplied);
-        m_overlay.setDevicePixelRatio(m_overlay_dpr);
+void rhi_renderer::post_overlay_job(bool relayout)
+{
+    if (m_rhi_widget->overlay_tile_budget() > 0 && OverlayTileGrid::fits(*m_camera, m_overlay_dpr)) {
+        post_overlay_tiles(relayout);
+        return;
+    }
+    if (m_tiles_active) {
+        m_tiles_active = false;
+        m_rhi_widget->set_overlay_tile_view({});
+    }
+    if (relayout)
+        m_overlay_worker->post({m_overlay_layer, *m_camera, m_size, m_overlay_dpr,
+                                compute_mvp(), m_overlay_layer->revision});
+}
+
+void rhi_renderer::post_overlay_tiles(bool relayout)
+{
+    const OverlayTileGrid grid   = OverlayTileGrid::for_camera(*m_camera, m_overlay_dpr);
+    const double          aspect = grid.px_per_world_y / grid.px_per_world_x;
+
+    // Tiles of an older epoch were rasterized from other commands or at
+    // another resolution; the widget keeps them only as stand-ins.
+    const bool new_epoch = !m_tiles_active
+                        || m_tile_layer.lock() != m_overlay_layer
+                        || m_tile_revision != m_overlay_layer->revision
+                        || m_tile_dpr != m_overlay_dpr
+                        || m_tile_aspect != aspect;
+    if (new_epoch) {
+        m_tiles_active  = true;
+        m_tile_layer    = m_overlay_layer;
+        m_tile_revision = m_overlay_layer->revision;
+        m_tile_dpr      = m_overlay_dpr;
+        m_tile_aspect   = aspect;
+        ++m_tile_epoch;
     }
 
-    m_overlay.fill(Qt::transparent);
+    // SCREEN content does not move with the camera: lay it out once per
+    // epoch and size, and draw it as is.
+    if (new_epoch || m_tile_screen_size != m_size) {
+        m_tile_screen_size = m_size;
+        m_overlay_worker->post({m_overlay_layer, *m_camera, m_size, m_overlay_dpr,
+                                compute_mvp(), m_overlay_layer->revision,
+                                overlay_space::screen});
+    }
 
-    m_overlay_painter.begin(&m_overlay);
-    m_overlay_painter.setAntialias(false);
-    m_overlay_painter.setSmoothPixmap(false);
-    update_painter(&m_overlay_painter, &m_overlay);
-    m_overlay_deferred->set_painter_surface(&m_overlay_painter, &m_overlay);
+    OverlayTileView view;
+    view.epoch = m_tile_epoch;
+    const std::vector<OverlayTileKey> visible = grid.tiles_covering(irenderer::get_visible_world(), 0);
+    view.visible.reserve(visible.size());
+    for (const OverlayTileKey& key : visible)
+        view.visible.push_back({key, grid.tile_world(key)});
+    m_rhi_widget->set_overlay_tile_view(std::move(view));
+
+    // Between relayouts (camera animations) the cache draws what it has,
+    // standing in other levels for missing tiles; nothing is rasterized.
+    if (!relayout)
+        return;
 
-    m_skip_tile_writes = false;
+    std::vector<OverlayTileKey> keys = visible;
+    const std::unordered_set<OverlayTileKey, OverlayTileKeyHash> in_view(visible.begin(), visible.end());
+    for (const OverlayTileKey& key : grid.tiles_covering(irenderer::get_visible_world(),
+                                                         kOverlayTilePrefetchRing)) {
+        if (in_view.count(key) == 0)
+            keys.push_back(key);
+    }
+    m_overlay_worker->post_tiles({m_overlay_layer, *m_camera, m_overlay_dpr, grid, m_tile_epoch,
+                                  m_rhi_widget->missing_overlay_tiles(m_tile_epoch, std::move(keys))});
 }
 
-void rhi_renderer::render_cached_overlay()
+// ---- pick recording --------------------------------------------------------
+
+void rhi_renderer::record_pick(const point2d& a, const point2d& b, bool segment)
 {
-    begin_overlay_frame();
-    m_overlay_deferred->replay_overlay();
+    if (current_pick_id == 0 || current_coordinate_system != WORLD || skip_recording())
+        return;
+    const PickEntry entry{float(a.x), float(a.y), float(b.x), float(b.y),
+                          current_pick_id, (m_pick_sequence++ << 1) | (segment ? 1u : 0u)};
+    const int b0 = band_for_tile_row(clamp_tile_y(std::min(a.y, b.y)));
+    const int b1 = band_for_tile_row(clamp_tile_y(std::max(a.y, b.y)));
+    for (int band = b0; band <= b1; ++band) m_cmd_picks[band].push_back(entry);
+}
 
-    if (m_overlay_painter.isActive())
-        m_overlay_painter.end();
+// ---- polygon triangulation cache -------------------------------------------
+
+void rhi_renderer::push_fill_tri(StyleKey sk, const point2d& a, const point2d& b, const point2d& c)
+{
+    const FillTriCmd cmd{sk,
+        float(a.x), float(a.y), float(b.x), float(b.y), float(c.x), float(c.y)};
+    const int b0 = band_for_tile_row(clamp_tile_y(std::min({a.y, b.y, c.y})));
+    const int b1 = band_for_tile_row(clamp_tile_y(std::max({a.y, b.y, c.y})));
+    for (int band = b0; band <= b1; ++band) m_cmd_fill_tris[band].push_back(cmd);
+}
+
+// Record a polygon as one mesh so its triangles can share vertices in the
+// tile batches. @p indices == nullptr means a convex fan over @p verts.
+void rhi_renderer::push_fill_mesh(StyleKey                          sk,
+                                  const std::vector<point2d>&       verts,
+                                  const std::vector<std::uint32_t>* indices)
+{
+    FillMeshCmd cmd{};
+    cmd.sk           = sk;
+    cmd.first_vertex = std::uint32_t(m_mesh_verts.size());
+    cmd.vertex_count = std::uint32_t(verts.size());
+    cmd.first_index  = std::uint32_t(m_mesh_indices.size());
+    cmd.x_min = cmd.y_min = std::numeric_limits<float>::max();
+    cmd.x_max = cmd.y_max = std::numeric_limits<float>::lowest();
+
+    for (const point2d& p : verts) {
+        const PosVertex v{float(p.x), float(p.y)};
+        cmd.x_min = std::min(cmd.x_min, v.x);
+        cmd.y_min = std::min(cmd.y_min, v.y);
+        cmd.x_max = std::max(cmd.x_max, v.x);
+        cmd.y_max = std::max(cmd.y_max, v.y);
+        m_mesh_verts.push_back(v);
+    }
+
+    if (indices) {
+        m_mesh_indices.insert(m_mesh_indices.end(), indices->begin(), indices->end());
+    } else {
+        for (std::uint32_t i = 1; i + 1 < cmd.vertex_count; ++i) {
+            m_mesh_indices.push_back(0);
+            m_mesh_indices.push_back(i);
+            m_mesh_indices.push_back(i + 1);
+        }
+    }
+    cmd.index_count = std::uint32_t(m_mesh_indices.size()) - cmd.first_index;
+
+    const int b0 = band_for_tile_row(clamp_tile_y(cmd.y_min));
+    const int b1 = band_for_tile_row(clamp_tile_y(cmd.y_max));
+    for (int band = b0; band <= b1; ++band) m_cmd_fill_meshes[band].push_back(cmd);
+}
+
+const rhi_renderer::TriangulationEntry&
+rhi_renderer::cached_triangulation(const std::vector<point2d>& outer,
+                                   const std::vector<std::vector<point2d>>& holes)
+{
+    // 64-bit FNV-1a over the coordinate bit patterns and the ring sizes.
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    auto mix = [&hash](std::uint64_t v) {
+        hash ^= v;
+        hash *= 0x100000001b3ull;
+    };
+    auto mix_ring = [&mix](const std::vector<point2d>& ring) {
+        mix(ring.size());
+        for (const point2d& p : ring) {
+            mix(std::bit_cast<std::uint64_t>(p.x));
+            mix(std::bit_cast<std::uint64_t>(p.y));
+        }
+    };
+    mix_ring(outer);
+    for (const std::vector<point2d>& hole : holes)
+        mix_ring(hole);
+
+    // The hash covers every point; the check below only guards against a
+    // collision with a polygon of another shape.
+    const point2d first = outer.empty() ? point2d{0, 0} : outer.front();
+    const point2d last  = holes.empty() || holes.back().empty()
+                              ? (outer.empty() ? point2d{0, 0} : outer.back())
+                              : holes.back().back();
+    auto same_input = [&](const TriangulationEntry& e) {
+        if (e.ring_sizes.size() != holes.size() + 1 || e.ring_sizes[0] != outer.size())
+            return false;
+        for (std::size_t h = 0; h < holes.size(); ++h)
+            if (e.ring_sizes[h + 1] != holes[h].size())
+                return false;
+        return e.first == first && e.last == last;
+    };
+
+    auto [it, inserted] = m_triangulation_cache.try_emplace(hash);
+    TriangulationEntry& entry = it->second;
+    entry.last_used_frame = m_frame_index;
+    if (!inserted && same_input(entry))
+        return entry;
+
+    // New polygon, or a hash collision: (re)build the entry in place.
+    std::size_t point_count = outer.size();
+    entry.ring_sizes.assign(1, std::uint32_t(outer.size()));
+    for (const std::vector<point2d>& hole : holes) {
+        entry.ring_sizes.push_back(std::uint32_t(hole.size()));
+        point_count += hole.size();
+    }
+    entry.first   = first;
+    entry.last    = last;
+    entry.indices = triangulate_polygon(outer, holes);
+    if (entry.indices.empty()) {
+        qWarning("rhi_renderer: failed to triangulate polygon with %llu points",
+                 static_cast<unsigned long long>(point_count));
+    }
+    return entry;
+}
+
+void rhi_renderer::evict_stale_triangulations()
+{
+    std::erase_if(m_triangulation_cache, [this](const auto& kv) {
+        return m_frame_index - kv.second.last_used_frame > kTriangulationMaxIdleFrames;
+    });
 }
 
 // ---- helpers ---------------------------------------------------------------
@@ -874,20 +960,30 @@ void rhi_renderer::append_fill_rect(RhiTileBatch& tile,
     );
 }
 
-void rhi_renderer::append_fill_triangle(RhiTileBatch& tile,
-                                        const point2d& a,
-                                        const point2d& b,
-                                        const point2d& c,
-                                        StyleKey      style_key,
-                                        std::uint32_t rgba)
+// Append a convex polygon (a triangle, or a triangle clipped to the tile)
+// as one vertex per corner plus a fan of indices. Degenerate fan triangles
+// are dropped; a polygon with no area adds nothing.
+void rhi_renderer::append_fill_polygon(RhiTileBatch&  tile,
+                                       const point2d* points,
+                                       int            count,
+                                       StyleKey       style_key,
+                                       std::uint32_t  rgba)
 {
-    if (std::abs(cross(a, b, c)) <= kPolygonEpsilon)
-        return;
-
-    TileFillPolyBatch& batch = ensure_fill_poly_batch(tile, style_key, rgba);
-    batch.verts.emplace_back(float(a.x), float(a.y));
-    batch.verts.emplace_back(float(b.x), float(b.y));
-    batch.verts.emplace_back(float(c.x), float(c.y));
+    TileFillPolyBatch* batch = nullptr;
+    std::uint32_t base = 0;
+    for (int i = 1; i + 1 < count; ++i) {
+        if (std::abs(cross(points[0], points[i], points[i + 1])) <= kPolygonEpsilon)
+            continue;
+        if (!batch) {
+            batch = &ensure_fill_poly_batch(tile, style_key, rgba);
+            base  = std::uint32_t(batch->verts.size());
+            for (int k = 0; k < count; ++k)
+                batch->verts.emplace_back(float(points[k].x), float(points[k].y));
+        }
+        batch->indices.push_back(base);
+        batch->indices.push_back(base + std::uint32_t(i));
+        batch->indices.push_back(base + std::uint32_t(i + 1));
+    }
 }
 
 void rhi_renderer::ensure_tile_grid()
@@ -945,9 +1041,14 @@ void rhi_renderer::clear_commands()
         m_cmd_thin_lines[b].clear();
         m_cmd_fill_rects[b].clear();
         m_cmd_fill_tris[b].clear();
+        m_cmd_fill_meshes[b].clear();
         m_cmd_thick_lines[b].clear();
         m_cmd_dashed_lines[b].clear();
+        m_cmd_picks[b].clear();
     }
+    m_pick_sequence = 0;
+    m_mesh_verts.clear();
+    m_mesh_indices.clear();
     // Note: m_cmd_arrows is NOT cleared here. The line/rect/etc. queues are
     // safe to clear because dispatch_commands_to_tiles has already moved
     // their contents into per-tile batches. Arrows are not tile-binned, so
@@ -1053,10 +1154,7 @@ void rhi_renderer::append_fill_triangle_to_tiles(const point2d& a,
             if (clipped.n < 3)
                 continue;
 
-            const point2d& anchor = clipped.v[0];
-            for (int i = 1; i + 1 < clipped.n; ++i) {
-                append_fill_triangle(tile, anchor, clipped.v[i], clipped.v[i + 1], style_key, rgba);
-            }
+            append_fill_polygon(tile, clipped.v, clipped.n, style_key, rgba);
         }
     }
 }
@@ -1186,10 +1284,10 @@ void rhi_renderer::append_dashed_draw_segment_to_tiles(const point2d& start,
 // Combined world→NDC (column-major QMatrix4x4):
 //   m(0,0) = 2*sx/fw,   m(0,3) = 2*tx/fw - 1
 //   m(1,1) = 2*sy/fh,   m(1,3) = 1 - 2*ty/fh
-QMatrix4x4 rhi_renderer::compute_mvp() const
+QMatrix4x4 rhi_renderer::compute_mvp(QSize size) const
 {
-    const float fw = float(m_size.width());
-    const float fh = float(m_size.height());
+    const float fw = float(size.width());
+    const float fh = float(size.height());
 
     const rectangle world  = m_camera->get_world();
     const rectangle screen = m_camera->get_screen();
@@ -1211,11 +1309,12 @@ QMatrix4x4 rhi_renderer::compute_mvp() const
 void rhi_renderer::draw_line(const point2d& start, const point2d& end)
 {
     if (current_coordinate_system != WORLD) {
-        m_overlay_deferred->draw_line(start, end);
+        overlay_recorder().draw_line(start, end);
         return;
     }
-    if (m_skip_tile_writes)
+    if (skip_recording())
         return;
+    record_pick(start, end, true);
 
     const int b0 = band_for_tile_row(clamp_tile_y(std::min(start.y, end.y)));
     const int b1 = band_for_tile_row(clamp_tile_y(std::max(start.y, end.y)));
@@ -1244,12 +1343,13 @@ void rhi_renderer::draw_line(const point2d& start, const point2d& end)
 void rhi_renderer::fill_rectangle(const point2d& start, const point2d& end)
 {
     if (current_coordinate_system != WORLD) {
-        m_overlay_deferred->fill_rectangle(start, end);
+        overlay_recorder().fill_rectangle(start, end);
         return;
     }
-    if (m_skip_tile_writes)
+    if (skip_recording())
         return;
 
+    record_pick(start, end, false);
     const FillRectCmd cmd{current_style_key(PrimitiveType::FilledRect),
         float(start.x), float(start.y), float(end.x), float(end.y)};
     const int b0 = band_for_tile_row(clamp_tile_y(std::min(start.y, end.y)));
@@ -1272,10 +1372,10 @@ void rhi_renderer::fill_rectangle(const rectangle& r)
 void rhi_renderer::draw_rectangle(const point2d& start, const point2d& end)
 {
     if (current_coordinate_system != WORLD) {
-        m_overlay_deferred->draw_rectangle(start, end);
+        overlay_recorder().draw_rectangle(start, end);
         return;
     }
-    if (m_skip_tile_writes)
+    if (skip_recording())
         return;
 
     // Normalize corners so x_lo <= x_hi and y_lo <= y_hi. Without this the
@@ -1293,6 +1393,7 @@ void rhi_renderer::draw_rectangle(const point2d& start, const point2d& end)
 
     const int b_bottom = band_for_tile_row(clamp_tile_y(y_lo));
     const int b_top    = band_for_tile_row(clamp_tile_y(y_hi));
+    record_pick(start, end, false);
 
     if (current_line_dash != line_dash::none) {
         const StyleKey sk = current_style_key(PrimitiveType::DashedLine, float(std::max(1, current_line_width)));
@@ -1346,6 +1447,70 @@ void rhi_renderer::draw_rectangle(const rectangle& r)
 SceneBuffers rhi_renderer::build_scene_buffers() const
 {
     SceneBuffers scene;
+    if (m_scene_storage.out_of_core)
+        scene.scratch = SceneScratchFile::create(m_scene_storage);
+    std::pmr::memory_resource* const resource =
+        scene.scratch ? static_cast<std::pmr::memory_resource*>(scene.scratch.get())
+                      : std::pmr::get_default_resource();
+
+    // Size every style array exactly before filling it. The scratch
+    // resource never frees, so growth by reallocation would leave every
+    // outgrown block behind in the file; on the heap it saves the copies.
+    struct Sizes { std::size_t elems = 0, idx16 = 0, idx32 = 0; };
+    std::unordered_map<StyleKey, Sizes> thin_sizes, rect_sizes, poly_sizes, thick_sizes, dashed_sizes,
+                                        arrow_sizes;
+    for (const RhiTileBatch& tile : m_tiles) {
+        if (tile.empty())
+            continue;
+        for (const TileThinLineBatch& batch : tile.thin_line_batches)
+            thin_sizes[batch.style_key].elems += batch.verts.size();
+        for (const TileFillRectBatch& batch : tile.fill_rect_batches)
+            rect_sizes[batch.style_key].elems += batch.instances.size();
+        for (const TileFillPolyBatch& batch : tile.fill_poly_batches) {
+            if (batch.indices.empty())
+                continue;
+            Sizes& sz = poly_sizes[batch.style_key];
+            sz.elems += batch.verts.size();
+            (batch.verts.size() > kMaxNarrowIndexedVertices ? sz.idx32 : sz.idx16) += batch.indices.size();
+        }
+        for (const TileThickLineBatch& batch : tile.thick_line_batches)
+            thick_sizes[batch.style_key].elems += batch.instances.size();
+        for (const TileDashedLineBatch& batch : tile.dashed_line_batches)
+            dashed_sizes[batch.style_key].elems += batch.instances.size();
+    }
+    for (const ArrowCmd& cmd : m_cmd_arrows)
+        ++arrow_sizes[cmd.sk].elems;
+    const auto make_buffers = [resource](auto& buffers, const auto& sizes, auto member) {
+        for (const auto& [sk, sz] : sizes) {
+            if (sz.elems == 0)
+                continue;
+            auto& buffer = buffers.try_emplace(sk, resource).first->second;
+            (buffer.*member).reserve(sz.elems);
+        }
+    };
+    make_buffers(scene.thin_lines,   thin_sizes,   &ThinLineStyleBuffer::verts);
+    make_buffers(scene.fill_rects,   rect_sizes,   &FillRectStyleBuffer::instances);
+    make_buffers(scene.thick_lines,  thick_sizes,  &ThickLineStyleBuffer::instances);
+    make_buffers(scene.dashed_lines, dashed_sizes, &DashedLineStyleBuffer::instances);
+    make_buffers(scene.fill_polys,   poly_sizes,   &FillPolyStyleBuffer::verts);
+    make_buffers(scene.arrows,       arrow_sizes,  &ArrowStyleBuffer::instances);
+    for (const auto& [sk, sz] : poly_sizes) {
+        const auto it = scene.fill_polys.find(sk);
+        if (it == scene.fill_polys.end())
+            continue;
+        it->second.indices16.reserve(sz.idx16);
+        it->second.indices32.reserve(sz.idx32);
+    }
+    const auto tile_geometry_bytes = [](const RhiTileBatch& tile) {
+        std::size_t bytes = 0;
+        for (const auto& b : tile.thin_line_batches)   bytes += b.verts.size() * sizeof(PosVertex);
+        for (const auto& b : tile.fill_rect_batches)   bytes += b.instances.size() * sizeof(FillRectInstance);
+        for (const auto& b : tile.fill_poly_batches)   bytes += b.verts.size() * sizeof(PosVertex)
+                                                              + b.indices.size() * sizeof(std::uint32_t);
+        for (const auto& b : tile.thick_line_batches)  bytes += b.instances.size() * sizeof(ThickLineInstance);
+        for (const auto& b : tile.dashed_line_batches) bytes += b.instances.size() * sizeof(DashedLineInstance);
+        return bytes;
+    };
 
     for (const RhiTileBatch& tile : m_tiles) {
         if (tile.empty())
@@ -1354,7 +1519,7 @@ SceneBuffers rhi_renderer::build_scene_buffers() const
         for (const TileThinLineBatch& batch : tile.thin_line_batches) {
             if (batch.verts.empty())
                 continue;
-            ThinLineStyleBuffer& scene_buffer = scene.thin_lines[batch.style_key];
+            ThinLineStyleBuffer& scene_buffer = scene.thin_lines.at(batch.style_key);
             if (scene_buffer.chunks.empty()) {
                 scene_buffer.style_key = batch.style_key;
                 scene_buffer.rgba = batch.rgba;
@@ -1373,7 +1538,7 @@ SceneBuffers rhi_renderer::build_scene_buffers() const
         for (const TileFillRectBatch& batch : tile.fill_rect_batches) {
             if (batch.instances.empty())
                 continue;
-            FillRectStyleBuffer& scene_buffer = scene.fill_rects[batch.style_key];
+            FillRectStyleBuffer& scene_buffer = scene.fill_rects.at(batch.style_key);
             if (scene_buffer.chunks.empty()) {
                 scene_buffer.style_key = batch.style_key;
                 scene_buffer.rgba = batch.rgba;
@@ -1390,19 +1555,30 @@ SceneBuffers rhi_renderer::build_scene_buffers() const
         }
 
         for (const TileFillPolyBatch& batch : tile.fill_poly_batches) {
-            if (batch.verts.empty())
+            if (batch.indices.empty())
                 continue;
-            FillPolyStyleBuffer& scene_buffer = scene.fill_polys[batch.style_key];
+            FillPolyStyleBuffer& scene_buffer = scene.fill_polys.at(batch.style_key);
             if (scene_buffer.chunks.empty()) {
                 scene_buffer.style_key = batch.style_key;
                 scene_buffer.rgba = batch.rgba;
             }
-            const std::size_t offset = scene_buffer.verts.size();
-            scene_buffer.chunks.emplace_back(
-                tile.world_bounds,
-                std::uint32_t(offset),
-                std::uint32_t(batch.verts.size())
-            );
+            IndexedChunk chunk;
+            chunk.world_bounds  = tile.world_bounds;
+            chunk.vertex_offset = std::uint32_t(scene_buffer.verts.size());
+            chunk.vertex_count  = std::uint32_t(batch.verts.size());
+            chunk.index_count   = std::uint32_t(batch.indices.size());
+            chunk.wide_indices  = batch.verts.size() > kMaxNarrowIndexedVertices;
+            if (chunk.wide_indices) {
+                chunk.index_offset = std::uint32_t(scene_buffer.indices32.size());
+                scene_buffer.indices32.insert(scene_buffer.indices32.end(),
+                                              batch.indices.begin(),
+                                              batch.indices.end());
+            } else {
+                chunk.index_offset = std::uint32_t(scene_buffer.indices16.size());
+                for (std::uint32_t index : batch.indices)
+                    scene_buffer.indices16.push_back(std::uint16_t(index));
+            }
+            scene_buffer.chunks.push_back(chunk);
             scene_buffer.verts.insert(scene_buffer.verts.end(),
                                       batch.verts.begin(),
                                       batch.verts.end());
@@ -1411,7 +1587,7 @@ SceneBuffers rhi_renderer::build_scene_buffers() const
         for (const TileThickLineBatch& batch : tile.thick_line_batches) {
             if (batch.instances.empty())
                 continue;
-            ThickLineStyleBuffer& scene_buffer = scene.thick_lines[batch.style_key];
+            ThickLineStyleBuffer& scene_buffer = scene.thick_lines.at(batch.style_key);
             if (scene_buffer.chunks.empty()) {
                 scene_buffer.style_key = batch.style_key;
                 scene_buffer.rgba = batch.rgba;
@@ -1430,7 +1606,7 @@ SceneBuffers rhi_renderer::build_scene_buffers() const
         for (const TileDashedLineBatch& batch : tile.dashed_line_batches) {
             if (batch.instances.empty())
                 continue;
-            DashedLineStyleBuffer& scene_buffer = scene.dashed_lines[batch.style_key];
+            DashedLineStyleBuffer& scene_buffer = scene.dashed_lines.at(batch.style_key);
             if (scene_buffer.chunks.empty()) {
                 scene_buffer.style_key = batch.style_key;
                 scene_buffer.rgba = batch.rgba;
@@ -1445,6 +1621,11 @@ SceneBuffers rhi_renderer::build_scene_buffers() const
                                           batch.instances.begin(),
                                           batch.instances.end());
         }
+
+        // Bound the resident part of an out-of-core scene while it is being
+        // written: pages beyond the budget are flushed to the scratch file.
+        if (scene.scratch)
+            scene.scratch->note_touched(tile_geometry_bytes(tile));
     }
 
     // Arrow instances are not tile-binned (see m_cmd_arrows comment in
@@ -1454,7 +1635,7 @@ SceneBuffers rhi_renderer::build_scene_buffers() const
     // because the bounds always intersect any visible_world rectangle.
     for (const ArrowCmd& cmd : m_cmd_arrows) {
         const std::uint32_t rgba = std::uint32_t(cmd.sk);
-        ArrowStyleBuffer& sb = scene.arrows[cmd.sk];
+        ArrowStyleBuffer& sb = scene.arrows.try_emplace(cmd.sk, resource).first->second;
         if (sb.instances.empty()) {
             sb.style_key = cmd.sk;
             sb.rgba      = rgba;
@@ -1534,9 +1715,62 @@ void rhi_renderer::dispatch_commands_to_tiles(int band)
                 RhiTileBatch& tile = tile_at(tx, ty);
                 const SmallPoly clipped = clip_triangle_to_rect(a, b, c, tile.world_bounds);
                 if (clipped.n < 3) continue;
-                const point2d& anchor = clipped.v[0];
-                for (int i = 1; i + 1 < clipped.n; ++i)
-                        append_fill_triangle(tile, anchor, clipped.v[i], clipped.v[i + 1], cmd.sk, rgba);
+                append_fill_polygon(tile, clipped.v, clipped.n, cmd.sk, rgba);
+            }
+        }
+    }
+
+    // Meshes: a triangle that lies entirely inside one tile reuses the
+    // vertices its neighbours already emitted there; only triangles cut by
+    // a tile edge are clipped and get fresh vertices. vertex_slot records,
+    // per mesh vertex, the tile it was last emitted into and its index in
+    // that tile's batch.
+    std::vector<std::pair<int, std::uint32_t>> vertex_slot;
+    for (const FillMeshCmd& cmd : m_cmd_fill_meshes[band]) {
+        const PosVertex*     mv   = m_mesh_verts.data() + cmd.first_vertex;
+        const std::uint32_t* mi   = m_mesh_indices.data() + cmd.first_index;
+        const std::uint32_t  rgba = std::uint32_t(cmd.sk);
+        vertex_slot.assign(cmd.vertex_count, {-1, 0});
+
+        for (std::uint32_t t = 0; t + 2 < cmd.index_count; t += 3) {
+            const std::uint32_t tri[3] = {mi[t], mi[t + 1], mi[t + 2]};
+            const point2d a{mv[tri[0]].x, mv[tri[0]].y};
+            const point2d b{mv[tri[1]].x, mv[tri[1]].y};
+            const point2d c{mv[tri[2]].x, mv[tri[2]].y};
+            if (std::abs(cross(a, b, c)) <= kPolygonEpsilon)
+                continue;
+
+            const double x_min = std::min({a.x, b.x, c.x});
+            const double x_max = std::max({a.x, b.x, c.x});
+            const double y_min = std::min({a.y, b.y, c.y});
+            const double y_max = std::max({a.y, b.y, c.y});
+            const int min_tx = clamp_tile_x(x_min);
+            const int max_tx = clamp_tile_x(x_max);
+            const int min_ty = std::max(clamp_tile_y(y_min), ty_min);
+            const int max_ty = std::min(clamp_tile_y(y_max), ty_max);
+            for (int ty = min_ty; ty <= max_ty; ++ty) {
+                for (int tx = min_tx; tx <= max_tx; ++tx) {
+                    RhiTileBatch& tile = tile_at(tx, ty);
+                    const rectangle& tb = tile.world_bounds;
+                    if (x_min < tb.left() || x_max > tb.right()
+                        || y_min < tb.bottom() || y_max > tb.top()) {
+                        const SmallPoly clipped = clip_triangle_to_rect(a, b, c, tb);
+                        if (clipped.n >= 3)
+                            append_fill_polygon(tile, clipped.v, clipped.n, cmd.sk, rgba);
+                        continue;
+                    }
+
+                    TileFillPolyBatch& batch = ensure_fill_poly_batch(tile, cmd.sk, rgba);
+                    const int ti = tile_index(tx, ty);
+                    for (std::uint32_t k : tri) {
+                        std::pair<int, std::uint32_t>& slot = vertex_slot[k];
+                        if (slot.first != ti) {
+                            slot = {ti, std::uint32_t(batch.verts.size())};
+                            batch.verts.push_back(mv[k]);
+                        }
+                        batch.indices.push_back(slot.second);
+                    }
+                }
             }
         }
     }
@@ -1580,13 +1814,38 @@ void rhi_renderer::dispatch_commands_to_tiles(int band)
         }
     }
 
+    // Pick entries: one list per tile of this band, each packed into its
+    // tile's tree. A segment only goes to the tiles it actually crosses.
+    if (m_pick_build) {
+        std::vector<std::vector<PickEntry>> tile_entries(
+            std::size_t(ty_max - ty_min + 1) * kTileGridDimension);
+        for (const PickEntry& entry : m_cmd_picks[band]) {
+            const int min_tx = clamp_tile_x(entry.left());
+            const int max_tx = clamp_tile_x(entry.right());
+            const int min_ty = std::max(clamp_tile_y(entry.bottom()), ty_min);
+            const int max_ty = std::min(clamp_tile_y(entry.top()),    ty_max);
+            for (int ty = min_ty; ty <= max_ty; ++ty) {
+                for (int tx = min_tx; tx <= max_tx; ++tx) {
+                    if (entry.is_segment()) {
+                        point2d cs{entry.x0, entry.y0}, ce{entry.x1, entry.y1};
+                        if (!clip_line_world(tile_at(tx, ty).world_bounds, cs, ce)) continue;
+                    }
+                    tile_entries[std::size_t(ty - ty_min) * kTileGridDimension + tx].push_back(entry);
+                }
+            }
+        }
+        for (int ty = ty_min; ty <= ty_max; ++ty)
+            for (int tx = 0; tx < kTileGridDimension; ++tx)
+                m_pick_build->tile(tx, ty).build(
+                    std::move(tile_entries[std::size_t(ty - ty_min) * kTileGridDimension + tx]));
+    }
 }
 
-// ---- flush -----------------------------------------------------------------
-
-void rhi_renderer::flush()
+void rhi_renderer::dispatch_commands(bool build_picks)
 {
-    render_cached_overlay();
+    // Only frames that recorded pick ids pay for the index.
+    if (build_picks && m_pick_sequence != 0)
+        m_pick_build = std::make_shared<PickIndex>(m_scene_bounds, kTileGridDimension);
 
     // Dispatch recorded draw commands to tile batches in parallel.
     // Each thread processes only its own band — commands were routed at record time.
@@ -1598,15 +1857,24 @@ void rhi_renderer::flush()
         for (auto& w : workers) w.join();
     }
     clear_commands();
+}
+
+// ---- flush -----------------------------------------------------------------
+
+void rhi_renderer::flush()
+{
+    // Queue the overlay first so QPainter rasterization overlaps the tile
+    // dispatch below. The widget keeps showing the previous overlay,
+    // reprojected, until the worker delivers this one.
+    post_overlay_job();
 
     constexpr double kBytesPerMb = 1024.0 * 1024.0;
-    SceneBuffers scene_buffers = build_scene_buffers();
-    m_cmd_arrows.clear();  // see clear_commands(): arrows live until after build
+    SceneBuffers scene_buffers = assemble_scene();
 
 #ifdef EZGL_RENDERER_DEBUG
     double line_verts_mb          = 0.0;
     double fill_rect_instances_mb = 0.0;
-    double fill_poly_verts_mb     = 0.0;
+    double fill_poly_mesh_mb      = 0.0;
     double thick_instances_mb     = 0.0;
     double dashed_instances_mb    = 0.0;
     double style_uniforms_mb      = 0.0;
@@ -1623,7 +1891,9 @@ void rhi_renderer::flush()
     }
     for (const auto& [style_key, buffer] : scene_buffers.fill_polys) {
         (void)style_key;
-        fill_poly_verts_mb += double(buffer.verts.size() * sizeof(PosVertex)) / kBytesPerMb;
+        fill_poly_mesh_mb += double(buffer.verts.size() * sizeof(PosVertex)
+                                    + buffer.indices16.size() * sizeof(std::uint16_t)
+                                    + buffer.indices32.size() * sizeof(std::uint32_t)) / kBytesPerMb;
         style_uniforms_mb += 32.0 / kBytesPerMb;
     }
     for (const auto& [style_key, buffer] : scene_buffers.thick_lines) {
@@ -1640,7 +1910,7 @@ void rhi_renderer::flush()
     const double total_mb =
         line_verts_mb
         + fill_rect_instances_mb
-        + fill_poly_verts_mb
+        + fill_poly_mesh_mb
         + thick_instances_mb
         + dashed_instances_mb
         + style_uniforms_mb;
@@ -1651,52 +1921,174 @@ void rhi_renderer::flush()
         << " total=" << total_mb << " mb"
         << " line_verts=" << line_verts_mb << " mb"
         << " fill_rect_instances=" << fill_rect_instances_mb << " mb"
-        << " fill_poly_verts=" << fill_poly_verts_mb << " mb"
+        << " fill_poly_mesh=" << fill_poly_mesh_mb << " mb"
         << " thick_instances=" << thick_instances_mb << " mb"
         << " dashed_instances=" << dashed_instances_mb << " mb"
         << " style_uniforms=" << style_uniforms_mb << " mb";
 #endif // EZGL_RENDERER_DEBUG
 
+    present_scene(std::move(scene_buffers));
+}
+
+SceneBuffers rhi_renderer::assemble_scene()
+{
+    dispatch_commands(/*build_picks=*/true);
+    m_pick_index = std::move(m_pick_build);
+
+    SceneBuffers scene_buffers = build_scene_buffers();
+    m_cmd_arrows.clear();  // see clear_commands(): arrows live until after build
+    return scene_buffers;
+}
+
+std::optional<rhi_renderer::AssembledFrame> rhi_renderer::assemble_detached()
+{
+    // Arrows survive begin_frame() (see clear_commands()), so a cancelled
+    // frame must drop them here or the next one draws them twice.
+    if (skip_recording()) {
+        m_cmd_arrows.clear();
+        return std::nullopt;
+    }
+
+    SceneBuffers scene_buffers = assemble_scene();
+    if (skip_recording())
+        return std::nullopt;
+
+    // Hand the layer over and record the next frame into a fresh one; the
+    // live renderer that adopts it owns it from now on.
+    AssembledFrame frame{std::move(scene_buffers), std::move(m_overlay_layer), std::move(m_pick_index)};
+    m_overlay_layer = std::make_shared<RhiOverlayLayer>(*m_camera);
+    return frame;
+}
+
+void rhi_renderer::present_detached(AssembledFrame frame)
+{
+    if (m_overlay_worker)
+        m_overlay_worker->cancel_pending();
+    m_overlay_layer = std::move(frame.overlay);
+    m_overlay_layer->cam = *m_camera;
+    m_pick_index = std::move(frame.picks);
+
+    if (m_rhi_widget) {
+        m_size = clamp_size({m_rhi_widget->width(), m_rhi_widget->height()});
+        m_overlay_dpr = m_rhi_widget->devicePixelRatioF();
+    }
+    post_overlay_job();
+    present_scene(std::move(frame.scene));
+}
+
+void rhi_renderer::present_scene(SceneBuffers scene_buffers)
+{
     m_rhi_widget->set_frame_data(
         std::move(scene_buffers),
         compute_mvp(),
         irenderer::get_visible_world(),
-        m_overlay,
         m_bg_color);
 
     m_rhi_widget->update();
 }
 
-// ---- flush_capture ---------------------------------------------------------
+// ---- snapshots -------------------------------------------------------------
 
-rhi_renderer::HeadlessFrameData rhi_renderer::flush_capture(const QColor& bg)
+bool rhi_renderer::save_snapshot(const QString& path)
 {
-    render_cached_overlay();
-
+    // Serialize the overlay before posting it: the worker must not be
+    // replaying the layer while it is read here.
+    QByteArray overlay;
     {
-        std::vector<std::thread> workers;
-        workers.reserve(m_n_bands);
-        for (int b = 0; b < m_n_bands; ++b)
-            workers.emplace_back([this, b]() { dispatch_commands_to_tiles(b); });
-        for (auto& w : workers) w.join();
+        QDataStream out(&overlay, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_6_5);
+        overlay_recorder().save_recording(out);
     }
-    clear_commands();
+    if (m_overlay_worker)
+        post_overlay_job();
+
+    SceneBuffers scene_buffers = assemble_scene();
+    const bool ok = write_scene_snapshot(path, scene_buffers, m_camera->get_initial_world(), overlay);
+    if (ok)
+        q_debug("Scene snapshot written to %s (%.1f MB of geometry).",
+                qPrintable(path), double(scene_buffers.byte_size()) / (1024.0 * 1024.0));
+
+    if (m_rhi_widget)
+        present_scene(std::move(scene_buffers));
+    return ok;
+}
+
+bool rhi_renderer::load_snapshot(const QString& path)
+{
+    begin_frame();
+    m_pick_index.reset();
+
+    std::optional<SceneSnapshot> snapshot = read_scene_snapshot(path, m_scene_storage);
+    if (!snapshot)
+        return false;
+    if (snapshot->scene_bounds != m_camera->get_initial_world())
+        q_warning("scene snapshot %s was saved for another world extent; drawing it anyway.",
+                  qPrintable(path));
 
-    if (m_overlay_painter.isActive())
-        m_overlay_painter.end();
+    QDataStream in(snapshot->overlay);
+    in.setVersion(QDataStream::Qt_6_5);
+    if (!overlay_recorder().load_recording(in)) {
+        q_warning("scene snapshot %s: overlay stream is corrupt.", qPrintable(path));
+        return false;
+    }
+
+    if (m_rhi_widget) {
+        post_overlay_job();
+        present_scene(std::move(snapshot->scene));
+    } else {
+        m_loaded_scene = std::move(snapshot->scene);
+    }
+    return true;
+}
 
-    HeadlessFrameData out{build_scene_buffers(),
+// ---- flush_capture ---------------------------------------------------------
+
+rhi_renderer::HeadlessFrameData rhi_renderer::flush_capture(const QColor& bg)
+{
+    // A captured image is never picked from.
+    dispatch_commands(/*build_picks=*/false);
+
+    SceneBuffers scene = m_loaded_scene ? std::move(*m_loaded_scene) : build_scene_buffers();
+    m_loaded_scene.reset();
+    HeadlessFrameData out{std::make_shared<const SceneBuffers>(std::move(scene)),
                           compute_mvp(),
                           irenderer::get_visible_world(),
-                          m_overlay,
+                          RhiOverlayWorker::rasterize(*m_overlay_layer, *m_camera,
+                                                      m_size, m_overlay_dpr),
                           bg};
     m_cmd_arrows.clear();  // see clear_commands(): arrows live until after build
     return out;
 }
 
+std::optional<rhi_renderer::HeadlessFrameData> rhi_renderer::capture_presented(QSize size, const QColor& bg)
+{
+    std::shared_ptr<const SceneBuffers> scene = m_rhi_widget->presented_scene();
+    if (!scene)
+        return std::nullopt;
+    return capture_view(std::move(scene), size, bg);
+}
+
+rhi_renderer::HeadlessFrameData rhi_renderer::capture_view(std::shared_ptr<const SceneBuffers> scene,
+                                                           QSize                               size,
+                                                           const QColor&                       bg)
+{
+    // The worker may be replaying the layer. Let it finish rather than
+    // quiesce(): the jobs it holds are what the widget is waiting for.
+    if (m_overlay_worker && m_overlay_layer->queued_jobs.load(std::memory_order_acquire) != 0)
+        m_overlay_worker->drain();
+
+    const QSize capture_size = clamp_size(size);
+    return HeadlessFrameData{std::move(scene),
+                             compute_mvp(capture_size),
+                             irenderer::get_visible_world(),
+                             RhiOverlayWorker::rasterize(*m_overlay_layer, *m_camera,
+                                                         capture_size, 1.0),
+                             bg};
+}
+
 // ---- flush_mvp_only --------------------------------------------------------
 
-void rhi_renderer::flush_mvp_only()
+void rhi_renderer::flush_mvp_only(bool relayout_overlay)
 {
     // Pick up the widget's current size before computing the MVP. The
     // resize-only path skips begin_frame(), so without this refresh the
@@ -1708,9 +2100,11 @@ void rhi_renderer::flush_mvp_only()
         m_overlay_dpr = m_rhi_widget->devicePixelRatioF();
     }
 
-    render_cached_overlay();
-    m_rhi_widget->set_mvp_and_overlay(compute_mvp(), irenderer::get_visible_world(), m_overlay);
+    // The GPU reprojects the current overlay to the new MVP right away; the
+    // re-laid-out overlay follows from the worker without blocking this call.
+    m_rhi_widget->set_mvp_only(compute_mvp(), irenderer::get_visible_world());
     m_rhi_widget->update();
+    post_overlay_job(relayout_overlay);
 }
 
 } // namespace ezgl
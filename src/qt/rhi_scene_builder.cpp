@@ -0,0 +1,113 @@
+#include "ezgl/qt/rhi_scene_builder.hpp"
+#include "ezgl/logutils.hpp"
+
+#include <utility>
+
+namespace ezgl {
+
+RhiSceneBuilder::RhiSceneBuilder(draw_canvas_fn draw_callback, QColor bg_color, deliver_fn deliver)
+    : m_draw_callback(draw_callback)
+    , m_bg_color(bg_color)
+    , m_deliver(std::move(deliver))
+    , m_cam(rectangle{})
+    , m_thread(&RhiSceneBuilder::run, this)
+{
+}
+
+RhiSceneBuilder::~RhiSceneBuilder()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.reset();
+        m_stop = true;
+        m_cancel.store(true, std::memory_order_relaxed);
+    }
+    m_wake.notify_all();
+    m_thread.join();
+}
+
+void RhiSceneBuilder::post(Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.emplace(std::move(job));
+        if (m_busy)
+            m_cancel.store(true, std::memory_order_relaxed);
+    }
+    m_wake.notify_one();
+}
+
+void RhiSceneBuilder::cancel()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.reset();
+    if (m_busy)
+        m_cancel.store(true, std::memory_order_relaxed);
+}
+
+void RhiSceneBuilder::cancel_and_wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_pending.reset();
+    if (m_busy)
+        m_cancel.store(true, std::memory_order_relaxed);
+    m_idle.wait(lock, [this]() { return !m_busy; });
+}
+
+void RhiSceneBuilder::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this]() { return !m_busy && !m_pending.has_value(); });
+}
+
+bool RhiSceneBuilder::busy() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_busy || m_pending.has_value();
+}
+
+void RhiSceneBuilder::run()
+{
+    using namespace std::placeholders;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wake.wait(lock, [this]() { return m_stop || m_pending.has_value(); });
+        if (m_stop)
+            return;
+
+        Job job = std::move(*m_pending);
+        m_pending.reset();
+        m_busy = true;
+        // Only a post() after this point may cancel the job.
+        m_cancel.store(false, std::memory_order_relaxed);
+        lock.unlock();
+
+        m_cam = job.cam;
+        if (!m_renderer) {
+            m_renderer = std::make_unique<rhi_renderer>(
+                job.size,
+                std::bind(&camera::world_to_screen, &m_cam, _1),
+                &m_cam,
+                m_draw_callback,
+                m_bg_color);
+            m_renderer->set_cancel_token(&m_cancel);
+        }
+        m_renderer->set_scene_storage(job.storage);
+
+        m_renderer->begin_frame();
+        m_draw_callback(m_renderer.get());
+        std::optional<rhi_renderer::AssembledFrame> frame = m_renderer->assemble_detached();
+        if (frame)
+            m_deliver(job.generation, std::move(*frame));
+        else
+            q_debug("Background scene build %llu cancelled.",
+                    static_cast<unsigned long long>(job.generation));
+
+        lock.lock();
+        m_busy = false;
+        m_idle.notify_all();
+    }
+}
+
+} // namespace ezgl
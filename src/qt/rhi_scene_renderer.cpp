@@ -20,24 +20,14 @@ namespace {
 
 constexpr std::size_t kMaxQrhiBufferBytes =
     std::size_t(std::numeric_limits<int>::max());
-constexpr std::size_t kInitialThinLineBufferBytes       = 1 * 1024 * 1024;
-constexpr std::size_t kInitialFillRectBufferBytes       = 512 * 1024;
-constexpr std::size_t kInitialFillPolyBufferBytes       = 512 * 1024;
-constexpr std::size_t kInitialThickInstanceBufferBytes  = 512 * 1024;
-constexpr std::size_t kInitialDashedInstanceBufferBytes = 512 * 1024;
-constexpr std::size_t kInitialArrowInstanceBufferBytes  = 512 * 1024;
 constexpr std::size_t kInitialStyleUniformBufferBytes   = 16 * 1024;
 
-constexpr std::size_t kMaxPosVerticesPerBuffer =
-    kMaxQrhiBufferBytes / sizeof(ezgl::PosVertex);
-constexpr std::size_t kMaxFillRectInstancesPerBuffer =
-    kMaxQrhiBufferBytes / sizeof(ezgl::FillRectInstance);
-constexpr std::size_t kMaxThickInstancesPerBuffer =
-    kMaxQrhiBufferBytes / sizeof(ezgl::ThickLineInstance);
-constexpr std::size_t kMaxDashedInstancesPerBuffer =
-    kMaxQrhiBufferBytes / sizeof(ezgl::DashedLineInstance);
-constexpr std::size_t kMaxArrowInstancesPerBuffer =
-    kMaxQrhiBufferBytes / sizeof(ezgl::ArrowInstance);
+// Sub-allocation alignment inside the geometry pools. 16 covers every
+// vertex/instance struct's natural alignment on all backends; 4 keeps
+// 16-bit index ranges valid where NonFourAlignedEffectiveIndexBufferOffset
+// is unsupported.
+constexpr std::size_t kVertexPoolAlignment = 16;
+constexpr std::size_t kIndexPoolAlignment  = 4;
 
 // MVP UBO layout (std140, binding 0):
 //   offset  0 : mat4  mvp      (64 bytes)
@@ -54,6 +44,19 @@ static_assert(sizeof(StyleUniform) == 32, "StyleUniform must match two std140 ve
 struct OverlayVertex { float x, y, u, v; };
 static_assert(sizeof(OverlayVertex) == 16, "OverlayVertex must be 16 bytes");
 
+// Full-viewport overlay quad (NDC corners, texture coordinates).
+const OverlayVertex kOverlayQuad[4] = {
+    { -1.0f, +1.0f, 0.0f, 0.0f }, { -1.0f, -1.0f, 0.0f, 1.0f },
+    { +1.0f, +1.0f, 1.0f, 0.0f }, { +1.0f, -1.0f, 1.0f, 1.0f }
+};
+
+// Texel coordinate of `v` on a ring of `n` texels.
+int wrap_texel(int v, int n)
+{
+    v %= n;
+    return v < 0 ? v + n : v;
+}
+
 std::size_t alignUp(std::size_t value, std::size_t alignment)
 {
     if (alignment == 0) return value;
@@ -111,12 +114,86 @@ bool ensureDynamicBuf(QRhi*                        rhi,
     return true;
 }
 
-void releaseDynamicBuf(std::unique_ptr<QRhiBuffer>& buf)
+void releaseBufLater(std::unique_ptr<QRhiBuffer>& buf)
 {
     QRhiBuffer* old = buf.release();
     if (old) old->deleteLater();
 }
 
+// Byte-level sub-allocation plan for one geometry pool: how full each
+// pool buffer will be once every chunk has been placed.
+struct PoolPlan {
+    std::size_t              alignment;
+    std::vector<std::size_t> buffer_bytes;
+
+    struct Placement { std::size_t buffer, byte_offset, count; };
+
+    // Reserve as many of @p count elements as fit in the current buffer
+    // (at least one; opens a new buffer otherwise).
+    Placement placeSome(std::size_t count, std::size_t elem_size)
+    {
+        std::size_t at = buffer_bytes.empty() ? 0 : alignUp(buffer_bytes.back(), alignment);
+        if (buffer_bytes.empty() || at + elem_size > kMaxQrhiBufferBytes) {
+            buffer_bytes.push_back(0);
+            at = 0;
+        }
+        const std::size_t fit = std::min(count, (kMaxQrhiBufferBytes - at) / elem_size);
+        buffer_bytes.back() = at + fit * elem_size;
+        return {buffer_bytes.size() - 1, at, fit};
+    }
+
+    // Reserve all @p count elements contiguously in one buffer (indexed
+    // chunks use chunk-local indices, so they cannot be split).
+    Placement placeAll(std::size_t count, std::size_t elem_size)
+    {
+        const std::size_t bytes = count * elem_size;
+        if (bytes > kMaxQrhiBufferBytes)
+            qFatal("RhiSceneRenderer: indexed chunk of %zu bytes exceeds the buffer limit", bytes);
+        std::size_t at = buffer_bytes.empty() ? 0 : alignUp(buffer_bytes.back(), alignment);
+        if (buffer_bytes.empty() || at + bytes > kMaxQrhiBufferBytes) {
+            buffer_bytes.push_back(0);
+            at = 0;
+        }
+        buffer_bytes.back() = at + bytes;
+        return {buffer_bytes.size() - 1, at, count};
+    }
+};
+
+// Replace @p pool with exact-size Immutable buffers for @p plan. The
+// previous buffers go through deleteLater() so frames still in flight
+// keep reading valid memory.
+void reallocatePool(QRhi*                                     rhi,
+                    std::vector<std::unique_ptr<QRhiBuffer>>& pool,
+                    const PoolPlan&                           plan,
+                    QRhiBuffer::UsageFlags                    usage)
+{
+    for (std::unique_ptr<QRhiBuffer>& buf : pool) releaseBufLater(buf);
+    pool.clear();
+    pool.reserve(plan.buffer_bytes.size());
+    for (std::size_t bytes : plan.buffer_bytes) {
+        const std::size_t size = std::max<std::size_t>(
+            std::min(alignUp(bytes, plan.alignment), kMaxQrhiBufferBytes), plan.alignment);
+        pool.emplace_back(rhi->newBuffer(QRhiBuffer::Immutable, usage, int(size)));
+        if (!pool.back()->create())
+            q_warning("RhiSceneRenderer: failed to allocate %zu-byte geometry buffer", size);
+    }
+}
+
+// Upload order key: chunks inside @p view first, then the rest by
+// distance from its centre, so the visible region fills in first and the
+// surroundings follow outward.
+double uploadPriority(const ezgl::rectangle& bounds, const ezgl::rectangle& view)
+{
+    const double view_cx = 0.5 * (view.left() + view.right());
+    const double view_cy = 0.5 * (view.bottom() + view.top());
+    const double dx = 0.5 * (bounds.left() + bounds.right()) - view_cx;
+    const double dy = 0.5 * (bounds.bottom() + bounds.top()) - view_cy;
+    const double dist2 = dx * dx + dy * dy;
+    const bool visible = !(bounds.right() < view.left() || bounds.left() > view.right()
+                        || bounds.top() < view.bottom() || bounds.bottom() > view.top());
+    return visible ? -1.0 / (1.0 + dist2) : dist2;
+}
+
 void buildPipeline(QRhi*                                   rhi,
                    std::unique_ptr<QRhiGraphicsPipeline>&  pso,
                    QRhiGraphicsPipeline::Topology           topology,
@@ -373,7 +450,7 @@ RhiSceneRenderer::~RhiSceneRenderer()
     release();
 }
 
-void RhiSceneRenderer::initialize(QRhi* rhi, QRhiRenderPassDescriptor* rp_desc)
+void RhiSceneRenderer::initialize(QRhi* rhi, QRhiRenderPassDescriptor* rp_desc, int frame_slots)
 {
     release(); // safe to re-initialize
 
@@ -392,19 +469,23 @@ void RhiSceneRenderer::initialize(QRhi* rhi, QRhiRenderPassDescriptor* rp_desc)
     QShader overlay_vs   = loadShader(":/ezgl/overlay.vert.qsb");
     QShader overlay_fs   = loadShader(":/ezgl/overlay.frag.qsb");
 
-    const int n_slots = std::max(1, rhi->resourceLimit(QRhi::FramesInFlight));
+    const int n_slots = frame_slots > 0
+                            ? frame_slots
+                            : std::max(1, rhi->resourceLimit(QRhi::FramesInFlight));
     m_frame_resources.clear();
     m_frame_resources.resize(std::size_t(n_slots));
-    m_frame_slot_geom_valid.assign(std::size_t(n_slots), false);
+    m_frame_slot_style_valid.assign(std::size_t(n_slots), false);
 
     // Linear, not Nearest: the overlay QImage is the same size as the
     // framebuffer in the common case, but HiDPI / DPR != 1 / fractional
     // scaling all introduce non-integer scaling at blit time. Nearest
     // there produces blocky text edges; Linear preserves the QPainter's
     // antialiased glyphs cleanly.
+    // Repeat, because the overlay texture is a ring (see upload_overlay()):
+    // the quad's texture coordinates run past 1.0 by the ring origin.
     m_overlay_sampler.reset(rhi->newSampler(
         QRhiSampler::Linear, QRhiSampler::Linear, QRhiSampler::None,
-        QRhiSampler::ClampToEdge, QRhiSampler::ClampToEdge));
+        QRhiSampler::Repeat, QRhiSampler::Repeat));
     m_overlay_sampler->create();
 
     for (FrameResources& fr : m_frame_resources) {
@@ -418,24 +499,28 @@ void RhiSceneRenderer::initialize(QRhi* rhi, QRhiRenderPassDescriptor* rp_desc)
         fr.style_ubuf->create();
         fr.overlay_tex.reset(rhi->newTexture(QRhiTexture::RGBA8, QSize(1, 1)));
         fr.overlay_tex->create();
-        fr.thin_line_vbufs.clear();
-        fr.fill_rect_instance_vbufs.clear();
-        fr.fill_poly_vbufs.clear();
-        fr.thick_line_instance_vbufs.clear();
-        fr.dashed_line_instance_vbufs.clear();
-        fr.arrow_instance_vbufs.clear();
-        fr.gpu_scene.clear();
+        fr.overlay_quad_vbuf.reset(rhi->newBuffer(
+            QRhiBuffer::Dynamic, QRhiBuffer::VertexBuffer,
+            int(4 * sizeof(OverlayVertex))));
+        fr.overlay_quad_vbuf->create();
     }
 
+    // Constant geometry: uploaded once by the first render() after this.
     m_thick_line_corner_vbuf.reset(rhi->newBuffer(
-        QRhiBuffer::Dynamic, QRhiBuffer::VertexBuffer,
+        QRhiBuffer::Immutable, QRhiBuffer::VertexBuffer,
         int(4 * sizeof(QuadCorner))));
     m_thick_line_corner_vbuf->create();
-
-    m_overlay_quad_vbuf.reset(rhi->newBuffer(
-        QRhiBuffer::Dynamic, QRhiBuffer::VertexBuffer,
-        int(4 * sizeof(OverlayVertex))));
-    m_overlay_quad_vbuf->create();
+    m_screen_quad_vbuf.reset(rhi->newBuffer(
+        QRhiBuffer::Immutable, QRhiBuffer::VertexBuffer,
+        int(sizeof(kOverlayQuad))));
+    m_screen_quad_vbuf->create();
+    m_corner_upload_pending = true;
+
+    // Geometry pools are rebuilt from m_cached_scene on the next render().
+    m_geom_vertex_pool.clear();
+    m_geom_index_pool.clear();
+    m_gpu_scene.clear();
+    m_geom_valid = false;
 
     for (FrameResources& fr : m_frame_resources) {
         fr.srb.reset(rhi->newShaderResourceBindings());
@@ -477,6 +562,7 @@ void RhiSceneRenderer::initialize(QRhi* rhi, QRhiRenderPassDescriptor* rp_desc)
                        arrow_vs, base_fs, geom_srb, rp_desc);
     buildOverlayPipeline(rhi, m_overlay_pso,
                          overlay_vs, overlay_fs, over_srb, rp_desc);
+    m_overlay_tiles.initialize(rhi, rp_desc, n_slots, overlay_vs, overlay_fs, over_srb);
 
     m_initialized = true;
 }
@@ -489,33 +575,25 @@ void RhiSceneRenderer::render(QRhiCommandBuffer*                         cb,
                                const std::shared_ptr<const SceneBuffers>& scene,
                                const QMatrix4x4&                          mvp,
                                const rectangle&                           visible_world,
-                               const QImage&                              overlay_in,
+                               const OverlayFrame&                        overlay,
                                QColor                                     bg)
 {
     if (!m_initialized || m_frame_resources.empty())
         return;
 
-    // Update the per-frame-slot geometry cache if needed.
+    // A new geometry revision replaces the shared pools once; every frame
+    // slot then only needs its own copy of the (small) style table.
     if (geom_dirty && scene) {
-        m_cached_scene = scene;
-        std::fill(m_frame_slot_geom_valid.begin(), m_frame_slot_geom_valid.end(), false);
+        m_cached_scene       = scene;
+        m_cached_scene_bytes = scene->byte_size();
+        m_geom_valid         = false;
+        m_had_scene          = true;
     }
 
-    const bool need_geom_for_slot =
-        std::size_t(frame_slot) < m_frame_slot_geom_valid.size()
-        && !m_frame_slot_geom_valid[std::size_t(frame_slot)]
-        && m_cached_scene;
-
-    const bool upload_geom = geom_dirty || need_geom_for_slot;
-    const std::shared_ptr<const SceneBuffers>& scene_buffers =
-        upload_geom ? (scene ? scene : m_cached_scene) : nullptr;
-
     FrameResources& fr = m_frame_resources[std::size_t(frame_slot)];
 
-    QImage overlay = overlay_in;
-    const bool has_overlay = !overlay.isNull();
-    if (has_overlay)
-        overlay = overlay.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+    const bool has_overlay        = !overlay.image.isNull();
+    const bool has_screen_overlay = !overlay.screen.isNull();
 
     // ---- Upload -------------------------------------------------------------
     QRhiResourceUpdateBatch* u = m_rhi->nextResourceUpdateBatch();
@@ -527,215 +605,82 @@ void RhiSceneRenderer::render(QRhiCommandBuffer*                         cb,
         u->updateDynamicBuffer(fr.mvp_ubuf.get(), 64, int(sizeof(vp)), vp);
     }
 
-    // Constant quad-corner buffer (same every frame, safe after re-init)
-    {
+    // Constant quad-corner buffer (once per initialize())
+    if (m_corner_upload_pending) {
         static const QuadCorner kCorners[4] = {
             { 0.0f, -1.0f }, { 0.0f, +1.0f }, { 1.0f, -1.0f }, { 1.0f, +1.0f }
         };
-        u->updateDynamicBuffer(m_thick_line_corner_vbuf.get(), 0,
-                               int(sizeof(kCorners)), kCorners);
-    }
-    {
-        static const OverlayVertex kQuad[4] = {
-            { -1.0f, +1.0f, 0.0f, 0.0f }, { -1.0f, -1.0f, 0.0f, 1.0f },
-            { +1.0f, +1.0f, 1.0f, 0.0f }, { +1.0f, -1.0f, 1.0f, 1.0f }
-        };
-        u->updateDynamicBuffer(m_overlay_quad_vbuf.get(), 0,
-                               int(sizeof(kQuad)), kQuad);
+        u->uploadStaticBuffer(m_thick_line_corner_vbuf.get(), kCorners);
+        u->uploadStaticBuffer(m_screen_quad_vbuf.get(), kOverlayQuad);
+        m_corner_upload_pending = false;
     }
 
-    // Overlay texture
+    // Overlay texture (before the quad: the quad carries the ring origin)
     if (has_overlay) {
-        const QSize overlay_size = overlay.size();
-        if (!fr.overlay_tex || fr.overlay_tex->pixelSize() != overlay_size) {
-            fr.overlay_srb.reset();
-            fr.overlay_tex.reset(m_rhi->newTexture(QRhiTexture::RGBA8, overlay_size));
-            fr.overlay_tex->create();
-            fr.overlay_srb.reset(m_rhi->newShaderResourceBindings());
-            fr.overlay_srb->setBindings({
-                QRhiShaderResourceBinding::sampledTexture(
-                    0, QRhiShaderResourceBinding::FragmentStage,
-                    fr.overlay_tex.get(), m_overlay_sampler.get())
-            });
-            fr.overlay_srb->create();
+        if (ensure_overlay_texture(fr.overlay_tex, fr.overlay_srb, overlay.image.size()))
+            fr.overlay_serial = 0;
+        upload_overlay(u, fr, overlay);
+    }
+    if (has_screen_overlay) {
+        if (ensure_overlay_texture(fr.screen_tex, fr.screen_srb, overlay.screen.size()))
+            fr.screen_serial = 0;
+        if (fr.screen_serial != overlay.screen_serial || overlay.screen_serial == 0) {
+            u->uploadTexture(fr.screen_tex.get(),
+                             overlay.screen.convertToFormat(QImage::Format_RGBA8888_Premultiplied));
+            fr.screen_serial = overlay.screen_serial;
         }
-        u->uploadTexture(fr.overlay_tex.get(), overlay);
     }
-
-    // Geometry: style UBO + vertex buffers
-    if (upload_geom && scene_buffers) {
-        struct PendingUpload {
-            quint32     buffer_index;
-            quint32     byte_offset;
-            quint32     byte_size;
-            const void* data;
-        };
-
-        const std::size_t style_stride =
-            alignUp(sizeof(StyleUniform), std::size_t(m_rhi->ubufAlignment()));
-        const std::size_t total_style_count =
-            scene_buffers->thin_lines.size() + scene_buffers->fill_rects.size()
-            + scene_buffers->fill_polys.size() + scene_buffers->thick_lines.size()
-            + scene_buffers->dashed_lines.size() + scene_buffers->arrows.size();
-
-        std::vector<std::uint8_t> style_uniform_bytes(total_style_count * style_stride, 0);
-        std::size_t next_style_index = 0;
-        auto assign_style_offset = [&](StyleKey sk, std::uint32_t rgba) {
-            const std::size_t offset = next_style_index * style_stride;
-            const StyleUniform su = makeStyleUniform(sk, rgba);
-            std::memcpy(style_uniform_bytes.data() + offset, &su, sizeof(StyleUniform));
-            ++next_style_index;
-            return quint32(offset);
-        };
-
-        std::vector<std::size_t> thin_counts, fill_rect_counts, fill_poly_counts,
-                                  thick_counts, dashed_counts, arrow_counts;
-        std::vector<PendingUpload> thin_uploads, fill_rect_uploads, fill_poly_uploads,
-                                    thick_uploads, dashed_uploads, arrow_uploads;
-        fr.gpu_scene.clear();
-
-        auto planStyleBuffers = [&](const auto& scene_map,
-                                     auto&        gpu_buffers,
-                                     auto&        uploads,
-                                     auto&        buffer_counts,
-                                     std::size_t  elem_size,
-                                     std::size_t  max_per_buffer,
-                                     auto         get_data) {
-            for (const auto& [sk, sb] : scene_map) {
-                const auto& data = get_data(sb);
-                if (data.empty()) continue;
-
-                GpuStyleBuffer gpu_buf;
-                gpu_buf.style_key    = sk;
-                gpu_buf.rgba         = sb.rgba;
-                gpu_buf.style_offset = assign_style_offset(sk, sb.rgba);
-
-                for (const Chunk& chunk : sb.chunks) {
-                    std::size_t remaining  = chunk.count;
-                    std::size_t data_offset = chunk.offset;
-                    while (remaining > 0) {
-                        if (buffer_counts.empty() || buffer_counts.back() == max_per_buffer)
-                            buffer_counts.push_back(0);
-
-                        const std::size_t buf_idx    = buffer_counts.size() - 1;
-                        const std::size_t buf_offset = buffer_counts.back();
-                        const std::size_t count      = std::min(remaining, max_per_buffer - buf_offset);
-                        const std::size_t byte_off   = buf_offset * elem_size;
-                        const std::size_t byte_sz    = count * elem_size;
-
-                        gpu_buf.chunks.emplace_back(
-                            GpuChunk{chunk.world_bounds, quint32(buf_idx),
-                                     quint32(byte_off), quint32(count)});
-                        uploads.emplace_back(
-                            PendingUpload{quint32(buf_idx), quint32(byte_off),
-                                          quint32(byte_sz),
-                                          static_cast<const void*>(data.data() + data_offset)});
-                        buffer_counts.back() += count;
-                        remaining   -= count;
-                        data_offset += count;
-                    }
-                }
-                gpu_buffers.push_back(std::move(gpu_buf));
+    m_overlay_tiles.prepare(u, frame_slot, overlay.tiles, mvp, pixel_size);
+    {
+        // The overlay covers the full viewport of the camera it was laid
+        // out for. If the camera has moved since (the worker is still
+        // painting the replacement), map its corners NDC→world→NDC so the
+        // old text stays pinned to the scene. Both matrices are 2D affine,
+        // so warping the 4 corners is exact. SCREEN content has its own
+        // image and quad, which stay put.
+        bool invertible = false;
+        const QMatrix4x4 reproject = mvp * overlay.mvp.inverted(&invertible);
+        const QSize ring_size = fr.overlay_tex ? fr.overlay_tex->pixelSize() : QSize(1, 1);
+        const float ring_u = float(fr.overlay_origin.x()) / float(ring_size.width());
+        const float ring_v = float(fr.overlay_origin.y()) / float(ring_size.height());
+        OverlayVertex quad[4];
+        for (int i = 0; i < 4; ++i) {
+            quad[i] = kOverlayQuad[i];
+            quad[i].u += ring_u;
+            quad[i].v += ring_v;
+            if (invertible) {
+                const QPointF p = reproject.map(QPointF(kOverlayQuad[i].x, kOverlayQuad[i].y));
+                quad[i].x = float(p.x());
+                quad[i].y = float(p.y());
             }
-        };
+        }
+        u->updateDynamicBuffer(fr.overlay_quad_vbuf.get(), 0,
+                               int(sizeof(quad)), quad);
+    }
 
-        planStyleBuffers(scene_buffers->thin_lines,   fr.gpu_scene.thin_lines,
-                         thin_uploads,   thin_counts,  sizeof(PosVertex),
-                         kMaxPosVerticesPerBuffer,
-                         [](const ThinLineStyleBuffer& b) -> const auto& { return b.verts; });
-        planStyleBuffers(scene_buffers->fill_rects,   fr.gpu_scene.fill_rects,
-                         fill_rect_uploads, fill_rect_counts, sizeof(FillRectInstance),
-                         kMaxFillRectInstancesPerBuffer,
-                         [](const FillRectStyleBuffer& b) -> const auto& { return b.instances; });
-        planStyleBuffers(scene_buffers->fill_polys,   fr.gpu_scene.fill_polys,
-                         fill_poly_uploads, fill_poly_counts, sizeof(PosVertex),
-                         kMaxPosVerticesPerBuffer,
-                         [](const FillPolyStyleBuffer& b) -> const auto& { return b.verts; });
-        planStyleBuffers(scene_buffers->thick_lines,  fr.gpu_scene.thick_lines,
-                         thick_uploads, thick_counts, sizeof(ThickLineInstance),
-                         kMaxThickInstancesPerBuffer,
-                         [](const ThickLineStyleBuffer& b) -> const auto& { return b.instances; });
-        planStyleBuffers(scene_buffers->dashed_lines, fr.gpu_scene.dashed_lines,
-                         dashed_uploads, dashed_counts, sizeof(DashedLineInstance),
-                         kMaxDashedInstancesPerBuffer,
-                         [](const DashedLineStyleBuffer& b) -> const auto& { return b.instances; });
-        planStyleBuffers(scene_buffers->arrows,       fr.gpu_scene.arrows,
-                         arrow_uploads, arrow_counts, sizeof(ArrowInstance),
-                         kMaxArrowInstancesPerBuffer,
-                         [](const ArrowStyleBuffer& b) -> const auto& { return b.instances; });
-
-        // Ensure / grow style UBO. If the buffer is reallocated, the
-        // fr.srb that was built once in initialize() still references the
-        // old (deleted-pending) QRhiBuffer pointer. D3D11/Metal/Vulkan
-        // cache the SRB's resource references at create() time, so the
-        // shader ends up reading stale data — symptom: blank scene with
-        // only the screen-space overlay visible. OpenGL re-resolves the
-        // SRB each draw and accidentally hides the bug on Linux. Rebuild
-        // the SRB whenever style_ubuf is recreated so the new buffer
-        // pointer is picked up. mvp_ubuf is never reallocated, so the
-        // other binding is stable.
-        const std::size_t style_ubuf_bytes =
-            std::max(style_stride, style_uniform_bytes.empty() ? 0 : style_uniform_bytes.size());
-        const bool style_ubuf_recreated = ensureDynamicBuf(
-            m_rhi, fr.style_ubuf, QRhiBuffer::UniformBuffer,
-            style_ubuf_bytes,
-            std::max<std::size_t>(kInitialStyleUniformBufferBytes, style_stride));
-        if (style_ubuf_recreated) {
-            fr.srb->setBindings({
-                QRhiShaderResourceBinding::uniformBuffer(
-                    0, QRhiShaderResourceBinding::VertexStage, fr.mvp_ubuf.get()),
-                QRhiShaderResourceBinding::uniformBufferWithDynamicOffset(
-                    1,
-                    QRhiShaderResourceBinding::VertexStage |
-                    QRhiShaderResourceBinding::FragmentStage,
-                    fr.style_ubuf.get(), sizeof(StyleUniform))
-            });
-            fr.srb->create();
+    // Geometry: shared device-local pools, then this slot's style UBO.
+    // Chunks stream in visible-first under m_upload_budget_bytes; until a
+    // chunk is resident the draw loops skip it.
+    if (!m_geom_valid && m_cached_scene) {
+        plan_scene_geometry(*m_cached_scene);
+        m_geom_valid = true;
+        std::fill(m_frame_slot_style_valid.begin(), m_frame_slot_style_valid.end(), false);
+    }
+    if (m_geom_valid && upload_pending()) {
+        upload_pending_chunks(u, visible_world);
+        // uploadStaticBuffer() has copied the bytes into the batch, so in
+        // lean mode the CPU scene can go once the last chunk is queued; the
+        // caller's snapshot is the only other reference and dies when
+        // render() returns.
+        if (!upload_pending() && !m_retain_cpu_scene) {
+            m_cached_scene.reset();
+            m_cached_scene_bytes = 0;
         }
-        if (!style_uniform_bytes.empty())
-            u->updateDynamicBuffer(fr.style_ubuf.get(), 0,
-                                   int(style_uniform_bytes.size()),
-                                   style_uniform_bytes.data());
-
-        // Ensure / grow vertex / instance buffers
-        auto trimBuffers = [](std::vector<std::unique_ptr<QRhiBuffer>>& v, std::size_t keep) {
-            for (std::size_t i = keep; i < v.size(); ++i) releaseDynamicBuf(v[i]);
-            v.resize(keep);
-        };
-        auto ensurePool = [&](std::vector<std::unique_ptr<QRhiBuffer>>& pool,
-                               const std::vector<std::size_t>&           counts,
-                               std::size_t                               elem_size,
-                               std::size_t                               initial_bytes) {
-            if (pool.size() < counts.size()) pool.resize(counts.size());
-            for (std::size_t i = 0; i < counts.size(); ++i) {
-                if (counts[i] == 0) continue;
-                ensureDynamicBuf(m_rhi, pool[i], QRhiBuffer::VertexBuffer,
-                                 counts[i] * elem_size, initial_bytes);
-            }
-            trimBuffers(pool, counts.size());
-        };
-        ensurePool(fr.thin_line_vbufs,          thin_counts,      sizeof(PosVertex),        kInitialThinLineBufferBytes);
-        ensurePool(fr.fill_rect_instance_vbufs, fill_rect_counts, sizeof(FillRectInstance), kInitialFillRectBufferBytes);
-        ensurePool(fr.fill_poly_vbufs,          fill_poly_counts, sizeof(PosVertex),        kInitialFillPolyBufferBytes);
-        ensurePool(fr.thick_line_instance_vbufs,thick_counts,     sizeof(ThickLineInstance),kInitialThickInstanceBufferBytes);
-        ensurePool(fr.dashed_line_instance_vbufs,dashed_counts,   sizeof(DashedLineInstance),kInitialDashedInstanceBufferBytes);
-        ensurePool(fr.arrow_instance_vbufs,    arrow_counts,     sizeof(ArrowInstance),    kInitialArrowInstanceBufferBytes);
-
-        auto uploadPool = [&](std::vector<std::unique_ptr<QRhiBuffer>>& pool,
-                               const std::vector<PendingUpload>&         uploads_list) {
-            for (const PendingUpload& up : uploads_list)
-                u->updateDynamicBuffer(pool[up.buffer_index].get(),
-                                       int(up.byte_offset), int(up.byte_size), up.data);
-        };
-        uploadPool(fr.thin_line_vbufs,          thin_uploads);
-        uploadPool(fr.fill_rect_instance_vbufs, fill_rect_uploads);
-        uploadPool(fr.fill_poly_vbufs,          fill_poly_uploads);
-        uploadPool(fr.thick_line_instance_vbufs,thick_uploads);
-        uploadPool(fr.dashed_line_instance_vbufs,dashed_uploads);
-        uploadPool(fr.arrow_instance_vbufs,    arrow_uploads);
-
-        if (std::size_t(frame_slot) < m_frame_slot_geom_valid.size())
-            m_frame_slot_geom_valid[std::size_t(frame_slot)] = true;
+    }
+    if (m_geom_valid && std::size_t(frame_slot) < m_frame_slot_style_valid.size()
+        && !m_frame_slot_style_valid[std::size_t(frame_slot)]) {
+        upload_style_uniforms(u, fr);
+        m_frame_slot_style_valid[std::size_t(frame_slot)] = true;
     }
 
     // ---- Record draw commands -----------------------------------------------
@@ -744,13 +689,13 @@ void RhiSceneRenderer::render(QRhiCommandBuffer*                         cb,
 
     auto drawStyled = [&](QRhiGraphicsPipeline*            pso,
                            const std::vector<GpuStyleBuffer>& styles,
-                           std::vector<std::unique_ptr<QRhiBuffer>>& vbufs,
                            bool instanced, bool use_corner_buf) {
         cb->setGraphicsPipeline(pso);
         for (const GpuStyleBuffer& style : styles) {
             const QRhiCommandBuffer::DynamicOffset dyn{1, style.style_offset};
             bool style_bound = false;
             for (const GpuChunk& chunk : style.chunks) {
+                if (!m_chunk_resident[chunk.resident_slot]) continue;
                 if (!rectanglesIntersect(chunk.world_bounds, visible_world)) continue;
                 if (!style_bound) {
                     cb->setShaderResources(fr.srb.get(), 1, &dyn);
@@ -759,18 +704,18 @@ void RhiSceneRenderer::render(QRhiCommandBuffer*                         cb,
                 if (use_corner_buf) {
                     const QRhiCommandBuffer::VertexInput inputs[2] = {
                         { m_thick_line_corner_vbuf.get(), 0 },
-                        { vbufs[chunk.buffer_index].get(), chunk.byte_offset }
+                        { m_geom_vertex_pool[chunk.buffer_index].get(), chunk.byte_offset }
                     };
                     cb->setVertexInput(0, 2, inputs);
                     cb->draw(4, chunk.count);
                 } else if (instanced) {
                     const QRhiCommandBuffer::VertexInput vi{
-                        vbufs[chunk.buffer_index].get(), chunk.byte_offset};
+                        m_geom_vertex_pool[chunk.buffer_index].get(), chunk.byte_offset};
                     cb->setVertexInput(0, 1, &vi);
                     cb->draw(4, chunk.count); // TriangleStrip instanced
                 } else {
                     const QRhiCommandBuffer::VertexInput vi{
-                        vbufs[chunk.buffer_index].get(), chunk.byte_offset};
+                        m_geom_vertex_pool[chunk.buffer_index].get(), chunk.byte_offset};
                     cb->setVertexInput(0, 1, &vi);
                     cb->draw(chunk.count);
                 }
@@ -778,28 +723,54 @@ void RhiSceneRenderer::render(QRhiCommandBuffer*                         cb,
         }
     };
 
-    drawStyled(m_fill_rect_pso.get(),  fr.gpu_scene.fill_rects,  fr.fill_rect_instance_vbufs,  true,  false);
-    drawStyled(m_fill_poly_pso.get(),  fr.gpu_scene.fill_polys,  fr.fill_poly_vbufs,            false, false);
-    drawStyled(m_line_pso.get(),       fr.gpu_scene.thin_lines,  fr.thin_line_vbufs,            false, false);
-    drawStyled(m_dashed_line_pso.get(),fr.gpu_scene.dashed_lines,fr.dashed_line_instance_vbufs, false, true);
-    drawStyled(m_thick_line_pso.get(), fr.gpu_scene.thick_lines, fr.thick_line_instance_vbufs,  false, true);
+    drawStyled(m_fill_rect_pso.get(),  m_gpu_scene.fill_rects,  true,  false);
+
+    // Filled polygons: one drawIndexed per visible chunk.
+    if (!m_gpu_scene.fill_polys.empty()) {
+        cb->setGraphicsPipeline(m_fill_poly_pso.get());
+        for (const GpuIndexedStyleBuffer& style : m_gpu_scene.fill_polys) {
+            const QRhiCommandBuffer::DynamicOffset dyn{1, style.style_offset};
+            bool style_bound = false;
+            for (const GpuIndexedChunk& chunk : style.chunks) {
+                if (!m_chunk_resident[chunk.resident_slot]) continue;
+                if (!rectanglesIntersect(chunk.world_bounds, visible_world)) continue;
+                if (!style_bound) {
+                    cb->setShaderResources(fr.srb.get(), 1, &dyn);
+                    style_bound = true;
+                }
+                const QRhiCommandBuffer::VertexInput vi{
+                    m_geom_vertex_pool[chunk.vertex_buffer_index].get(),
+                    chunk.vertex_byte_offset};
+                QRhiBuffer* ibuf = m_geom_index_pool[chunk.index_buffer_index].get();
+                cb->setVertexInput(0, 1, &vi, ibuf, chunk.index_byte_offset,
+                                   chunk.wide_indices ? QRhiCommandBuffer::IndexUInt32
+                                                      : QRhiCommandBuffer::IndexUInt16);
+                cb->drawIndexed(chunk.index_count);
+            }
+        }
+    }
+
+    drawStyled(m_line_pso.get(),       m_gpu_scene.thin_lines,   false, false);
+    drawStyled(m_dashed_line_pso.get(),m_gpu_scene.dashed_lines, false, true);
+    drawStyled(m_thick_line_pso.get(), m_gpu_scene.thick_lines,  false, true);
 
     // Arrow heads — single per-instance vertex binding, 3 vertices per
     // instance (Triangles topology). The vertex shader picks the corner via
     // gl_VertexIndex and synthesises the arrow at a constant SCREEN-pixel
     // size from style.line.x = arrow_size_px.
-    if (!fr.gpu_scene.arrows.empty()) {
+    if (!m_gpu_scene.arrows.empty()) {
         cb->setGraphicsPipeline(m_arrow_pso.get());
-        for (const GpuStyleBuffer& style : fr.gpu_scene.arrows) {
+        for (const GpuStyleBuffer& style : m_gpu_scene.arrows) {
             const QRhiCommandBuffer::DynamicOffset dyn{1, style.style_offset};
             bool style_bound = false;
             for (const GpuChunk& chunk : style.chunks) {
+                if (!m_chunk_resident[chunk.resident_slot]) continue;
                 if (!style_bound) {
                     cb->setShaderResources(fr.srb.get(), 1, &dyn);
                     style_bound = true;
                 }
                 const QRhiCommandBuffer::VertexInput vi{
-                    fr.arrow_instance_vbufs[chunk.buffer_index].get(),
+                    m_geom_vertex_pool[chunk.buffer_index].get(),
                     chunk.byte_offset};
                 cb->setVertexInput(0, 1, &vi);
                 cb->draw(3, chunk.count);
@@ -807,10 +778,20 @@ void RhiSceneRenderer::render(QRhiCommandBuffer*                         cb,
         }
     }
 
+    m_overlay_tiles.draw(cb, frame_slot);
+
     if (has_overlay && fr.overlay_tex) {
         cb->setGraphicsPipeline(m_overlay_pso.get());
         cb->setShaderResources(fr.overlay_srb.get());
-        const QRhiCommandBuffer::VertexInput vi{m_overlay_quad_vbuf.get(), 0};
+        const QRhiCommandBuffer::VertexInput vi{fr.overlay_quad_vbuf.get(), 0};
+        cb->setVertexInput(0, 1, &vi);
+        cb->draw(4);
+    }
+
+    if (has_screen_overlay && fr.screen_tex) {
+        cb->setGraphicsPipeline(m_overlay_pso.get());
+        cb->setShaderResources(fr.screen_srb.get());
+        const QRhiCommandBuffer::VertexInput vi{m_screen_quad_vbuf.get(), 0};
         cb->setVertexInput(0, 1, &vi);
         cb->draw(4);
     }
@@ -818,8 +799,345 @@ void RhiSceneRenderer::render(QRhiCommandBuffer*                         cb,
     cb->endPass();
 }
 
+bool RhiSceneRenderer::ensure_overlay_texture(std::unique_ptr<QRhiTexture>&                tex,
+                                              std::unique_ptr<QRhiShaderResourceBindings>& srb,
+                                              const QSize&                                 size)
+{
+    if (tex && tex->pixelSize() == size)
+        return false;
+    srb.reset();
+    tex.reset(m_rhi->newTexture(QRhiTexture::RGBA8, size));
+    tex->create();
+    srb.reset(m_rhi->newShaderResourceBindings());
+    srb->setBindings({
+        QRhiShaderResourceBinding::sampledTexture(
+            0, QRhiShaderResourceBinding::FragmentStage,
+            tex.get(), m_overlay_sampler.get())
+    });
+    srb->create();
+    return true;
+}
+
+void RhiSceneRenderer::upload_overlay(QRhiResourceUpdateBatch* u,
+                                      FrameResources&          fr,
+                                      const OverlayFrame&      overlay)
+{
+    if (overlay.serial != 0 && fr.overlay_serial == overlay.serial)
+        return;
+
+    const QImage& image = overlay.image;
+    const int     w     = image.width();
+    const int     h     = image.height();
+
+    // Replay the updates this slot has not seen. Strips painted by an
+    // earlier update move along with the content of the later ones.
+    const std::uint64_t behind = overlay.serial - fr.overlay_serial;
+    bool               incremental = overlay.serial != 0 && fr.overlay_serial != 0
+                                     && fr.overlay_serial < overlay.serial
+                                     && behind <= overlay.history.size();
+    QPoint             shift;
+    std::vector<QRect> dirty;
+    if (incremental) {
+        for (std::size_t i = overlay.history.size() - std::size_t(behind); i < overlay.history.size(); ++i) {
+            const OverlayUpdate& step = overlay.history[i];
+            if (!step.incremental) {
+                incremental = false;
+                break;
+            }
+            for (QRect& r : dirty)
+                r.translate(step.shift);
+            dirty.insert(dirty.end(), step.exposed.begin(), step.exposed.end());
+            shift += step.shift;
+        }
+    }
+
+    if (!incremental) {
+        fr.overlay_origin = QPoint();
+        u->uploadTexture(fr.overlay_tex.get(),
+                         image.convertToFormat(QImage::Format_RGBA8888_Premultiplied));
+        fr.overlay_serial = overlay.serial;
+        return;
+    }
+
+    // Content moved by `shift`: move the ring origin the other way, so
+    // every texel kept from before is already where the quad samples it.
+    fr.overlay_origin = QPoint(wrap_texel(fr.overlay_origin.x() - shift.x(), w),
+                               wrap_texel(fr.overlay_origin.y() - shift.y(), h));
+
+    QList<QRhiTextureUploadEntry> entries;
+    const QRect bounds(0, 0, w, h);
+    for (const QRect& r : dirty) {
+        const QRect rect = r.intersected(bounds);
+        if (rect.isEmpty())
+            continue;
+        const QImage pixels = image.copy(rect).convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+        // On the ring the rect may wrap past the right and bottom edges:
+        // upload it in up to four pieces.
+        const int x0 = wrap_texel(rect.x() + fr.overlay_origin.x(), w);
+        const int y0 = wrap_texel(rect.y() + fr.overlay_origin.y(), h);
+        const int head_w = std::min(rect.width(),  w - x0);
+        const int head_h = std::min(rect.height(), h - y0);
+        for (int wrapped_y = 0; wrapped_y < 2; ++wrapped_y) {
+            for (int wrapped_x = 0; wrapped_x < 2; ++wrapped_x) {
+                const int src_x  = wrapped_x ? head_w : 0;
+                const int src_y  = wrapped_y ? head_h : 0;
+                const int part_w = wrapped_x ? rect.width()  - head_w : head_w;
+                const int part_h = wrapped_y ? rect.height() - head_h : head_h;
+                if (part_w <= 0 || part_h <= 0)
+                    continue;
+                QRhiTextureSubresourceUploadDescription desc(pixels);
+                desc.setSourceTopLeft(QPoint(src_x, src_y));
+                desc.setSourceSize(QSize(part_w, part_h));
+                desc.setDestinationTopLeft(QPoint(wrapped_x ? 0 : x0, wrapped_y ? 0 : y0));
+                entries.append(QRhiTextureUploadEntry(0, 0, desc));
+            }
+        }
+    }
+    if (!entries.isEmpty()) {
+        QRhiTextureUploadDescription desc;
+        desc.setEntries(entries.cbegin(), entries.cend());
+        u->uploadTexture(fr.overlay_tex.get(), desc);
+    }
+    fr.overlay_serial = overlay.serial;
+}
+
+void RhiSceneRenderer::plan_scene_geometry(const SceneBuffers& scene)
+{
+    const std::size_t style_stride =
+        alignUp(sizeof(StyleUniform), std::size_t(m_rhi->ubufAlignment()));
+    const std::size_t total_style_count =
+        scene.thin_lines.size() + scene.fill_rects.size()
+        + scene.fill_polys.size() + scene.thick_lines.size()
+        + scene.dashed_lines.size() + scene.arrows.size();
+
+    m_style_uniform_bytes.assign(total_style_count * style_stride, 0);
+    std::size_t next_style_index = 0;
+    auto assign_style_offset = [&](StyleKey sk, std::uint32_t rgba) {
+        const std::size_t offset = next_style_index * style_stride;
+        const StyleUniform su = makeStyleUniform(sk, rgba);
+        std::memcpy(m_style_uniform_bytes.data() + offset, &su, sizeof(StyleUniform));
+        ++next_style_index;
+        return quint32(offset);
+    };
+
+    PoolPlan vertex_plan{kVertexPoolAlignment, {}};
+    PoolPlan index_plan{kIndexPoolAlignment, {}};
+    m_gpu_scene.clear();
+    m_pending_uploads.clear();
+    m_chunk_resident.clear();
+    m_upload_cursor      = 0;
+    m_uploaded_bytes     = 0;
+    m_total_upload_bytes = 0;
+    m_upload_order_valid = false;
+
+    // Every GPU chunk gets a residency slot and one pending upload; the
+    // uploads are drained by upload_pending_chunks() under the budget.
+    auto queue_upload = [&](const rectangle& bounds,
+                            quint32 vbuf, quint32 voff, quint32 vsize, const void* vdata,
+                            quint32 ibuf = 0, quint32 ioff = 0, quint32 isize = 0,
+                            const void* idata = nullptr) {
+        const quint32 slot = quint32(m_chunk_resident.size());
+        m_chunk_resident.push_back(0);
+        m_pending_uploads.push_back(PendingChunkUpload{
+            bounds, 0.0, slot, vbuf, voff, vsize, vdata, ibuf, ioff, isize, idata});
+        m_total_upload_bytes += std::size_t(vsize) + std::size_t(isize);
+        return slot;
+    };
+
+    // Every primitive type shares one vertex pool. A chunk that straddles
+    // the end of a pool buffer is split; instanced and line-list draws
+    // are order-independent within a chunk, so the halves draw the same.
+    auto planStyleBuffers = [&](const auto& scene_map,
+                                 auto&        gpu_buffers,
+                                 std::size_t  elem_size,
+                                 auto         get_data) {
+        for (const auto& [sk, sb] : scene_map) {
+            const auto& data = get_data(sb);
+            if (data.empty()) continue;
+
+            GpuStyleBuffer gpu_buf;
+            gpu_buf.style_key    = sk;
+            gpu_buf.rgba         = sb.rgba;
+            gpu_buf.style_offset = assign_style_offset(sk, sb.rgba);
+
+            for (const Chunk& chunk : sb.chunks) {
+                std::size_t remaining   = chunk.count;
+                std::size_t data_offset = chunk.offset;
+                while (remaining > 0) {
+                    const auto placed = vertex_plan.placeSome(remaining, elem_size);
+                    const quint32 slot = queue_upload(
+                        chunk.world_bounds, quint32(placed.buffer), quint32(placed.byte_offset),
+                        quint32(placed.count * elem_size),
+                        static_cast<const void*>(data.data() + data_offset));
+                    gpu_buf.chunks.emplace_back(
+                        GpuChunk{chunk.world_bounds, quint32(placed.buffer),
+                                 quint32(placed.byte_offset), quint32(placed.count), slot});
+                    remaining   -= placed.count;
+                    data_offset += placed.count;
+                }
+            }
+            gpu_buffers.push_back(std::move(gpu_buf));
+        }
+    };
+
+    planStyleBuffers(scene.thin_lines, m_gpu_scene.thin_lines, sizeof(PosVertex),
+                     [](const ThinLineStyleBuffer& b) -> const auto& { return b.verts; });
+    planStyleBuffers(scene.fill_rects, m_gpu_scene.fill_rects, sizeof(FillRectInstance),
+                     [](const FillRectStyleBuffer& b) -> const auto& { return b.instances; });
+
+    // Indexed fills. Indices are chunk-local, so a chunk's vertices and
+    // its indices must each land in one pool buffer. 16- and 32-bit index
+    // ranges share the index pool; the draw picks the width per chunk.
+    const bool wide_indices_supported = m_rhi->isFeatureSupported(QRhi::ElementIndexUint);
+    for (const auto& [sk, sb] : scene.fill_polys) {
+        if (sb.verts.empty()) continue;
+
+        GpuIndexedStyleBuffer gpu_buf;
+        gpu_buf.style_key    = sk;
+        gpu_buf.rgba         = sb.rgba;
+        gpu_buf.style_offset = assign_style_offset(sk, sb.rgba);
+
+        for (const IndexedChunk& chunk : sb.chunks) {
+            if (chunk.wide_indices && !wide_indices_supported) {
+                q_warning("RhiSceneRenderer: dropping fill chunk with %u vertices: "
+                          "backend has no 32-bit index support", chunk.vertex_count);
+                continue;
+            }
+            const std::size_t index_size = chunk.wide_indices ? sizeof(std::uint32_t)
+                                                              : sizeof(std::uint16_t);
+            const void* index_data = chunk.wide_indices
+                ? static_cast<const void*>(sb.indices32.data() + chunk.index_offset)
+                : static_cast<const void*>(sb.indices16.data() + chunk.index_offset);
+            const auto vplace = vertex_plan.placeAll(chunk.vertex_count, sizeof(PosVertex));
+            const auto iplace = index_plan.placeAll(chunk.index_count, index_size);
+            const quint32 slot = queue_upload(
+                chunk.world_bounds,
+                quint32(vplace.buffer), quint32(vplace.byte_offset),
+                quint32(chunk.vertex_count * sizeof(PosVertex)),
+                static_cast<const void*>(sb.verts.data() + chunk.vertex_offset),
+                quint32(iplace.buffer), quint32(iplace.byte_offset),
+                quint32(chunk.index_count * index_size), index_data);
+
+            gpu_buf.chunks.push_back(GpuIndexedChunk{
+                chunk.world_bounds,
+                quint32(vplace.buffer), quint32(vplace.byte_offset),
+                quint32(iplace.buffer), quint32(iplace.byte_offset),
+                chunk.index_count, chunk.wide_indices, slot});
+        }
+        m_gpu_scene.fill_polys.push_back(std::move(gpu_buf));
+    }
+
+    planStyleBuffers(scene.thick_lines,  m_gpu_scene.thick_lines,  sizeof(ThickLineInstance),
+                     [](const ThickLineStyleBuffer& b) -> const auto& { return b.instances; });
+    planStyleBuffers(scene.dashed_lines, m_gpu_scene.dashed_lines, sizeof(DashedLineInstance),
+                     [](const DashedLineStyleBuffer& b) -> const auto& { return b.instances; });
+    planStyleBuffers(scene.arrows,       m_gpu_scene.arrows,       sizeof(ArrowInstance),
+                     [](const ArrowStyleBuffer& b) -> const auto& { return b.instances; });
+
+    reallocatePool(m_rhi, m_geom_vertex_pool, vertex_plan, QRhiBuffer::VertexBuffer);
+    reallocatePool(m_rhi, m_geom_index_pool,  index_plan,  QRhiBuffer::IndexBuffer);
+
+    q_debug("RhiSceneRenderer: geometry pools %zu vertex + %zu index buffer(s), %.1f MB, "
+            "%zu chunk upload(s)",
+            m_geom_vertex_pool.size(), m_geom_index_pool.size(),
+            double(geometry_pool_bytes()) / (1024.0 * 1024.0), m_pending_uploads.size());
+}
+
+void RhiSceneRenderer::upload_pending_chunks(QRhiResourceUpdateBatch* u,
+                                             const rectangle&         visible_world)
+{
+    if (m_upload_cursor >= m_pending_uploads.size())
+        return;
+
+    // Budgeted streaming follows the camera: whenever the view moved since
+    // the queue was ordered, re-sort what is left so newly exposed chunks
+    // jump ahead. Without a budget everything goes this frame, in any order.
+    const bool budgeted = m_upload_budget_bytes > 0;
+    if (budgeted && (!m_upload_order_valid || m_upload_order_view != visible_world)) {
+        for (auto it = m_pending_uploads.begin() + std::ptrdiff_t(m_upload_cursor);
+             it != m_pending_uploads.end(); ++it)
+            it->priority = uploadPriority(it->world_bounds, visible_world);
+        std::sort(m_pending_uploads.begin() + std::ptrdiff_t(m_upload_cursor),
+                  m_pending_uploads.end(),
+                  [](const PendingChunkUpload& a, const PendingChunkUpload& b) {
+                      return a.priority < b.priority;
+                  });
+        m_upload_order_view  = visible_world;
+        m_upload_order_valid = true;
+    }
+
+    // At least one chunk per frame, so a chunk larger than the budget
+    // still makes progress.
+    std::size_t frame_bytes = 0;
+    while (m_upload_cursor < m_pending_uploads.size()) {
+        const PendingChunkUpload& up = m_pending_uploads[m_upload_cursor];
+        const std::size_t bytes = std::size_t(up.vertex_byte_size) + std::size_t(up.index_byte_size);
+        if (budgeted && frame_bytes > 0 && frame_bytes + bytes > m_upload_budget_bytes)
+            break;
+        if (up.vertex_byte_size > 0)
+            u->uploadStaticBuffer(m_geom_vertex_pool[up.vertex_buffer_index].get(),
+                                  up.vertex_byte_offset, up.vertex_byte_size, up.vertex_data);
+        if (up.index_byte_size > 0)
+            u->uploadStaticBuffer(m_geom_index_pool[up.index_buffer_index].get(),
+                                  up.index_byte_offset, up.index_byte_size, up.index_data);
+        m_chunk_resident[up.resident_slot] = 1;
+        frame_bytes += bytes;
+        ++m_upload_cursor;
+    }
+    m_uploaded_bytes += frame_bytes;
+
+    // uploadStaticBuffer has copied the bytes, so the pages just read from
+    // an out-of-core scene count toward its resident budget and may go.
+    if (m_cached_scene && m_cached_scene->scratch)
+        m_cached_scene->scratch->note_touched(frame_bytes);
+
+    if (m_upload_cursor >= m_pending_uploads.size()) {
+        m_pending_uploads.clear();
+        m_pending_uploads.shrink_to_fit();
+        m_upload_cursor = 0;
+    }
+}
+
+void RhiSceneRenderer::upload_style_uniforms(QRhiResourceUpdateBatch* u, FrameResources& fr)
+{
+    const std::size_t style_stride =
+        alignUp(sizeof(StyleUniform), std::size_t(m_rhi->ubufAlignment()));
+
+    // Ensure / grow style UBO. If the buffer is reallocated, the fr.srb
+    // that was built once in initialize() still references the old
+    // (deleted-pending) QRhiBuffer pointer. D3D11/Metal/Vulkan cache the
+    // SRB's resource references at create() time, so the shader ends up
+    // reading stale data — symptom: blank scene with only the
+    // screen-space overlay visible. OpenGL re-resolves the SRB each draw
+    // and accidentally hides the bug on Linux. Rebuild the SRB whenever
+    // style_ubuf is recreated so the new buffer pointer is picked up.
+    // mvp_ubuf is never reallocated, so the other binding is stable.
+    const std::size_t style_ubuf_bytes = std::max(style_stride, m_style_uniform_bytes.size());
+    const bool style_ubuf_recreated = ensureDynamicBuf(
+        m_rhi, fr.style_ubuf, QRhiBuffer::UniformBuffer,
+        style_ubuf_bytes,
+        std::max<std::size_t>(kInitialStyleUniformBufferBytes, style_stride));
+    if (style_ubuf_recreated) {
+        fr.srb->setBindings({
+            QRhiShaderResourceBinding::uniformBuffer(
+                0, QRhiShaderResourceBinding::VertexStage, fr.mvp_ubuf.get()),
+            QRhiShaderResourceBinding::uniformBufferWithDynamicOffset(
+                1,
+                QRhiShaderResourceBinding::VertexStage |
+                QRhiShaderResourceBinding::FragmentStage,
+                fr.style_ubuf.get(), sizeof(StyleUniform))
+        });
+        fr.srb->create();
+    }
+    if (!m_style_uniform_bytes.empty())
+        u->updateDynamicBuffer(fr.style_ubuf.get(), 0,
+                               int(m_style_uniform_bytes.size()),
+                               m_style_uniform_bytes.data());
+}
+
 void RhiSceneRenderer::release()
 {
+    m_overlay_tiles.release();
     m_overlay_pso.reset();
     m_arrow_pso.reset();
     m_dashed_line_pso.reset();
@@ -828,32 +1146,51 @@ void RhiSceneRenderer::release()
     m_fill_rect_pso.reset();
     m_line_pso.reset();
     m_overlay_sampler.reset();
-    m_overlay_quad_vbuf.reset();
     m_thick_line_corner_vbuf.reset();
+    m_screen_quad_vbuf.reset();
+    m_corner_upload_pending = false;
+
+    m_geom_index_pool.clear();
+    m_geom_vertex_pool.clear();
+    m_gpu_scene.clear();
+    m_style_uniform_bytes.clear();
+    m_pending_uploads.clear();
+    m_chunk_resident.clear();
+    m_upload_cursor      = 0;
+    m_uploaded_bytes     = 0;
+    m_total_upload_bytes = 0;
+    m_geom_valid         = false;
 
     for (FrameResources& fr : m_frame_resources) {
         fr.overlay_srb.reset();
         fr.overlay_tex.reset();
+        fr.overlay_serial = 0;
+        fr.overlay_quad_vbuf.reset();
+        fr.screen_srb.reset();
+        fr.screen_tex.reset();
+        fr.screen_serial = 0;
         fr.srb.reset();
-        fr.arrow_instance_vbufs.clear();
-        fr.dashed_line_instance_vbufs.clear();
-        fr.thick_line_instance_vbufs.clear();
-        fr.fill_poly_vbufs.clear();
-        fr.fill_rect_instance_vbufs.clear();
-        fr.thin_line_vbufs.clear();
-        fr.gpu_scene.clear();
         fr.style_ubuf.reset();
         fr.mvp_ubuf.reset();
     }
     m_frame_resources.clear();
-    m_frame_slot_geom_valid.clear();
+    m_frame_slot_style_valid.clear();
     m_initialized = false;
     m_rhi = nullptr;
 }
 
 void RhiSceneRenderer::invalidate_geometry_cache()
 {
-    std::fill(m_frame_slot_geom_valid.begin(), m_frame_slot_geom_valid.end(), false);
+    m_geom_valid = false;
+    std::fill(m_frame_slot_style_valid.begin(), m_frame_slot_style_valid.end(), false);
+}
+
+std::size_t RhiSceneRenderer::geometry_pool_bytes() const noexcept
+{
+    std::size_t total = 0;
+    for (const auto& buf : m_geom_vertex_pool) if (buf) total += std::size_t(buf->size());
+    for (const auto& buf : m_geom_index_pool)  if (buf) total += std::size_t(buf->size());
+    return total;
 }
 
 } // namespace ezgl
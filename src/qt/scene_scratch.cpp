@@ -0,0 +1,137 @@
+#include "ezgl/qt/scene_scratch.hpp"
+#include "ezgl/logutils.hpp"
+
+#include <QDir>
+#include <QTemporaryFile>
+
+#include <algorithm>
+#include <new>
+
+#if defined(Q_OS_UNIX)
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#endif
+
+namespace ezgl {
+
+namespace {
+
+// Mapping granularity. A multiple of every platform's page / allocation
+// granularity, so each segment's file offset is a valid map offset.
+constexpr std::size_t kSegmentBytes = std::size_t(64) * 1024 * 1024;
+
+std::size_t round_up(std::size_t value, std::size_t multiple)
+{
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+} // namespace
+
+std::shared_ptr<SceneScratchFile> SceneScratchFile::create(const SceneStorageOptions& options)
+{
+    std::shared_ptr<SceneScratchFile> scratch(new SceneScratchFile(options));
+    if (!scratch->m_file->open()) {
+        q_warning("SceneScratchFile: cannot create scratch file in %s: %s",
+                  qPrintable(scratch->m_file->fileTemplate()),
+                  qPrintable(scratch->m_file->errorString()));
+        return nullptr;
+    }
+    return scratch;
+}
+
+SceneScratchFile::SceneScratchFile(const SceneStorageOptions& options)
+    : m_budget_bytes(options.resident_budget_bytes)
+{
+    const QString dir = options.scratch_dir.isEmpty() ? QDir::tempPath() : options.scratch_dir;
+    m_file = std::make_unique<QTemporaryFile>(QDir(dir).filePath(QStringLiteral("ezgl-scene-XXXXXX.bin")));
+}
+
+SceneScratchFile::~SceneScratchFile()
+{
+    // The temporary file is removed when m_file closes; unmap first.
+    for (const Segment& seg : m_segments)
+        m_file->unmap(seg.base);
+}
+
+void* SceneScratchFile::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_segments.empty()) {
+        Segment& seg = m_segments.back();
+        const std::size_t at = round_up(seg.used, alignment);
+        if (at + bytes <= seg.size) {
+            seg.used = at + bytes;
+            m_allocated += bytes;
+            return seg.base + at;
+        }
+    }
+
+    // Open a new segment at the end of the file. Segments never move, so
+    // pointers handed out earlier stay valid.
+    const std::size_t seg_size = round_up(std::max(bytes, kSegmentBytes), kSegmentBytes);
+    if (!m_file->resize(qint64(m_file_size + seg_size))) {
+        q_warning("SceneScratchFile: cannot grow scratch file to %zu bytes: %s",
+                  m_file_size + seg_size, qPrintable(m_file->errorString()));
+        throw std::bad_alloc();
+    }
+    unsigned char* base = m_file->map(qint64(m_file_size), qint64(seg_size));
+    if (!base) {
+        q_warning("SceneScratchFile: cannot map %zu bytes of scratch file: %s",
+                  seg_size, qPrintable(m_file->errorString()));
+        throw std::bad_alloc();
+    }
+    m_segments.push_back(Segment{base, m_file_size, seg_size, bytes});
+    m_file_size += seg_size;
+    m_allocated += bytes;
+    return base;
+}
+
+void SceneScratchFile::note_touched(std::size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_touched += bytes;
+    if (m_touched > m_budget_bytes)
+        trim_locked();
+}
+
+void SceneScratchFile::trim()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    trim_locked();
+}
+
+void SceneScratchFile::trim_locked()
+{
+#if defined(Q_OS_UNIX)
+    const int fd = m_file->handle();
+    for (const Segment& seg : m_segments) {
+        if (seg.used == 0) continue;
+        const std::size_t len = std::min(round_up(seg.used, std::size_t(4096)), seg.size);
+        // Write back synchronously so the pages are clean, drop them from
+        // this mapping, then ask the kernel to evict them from the page
+        // cache too; otherwise they would merely move from RSS to cache.
+        ::msync(seg.base, len, MS_SYNC);
+        ::madvise(seg.base, len, MADV_DONTNEED);
+        if (fd >= 0)
+            ::posix_fadvise(fd, off_t(seg.file_offset), off_t(len), POSIX_FADV_DONTNEED);
+    }
+#endif
+    // Elsewhere the OS pages the mapping out under memory pressure on its
+    // own; the file backing still keeps it out of the swap file.
+    m_touched = 0;
+}
+
+std::size_t SceneScratchFile::resident_bytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return std::min(m_touched, m_allocated);
+}
+
+std::size_t SceneScratchFile::allocated_bytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_allocated;
+}
+
+} // namespace ezgl
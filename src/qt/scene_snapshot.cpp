@@ -0,0 +1,479 @@
+#include "ezgl/qt/scene_snapshot.hpp"
+#include "ezgl/logutils.hpp"
+
+#include <QFile>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace ezgl {
+
+namespace {
+
+constexpr char          kMagic[8]          = {'E', 'Z', 'G', 'L', 'S', 'C', 'N', '\0'};
+constexpr std::uint32_t kByteOrderMark     = 0x01020304u;
+constexpr std::uint64_t kSectionAlignment  = 16;
+
+struct SnapshotHeader {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    double        bounds[4];   // left, bottom, right, top
+    std::uint32_t style_count;
+    std::uint32_t reserved;
+    std::uint64_t overlay_offset;
+    std::uint64_t overlay_size;
+};
+
+struct SnapshotStyleRecord {
+    std::uint64_t style_key;
+    std::uint32_t rgba;
+    std::uint32_t chunk_count;
+    std::uint64_t chunk_offset;
+    std::uint64_t elem_offset;
+    std::uint64_t elem_count;
+    std::uint64_t idx16_offset;
+    std::uint64_t idx16_count;
+    std::uint64_t idx32_offset;
+    std::uint64_t idx32_count;
+};
+
+// One record type for both chunk kinds. A plain Chunk uses offset/count
+// for its element range and leaves the index fields zero.
+struct SnapshotChunk {
+    double        bounds[4];
+    std::uint32_t offset;
+    std::uint32_t count;
+    std::uint32_t index_offset;
+    std::uint32_t index_count;
+    std::uint32_t wide_indices;
+    std::uint32_t reserved;
+};
+
+static_assert(std::is_trivially_copyable_v<SnapshotHeader>);
+static_assert(std::is_trivially_copyable_v<SnapshotStyleRecord>);
+static_assert(std::is_trivially_copyable_v<SnapshotChunk>);
+
+std::size_t element_size(PrimitiveType type)
+{
+    switch (type) {
+    case PrimitiveType::ThinLine:   return sizeof(PosVertex);
+    case PrimitiveType::FilledRect: return sizeof(FillRectInstance);
+    case PrimitiveType::FilledPoly: return sizeof(PosVertex);
+    case PrimitiveType::ThickLine:  return sizeof(ThickLineInstance);
+    case PrimitiveType::DashedLine: return sizeof(DashedLineInstance);
+    case PrimitiveType::Arrow:      return sizeof(ArrowInstance);
+    }
+    return 0;
+}
+
+PrimitiveType style_key_primitive(StyleKey key)
+{
+    return PrimitiveType(std::uint8_t(key >> 56));
+}
+
+void store_bounds(double out[4], const rectangle& r)
+{
+    out[0] = r.left(); out[1] = r.bottom(); out[2] = r.right(); out[3] = r.top();
+}
+
+rectangle load_bounds(const double in[4])
+{
+    return rectangle{{in[0], in[1]}, {in[2], in[3]}};
+}
+
+// ---- writing ----------------------------------------------------------------
+
+// Flattened view of one style buffer of any type.
+struct StyleView {
+    StyleKey                         key  = 0;
+    std::uint32_t                    rgba = 0;
+    std::vector<SnapshotChunk>       chunks;
+    const void*                      elems = nullptr;
+    std::size_t                      elem_bytes = 0;
+    std::size_t                      elem_count = 0;
+    const std::uint16_t*             idx16 = nullptr;
+    std::size_t                      idx16_count = 0;
+    const std::uint32_t*             idx32 = nullptr;
+    std::size_t                      idx32_count = 0;
+};
+
+template <typename Map, typename Member>
+void collect_plain(std::vector<StyleView>& out, const Map& buffers, Member member)
+{
+    for (const auto& [sk, b] : buffers) {
+        StyleView v;
+        v.key  = sk;
+        v.rgba = b.rgba;
+        v.chunks.reserve(b.chunks.size());
+        for (const Chunk& c : b.chunks) {
+            SnapshotChunk rec{};
+            store_bounds(rec.bounds, c.world_bounds);
+            rec.offset = c.offset;
+            rec.count  = c.count;
+            v.chunks.push_back(rec);
+        }
+        const auto& elems = b.*member;
+        v.elems      = elems.data();
+        v.elem_count = elems.size();
+        v.elem_bytes = elems.size() * sizeof(elems[0]);
+        out.push_back(std::move(v));
+    }
+}
+
+void collect_fill_polys(std::vector<StyleView>& out,
+                        const std::unordered_map<StyleKey, FillPolyStyleBuffer>& buffers)
+{
+    for (const auto& [sk, b] : buffers) {
+        StyleView v;
+        v.key  = sk;
+        v.rgba = b.rgba;
+        v.chunks.reserve(b.chunks.size());
+        for (const IndexedChunk& c : b.chunks) {
+            SnapshotChunk rec{};
+            store_bounds(rec.bounds, c.world_bounds);
+            rec.offset       = c.vertex_offset;
+            rec.count        = c.vertex_count;
+            rec.index_offset = c.index_offset;
+            rec.index_count  = c.index_count;
+            rec.wide_indices = c.wide_indices ? 1u : 0u;
+            v.chunks.push_back(rec);
+        }
+        v.elems       = b.verts.data();
+        v.elem_count  = b.verts.size();
+        v.elem_bytes  = b.verts.size() * sizeof(PosVertex);
+        v.idx16       = b.indices16.data();
+        v.idx16_count = b.indices16.size();
+        v.idx32       = b.indices32.data();
+        v.idx32_count = b.indices32.size();
+        out.push_back(std::move(v));
+    }
+}
+
+class SectionWriter {
+public:
+    explicit SectionWriter(QSaveFile& file) : m_file(file) {}
+
+    bool ok() const { return m_ok; }
+
+    /// Append @p bytes at the next aligned position; returns its offset.
+    std::uint64_t append(const void* data, std::size_t bytes)
+    {
+        static const char kZeros[kSectionAlignment] = {};
+        const std::uint64_t pad = (kSectionAlignment - m_pos % kSectionAlignment) % kSectionAlignment;
+        write(kZeros, std::size_t(pad));
+        const std::uint64_t offset = m_pos;
+        write(data, bytes);
+        return offset;
+    }
+
+    void write(const void* data, std::size_t bytes)
+    {
+        if (!m_ok || bytes == 0)
+            return;
+        m_ok = m_file.write(static_cast<const char*>(data), qint64(bytes)) == qint64(bytes);
+        m_pos += bytes;
+    }
+
+    void rewrite_at(std::uint64_t offset, const void* data, std::size_t bytes)
+    {
+        if (!m_ok)
+            return;
+        m_ok = m_file.seek(qint64(offset))
+            && m_file.write(static_cast<const char*>(data), qint64(bytes)) == qint64(bytes);
+    }
+
+private:
+    QSaveFile&    m_file;
+    std::uint64_t m_pos = 0;
+    bool          m_ok  = true;
+};
+
+// ---- reading ----------------------------------------------------------------
+
+class MappedReader {
+public:
+    MappedReader(const uchar* base, std::uint64_t size) : m_base(base), m_size(size) {}
+
+    /// Pointer to @p count objects of T at @p offset, or nullptr if the
+    /// range does not lie inside the file or is misaligned for T.
+    template <typename T>
+    const T* span(std::uint64_t offset, std::uint64_t count) const
+    {
+        if (count == 0)
+            return reinterpret_cast<const T*>(m_base);
+        if (offset > m_size || offset % alignof(T) != 0
+            || count > (m_size - offset) / sizeof(T))
+            return nullptr;
+        return reinterpret_cast<const T*>(m_base + offset);
+    }
+
+private:
+    const uchar*  m_base;
+    std::uint64_t m_size;
+};
+
+bool chunk_fits(const SnapshotChunk& c, std::uint64_t elem_count)
+{
+    return std::uint64_t(c.offset) + c.count <= elem_count;
+}
+
+template <typename Buffer, typename Elem>
+bool load_plain(const MappedReader& reader, const SnapshotStyleRecord& rec,
+                std::unordered_map<StyleKey, Buffer>& buffers,
+                std::pmr::vector<Elem> Buffer::* member,
+                std::pmr::memory_resource* resource)
+{
+    const SnapshotChunk* chunks = reader.span<SnapshotChunk>(rec.chunk_offset, rec.chunk_count);
+    const Elem*          elems  = reader.span<Elem>(rec.elem_offset, rec.elem_count);
+    if (!chunks || !elems)
+        return false;
+
+    // Each style key is written once; a repeat would merge two records.
+    const auto [it, inserted] = buffers.try_emplace(rec.style_key, resource);
+    if (!inserted)
+        return false;
+    Buffer& b = it->second;
+    b.style_key = rec.style_key;
+    b.rgba      = rec.rgba;
+    b.chunks.reserve(rec.chunk_count);
+    for (std::uint32_t i = 0; i < rec.chunk_count; ++i) {
+        if (!chunk_fits(chunks[i], rec.elem_count))
+            return false;
+        b.chunks.emplace_back(load_bounds(chunks[i].bounds), chunks[i].offset, chunks[i].count);
+    }
+    (b.*member).assign(elems, elems + rec.elem_count);
+    return true;
+}
+
+// Indices are relative to their chunk's first vertex.
+template <typename Index>
+bool indices_in_range(const Index* indices, std::uint32_t count, std::uint32_t vertex_count)
+{
+    return std::all_of(indices, indices + count,
+                       [vertex_count](Index i) { return std::uint32_t(i) < vertex_count; });
+}
+
+bool load_fill_polys(const MappedReader& reader, const SnapshotStyleRecord& rec,
+                     std::unordered_map<StyleKey, FillPolyStyleBuffer>& buffers,
+                     std::pmr::memory_resource* resource)
+{
+    const SnapshotChunk* chunks = reader.span<SnapshotChunk>(rec.chunk_offset, rec.chunk_count);
+    const PosVertex*     verts  = reader.span<PosVertex>(rec.elem_offset, rec.elem_count);
+    const std::uint16_t* idx16  = reader.span<std::uint16_t>(rec.idx16_offset, rec.idx16_count);
+    const std::uint32_t* idx32  = reader.span<std::uint32_t>(rec.idx32_offset, rec.idx32_count);
+    if (!chunks || !verts || !idx16 || !idx32)
+        return false;
+
+    const auto [it, inserted] = buffers.try_emplace(rec.style_key, resource);
+    if (!inserted)
+        return false;
+    FillPolyStyleBuffer& b = it->second;
+    b.style_key = rec.style_key;
+    b.rgba      = rec.rgba;
+    b.chunks.reserve(rec.chunk_count);
+    for (std::uint32_t i = 0; i < rec.chunk_count; ++i) {
+        const SnapshotChunk& c = chunks[i];
+        const std::uint64_t index_count = c.wide_indices ? rec.idx32_count : rec.idx16_count;
+        if (!chunk_fits(c, rec.elem_count)
+            || std::uint64_t(c.index_offset) + c.index_count > index_count
+            || (!c.wide_indices && c.count > kMaxNarrowIndexedVertices))
+            return false;
+        // An index past the chunk's vertices would make the GPU read
+        // beyond the vertex buffer.
+        if (c.wide_indices ? !indices_in_range(idx32 + c.index_offset, c.index_count, c.count)
+                           : !indices_in_range(idx16 + c.index_offset, c.index_count, c.count))
+            return false;
+        IndexedChunk chunk;
+        chunk.world_bounds  = load_bounds(c.bounds);
+        chunk.vertex_offset = c.offset;
+        chunk.vertex_count  = c.count;
+        chunk.index_offset  = c.index_offset;
+        chunk.index_count   = c.index_count;
+        chunk.wide_indices  = c.wide_indices != 0;
+        b.chunks.push_back(chunk);
+    }
+    b.verts.assign(verts, verts + rec.elem_count);
+    b.indices16.assign(idx16, idx16 + rec.idx16_count);
+    b.indices32.assign(idx32, idx32 + rec.idx32_count);
+    return true;
+}
+
+bool header_valid(const SnapshotHeader& header, const QString& path)
+{
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        q_warning("scene snapshot %s: not a scene snapshot", qPrintable(path));
+        return false;
+    }
+    if (header.byte_order != kByteOrderMark) {
+        q_warning("scene snapshot %s: written on a machine with another byte order", qPrintable(path));
+        return false;
+    }
+    if (header.version != kSceneSnapshotVersion) {
+        q_warning("scene snapshot %s: version %u, expected %u",
+                  qPrintable(path), unsigned(header.version), unsigned(kSceneSnapshotVersion));
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool write_scene_snapshot(const QString&      path,
+                          const SceneBuffers& scene,
+                          const rectangle&    scene_bounds,
+                          const QByteArray&   overlay)
+{
+    std::vector<StyleView> views;
+    collect_plain(views, scene.thin_lines,   &ThinLineStyleBuffer::verts);
+    collect_plain(views, scene.fill_rects,   &FillRectStyleBuffer::instances);
+    collect_fill_polys(views, scene.fill_polys);
+    collect_plain(views, scene.thick_lines,  &ThickLineStyleBuffer::instances);
+    collect_plain(views, scene.dashed_lines, &DashedLineStyleBuffer::instances);
+    collect_plain(views, scene.arrows,       &ArrowStyleBuffer::instances);
+    // Deterministic files for identical scenes, whatever the map order.
+    std::sort(views.begin(), views.end(),
+              [](const StyleView& a, const StyleView& b) { return a.key < b.key; });
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        q_warning("scene snapshot %s: cannot open for writing: %s",
+                  qPrintable(path), qPrintable(file.errorString()));
+        return false;
+    }
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version     = kSceneSnapshotVersion;
+    header.byte_order  = kByteOrderMark;
+    header.style_count = std::uint32_t(views.size());
+    store_bounds(header.bounds, scene_bounds);
+
+    // Header and style table first with placeholder offsets, then the
+    // sections; both are rewritten once the offsets are known.
+    std::vector<SnapshotStyleRecord> records(views.size());
+    SectionWriter writer(file);
+    writer.write(&header, sizeof(header));
+    writer.write(records.data(), records.size() * sizeof(SnapshotStyleRecord));
+
+    for (std::size_t i = 0; i < views.size(); ++i) {
+        const StyleView&     v   = views[i];
+        SnapshotStyleRecord& rec = records[i];
+        rec.style_key    = v.key;
+        rec.rgba         = v.rgba;
+        rec.chunk_count  = std::uint32_t(v.chunks.size());
+        rec.chunk_offset = writer.append(v.chunks.data(), v.chunks.size() * sizeof(SnapshotChunk));
+        rec.elem_count   = v.elem_count;
+        rec.elem_offset  = writer.append(v.elems, v.elem_bytes);
+        rec.idx16_count  = v.idx16_count;
+        rec.idx16_offset = writer.append(v.idx16, v.idx16_count * sizeof(std::uint16_t));
+        rec.idx32_count  = v.idx32_count;
+        rec.idx32_offset = writer.append(v.idx32, v.idx32_count * sizeof(std::uint32_t));
+    }
+    header.overlay_size   = std::uint64_t(overlay.size());
+    header.overlay_offset = writer.append(overlay.constData(), std::size_t(overlay.size()));
+
+    writer.rewrite_at(0, &header, sizeof(header));
+    writer.rewrite_at(sizeof(header), records.data(), records.size() * sizeof(SnapshotStyleRecord));
+
+    if (!writer.ok() || !file.commit()) {
+        q_warning("scene snapshot %s: write failed: %s",
+                  qPrintable(path), qPrintable(file.errorString()));
+        return false;
+    }
+    return true;
+}
+
+std::optional<SceneSnapshot> read_scene_snapshot(const QString&             path,
+                                                 const SceneStorageOptions& storage)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        q_warning("scene snapshot %s: cannot open: %s", qPrintable(path), qPrintable(file.errorString()));
+        return std::nullopt;
+    }
+    const std::uint64_t file_size = std::uint64_t(file.size());
+    if (file_size < sizeof(SnapshotHeader)) {
+        q_warning("scene snapshot %s: truncated", qPrintable(path));
+        return std::nullopt;
+    }
+    const uchar* base = file.map(0, qint64(file_size));
+    if (!base) {
+        q_warning("scene snapshot %s: cannot map: %s", qPrintable(path), qPrintable(file.errorString()));
+        return std::nullopt;
+    }
+    const MappedReader reader(base, file_size);
+
+    SnapshotHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    if (!header_valid(header, path))
+        return std::nullopt;
+
+    const SnapshotStyleRecord* records =
+        reader.span<SnapshotStyleRecord>(sizeof(SnapshotHeader), header.style_count);
+    const char* overlay = reader.span<char>(header.overlay_offset, header.overlay_size);
+    if (!records || !overlay) {
+        q_warning("scene snapshot %s: truncated", qPrintable(path));
+        return std::nullopt;
+    }
+
+    SceneSnapshot snapshot;
+    snapshot.scene_bounds = load_bounds(header.bounds);
+    if (storage.out_of_core)
+        snapshot.scene.scratch = SceneScratchFile::create(storage);
+    SceneBuffers& scene = snapshot.scene;
+    std::pmr::memory_resource* const resource =
+        scene.scratch ? static_cast<std::pmr::memory_resource*>(scene.scratch.get())
+                      : std::pmr::get_default_resource();
+
+    for (std::uint32_t i = 0; i < header.style_count; ++i) {
+        const SnapshotStyleRecord& rec = records[i];
+        bool ok = false;
+        switch (style_key_primitive(rec.style_key)) {
+        case PrimitiveType::ThinLine:
+            ok = load_plain(reader, rec, scene.thin_lines, &ThinLineStyleBuffer::verts, resource);
+            break;
+        case PrimitiveType::FilledRect:
+            ok = load_plain(reader, rec, scene.fill_rects, &FillRectStyleBuffer::instances, resource);
+            break;
+        case PrimitiveType::FilledPoly:
+            ok = load_fill_polys(reader, rec, scene.fill_polys, resource);
+            break;
+        case PrimitiveType::ThickLine:
+            ok = load_plain(reader, rec, scene.thick_lines, &ThickLineStyleBuffer::instances, resource);
+            break;
+        case PrimitiveType::DashedLine:
+            ok = load_plain(reader, rec, scene.dashed_lines, &DashedLineStyleBuffer::instances, resource);
+            break;
+        case PrimitiveType::Arrow:
+            ok = load_plain(reader, rec, scene.arrows, &ArrowStyleBuffer::instances, resource);
+            break;
+        }
+        if (!ok) {
+            q_warning("scene snapshot %s: style record %u is inconsistent", qPrintable(path), unsigned(i));
+            return std::nullopt;
+        }
+        if (scene.scratch)
+            scene.scratch->note_touched(std::size_t(rec.elem_count) * element_size(style_key_primitive(rec.style_key)));
+    }
+
+    snapshot.overlay = QByteArray(overlay, qsizetype(header.overlay_size));
+    return snapshot;
+}
+
+bool probe_scene_snapshot(const QString& path)
+{
+    QFile file(path);
+    SnapshotHeader header;
+    if (!file.open(QIODevice::ReadOnly)
+        || file.read(reinterpret_cast<char*>(&header), sizeof(header)) != qint64(sizeof(header))) {
+        q_warning("scene snapshot %s: cannot read", qPrintable(path));
+        return false;
+    }
+    return header_valid(header, path);
+}
+
+} // namespace ezgl
@@ -0,0 +1,385 @@
+#include "ezgl/qt/streaming_image_writer.hpp"
+#include "ezgl/logutils.hpp"
+
+#include <QByteArray>
+#include <QFileInfo>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#ifdef EZGL_HAVE_ZLIB
+#  include <zlib.h>
+#endif
+
+namespace {
+
+template <typename T>
+void put_le(QByteArray& out, T value)
+{
+    value = qToLittleEndian(value);
+    out.append(reinterpret_cast<const char*>(&value), qsizetype(sizeof(value)));
+}
+
+template <typename T>
+void put_be(QByteArray& out, T value)
+{
+    value = qToBigEndian(value);
+    out.append(reinterpret_cast<const char*>(&value), qsizetype(sizeof(value)));
+}
+
+// ---- TIFF ------------------------------------------------------------------
+
+// Baseline RGB TIFF with Deflate (Adobe, zlib-wrapped) strips. The strips
+// are written as rows arrive; the directory and the strip tables follow
+// the last one, and the header's directory offset is patched at the end.
+class tiff_writer final : public ezgl::StreamingImageWriter {
+public:
+    tiff_writer(const QString& path, QSize size) : StreamingImageWriter(path, size)
+    {
+        // Deflate can expand incompressible data slightly; stay well clear
+        // of the 32-bit offset limit before committing to classic TIFF.
+        const std::uint64_t raw    = std::uint64_t(size.width()) * 3 * std::uint64_t(size.height());
+        const std::uint64_t strips = std::uint64_t(size.height()) / kTiffRowsPerStrip + 1;
+        m_big = raw + raw / 64 + strips * 128 + (1u << 20) > 0xFFFFFFFFull;
+    }
+
+protected:
+    bool write_header() override
+    {
+        QByteArray header("II", 2);
+        if (m_big) {
+            put_le<quint16>(header, 43);
+            put_le<quint16>(header, 8); // offset size
+            put_le<quint16>(header, 0);
+            put_le<quint64>(header, 0); // directory offset, patched by finish_file()
+        } else {
+            put_le<quint16>(header, 42);
+            put_le<quint32>(header, 0);
+        }
+        return m_file.write(header) == header.size();
+    }
+
+    bool encode_rows(const uchar* rgb, qsizetype bytes_per_line, int count) override
+    {
+        const qsizetype row_bytes = qsizetype(m_size.width()) * 3;
+        for (int y = 0; y < count; ++y) {
+            m_strip.append(reinterpret_cast<const char*>(rgb + y * bytes_per_line), row_bytes);
+            if (++m_strip_rows == kTiffRowsPerStrip && !flush_strip())
+                return false;
+        }
+        return true;
+    }
+
+    bool finish_file() override
+    {
+        if (m_strip_rows > 0 && !flush_strip())
+            return false;
+
+        struct entry {
+            quint16    tag;
+            quint16    type;
+            quint64    count;
+            QByteArray values;
+        };
+        enum : quint16 { SHORT = 3, LONG = 4, RATIONAL = 5, LONG8 = 16 };
+
+        auto shorts = [](std::initializer_list<quint16> v) {
+            QByteArray out;
+            for (quint16 s : v) put_le(out, s);
+            return out;
+        };
+        auto longs = [](std::initializer_list<quint32> v) {
+            QByteArray out;
+            for (quint32 l : v) put_le(out, l);
+            return out;
+        };
+        auto offsets = [this](const std::vector<quint64>& v) {
+            QByteArray out;
+            for (quint64 o : v) {
+                if (m_big) put_le(out, o);
+                else       put_le(out, quint32(o));
+            }
+            return out;
+        };
+        const quint16     offset_type = m_big ? LONG8 : LONG;
+        const std::size_t n_strips    = m_strip_offsets.size();
+
+        // Tags in ascending order, as the format requires.
+        std::vector<entry> entries = {
+            {256, LONG,        1,        longs({quint32(m_size.width())})},
+            {257, LONG,        1,        longs({quint32(m_size.height())})},
+            {258, SHORT,       3,        shorts({8, 8, 8})},
+            {259, SHORT,       1,        shorts({8})},  // Adobe Deflate
+            {262, SHORT,       1,        shorts({2})},  // RGB
+            {273, offset_type, n_strips, offsets(m_strip_offsets)},
+            {277, SHORT,       1,        shorts({3})},
+            {278, LONG,        1,        longs({quint32(kTiffRowsPerStrip)})},
+            {279, offset_type, n_strips, offsets(m_strip_bytes)},
+            {282, RATIONAL,    1,        longs({72, 1})},
+            {283, RATIONAL,    1,        longs({72, 1})},
+            {284, SHORT,       1,        shorts({1})},  // chunky
+            {296, SHORT,       1,        shorts({2})},  // inch
+        };
+
+        // Values that do not fit in an entry go first, word-aligned.
+        const qsizetype    inline_bytes = m_big ? 8 : 4;
+        std::vector<quint64> value_offsets(entries.size(), 0);
+        for (std::size_t i = 0; i < entries.size(); ++i) {
+            if (entries[i].values.size() <= inline_bytes)
+                continue;
+            if (!align_file())
+                return false;
+            value_offsets[i] = quint64(m_file.pos());
+            if (m_file.write(entries[i].values) != entries[i].values.size())
+                return false;
+        }
+
+        if (!align_file())
+            return false;
+        const quint64 ifd_offset = quint64(m_file.pos());
+        QByteArray    ifd;
+        if (m_big) put_le<quint64>(ifd, entries.size());
+        else       put_le<quint16>(ifd, quint16(entries.size()));
+        for (std::size_t i = 0; i < entries.size(); ++i) {
+            const entry& e = entries[i];
+            put_le(ifd, e.tag);
+            put_le(ifd, e.type);
+            if (m_big) put_le<quint64>(ifd, e.count);
+            else       put_le<quint32>(ifd, quint32(e.count));
+            if (e.values.size() <= inline_bytes) {
+                QByteArray value = e.values;
+                value.resize(inline_bytes, '\0');
+                ifd.append(value);
+            } else if (m_big) {
+                put_le<quint64>(ifd, value_offsets[i]);
+            } else {
+                put_le<quint32>(ifd, quint32(value_offsets[i]));
+            }
+        }
+        if (m_big) put_le<quint64>(ifd, 0); // no next directory
+        else       put_le<quint32>(ifd, 0);
+        if (m_file.write(ifd) != ifd.size())
+            return false;
+
+        QByteArray patch;
+        if (m_big) put_le<quint64>(patch, ifd_offset);
+        else       put_le<quint32>(patch, quint32(ifd_offset));
+        return m_file.seek(m_big ? 8 : 4) && m_file.write(patch) == patch.size();
+    }
+
+private:
+    bool flush_strip()
+    {
+        // qCompress prefixes the zlib stream with a 4-byte length.
+        const QByteArray compressed = qCompress(m_strip, 6).mid(4);
+        m_strip_offsets.push_back(quint64(m_file.pos()));
+        m_strip_bytes.push_back(quint64(compressed.size()));
+        m_strip.clear();
+        m_strip_rows = 0;
+        return m_file.write(compressed) == compressed.size();
+    }
+
+    bool align_file()
+    {
+        return m_file.pos() % 2 == 0 || m_file.write("\0", 1) == 1;
+    }
+
+    bool                 m_big = false;
+    QByteArray           m_strip;
+    int                  m_strip_rows = 0;
+    std::vector<quint64> m_strip_offsets;
+    std::vector<quint64> m_strip_bytes;
+};
+
+// ---- PNG -------------------------------------------------------------------
+
+#ifdef EZGL_HAVE_ZLIB
+
+// RGB PNG, filter type None. All rows feed one deflate stream, whose
+// output is cut into IDAT chunks as the buffer fills.
+class png_writer final : public ezgl::StreamingImageWriter {
+public:
+    static constexpr std::size_t kChunkBytes = std::size_t(1) << 18;
+
+    png_writer(const QString& path, QSize size)
+        : StreamingImageWriter(path, size)
+        , m_out(kChunkBytes)
+        , m_row(std::size_t(size.width()) * 3 + 1)
+    {
+    }
+
+    ~png_writer() override
+    {
+        if (m_deflating)
+            deflateEnd(&m_zs);
+    }
+
+protected:
+    bool write_header() override
+    {
+        static const char kSignature[] = "\x89PNG\r\n\x1a\n";
+        if (m_file.write(kSignature, 8) != 8)
+            return false;
+
+        QByteArray ihdr;
+        put_be<quint32>(ihdr, quint32(m_size.width()));
+        put_be<quint32>(ihdr, quint32(m_size.height()));
+        ihdr.append(char(8)); // bit depth
+        ihdr.append(char(2)); // color type: RGB
+        ihdr.append(char(0)); // deflate
+        ihdr.append(char(0)); // adaptive filtering
+        ihdr.append(char(0)); // no interlace
+        if (!write_chunk("IHDR", ihdr.constData(), std::size_t(ihdr.size())))
+            return false;
+
+        m_deflating = deflateInit(&m_zs, 6) == Z_OK;
+        return m_deflating;
+    }
+
+    bool encode_rows(const uchar* rgb, qsizetype bytes_per_line, int count) override
+    {
+        for (int y = 0; y < count; ++y) {
+            m_row[0] = 0; // filter: None
+            std::memcpy(m_row.data() + 1, rgb + y * bytes_per_line, m_row.size() - 1);
+            if (!pump(m_row.data(), m_row.size(), Z_NO_FLUSH))
+                return false;
+        }
+        return true;
+    }
+
+    bool finish_file() override
+    {
+        if (!pump(nullptr, 0, Z_FINISH))
+            return false;
+        if (m_out_used > 0 && !write_chunk("IDAT", m_out.data(), m_out_used))
+            return false;
+        deflateEnd(&m_zs);
+        m_deflating = false;
+        return write_chunk("IEND", nullptr, 0);
+    }
+
+private:
+    // Feed @p size bytes to deflate, writing an IDAT chunk whenever the
+    // output buffer fills up.
+    bool pump(const uchar* data, std::size_t size, int flush)
+    {
+        m_zs.next_in  = const_cast<Bytef*>(data);
+        m_zs.avail_in = uInt(size);
+        for (;;) {
+            m_zs.next_out  = reinterpret_cast<Bytef*>(m_out.data()) + m_out_used;
+            m_zs.avail_out = uInt(kChunkBytes - m_out_used);
+            const int rc = deflate(&m_zs, flush);
+            if (rc == Z_STREAM_ERROR)
+                return false;
+            m_out_used = kChunkBytes - m_zs.avail_out;
+            const bool full = m_zs.avail_out == 0;
+            if (full) {
+                if (!write_chunk("IDAT", m_out.data(), m_out_used))
+                    return false;
+                m_out_used = 0;
+            }
+            if (flush == Z_FINISH ? rc == Z_STREAM_END : (!full && m_zs.avail_in == 0))
+                return true;
+        }
+    }
+
+    bool write_chunk(const char* type, const char* data, std::size_t size)
+    {
+        QByteArray chunk;
+        chunk.reserve(qsizetype(size) + 12);
+        put_be<quint32>(chunk, quint32(size));
+        chunk.append(type, 4);
+        if (size > 0)
+            chunk.append(data, qsizetype(size));
+        const uLong crc = crc32(crc32(0L, Z_NULL, 0),
+                                reinterpret_cast<const Bytef*>(chunk.constData()) + 4,
+                                uInt(size + 4));
+        put_be<quint32>(chunk, quint32(crc));
+        return m_file.write(chunk) == chunk.size();
+    }
+
+    z_stream          m_zs{};
+    bool              m_deflating = false;
+    std::vector<char> m_out;
+    std::size_t       m_out_used = 0;
+    std::vector<uchar> m_row;
+};
+
+#endif // EZGL_HAVE_ZLIB
+
+} // anonymous namespace
+
+namespace ezgl {
+
+std::unique_ptr<StreamingImageWriter> StreamingImageWriter::create(const QString& path, QSize size)
+{
+    if (size.isEmpty()) {
+        q_warning("StreamingImageWriter: invalid image size %dx%d.", size.width(), size.height());
+        return nullptr;
+    }
+
+    std::unique_ptr<StreamingImageWriter> writer;
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "tif" || suffix == "tiff") {
+        writer = std::make_unique<tiff_writer>(path, size);
+    } else {
+#ifdef EZGL_HAVE_ZLIB
+        writer = std::make_unique<png_writer>(path, size);
+#else
+        q_warning("StreamingImageWriter: built without zlib, so only .tif output is available.");
+        return nullptr;
+#endif
+    }
+
+    if (!writer->m_file.open(QIODevice::WriteOnly | QIODevice::Truncate) || !writer->write_header()) {
+        q_warning("StreamingImageWriter: could not write %s.", qPrintable(path));
+        return nullptr;
+    }
+    return writer;
+}
+
+StreamingImageWriter::StreamingImageWriter(const QString& path, QSize size)
+    : m_file(path)
+    , m_size(size)
+{
+}
+
+StreamingImageWriter::~StreamingImageWriter() = default;
+
+bool StreamingImageWriter::write_rows(const QImage& band)
+{
+    if (!m_ok || m_finished)
+        return false;
+    if (band.width() != m_size.width()) {
+        q_warning("StreamingImageWriter: band is %d pixels wide, image is %d.", band.width(), m_size.width());
+        m_ok = false;
+        return false;
+    }
+    const int count = std::min(band.height(), m_size.height() - m_rows_written);
+    if (count <= 0)
+        return true;
+
+    const QImage rgb = band.convertToFormat(QImage::Format_RGB888);
+    m_ok = encode_rows(rgb.constBits(), rgb.bytesPerLine(), count);
+    m_rows_written += count;
+    return m_ok;
+}
+
+bool StreamingImageWriter::finish()
+{
+    if (m_finished)
+        return m_ok;
+    m_finished = true;
+    if (m_ok && m_rows_written < m_size.height()) {
+        q_warning("StreamingImageWriter: only %d of %d rows were written.", m_rows_written, m_size.height());
+        m_ok = false;
+    }
+    m_ok = m_ok && finish_file();
+    m_file.close();
+    return m_ok;
+}
+
+} // namespace ezgl
@@ -0,0 +1,618 @@
+#include "ezgl/qt/triangulator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+
+namespace ezgl {
+
+namespace {
+
+// One vertex of a polygon ring. @c prev / @c next walk the ring; @c prev_z /
+// @c next_z walk the same vertices sorted by z-order code (only linked when
+// hashing is enabled).
+struct Node {
+    Node(std::uint32_t index, double px, double py) : i(index), x(px), y(py) {}
+
+    std::uint32_t i;
+    double        x;
+    double        y;
+    Node*         prev    = nullptr;
+    Node*         next    = nullptr;
+    std::int32_t  z       = 0;
+    Node*         prev_z  = nullptr;
+    Node*         next_z  = nullptr;
+    bool          steiner = false;
+};
+
+double area(const Node* p, const Node* q, const Node* r)
+{
+    return (q->y - p->y) * (r->x - q->x) - (q->x - p->x) * (r->y - q->y);
+}
+
+bool equals(const Node* a, const Node* b)
+{
+    return a->x == b->x && a->y == b->y;
+}
+
+int sign(double v)
+{
+    return (v > 0.0) - (v < 0.0);
+}
+
+bool point_in_triangle(double ax, double ay, double bx, double by,
+                       double cx, double cy, double px, double py)
+{
+    return (cx - px) * (ay - py) >= (ax - px) * (cy - py)
+        && (ax - px) * (by - py) >= (bx - px) * (ay - py)
+        && (bx - px) * (cy - py) >= (cx - px) * (by - py);
+}
+
+// q lies on segment pr, given p, q, r are collinear.
+bool on_segment(const Node* p, const Node* q, const Node* r)
+{
+    return q->x <= std::max(p->x, r->x) && q->x >= std::min(p->x, r->x)
+        && q->y <= std::max(p->y, r->y) && q->y >= std::min(p->y, r->y);
+}
+
+bool intersects(const Node* p1, const Node* q1, const Node* p2, const Node* q2)
+{
+    const int o1 = sign(area(p1, q1, p2));
+    const int o2 = sign(area(p1, q1, q2));
+    const int o3 = sign(area(p2, q2, p1));
+    const int o4 = sign(area(p2, q2, q1));
+
+    if (o1 != o2 && o3 != o4) return true;
+    if (o1 == 0 && on_segment(p1, p2, q1)) return true;
+    if (o2 == 0 && on_segment(p1, q2, q1)) return true;
+    if (o3 == 0 && on_segment(p2, p1, q2)) return true;
+    if (o4 == 0 && on_segment(p2, q1, q2)) return true;
+    return false;
+}
+
+// Diagonal ab intersects any polygon edge not incident to a or b.
+bool intersects_polygon(const Node* a, const Node* b)
+{
+    const Node* p = a;
+    do {
+        if (p->i != a->i && p->next->i != a->i && p->i != b->i && p->next->i != b->i
+            && intersects(p, p->next, a, b))
+            return true;
+        p = p->next;
+    } while (p != a);
+    return false;
+}
+
+// Diagonal ab leaves a towards the interior of the polygon.
+bool locally_inside(const Node* a, const Node* b)
+{
+    return area(a->prev, a, a->next) < 0.0
+        ? area(a, b, a->next) >= 0.0 && area(a, a->prev, b) >= 0.0
+        : area(a, b, a->prev) < 0.0 || area(a, a->next, b) < 0.0;
+}
+
+// Midpoint of diagonal ab lies inside the polygon (even-odd ray cast).
+bool middle_inside(const Node* a, const Node* b)
+{
+    const Node* p = a;
+    bool inside = false;
+    const double px = (a->x + b->x) / 2.0;
+    const double py = (a->y + b->y) / 2.0;
+    do {
+        if (((p->y > py) != (p->next->y > py)) && p->next->y != p->y
+            && px < (p->next->x - p->x) * (py - p->y) / (p->next->y - p->y) + p->x)
+            inside = !inside;
+        p = p->next;
+    } while (p != a);
+    return inside;
+}
+
+bool is_valid_diagonal(const Node* a, const Node* b)
+{
+    return a->next->i != b->i && a->prev->i != b->i && !intersects_polygon(a, b)
+        && ((locally_inside(a, b) && locally_inside(b, a) && middle_inside(a, b)
+             && (area(a->prev, a, b->prev) != 0.0 || area(a, b->prev, b) != 0.0))
+            || (equals(a, b) && area(a->prev, a, a->next) > 0.0
+                && area(b->prev, b, b->next) > 0.0));
+}
+
+bool sector_contains_sector(const Node* m, const Node* p)
+{
+    return area(m->prev, m, p->prev) < 0.0 && area(p->next, m, m->next) < 0.0;
+}
+
+void remove_node(Node* p)
+{
+    p->next->prev = p->prev;
+    p->prev->next = p->next;
+    if (p->prev_z) p->prev_z->next_z = p->next_z;
+    if (p->next_z) p->next_z->prev_z = p->prev_z;
+}
+
+class Earcut {
+public:
+    std::vector<std::uint32_t> run(const std::vector<point2d>& outer,
+                                   const std::vector<std::vector<point2d>>& holes);
+
+private:
+    Node* insert_node(std::uint32_t i, const point2d& p, Node* last);
+    Node* linked_list(const std::vector<point2d>& ring, std::uint32_t base, bool clockwise);
+    Node* filter_points(Node* start, Node* end = nullptr);
+    Node* eliminate_holes(const std::vector<std::vector<point2d>>& holes,
+                          std::uint32_t first_hole_index, Node* outer_node);
+    Node* eliminate_hole(Node* hole, Node* outer_node);
+    Node* find_hole_bridge(Node* hole, Node* outer_node);
+    Node* split_polygon(Node* a, Node* b);
+    Node* cure_local_intersections(Node* start);
+
+    void earcut_linked(Node* ear, int pass);
+    void split_earcut(Node* start);
+    bool is_ear(const Node* ear) const;
+    bool is_ear_hashed(const Node* ear) const;
+    void index_curve(Node* start) const;
+    std::int32_t z_order(double x, double y) const;
+
+    void emit(const Node* a, const Node* b, const Node* c)
+    {
+        m_indices.push_back(a->i);
+        m_indices.push_back(b->i);
+        m_indices.push_back(c->i);
+    }
+
+    std::deque<Node>           m_nodes; // deque: node addresses stay stable on growth
+    std::vector<std::uint32_t> m_indices;
+    bool                       m_hashed   = false;
+    double                     m_min_x    = 0.0;
+    double                     m_min_y    = 0.0;
+    double                     m_inv_size = 0.0;
+};
+
+std::vector<std::uint32_t> Earcut::run(const std::vector<point2d>& outer,
+                                       const std::vector<std::vector<point2d>>& holes)
+{
+    if (outer.size() < 3)
+        return {};
+
+    Node* outer_node = linked_list(outer, 0, true);
+    if (!outer_node || outer_node->next == outer_node->prev)
+        return {};
+
+    std::size_t total = outer.size();
+    for (const std::vector<point2d>& hole : holes)
+        total += hole.size();
+    m_indices.reserve((total + 2 * holes.size()) * 3);
+
+    if (!holes.empty())
+        outer_node = eliminate_holes(holes, std::uint32_t(outer.size()), outer_node);
+
+    if (total > kTriangulatorHashThreshold) {
+        double max_x = outer[0].x, max_y = outer[0].y;
+        m_min_x = max_x;
+        m_min_y = max_y;
+        for (const point2d& p : outer) {
+            m_min_x = std::min(m_min_x, p.x);
+            m_min_y = std::min(m_min_y, p.y);
+            max_x   = std::max(max_x, p.x);
+            max_y   = std::max(max_y, p.y);
+        }
+        const double size = std::max(max_x - m_min_x, max_y - m_min_y);
+        m_inv_size = size != 0.0 ? 32767.0 / size : 0.0;
+        m_hashed   = m_inv_size != 0.0;
+    }
+
+    earcut_linked(outer_node, 0);
+    return std::move(m_indices);
+}
+
+Node* Earcut::insert_node(std::uint32_t i, const point2d& p, Node* last)
+{
+    Node* node = &m_nodes.emplace_back(i, p.x, p.y);
+    if (!last) {
+        node->prev = node;
+        node->next = node;
+    } else {
+        node->next       = last->next;
+        node->prev       = last;
+        last->next->prev = node;
+        last->next       = node;
+    }
+    return node;
+}
+
+// Build a circular list for @p ring with the requested orientation. Indices
+// are @p base + position in the ring.
+Node* Earcut::linked_list(const std::vector<point2d>& ring, std::uint32_t base, bool clockwise)
+{
+    const std::size_t n = ring.size();
+    if (n == 0)
+        return nullptr;
+
+    double sum = 0.0;
+    for (std::size_t i = 0, j = n - 1; i < n; j = i++)
+        sum += (ring[j].x - ring[i].x) * (ring[i].y + ring[j].y);
+
+    Node* last = nullptr;
+    if (clockwise == (sum > 0.0)) {
+        for (std::size_t i = 0; i < n; ++i)
+            last = insert_node(base + std::uint32_t(i), ring[i], last);
+    } else {
+        for (std::size_t i = n; i-- > 0;)
+            last = insert_node(base + std::uint32_t(i), ring[i], last);
+    }
+
+    if (last && equals(last, last->next)) {
+        remove_node(last);
+        last = last->next;
+    }
+    return last;
+}
+
+// Drop duplicate and collinear vertices between @p start and @p end.
+Node* Earcut::filter_points(Node* start, Node* end)
+{
+    if (!start)
+        return start;
+    if (!end)
+        end = start;
+
+    Node* p = start;
+    bool again;
+    do {
+        again = false;
+        if (!p->steiner && (equals(p, p->next) || area(p->prev, p, p->next) == 0.0)) {
+            remove_node(p);
+            p = end = p->prev;
+            if (p == p->next)
+                break;
+            again = true;
+        } else {
+            p = p->next;
+        }
+    } while (again || p != end);
+    return end;
+}
+
+// Main ear slicing loop. Pass 0 is plain clipping; when it stalls, pass 1
+// filters degenerate points, pass 2 cuts off local self-intersections, and
+// the last resort splits the ring along a valid diagonal.
+void Earcut::earcut_linked(Node* ear, int pass)
+{
+    if (!ear)
+        return;
+    if (pass == 0 && m_hashed)
+        index_curve(ear);
+
+    Node* stop = ear;
+    while (ear->prev != ear->next) {
+        Node* prev = ear->prev;
+        Node* next = ear->next;
+
+        if (m_hashed ? is_ear_hashed(ear) : is_ear(ear)) {
+            emit(prev, ear, next);
+            remove_node(ear);
+            // Skipping the next vertex produces fewer sliver triangles.
+            ear  = next->next;
+            stop = next->next;
+            continue;
+        }
+
+        ear = next;
+        if (ear == stop) {
+            if (pass == 0)
+                earcut_linked(filter_points(ear), 1);
+            else if (pass == 1)
+                earcut_linked(cure_local_intersections(filter_points(ear)), 2);
+            else
+                split_earcut(ear);
+            break;
+        }
+    }
+}
+
+bool Earcut::is_ear(const Node* ear) const
+{
+    const Node* a = ear->prev;
+    const Node* b = ear;
+    const Node* c = ear->next;
+    if (area(a, b, c) >= 0.0)
+        return false; // reflex
+
+    const double x0 = std::min({a->x, b->x, c->x});
+    const double y0 = std::min({a->y, b->y, c->y});
+    const double x1 = std::max({a->x, b->x, c->x});
+    const double y1 = std::max({a->y, b->y, c->y});
+
+    for (const Node* p = c->next; p != a; p = p->next) {
+        if (p->x >= x0 && p->x <= x1 && p->y >= y0 && p->y <= y1
+            && point_in_triangle(a->x, a->y, b->x, b->y, c->x, c->y, p->x, p->y)
+            && area(p->prev, p, p->next) >= 0.0)
+            return false;
+    }
+    return true;
+}
+
+bool Earcut::is_ear_hashed(const Node* ear) const
+{
+    const Node* a = ear->prev;
+    const Node* b = ear;
+    const Node* c = ear->next;
+    if (area(a, b, c) >= 0.0)
+        return false;
+
+    const double x0 = std::min({a->x, b->x, c->x});
+    const double y0 = std::min({a->y, b->y, c->y});
+    const double x1 = std::max({a->x, b->x, c->x});
+    const double y1 = std::max({a->y, b->y, c->y});
+
+    const std::int32_t min_z = z_order(x0, y0);
+    const std::int32_t max_z = z_order(x1, y1);
+
+    auto blocks = [&](const Node* p) {
+        return p->x >= x0 && p->x <= x1 && p->y >= y0 && p->y <= y1
+            && p != a && p != c
+            && point_in_triangle(a->x, a->y, b->x, b->y, c->x, c->y, p->x, p->y)
+            && area(p->prev, p, p->next) >= 0.0;
+    };
+
+    // Walk both directions of the z-order list at once while inside the
+    // bounding box's z range.
+    const Node* p = ear->prev_z;
+    const Node* n = ear->next_z;
+    while (p && p->z >= min_z && n && n->z <= max_z) {
+        if (blocks(p)) return false;
+        p = p->prev_z;
+        if (blocks(n)) return false;
+        n = n->next_z;
+    }
+    for (; p && p->z >= min_z; p = p->prev_z)
+        if (blocks(p)) return false;
+    for (; n && n->z <= max_z; n = n->next_z)
+        if (blocks(n)) return false;
+    return true;
+}
+
+Node* Earcut::cure_local_intersections(Node* start)
+{
+    Node* p = start;
+    do {
+        Node* a = p->prev;
+        Node* b = p->next->next;
+        if (!equals(a, b) && intersects(a, p, p->next, b)
+            && locally_inside(a, b) && locally_inside(b, a)) {
+            emit(a, p, b);
+            remove_node(p);
+            remove_node(p->next);
+            p = start = b;
+        }
+        p = p->next;
+    } while (p != start);
+    return filter_points(p);
+}
+
+void Earcut::split_earcut(Node* start)
+{
+    Node* a = start;
+    do {
+        for (Node* b = a->next->next; b != a->prev; b = b->next) {
+            if (a->i != b->i && is_valid_diagonal(a, b)) {
+                Node* c = split_polygon(a, b);
+                a = filter_points(a, a->next);
+                c = filter_points(c, c->next);
+                earcut_linked(a, 0);
+                earcut_linked(c, 0);
+                return;
+            }
+        }
+        a = a->next;
+    } while (a != start);
+}
+
+Node* Earcut::eliminate_holes(const std::vector<std::vector<point2d>>& holes,
+                              std::uint32_t first_hole_index, Node* outer_node)
+{
+    std::vector<Node*> queue;
+    queue.reserve(holes.size());
+
+    std::uint32_t base = first_hole_index;
+    for (const std::vector<point2d>& hole : holes) {
+        Node* list = linked_list(hole, base, false);
+        base += std::uint32_t(hole.size());
+        if (!list)
+            continue;
+        if (list == list->next)
+            list->steiner = true;
+
+        Node* leftmost = list;
+        Node* p = list;
+        do {
+            if (p->x < leftmost->x || (p->x == leftmost->x && p->y < leftmost->y))
+                leftmost = p;
+            p = p->next;
+        } while (p != list);
+        queue.push_back(leftmost);
+    }
+
+    // Bridge holes left to right so each bridge only has to cross the
+    // outer ring, never a not-yet-merged hole.
+    std::sort(queue.begin(), queue.end(), [](const Node* a, const Node* b) {
+        return a->x < b->x || (a->x == b->x && a->y < b->y);
+    });
+    for (Node* hole : queue)
+        outer_node = eliminate_hole(hole, outer_node);
+    return outer_node;
+}
+
+Node* Earcut::eliminate_hole(Node* hole, Node* outer_node)
+{
+    Node* bridge = find_hole_bridge(hole, outer_node);
+    if (!bridge)
+        return outer_node;
+
+    Node* bridge_reverse = split_polygon(bridge, hole);
+    filter_points(bridge_reverse, bridge_reverse->next);
+    return filter_points(bridge, bridge->next);
+}
+
+// David Eberly's hole bridging: cast a ray left from the hole's leftmost
+// vertex, take the closest outer edge hit, then pick the outer vertex that
+// is visible from the hole vertex with the smallest angle to the ray.
+Node* Earcut::find_hole_bridge(Node* hole, Node* outer_node)
+{
+    Node* p = outer_node;
+    const double hx = hole->x;
+    const double hy = hole->y;
+    double qx = -std::numeric_limits<double>::infinity();
+    Node* m = nullptr;
+
+    do {
+        if (hy <= p->y && hy >= p->next->y && p->next->y != p->y) {
+            const double x = p->x + (hy - p->y) * (p->next->x - p->x) / (p->next->y - p->y);
+            if (x <= hx && x > qx) {
+                qx = x;
+                m  = p->x < p->next->x ? p : p->next;
+                if (x == hx)
+                    return m; // hole touches the outer segment
+            }
+        }
+        p = p->next;
+    } while (p != outer_node);
+
+    if (!m)
+        return nullptr;
+
+    const Node* stop = m;
+    const double mx = m->x;
+    const double my = m->y;
+    double tan_min = std::numeric_limits<double>::infinity();
+
+    p = m;
+    do {
+        if (hx >= p->x && p->x >= mx && hx != p->x
+            && point_in_triangle(hy < my ? hx : qx, hy, mx, my,
+                                 hy < my ? qx : hx, hy, p->x, p->y)) {
+            const double tan = std::abs(hy - p->y) / (hx - p->x);
+            if (locally_inside(p, hole)
+                && (tan < tan_min
+                    || (tan == tan_min
+                        && (p->x > m->x || (p->x == m->x && sector_contains_sector(m, p)))))) {
+                m       = p;
+                tan_min = tan;
+            }
+        }
+        p = p->next;
+    } while (p != stop);
+
+    return m;
+}
+
+// Link a and b with a diagonal. If they belong to one ring the ring splits
+// in two; if they belong to different rings (hole bridging) the rings merge.
+// Returns the duplicate of b that starts the second half.
+Node* Earcut::split_polygon(Node* a, Node* b)
+{
+    Node* a2 = &m_nodes.emplace_back(a->i, a->x, a->y);
+    Node* b2 = &m_nodes.emplace_back(b->i, b->x, b->y);
+    Node* an = a->next;
+    Node* bp = b->prev;
+
+    a->next  = b;
+    b->prev  = a;
+    a2->next = an;
+    an->prev = a2;
+    b2->next = a2;
+    a2->prev = b2;
+    bp->next = b2;
+    b2->prev = bp;
+    return b2;
+}
+
+// Link the ring into z-order and sort it (Simon Tatham's in-place linked
+// list merge sort).
+void Earcut::index_curve(Node* start) const
+{
+    Node* p = start;
+    do {
+        p->z      = z_order(p->x, p->y);
+        p->prev_z = p->prev;
+        p->next_z = p->next;
+        p = p->next;
+    } while (p != start);
+
+    p->prev_z->next_z = nullptr;
+    p->prev_z         = nullptr;
+
+    Node* list = p;
+    int in_size = 1;
+    int num_merges;
+    do {
+        p    = list;
+        list = nullptr;
+        Node* tail = nullptr;
+        num_merges = 0;
+
+        while (p) {
+            ++num_merges;
+            Node* q = p;
+            int p_size = 0;
+            for (int i = 0; i < in_size; ++i) {
+                ++p_size;
+                q = q->next_z;
+                if (!q)
+                    break;
+            }
+            int q_size = in_size;
+
+            while (p_size > 0 || (q_size > 0 && q)) {
+                Node* e;
+                if (p_size != 0 && (q_size == 0 || !q || p->z <= q->z)) {
+                    e = p;
+                    p = p->next_z;
+                    --p_size;
+                } else {
+                    e = q;
+                    q = q->next_z;
+                    --q_size;
+                }
+                if (tail)
+                    tail->next_z = e;
+                else
+                    list = e;
+                e->prev_z = tail;
+                tail      = e;
+            }
+            p = q;
+        }
+        tail->next_z = nullptr;
+        in_size *= 2;
+    } while (num_merges > 1);
+}
+
+// Interleave the bits of the 15-bit quantised coordinates into a Morton code.
+std::int32_t Earcut::z_order(double px, double py) const
+{
+    std::int32_t x = std::int32_t((px - m_min_x) * m_inv_size);
+    std::int32_t y = std::int32_t((py - m_min_y) * m_inv_size);
+
+    x = (x | (x << 8)) & 0x00FF00FF;
+    x = (x | (x << 4)) & 0x0F0F0F0F;
+    x = (x | (x << 2)) & 0x33333333;
+    x = (x | (x << 1)) & 0x55555555;
+
+    y = (y | (y << 8)) & 0x00FF00FF;
+    y = (y | (y << 4)) & 0x0F0F0F0F;
+    y = (y | (y << 2)) & 0x33333333;
+    y = (y | (y << 1)) & 0x55555555;
+
+    return x | (y << 1);
+}
+
+} // namespace
+
+std::vector<std::uint32_t> triangulate_polygon(const std::vector<point2d>& outer,
+                                               const std::vector<std::vector<point2d>>& holes)
+{
+    return Earcut().run(outer, holes);
+}
+
+} // namespace ezgl
@@ -0,0 +1,881 @@
+#include "ezgl/qt/vector_renderer.hpp"
+#include "ezgl/camera.hpp"
+#include "ezgl/logutils.hpp"
+#include "ezgl/qt/painter.hpp"
+
+#include <QBuffer>
+#include <QByteArray>
+#include <QFile>
+#include <QFontMetricsF>
+
+#include <algorithm>
+#include <cfloat>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <numbers>
+#include <set>
+#include <utility>
+
+namespace {
+
+// Two page points closer than this are the same point when joining lines.
+constexpr double kJoinEpsilon = 1e-6;
+// |sin| of the angle below which two segments count as collinear.
+constexpr double kCollinearSine = 1e-6;
+
+// Shortest fixed-point form with at most two decimals ("12", "0.5", "-3.25").
+void put_number(QByteArray& out, double value)
+{
+    char buf[48];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::fixed, 2);
+    if (ec != std::errc()) {
+        out.append('0');
+        return;
+    }
+    char* last = end;
+    while (last[-1] == '0') --last;
+    if (last[-1] == '.') --last;
+    if (last - buf == 2 && buf[0] == '-' && buf[1] == '0')
+        out.append('0');
+    else
+        out.append(buf, last - buf);
+}
+
+void put_point(QByteArray& out, QPointF p)
+{
+    put_number(out, p.x());
+    out.append(' ');
+    put_number(out, p.y());
+}
+
+// ---- SVG -------------------------------------------------------------------
+
+class svg_document final : public ezgl::vector_document {
+public:
+    svg_document(const QString& path, QSize page) : m_file(path), m_page(page) {}
+
+    bool open()
+    {
+        if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            return false;
+        QByteArray head = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                          "<svg xmlns=\"http://www.w3.org/2000/svg\" "
+                          "xmlns:xlink=\"http://www.w3.org/1999/xlink\" version=\"1.1\" width=\"";
+        head += QByteArray::number(m_page.width()) + "\" height=\"" + QByteArray::number(m_page.height());
+        head += "\" viewBox=\"0 0 " + QByteArray::number(m_page.width()) + ' '
+                + QByteArray::number(m_page.height()) + "\">\n";
+        return write(head);
+    }
+
+    void write_path(const ezgl::vector_style& style, const ezgl::vector_path& path) override
+    {
+        QByteArray e = "<path d=\"";
+        for (const ezgl::vector_path::subpath& sp : path.subpaths) {
+            e.append('M');
+            put_point(e, path.points[sp.first]);
+            for (std::uint32_t i = 1; i < sp.count; ++i) {
+                e.append(i == 1 ? 'L' : ' ');
+                put_point(e, path.points[sp.first + i]);
+            }
+            if (sp.closed)
+                e.append('Z');
+        }
+        e += '"';
+        if (style.fill) {
+            e += " fill=\"" + style.color.name(QColor::HexRgb).toLatin1() + '"';
+            put_opacity(e, " fill-opacity=\"", style.color);
+        } else {
+            e += " fill=\"none\" stroke=\"" + style.color.name(QColor::HexRgb).toLatin1() + '"';
+            put_opacity(e, " stroke-opacity=\"", style.color);
+            if (style.line_width != 1.0) {
+                e += " stroke-width=\"";
+                put_number(e, style.line_width);
+                e += '"';
+            }
+            if (style.cap == ezgl::line_cap::round)
+                e += " stroke-linecap=\"round\"";
+            if (style.dash == ezgl::line_dash::asymmetric_5_3)
+                e += " stroke-dasharray=\"5 3\"";
+        }
+        e += "/>\n";
+        write(e);
+    }
+
+    void write_text(const QString& text, QPointF origin, double rotation,
+                    const QFont& font, const QColor& color) override
+    {
+        QByteArray e = "<text x=\"";
+        put_number(e, origin.x());
+        e += "\" y=\"";
+        put_number(e, origin.y());
+        e += "\" font-family=\"" + font.family().toHtmlEscaped().toUtf8() + "\" font-size=\"";
+        put_number(e, font.pixelSize() > 0 ? double(font.pixelSize()) : font.pointSizeF());
+        e += '"';
+        if (font.weight() >= QFont::Bold)
+            e += " font-weight=\"bold\"";
+        if (font.style() != QFont::StyleNormal)
+            e += " font-style=\"italic\"";
+        e += " fill=\"" + color.name(QColor::HexRgb).toLatin1() + '"';
+        put_opacity(e, " fill-opacity=\"", color);
+        if (rotation != 0.0) {
+            e += " transform=\"rotate(";
+            put_number(e, rotation);
+            e += ' ';
+            put_point(e, origin);
+            e += ")\"";
+        }
+        e += " xml:space=\"preserve\">" + text.toHtmlEscaped().toUtf8() + "</text>\n";
+        write(e);
+    }
+
+    void write_image(const QImage& image, const QRectF& target) override
+    {
+        QByteArray png;
+        QBuffer    buffer(&png);
+        buffer.open(QIODevice::WriteOnly);
+        if (!image.save(&buffer, "PNG")) {
+            m_ok = false;
+            return;
+        }
+        QByteArray e = "<image x=\"";
+        put_number(e, target.x());
+        e += "\" y=\"";
+        put_number(e, target.y());
+        e += "\" width=\"";
+        put_number(e, target.width());
+        e += "\" height=\"";
+        put_number(e, target.height());
+        e += "\" preserveAspectRatio=\"none\" xlink:href=\"data:image/png;base64,";
+        e += png.toBase64() + "\"/>\n";
+        write(e);
+    }
+
+    bool finish() override
+    {
+        write("</svg>\n");
+        m_file.close();
+        return m_ok;
+    }
+
+private:
+    static void put_opacity(QByteArray& e, const char* attribute, const QColor& color)
+    {
+        if (color.alpha() == 255)
+            return;
+        e += attribute;
+        put_number(e, color.alphaF());
+        e += '"';
+    }
+
+    bool write(const QByteArray& bytes)
+    {
+        m_ok = m_ok && m_file.write(bytes) == bytes.size();
+        return m_ok;
+    }
+
+    QFile m_file;
+    QSize m_page;
+    bool  m_ok = true;
+};
+
+// ---- PDF -------------------------------------------------------------------
+
+// One-page PDF written front to back. The page content is cut into
+// Flate-compressed streams of about kContentChunkBytes each (the page's
+// /Contents array joins them), images become XObjects as they arrive, and
+// the page, fonts and cross-reference table follow at the end.
+class pdf_document final : public ezgl::vector_document {
+public:
+    static constexpr qsizetype kContentChunkBytes = qsizetype(1) << 20;
+
+    // Object numbers fixed up front; content and images come after.
+    enum : int { kCatalog = 1, kPages = 2, kPage = 3, kFirstFont = 4, kFontCount = 4 };
+
+    pdf_document(const QString& path, QSize page) : m_file(path), m_page(page) {}
+
+    bool open()
+    {
+        if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            return false;
+        m_offsets.assign(kFirstFont + kFontCount, 0);
+        // Page units with y down, like the canvas.
+        m_content = "1 0 0 -1 0 " + QByteArray::number(m_page.height()) + " cm\n";
+        return write("%PDF-1.4\n%\xE2\xE3\xCF\xD3\n");
+    }
+
+    void write_path(const ezgl::vector_style& style, const ezgl::vector_path& path) override
+    {
+        set_alpha(style.color.alpha());
+        if (style.fill) {
+            put_color(style.color, "rg\n");
+        } else {
+            put_color(style.color, "RG\n");
+            if (style.line_width != m_line_width) {
+                put_number(m_content, style.line_width);
+                m_content += " w\n";
+                m_line_width = style.line_width;
+            }
+            const int cap = style.cap == ezgl::line_cap::round ? 1 : 0;
+            if (cap != m_cap) {
+                m_content += QByteArray::number(cap) + " J\n";
+                m_cap = cap;
+            }
+            const int dash = int(style.dash);
+            if (dash != m_dash) {
+                m_content += style.dash == ezgl::line_dash::asymmetric_5_3 ? "[5 3] 0 d\n" : "[] 0 d\n";
+                m_dash = dash;
+            }
+        }
+
+        for (const ezgl::vector_path::subpath& sp : path.subpaths) {
+            for (std::uint32_t i = 0; i < sp.count; ++i) {
+                put_point(m_content, path.points[sp.first + i]);
+                m_content += i == 0 ? " m\n" : " l\n";
+            }
+            if (sp.closed)
+                m_content += "h\n";
+        }
+        m_content += style.fill ? "f\n" : "S\n";
+        flush_content(false);
+    }
+
+    void write_text(const QString& text, QPointF origin, double rotation,
+                    const QFont& font, const QColor& color) override
+    {
+        set_alpha(color.alpha());
+        put_color(color, "rg\n");
+
+        // Latin-1 covers WinAnsi for the characters labels use; anything
+        // else becomes '?'.
+        QByteArray s;
+        for (QChar c : text) {
+            const char16_t u = c.unicode();
+            const char     ch = (u >= 32 && u < 256) ? char(u) : '?';
+            if (ch == '(' || ch == ')' || ch == '\\')
+                s.append('\\');
+            s.append(ch);
+        }
+
+        const int    font_index = (font.weight() >= QFont::Bold ? 1 : 0)
+                                + (font.style() != QFont::StyleNormal ? 2 : 0);
+        const double size = font.pixelSize() > 0 ? double(font.pixelSize()) : font.pointSizeF();
+        // Text space is y-up; undo the page flip and rotate clockwise.
+        const double rad = rotation * std::numbers::pi / 180.0;
+        const double c = std::cos(rad);
+        const double n = std::sin(rad);
+        m_content += "BT /F" + QByteArray::number(font_index + 1) + ' ';
+        put_number(m_content, size);
+        m_content += " Tf ";
+        for (double v : {c, n, n, -c}) {
+            put_number(m_content, v);
+            m_content += ' ';
+        }
+        put_point(m_content, origin);
+        m_content += " Tm (" + s + ") Tj ET\n";
+        flush_content(false);
+    }
+
+    void write_image(const QImage& image, const QRectF& target) override
+    {
+        if (image.isNull())
+            return;
+        const int w = image.width();
+        const int h = image.height();
+        auto packed = [w, h](const QImage& img, int bytes_per_pixel) {
+            QByteArray data;
+            data.reserve(qsizetype(w) * bytes_per_pixel * h);
+            for (int y = 0; y < h; ++y)
+                data.append(reinterpret_cast<const char*>(img.constScanLine(y)), qsizetype(w) * bytes_per_pixel);
+            return data;
+        };
+        const QByteArray header = " /Type /XObject /Subtype /Image /Width " + QByteArray::number(w)
+                                + " /Height " + QByteArray::number(h) + " /BitsPerComponent 8";
+
+        QByteArray smask;
+        if (image.hasAlphaChannel()) {
+            const int mask_id = new_object();
+            write_stream(mask_id, header + " /ColorSpace /DeviceGray",
+                         packed(image.convertToFormat(QImage::Format_Alpha8), 1));
+            smask = " /SMask " + QByteArray::number(mask_id) + " 0 R";
+        }
+        const int id = new_object();
+        write_stream(id, header + " /ColorSpace /DeviceRGB" + smask,
+                     packed(image.convertToFormat(QImage::Format_RGB888), 3));
+        m_images.push_back(id);
+
+        // The unit square's top edge is the image's first row.
+        m_content += "q ";
+        put_number(m_content, target.width());
+        m_content += " 0 0 ";
+        put_number(m_content, -target.height());
+        m_content += ' ';
+        put_point(m_content, target.bottomLeft());
+        m_content += " cm /Im" + QByteArray::number(id) + " Do Q\n";
+        flush_content(false);
+    }
+
+    bool finish() override
+    {
+        flush_content(true);
+
+        static const char* const kFonts[kFontCount] = {
+            "Helvetica", "Helvetica-Bold", "Helvetica-Oblique", "Helvetica-BoldOblique"};
+        for (int i = 0; i < kFontCount; ++i) {
+            begin_object(kFirstFont + i);
+            write(QByteArray("<< /Type /Font /Subtype /Type1 /BaseFont /") + kFonts[i]
+                  + " /Encoding /WinAnsiEncoding >>\nendobj\n");
+        }
+
+        QByteArray page = "<< /Type /Page /Parent 2 0 R /MediaBox [0 0 "
+                        + QByteArray::number(m_page.width()) + ' ' + QByteArray::number(m_page.height())
+                        + "]\n/Resources << /Font <<";
+        for (int i = 0; i < kFontCount; ++i)
+            page += " /F" + QByteArray::number(i + 1) + ' ' + QByteArray::number(kFirstFont + i) + " 0 R";
+        page += " >> /ExtGState <<";
+        for (int alpha : m_alphas) {
+            page += " /A" + QByteArray::number(alpha) + " << /CA ";
+            put_number(page, alpha / 255.0);
+            page += " /ca ";
+            put_number(page, alpha / 255.0);
+            page += " >>";
+        }
+        page += " >> /XObject <<";
+        for (int id : m_images)
+            page += " /Im" + QByteArray::number(id) + ' ' + QByteArray::number(id) + " 0 R";
+        page += " >> >>\n/Contents [";
+        for (int id : m_contents)
+            page += QByteArray::number(id) + " 0 R ";
+        page += "] >>\nendobj\n";
+        begin_object(kPage);
+        write(page);
+
+        begin_object(kPages);
+        write("<< /Type /Pages /Kids [3 0 R] /Count 1 >>\nendobj\n");
+        begin_object(kCatalog);
+        write("<< /Type /Catalog /Pages 2 0 R >>\nendobj\n");
+
+        const qint64 xref = m_file.pos();
+        QByteArray   table = "xref\n0 " + QByteArray::number(qsizetype(m_offsets.size())) + "\n0000000000 65535 f \n";
+        for (std::size_t id = 1; id < m_offsets.size(); ++id) {
+            char entry[24];
+            std::snprintf(entry, sizeof(entry), "%010lld 00000 n \n", static_cast<long long>(m_offsets[id]));
+            table += entry;
+        }
+        table += "trailer\n<< /Size " + QByteArray::number(qsizetype(m_offsets.size()))
+               + " /Root 1 0 R >>\nstartxref\n" + QByteArray::number(xref) + "\n%%EOF\n";
+        write(table);
+        m_file.close();
+        return m_ok;
+    }
+
+private:
+    int new_object()
+    {
+        m_offsets.push_back(0);
+        return int(m_offsets.size() - 1);
+    }
+
+    void begin_object(int id)
+    {
+        m_offsets[std::size_t(id)] = m_file.pos();
+        write(QByteArray::number(id) + " 0 obj\n");
+    }
+
+    void write_stream(int id, const QByteArray& dictionary, const QByteArray& data)
+    {
+        // qCompress prefixes the zlib stream with a 4-byte length.
+        const QByteArray compressed = qCompress(data, 6).mid(4);
+        begin_object(id);
+        write("<< /Length " + QByteArray::number(compressed.size()) + " /Filter /FlateDecode"
+              + dictionary + " >>\nstream\n");
+        write(compressed);
+        write("\nendstream\nendobj\n");
+    }
+
+    // Content streams may only split between operators, which is where
+    // every caller leaves m_content.
+    void flush_content(bool force)
+    {
+        if (m_content.isEmpty() || (!force && m_content.size() < kContentChunkBytes))
+            return;
+        const int id = new_object();
+        write_stream(id, {}, m_content);
+        m_contents.push_back(id);
+        m_content.clear();
+    }
+
+    void set_alpha(int alpha)
+    {
+        if (alpha == m_alpha)
+            return;
+        m_alphas.insert(alpha);
+        m_content += "/A" + QByteArray::number(alpha) + " gs\n";
+        m_alpha = alpha;
+    }
+
+    void put_color(const QColor& color, const char* op)
+    {
+        const bool fill = op[0] == 'r';
+        QRgb&      current = fill ? m_fill_rgb : m_stroke_rgb;
+        if (color.rgb() == current)
+            return;
+        current = color.rgb();
+        for (double v : {color.redF(), color.greenF(), color.blueF()}) {
+            put_number(m_content, std::round(v * 1000.0) / 1000.0);
+            m_content += ' ';
+        }
+        m_content += op;
+    }
+
+    bool write(const QByteArray& bytes)
+    {
+        m_ok = m_ok && m_file.write(bytes) == bytes.size();
+        return m_ok;
+    }
+
+    QFile               m_file;
+    QSize               m_page;
+    bool                m_ok = true;
+    std::vector<qint64> m_offsets; ///< by object number; [0] unused
+    std::vector<int>    m_contents;
+    std::vector<int>    m_images;
+    std::set<int>       m_alphas;
+    QByteArray          m_content;
+
+    // Graphics state last set in the content, to skip redundant operators.
+    int    m_alpha      = 255;
+    QRgb   m_fill_rgb   = qRgb(0, 0, 0);
+    QRgb   m_stroke_rgb = qRgb(0, 0, 0);
+    double m_line_width = 1.0;
+    int    m_cap        = 0;
+    int    m_dash       = 0;
+};
+
+} // anonymous namespace
+
+namespace ezgl {
+
+// ---- vector_path -------------------------------------------------------------
+
+void vector_path::move_to(QPointF p)
+{
+    subpaths.push_back({std::uint32_t(points.size()), 1, false});
+    points.push_back(p);
+}
+
+void vector_path::line_to(QPointF p)
+{
+    if (subpaths.empty()) {
+        move_to(p);
+        return;
+    }
+    points.push_back(p);
+    ++subpaths.back().count;
+}
+
+void vector_path::close()
+{
+    if (!subpaths.empty())
+        subpaths.back().closed = true;
+}
+
+void vector_path::clear()
+{
+    points.clear();
+    subpaths.clear();
+}
+
+// ---- vector_document ---------------------------------------------------------
+
+std::unique_ptr<vector_document> vector_document::create(const QString& path,
+                                                         QSize          page_size,
+                                                         vector_format  format)
+{
+    if (format == vector_format::pdf) {
+        auto doc = std::make_unique<pdf_document>(path, page_size);
+        if (doc->open())
+            return doc;
+    } else {
+        auto doc = std::make_unique<svg_document>(path, page_size);
+        if (doc->open())
+            return doc;
+    }
+    q_warning("vector_document: could not write %s.", qPrintable(path));
+    return nullptr;
+}
+
+// ---- construction ------------------------------------------------------------
+
+vector_renderer::vector_renderer(vector_document& out, transform_fn transform, camera* cam)
+    : irenderer(nullptr, std::move(transform), cam, nullptr)
+    , m_out(out)
+    , m_metrics_surface(1, 1, QImage::Format_ARGB32_Premultiplied)
+    , m_metrics_painter(std::make_unique<Painter>(&m_metrics_surface))
+{
+    current_font = m_metrics_painter->font();
+    update_painter(m_metrics_painter.get(), &m_metrics_surface);
+}
+
+vector_renderer::~vector_renderer()
+{
+    flush();
+}
+
+// ---- runs --------------------------------------------------------------------
+
+void vector_renderer::flush()
+{
+    if (!m_run.empty())
+        m_out.write_path(m_run_style, m_run);
+    m_run.clear();
+}
+
+vector_style vector_renderer::stroke_style() const
+{
+    vector_style style;
+    style.color = QColor(current_color.red, current_color.green, current_color.blue, current_color.alpha);
+    style.line_width = current_line_width == 0 ? 1.0 : double(current_line_width);
+    style.cap = current_line_cap;
+    style.dash = current_line_dash;
+    return style;
+}
+
+vector_style vector_renderer::fill_style() const
+{
+    // Pen attributes do not affect fills, so they are left at their
+    // defaults and fills of one color merge regardless of them.
+    vector_style style;
+    style.color = QColor(current_color.red, current_color.green, current_color.blue, current_color.alpha);
+    style.fill = true;
+    return style;
+}
+
+QPointF vector_renderer::to_page(const point2d& p) const
+{
+    const point2d page = current_coordinate_system == WORLD ? m_transform(p) : p;
+    return {page.x, page.y};
+}
+
+void vector_renderer::begin_run(const vector_style& style, std::size_t extra_points)
+{
+    if (!(style == m_run_style) || m_run.points.size() + extra_points > kMaxRunPoints)
+        flush();
+    m_run_style = style;
+}
+
+void vector_renderer::add_ring(std::vector<QPointF> ring, bool hole)
+{
+    double twice_area = 0.0;
+    for (std::size_t i = 0, j = ring.size() - 1; i < ring.size(); j = i++)
+        twice_area += ring[j].x() * ring[i].y() - ring[i].x() * ring[j].y();
+    if ((twice_area < 0.0) != hole)
+        std::reverse(ring.begin(), ring.end());
+
+    m_run.move_to(ring[0]);
+    for (std::size_t i = 1; i < ring.size(); ++i)
+        m_run.line_to(ring[i]);
+    m_run.close();
+}
+
+// ---- lines and rectangles ----------------------------------------------------
+
+void vector_renderer::draw_line(const point2d& start, const point2d& end)
+{
+    point2d a = start;
+    point2d b = end;
+    if (current_coordinate_system == WORLD && !clip_line_world(get_visible_world(), a, b))
+        return;
+    const QPointF pa = to_page(a);
+    const QPointF pb = to_page(b);
+
+    begin_run(stroke_style(), 2);
+
+    // Extend the previous polyline if this segment continues it.
+    if (!m_run.empty() && !m_run.subpaths.back().closed) {
+        auto same = [](QPointF p, QPointF q) {
+            return std::abs(p.x() - q.x()) < kJoinEpsilon && std::abs(p.y() - q.y()) < kJoinEpsilon;
+        };
+        QPointF&      tail = m_run.points.back();
+        const bool    from_a = same(tail, pa);
+        if (from_a || same(tail, pb)) {
+            const QPointF next = from_a ? pb : pa;
+            if (m_run.subpaths.back().count >= 2) {
+                const QPointF prev = m_run.points[m_run.points.size() - 2];
+                const QPointF d1 = tail - prev;
+                const QPointF d2 = next - tail;
+                const double  cross = d1.x() * d2.y() - d1.y() * d2.x();
+                const double  dot = d1.x() * d2.x() + d1.y() * d2.y();
+                const double  lengths = std::hypot(d1.x(), d1.y()) * std::hypot(d2.x(), d2.y());
+                if (dot > 0.0 && std::abs(cross) <= kCollinearSine * lengths) {
+                    tail = next;
+                    return;
+                }
+            }
+            m_run.line_to(next);
+            return;
+        }
+    }
+    m_run.move_to(pa);
+    m_run.line_to(pb);
+}
+
+void vector_renderer::add_rectangle(const point2d& start, const point2d& end, bool fill)
+{
+    if (rectangle_off_screen({start, end}))
+        return;
+    const QPointF s = to_page(start);
+    const QPointF e = to_page(end);
+    std::vector<QPointF> ring = {s, {s.x(), e.y()}, e, {e.x(), s.y()}};
+    if (fill) {
+        begin_run(fill_style(), ring.size());
+        add_ring(std::move(ring), false);
+    } else {
+        begin_run(stroke_style(), ring.size());
+        m_run.move_to(ring[0]);
+        for (std::size_t i = 1; i < ring.size(); ++i)
+            m_run.line_to(ring[i]);
+        m_run.close();
+    }
+}
+
+void vector_renderer::draw_rectangle(const point2d& start, const point2d& end)
+{
+    add_rectangle(start, end, false);
+}
+
+void vector_renderer::draw_rectangle(const point2d& start, double width, double height)
+{
+    add_rectangle(start, {start.x + width, start.y + height}, false);
+}
+
+void vector_renderer::draw_rectangle(const rectangle& r)
+{
+    add_rectangle({r.left(), r.bottom()}, {r.right(), r.top()}, false);
+}
+
+void vector_renderer::fill_rectangle(const point2d& start, const point2d& end)
+{
+    add_rectangle(start, end, true);
+}
+
+void vector_renderer::fill_rectangle(const point2d& start, double width, double height)
+{
+    add_rectangle(start, {start.x + width, start.y + height}, true);
+}
+
+void vector_renderer::fill_rectangle(const rectangle& r)
+{
+    add_rectangle({r.left(), r.bottom()}, {r.right(), r.top()}, true);
+}
+
+// ---- polygons ----------------------------------------------------------------
+
+void vector_renderer::fill_poly(const std::vector<point2d>& points)
+{
+    fill_poly_with_holes(points, {});
+}
+
+void vector_renderer::fill_triangle(const point2d& a, const point2d& b, const point2d& c)
+{
+    fill_poly_with_holes({a, b, c}, {});
+}
+
+void vector_renderer::fill_poly_with_holes(const std::vector<point2d>& outer,
+                                           const std::vector<std::vector<point2d>>& holes)
+{
+    if (outer.size() < 3)
+        return;
+
+    double x_min = outer[0].x, x_max = outer[0].x;
+    double y_min = outer[0].y, y_max = outer[0].y;
+    for (const point2d& p : outer) {
+        x_min = std::min(x_min, p.x);
+        x_max = std::max(x_max, p.x);
+        y_min = std::min(y_min, p.y);
+        y_max = std::max(y_max, p.y);
+    }
+    if (rectangle_off_screen({{x_min, y_min}, {x_max, y_max}}))
+        return;
+
+    auto page_ring = [this](const std::vector<point2d>& ring) {
+        std::vector<QPointF> out;
+        out.reserve(ring.size());
+        for (const point2d& p : ring)
+            out.push_back(to_page(p));
+        return out;
+    };
+    std::size_t total = outer.size();
+    for (const std::vector<point2d>& hole : holes)
+        total += hole.size();
+
+    begin_run(fill_style(), total);
+    add_ring(page_ring(outer), false);
+    for (const std::vector<point2d>& hole : holes)
+        if (hole.size() >= 3)
+            add_ring(page_ring(hole), true);
+}
+
+// ---- arcs --------------------------------------------------------------------
+
+void vector_renderer::add_arc(const point2d& center, double radius_x, double radius_y,
+                              double start_angle, double extent_angle, bool fill)
+{
+    if (rectangle_off_screen({{center.x - radius_x, center.y - radius_y},
+                              {center.x + radius_x, center.y + radius_y}}))
+        return;
+
+    const QPointF pc = to_page(center);
+    const double  rx = std::abs(to_page({center.x + radius_x, center.y}).x() - pc.x());
+    const double  ry = std::abs(to_page({center.x, center.y + radius_y}).y() - pc.y());
+
+    // Angles are counter-clockwise in degrees; the page's y points down.
+    const double a0 = start_angle * std::numbers::pi / 180.0;
+    const double da = extent_angle * std::numbers::pi / 180.0;
+    const int    n  = std::clamp(int(std::ceil(std::abs(da) * std::max(rx, ry) / 2.0)), 4, 1024);
+    std::vector<QPointF> points;
+    points.reserve(std::size_t(n) + 2);
+    const bool pie = fill && std::abs(extent_angle) < 360.0;
+    if (pie)
+        points.push_back(pc);
+    for (int i = 0; i <= n; ++i) {
+        const double a = a0 + da * i / n;
+        points.emplace_back(pc.x() + rx * std::cos(a), pc.y() - ry * std::sin(a));
+    }
+
+    if (fill) {
+        begin_run(fill_style(), points.size());
+        add_ring(std::move(points), false);
+    } else {
+        begin_run(stroke_style(), points.size());
+        m_run.move_to(points[0]);
+        for (std::size_t i = 1; i < points.size(); ++i)
+            m_run.line_to(points[i]);
+    }
+}
+
+void vector_renderer::draw_elliptic_arc(const point2d& center, double radius_x, double radius_y,
+                                        double start_angle, double extent_angle)
+{
+    add_arc(center, radius_x, radius_y, start_angle, extent_angle, false);
+}
+
+void vector_renderer::draw_arc(const point2d& center, double radius,
+                               double start_angle, double extent_angle)
+{
+    add_arc(center, radius, radius, start_angle, extent_angle, false);
+}
+
+void vector_renderer::fill_elliptic_arc(const point2d& center, double radius_x, double radius_y,
+                                        double start_angle, double extent_angle)
+{
+    add_arc(center, radius_x, radius_y, start_angle, extent_angle, true);
+}
+
+void vector_renderer::fill_arc(const point2d& center, double radius,
+                               double start_angle, double extent_angle)
+{
+    add_arc(center, radius, radius, start_angle, extent_angle, true);
+}
+
+// ---- text and surfaces -------------------------------------------------------
+
+void vector_renderer::draw_text(const point2d& point, const std::string& text)
+{
+    add_text(point, text, DBL_MAX, DBL_MAX);
+}
+
+void vector_renderer::draw_text(const point2d& point, const std::string& text,
+                                double bound_x, double bound_y)
+{
+    add_text(point, text, bound_x, bound_y);
+}
+
+void vector_renderer::add_text(const point2d& point, const std::string& text,
+                               double bound_x, double bound_y)
+{
+    // Same fit test, culling and placement as irenderer::paint_text(); the
+    // bounds only decide whether the label is written, not a clip.
+    text_extents_t text_extents{0, 0, 0, 0, 0, 0};
+    m_painter->text_extents(text.c_str(), &text_extents);
+
+    const point2d world_scale = m_camera->get_world_scale_factor();
+    double scaled_width  = text_extents.width;
+    double scaled_height = text_extents.height;
+    if (current_coordinate_system == WORLD) {
+        scaled_width  *= world_scale.x;
+        scaled_height *= world_scale.y;
+    }
+
+    const bool   bounded_x = std::isfinite(bound_x) && bound_x < DBL_MAX;
+    const bool   bounded_y = std::isfinite(bound_y) && bound_y < DBL_MAX;
+    const double clip_w    = bounded_x ? bound_x : scaled_width;
+    const double clip_h    = bounded_y ? bound_y : scaled_height;
+    if ((bounded_x && scaled_width > bound_x) || (bounded_y && scaled_height > bound_y))
+        return;
+
+    point2d center = point;
+    if (horiz_justification == justification::left)        center.x += clip_w / 2.0;
+    else if (horiz_justification == justification::right)  center.x -= clip_w / 2.0;
+    if (vert_justification == justification::top)          center.y -= clip_h / 2.0;
+    else if (vert_justification == justification::bottom)  center.y += clip_h / 2.0;
+    if (rectangle_off_screen({{center.x - clip_w / 2.0, center.y - clip_h / 2.0}, clip_w, clip_h}))
+        return;
+
+    point2d draw_center = current_coordinate_system == WORLD ? m_transform(point) : point;
+    draw_center.x += text_screen_offset_px.x;
+    draw_center.y += text_screen_offset_px.y;
+    text_screen_offset_px = {0.0, 0.0};
+
+    const QString qtext = QString::fromStdString(text);
+    const QRectF  br = QFontMetricsF(m_painter->font()).boundingRect(qtext);
+    QPointF offset(-(br.x() + br.width() / 2.0), -(br.y() + br.height() / 2.0));
+    if (horiz_justification == justification::left)        offset.rx() += br.width() / 2.0;
+    else if (horiz_justification == justification::right)  offset.rx() -= br.width() / 2.0;
+    if (vert_justification == justification::top)          offset.ry() += br.height() / 2.0;
+    else if (vert_justification == justification::bottom)  offset.ry() -= br.height() / 2.0;
+
+    // The baseline origin, rotated about the anchor like the painter does.
+    const double  c = std::cos(rotation_angle);
+    const double  s = std::sin(rotation_angle);
+    const QPointF origin(draw_center.x + offset.x() * c - offset.y() * s,
+                         draw_center.y + offset.x() * s + offset.y() * c);
+
+    flush();
+    m_out.write_text(qtext, origin, rotation_angle * 180.0 / std::numbers::pi, m_painter->font(),
+                     QColor(current_color.red, current_color.green, current_color.blue, current_color.alpha));
+}
+
+void vector_renderer::draw_surface(surface* p_surface, const point2d& anchor_point, double scale_factor)
+{
+    if (p_surface == nullptr || p_surface->isNull()) {
+        q_warning("draw_surface: null/invalid surface at %p", (void*)p_surface);
+        return;
+    }
+
+    // Placement as in irenderer::paint_surface().
+    const double page_width  = double(p_surface->width()) * scale_factor;
+    const double page_height = double(p_surface->height()) * scale_factor;
+    double s_width  = page_width;
+    double s_height = page_height;
+    if (current_coordinate_system == WORLD) {
+        s_width  *= m_camera->get_world_scale_factor().x;
+        s_height *= m_camera->get_world_scale_factor().y;
+    }
+
+    point2d top_left = anchor_point;
+    if (horiz_justification == justification::center) top_left.x -= s_width / 2.0;
+    else if (horiz_justification == justification::right) top_left.x -= s_width;
+    if (vert_justification == justification::center)
+        top_left.y += (current_coordinate_system == WORLD) ?  s_height / 2.0 : -s_height / 2.0;
+    else if (vert_justification == justification::bottom)
+        top_left.y += (current_coordinate_system == WORLD) ?  s_height : -s_height;
+
+    if (rectangle_off_screen({{top_left.x, top_left.y - s_height}, s_width, s_height}))
+        return;
+
+    flush();
+    m_out.write_image(*p_surface, QRectF(to_page(top_left), QSizeF(page_width, page_height)));
+}
+
+} // namespace ezgl